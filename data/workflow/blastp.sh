@@ -9,6 +9,30 @@ notExists() {
 	[ ! -f "$1" ]
 }
 
+# with --remove-tmp-files intermediates are removed as soon as the last step reading them has finished
+# retain <db> <step>...: the listed steps still have to read <db>
+retain() {
+    if [ -n "$REMOVE_TMP" ] && [ -f "$1.dbtype" ] && notExists "$1.refs"; then
+        DB="$1"
+        shift
+        printf '%s\n' "$@" > "$DB.refs"
+    fi
+}
+
+# release <db> <step>: <step> has finished reading <db>, the last one removes it
+release() {
+    if [ -n "$REMOVE_TMP" ] && [ -f "$1.refs" ]; then
+        grep -vx "$2" "$1.refs" > "$1.refs.tmp" || true
+        if [ -s "$1.refs.tmp" ]; then
+            mv -f "$1.refs.tmp" "$1.refs"
+        else
+            rm -f "$1.refs.tmp" "$1.refs"
+            # shellcheck disable=SC2086
+            "$MMSEQS" rmdb "$1" ${VERBOSITY}
+        fi
+    fi
+}
+
 # check number of input variables
 [ "$#" -ne 4 ] && echo "Please provide <queryDB> <targetDB> <outDB> <tmp>" && exit 1;
 # check if files exist
@@ -25,37 +49,55 @@ STEP=0
 STEPS="${STEPS:-1}"
 ALN_RES_MERGE="$TMP_PATH/aln_0"
 while [ "$STEP" -lt "$STEPS" ]; do
+    # intermediates of finished steps might be removed already, do not repeat them
+    if [ -f "$TMP_PATH/step_$STEP.done" ]; then
+        if [ "$STEP" -gt 0 ]; then
+            ALN_RES_MERGE="$TMP_PATH/aln_merge"
+        fi
+        INPUT="$TMP_PATH/input_$STEP"
+        STEP="$((STEP+1))"
+        continue
+    fi
     SENS_PARAM=SENSE_${STEP}
     eval SENS="\$$SENS_PARAM"
+    ALN_RES="$TMP_PATH/aln_$STEP"
+    ALN_PAR="$ALIGNMENT_TMP_PAR"
+    if [ "$STEPS" -eq 1 ]; then
+        ALN_RES="$3"
+        ALN_PAR="$ALIGNMENT_PAR"
+    fi
+
     # call prefilter module
-    if notExists "$TMP_PATH/pref_$STEP.dbtype"; then
+    if notExists "$TMP_PATH/pref_$STEP.dbtype" && notExists "$ALN_RES.dbtype" && notExists "$TMP_PATH/aln_${STEP}.hasmerged"; then
         # shellcheck disable=SC2086
         $RUNNER "$MMSEQS" prefilter "$INPUT" "$TARGET" "$TMP_PATH/pref_$STEP" $PREFILTER_PAR -s "$SENS" \
             || fail "Prefilter died"
     fi
+    retain "$TMP_PATH/pref_$STEP" align
 
     # call alignment module
+    if notExists "$ALN_RES.dbtype" && notExists "$TMP_PATH/aln_${STEP}.hasmerged"; then
+        # shellcheck disable=SC2086
+        $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$ALN_RES" $ALN_PAR  \
+            || fail "Alignment died"
+    fi
+    release "$TMP_PATH/pref_$STEP" align
     if [ "$STEPS" -eq 1 ]; then
-        if notExists "$3.dbtype"; then
-            # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$3" $ALIGNMENT_PAR  \
-                || fail "Alignment died"
-        fi
         break
+    fi
+    # the last step has no order step, the first one is merged in the next step
+    if [ "$STEP" -lt "$((STEPS-1))" ]; then
+        retain "$ALN_RES" order merge
     else
-        if notExists "$TMP_PATH/aln_$STEP.dbtype"; then
-            # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$TMP_PATH/aln_$STEP" $ALIGNMENT_PAR  \
-                || fail "Alignment died"
-        fi
+        retain "$ALN_RES" merge
     fi
 
     # only merge results after first step
     if [ "$STEP" -gt 0 ]; then
-        if notExists "$TMP_PATH/aln_${SENS}.hasmerged"; then
+        if notExists "$TMP_PATH/aln_${STEP}.hasmerged"; then
             if [ "$STEP" -lt $((STEPS-1)) ]; then
                 # shellcheck disable=SC2086
-                "$MMSEQS" mergedbs "$1" "$TMP_PATH/aln_merge_new" "$ALN_RES_MERGE" "$TMP_PATH/aln_$STEP" ${VERB_COMP_PAR} \
+                "$MMSEQS" mergedbs "$1" "$TMP_PATH/aln_merge_new" "$ALN_RES_MERGE" "$TMP_PATH/aln_$STEP" ${VERB_COMP_TMP_PAR} \
                     || fail "Mergedbs died"
                 # shellcheck disable=SC2086
                 "$MMSEQS" rmdb "$TMP_PATH/aln_merge" ${VERBOSITY}
@@ -69,6 +111,8 @@ while [ "$STEP" -lt "$STEPS" ]; do
             fi
             touch "$TMP_PATH/aln_${STEP}.hasmerged"
         fi
+        release "$ALN_RES_MERGE" merge
+        release "$ALN_RES" merge
     fi
     if [ "$STEP" -gt 0 ]; then
       ALN_RES_MERGE="$TMP_PATH/aln_merge"
@@ -77,14 +121,23 @@ while [ "$STEP" -lt "$STEPS" ]; do
     NEXTINPUT="$TMP_PATH/input_$STEP"
     #do not create subdb at last step
     if [ "$STEP" -lt "$((STEPS-1))" ]; then
-        if notExists "$TMP_PATH/order_$STEP.dbtype"; then
-            awk '$3 < 2 { print $1 }' "$TMP_PATH/aln_$STEP.index" > "$TMP_PATH/order_$STEP" \
+        if notExists "$TMP_PATH/order_$STEP"; then
+            awk '$3 < 2 { print $1 }' "$TMP_PATH/aln_$STEP.index" > "$TMP_PATH/order_$STEP.tmp" \
                 || fail "Awk step $STEP died"
+            mv -f "$TMP_PATH/order_$STEP.tmp" "$TMP_PATH/order_$STEP"
         fi
+        release "$TMP_PATH/aln_$STEP" order
 
         if [ ! -s "$TMP_PATH/order_$STEP" ]; then
-            # shellcheck disable=SC2086
-            "$MMSEQS" mvdb "$ALN_RES_MERGE" "$3" ${VERBOSITY}
+            # intermediates might be compressed, the result only if requested
+            if [ -n "$TMP_COMPRESSED" ]; then
+                # shellcheck disable=SC2086
+                "$MMSEQS" decompress "$ALN_RES_MERGE" "$3" ${THREADS_PAR} \
+                    || fail "Decompress died"
+            else
+                # shellcheck disable=SC2086
+                "$MMSEQS" mvdb "$ALN_RES_MERGE" "$3" ${VERBOSITY}
+            fi
             break
         fi
 
@@ -94,6 +147,7 @@ while [ "$STEP" -lt "$STEPS" ]; do
                 || fail "Order step $STEP died"
         fi
     fi
+    touch "$TMP_PATH/step_$STEP.done"
     INPUT="$NEXTINPUT"
     STEP="$((STEP+1))"
 done
@@ -107,7 +161,8 @@ if [ -n "$REMOVE_TMP" ]; then
         "$MMSEQS" rmdb "${TMP_PATH}/aln_$STEP" ${VERBOSITY}
         # shellcheck disable=SC2086
         "$MMSEQS" rmdb "${TMP_PATH}/input_$STEP" ${VERBOSITY}
-        rm -f "${TMP_PATH}/order_$STEP"
+        rm -f "${TMP_PATH}/order_$STEP" "${TMP_PATH}/step_$STEP.done" "${TMP_PATH}/aln_$STEP.hasmerged"
+        rm -f "${TMP_PATH}/pref_$STEP.refs" "${TMP_PATH}/aln_$STEP.refs"
         STEP="$((STEP+1))"
     done
     # shellcheck disable=SC2086
@@ -22,6 +22,30 @@ abspath() {
     fi
 }
 
+# with --remove-tmp-files intermediates are removed as soon as the last step reading them has finished
+# retain <db> <step>...: the listed steps still have to read <db>
+retain() {
+    if [ -n "$REMOVE_TMP" ] && [ -f "$1.dbtype" ] && notExists "$1.refs"; then
+        DB="$1"
+        shift
+        printf '%s\n' "$@" > "$DB.refs"
+    fi
+}
+
+# release <db> <step>: <step> has finished reading <db>, the last one removes it
+release() {
+    if [ -n "$REMOVE_TMP" ] && [ -f "$1.refs" ]; then
+        grep -vx "$2" "$1.refs" > "$1.refs.tmp" || true
+        if [ -s "$1.refs.tmp" ]; then
+            mv -f "$1.refs.tmp" "$1.refs"
+        else
+            rm -f "$1.refs.tmp" "$1.refs"
+            # shellcheck disable=SC2086
+            "$MMSEQS" rmdb "$1" ${VERBOSITY}
+        fi
+    fi
+}
+
 
 # check number of input variables
 [ "$#" -ne 3 ] && echo "Please provide <sequenceDB> <outDB> <tmp>" && exit 1;
@@ -54,18 +78,21 @@ CLUSTER_STR=""
 while [ "$STEP" -lt "$STEPS" ]; do
     PARAM=PREFILTER${STEP}_PAR
     eval TMP="\$$PARAM"
-    if notExists "${TMP_PATH}/pref_step$STEP.dbtype"; then
+    if notExists "${TMP_PATH}/pref_step$STEP.dbtype" && notExists "${TMP_PATH}/aln_step$STEP.dbtype" && notExists "${TMP_PATH}/clu_step$STEP.dbtype"; then
          # shellcheck disable=SC2086
         $RUNNER "$MMSEQS" prefilter "$INPUT" "$INPUT" "${TMP_PATH}/pref_step$STEP" ${TMP} \
             || fail "Prefilter step $STEP died"
     fi
+    retain "${TMP_PATH}/pref_step$STEP" align
     PARAM=ALIGNMENT${STEP}_PAR
     eval TMP="\$$PARAM"
-    if notExists "${TMP_PATH}/aln_step$STEP.dbtype"; then
+    if notExists "${TMP_PATH}/aln_step$STEP.dbtype" && notExists "${TMP_PATH}/clu_step$STEP.dbtype"; then
          # shellcheck disable=SC2086
         $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$INPUT" "${TMP_PATH}/pref_step$STEP" "${TMP_PATH}/aln_step$STEP" ${TMP} \
             || fail "Alignment step $STEP died"
     fi
+    release "${TMP_PATH}/pref_step$STEP" align
+    retain "${TMP_PATH}/aln_step$STEP" clust
     PARAM=CLUSTER${STEP}_PAR
     eval TMP="\$$PARAM"
     if notExists "${TMP_PATH}/clu_step$STEP.dbtype"; then
@@ -73,6 +100,7 @@ while [ "$STEP" -lt "$STEPS" ]; do
         "$MMSEQS" clust "$INPUT" "${TMP_PATH}/aln_step$STEP" "${TMP_PATH}/clu_step$STEP" ${TMP} \
             || fail "Clustering step $STEP died"
     fi
+    release "${TMP_PATH}/aln_step$STEP" clust
 
     # FIXME: This won't work if paths contain spaces
     CLUSTER_STR="${CLUSTER_STR} ${TMP_PATH}/clu_step$STEP"
@@ -267,6 +295,7 @@ if [ -n "$REMOVE_TMP" ]; then
         "$MMSEQS" rmdb "${TMP_PATH}/aln_step$STEP" ${VERBOSITY}
         # shellcheck disable=SC2086
         "$MMSEQS" rmdb "${TMP_PATH}/clu_step$STEP" ${VERBOSITY}
+        rm -f "${TMP_PATH}/pref_step$STEP.refs" "${TMP_PATH}/aln_step$STEP.refs"
         STEP=$((STEP+1))
     done
 
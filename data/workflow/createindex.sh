@@ -49,6 +49,29 @@ elif [ -n "$LIN_NUCL" ] || [ -n "$NUCL" ]; then
         "$MMSEQS" rmdb "$2/nucl_split_seq" ${VERBOSITY}
         rm -f "$2/createindex.sh"
     fi
+elif [ -n "$REORDER" ]; then
+    # 1. store similar sequences next to each other, the index embeds the reordered sequences
+    if notExists "$2/reordered.dbtype"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" reorderdb "$INPUT" "$2/reordered" ${REORDER_PAR} \
+            || fail "reorderdb died"
+    fi
+
+    # shellcheck disable=SC2086
+    "$MMSEQS" $INDEXER "$2/reordered" "$2/reordered" ${INDEX_PAR} \
+        || fail "indexdb died"
+
+    # shellcheck disable=SC2086
+    "$MMSEQS" mvdb "$2/reordered.idx" "$INPUT.idx" ${VERBOSITY} \
+        || fail "mvdb died"
+
+    if [ -n "$REMOVE_TMP" ]; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" rmdb "$2/reordered" ${VERBOSITY}
+        # shellcheck disable=SC2086
+        "$MMSEQS" rmdb "$2/reordered_h" ${VERBOSITY}
+        rm -f "$2/createindex.sh"
+    fi
 else
     # shellcheck disable=SC2086
     "$MMSEQS" $INDEXER "$INPUT" "$INPUT" ${INDEX_PAR} \
@@ -24,7 +24,7 @@ if notExists "${TMP_PATH}/pref.dbtype"; then
     $RUNNER "$MMSEQS" kmermatcher "$INPUT" "${TMP_PATH}/pref" ${KMERMATCHER_PAR} \
         || fail "kmermatcher died"
 fi
-# 2. Hamming distance pre-clustering
+# 2. Hamming distance pre-clustering (usually already done by kmermatcher)
 if notExists "${TMP_PATH}/pref_rescore1.dbtype"; then
     # shellcheck disable=SC2086
     $RUNNER "$MMSEQS" rescorediagonal "$INPUT" "$INPUT" "${TMP_PATH}/pref" "${TMP_PATH}/pref_rescore1" ${HAMMING_PAR} \
@@ -1,4 +1,9 @@
 #!/bin/sh -e
+fail() {
+    echo "Error: $1"
+    exit 1
+}
+
 [ -z "$MMSEQS" ] && echo "Please set the environment variable \$MMSEQS to your MMSEQS binary." && exit 1;
 [ "$#" -ne 4 ] && echo "Please provide <queryDB> <targetDB> <outDB> <tmp>" && exit 1;
 [ ! -f "$1.dbtype" ] && echo "$1.dbtype not found!" && exit 1;
@@ -6,5 +11,12 @@
 [   -f "$3.dbtype" ] && echo "$3.dbtype exists already!" && exit 1;
 [ ! -d "$4" ] && echo "tmp directory $4 not found!" && mkdir -p "$4";
 
-# shellcheck disable=SC2086
-"$MMSEQS" search "$1" "$2" "$3" "$4" ${SEARCH_PAR}
+if [ -n "$SEED_MAPPING" ]; then
+    # shellcheck disable=SC2086
+    "$MMSEQS" kmermap "$1" "$2" "$3" ${KMERMAP_PAR} \
+        || fail "kmermap died"
+else
+    # shellcheck disable=SC2086
+    "$MMSEQS" search "$1" "$2" "$3" "$4" ${SEARCH_PAR} \
+        || fail "search died"
+fi
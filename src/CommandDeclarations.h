@@ -16,6 +16,7 @@ extern int clusthash(int argc, const char **argv, const Command& command);
 extern int combinepvalperset(int argc, const char **argv, const Command &command);
 extern int compress(int argc, const char **argv, const Command &command);
 extern int concatdbs(int argc, const char **argv, const Command& command);
+extern int federatedbs(int argc, const char **argv, const Command& command);
 extern int convert2fasta(int argc, const char **argv, const Command& command);
 extern int convertalignments(int argc, const char **argv, const Command& command);
 extern int convertca3m(int argc, const char **argv, const Command& command);
@@ -60,6 +61,7 @@ extern int masksequence(int argc, const char **argv, const Command& command);
 extern int indexdb(int argc, const char **argv, const Command& command);
 extern int kmermatcher(int argc, const char **argv, const Command &command);
 extern int kmersearch(int argc, const char **argv, const Command &command);
+extern int kmermap(int argc, const char **argv, const Command &command);
 extern int kmerindexdb(int argc, const char **argv, const Command &command);
 extern int lca(int argc, const char **argv, const Command& command);
 extern int lcaalign(int argc, const char **argv, const Command& command);
@@ -67,6 +69,7 @@ extern int taxonomyreport(int argc, const char **argv, const Command& command);
 extern int linclust(int argc, const char **argv, const Command& command);
 extern int map(int argc, const char **argv, const Command& command);
 extern int renamedbkeys(int argc, const char **argv, const Command& command);
+extern int reorderdb(int argc, const char **argv, const Command& command);
 extern int majoritylca(int argc, const char **argv, const Command& command);
 extern int maskbygff(int argc, const char **argv, const Command& command);
 extern int mergeclusters(int argc, const char **argv, const Command& command);
@@ -591,6 +591,15 @@ std::vector<Command> baseCommands = {
                 CITATION_MMSEQS2, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                          {"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::indexDb },
                                          {"prefilterDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::prefilterDb }}},
+        {"kmermap",              kmermap,              &par.kmermap,              COMMAND_PREFILTER,
+                "Map near-identical sequences by exact minimizer seeds with ungapped-first extension",
+                "# Map proteins at high identity, the result has the same format as search\n"
+                "mmseqs kmermap queryDB targetDB alnDB --min-seq-id 0.9 -c 0.95 --cov-mode 2\n",
+                "Martin Steinegger <martin.steinegger@snu.ac.kr>",
+                "<i:queryDB> <i:targetDB> <o:alignmentDB>",
+                CITATION_MMSEQS2, {{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                          {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                          {"alignmentDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::alignmentDb }}},
         {"kmerindexdb",          kmerindexdb,          &par.kmerindexdb,          COMMAND_HIDDEN,
                 "Create bottom-m-hashed k-mer index",
                 NULL,
@@ -674,7 +683,7 @@ std::vector<Command> baseCommands = {
 
 
 
-        {"compress",             compress,             &par.onlythreads,          COMMAND_STORAGE,
+        {"compress",             compress,             &par.compressdb,           COMMAND_STORAGE,
                 "Compress DB entries",
                 NULL,
                 "Milot Mirdita <milot@mirdita.de>",
@@ -749,6 +758,17 @@ std::vector<Command> baseCommands = {
                 CITATION_MMSEQS2, {{"subsetFile", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDbAndFlat },
                                           {"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDb },
                                           {"DB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::allDb }}},
+        {"reorderdb",            reorderdb,            &par.reorderdb,            COMMAND_STORAGE,
+                "Change the physical order of a sequence DB to improve locality, keys stay the same",
+                "# Store sequences with similar k-mer signatures next to each other\n"
+                "mmseqs reorderdb sequenceDB reorderedDB\n\n"
+                "# Store the members of each cluster next to each other\n"
+                "mmseqs cluster sequenceDB clusterDB tmp\n"
+                "mmseqs reorderdb sequenceDB reorderedDB --reorder-mode 2 --cluster-db clusterDB\n",
+                "Milot Mirdita <milot@mirdita.de>",
+                "<i:sequenceDB> <o:sequenceDB>",
+                CITATION_MMSEQS2, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                          {"sequenceDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}},
         {"concatdbs",            concatdbs,            &par.concatdbs,            COMMAND_SET,
                 "Concatenate two DBs, giving new IDs to entries from 2nd DB",
 //                "If exist, the auxillary files: _mapping, source and lookup are also concatenated after IDs update of the 2nd DB",
@@ -763,6 +783,18 @@ std::vector<Command> baseCommands = {
                 CITATION_MMSEQS2, {{"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDb },
                                           {"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDb },
                                           {"DB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::allDb }}},
+        {"federatedbs",          federatedbs,          &par.federatedbs,          COMMAND_SET,
+                "Combine DBs into one federated DB that is read like their concatenation without copying them",
+                "# Search a DB that grows every day without concatenating it\n"
+                "mmseqs federatedbs day1DB day2DB federatedDB\n"
+                "# Append a new DB later, members with a precomputed index are searched with it\n"
+                "mmseqs createindex day3DB tmp\n"
+                "mmseqs federatedbs federatedDB day3DB federatedDB\n"
+                "mmseqs search queryDB federatedDB resultDB tmp\n",
+                "Milot Mirdita <milot@mirdita.de>",
+                "<i:DB1> ... <i:DBn> <o:DB>",
+                CITATION_MMSEQS2, {{"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA | DbType::VARIADIC, &DbValidator::allDb },
+                                          {"DB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::allDb }}},
         {"splitdb",              splitdb,              &par.splitdb,              COMMAND_SET,
                 "Split DB into subsets",
                 NULL,
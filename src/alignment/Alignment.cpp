@@ -11,7 +11,9 @@
 #include "FileUtil.h"
 #include "Parameters.h"
 #include "FastSort.h"
+#include "QueryScheduler.h"
 #include "Sequence.h"
+#include "ResumableChunks.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -22,7 +24,7 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
                      const std::string &outDB, const std::string &outDBIndex, const Parameters &par, const bool lcaAlign) :
         covThr(par.covThr), canCovThr(par.covThr), covMode(par.covMode), seqIdMode(par.seqIdMode), evalThr(par.evalThr), seqIdThr(par.seqIdThr),
         alnLenThr(par.alnLenThr), includeIdentity(par.includeIdentity), addBacktrace(par.addBacktrace), realign(par.realign), scoreBias(par.scoreBias), realignScoreBias(par.realignScoreBias), realignMaxSeqs(par.realignMaxSeqs),
-        threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed), outDB(outDB), outDBIndex(outDBIndex),
+        threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed), checkpointChunks(par.checkpointChunks), outDB(outDB), outDBIndex(outDBIndex),
         maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), compBiasCorrectionScale(par.compBiasCorrectionScale), altAlignment(par.altAlignment), alignmentOutputMode(par.alignmentOutputMode),
         maxAccept(static_cast<unsigned int>(par.maxAccept)), maxReject(static_cast<unsigned int>(par.maxRejected)), wrappedScoring(par.wrappedScoring),
         lcaAlign(lcaAlign), qdbr(NULL), qDbrIdx(NULL), tdbr(NULL), tDbrIdx(NULL) {
@@ -138,6 +140,10 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
 
     prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
     prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    targetDuplicates = new EntryDuplicates(*tdbr, EntryDuplicates::isDeduplicated(tdbr->getDbtype()));
+    queryDuplicates = (sameQTDB == true) ? targetDuplicates : new EntryDuplicates(*qdbr, EntryDuplicates::isDeduplicated(qdbr->getDbtype()));
+    // the prefilter shares the result entries of identical queries, which only exist in a deduplicated query DB
+    prefDuplicates = new EntryDuplicates(*prefdbr, EntryDuplicates::isDeduplicated(qdbr->getDbtype()));
     reversePrefilterResult = Parameters::isEqualDbtype(prefdbr->getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES);
 
     correlationScoreWeight = par.correlationScoreWeight;
@@ -212,6 +218,12 @@ Alignment::~Alignment() {
         }
     }
 
+    if (queryDuplicates != targetDuplicates) {
+        delete queryDuplicates;
+    }
+    delete targetDuplicates;
+    delete prefDuplicates;
+
     prefdbr->close();
     delete prefdbr;
 }
@@ -241,8 +253,29 @@ void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc) {
     }
 }
 
-void Alignment::run() {
-    run(outDB, outDBIndex, 0, prefdbr->getSize(), false);
+void Alignment::run(size_t checkpointFingerprint) {
+    const size_t chunks = std::min(static_cast<size_t>(checkpointChunks), prefdbr->getSize());
+    if (chunks <= 1) {
+        run(outDB, outDBIndex, 0, prefdbr->getSize(), false);
+        return;
+    }
+
+    ResumableChunks checkpoint(outDB, outDBIndex, chunks, checkpointFingerprint);
+    for (size_t i = 0; i < chunks; ++i) {
+        if (checkpoint.isDone(i)) {
+            Debug(Debug::INFO) << "Skip chunk " << (i + 1) << " of " << chunks << ", it was committed by an earlier run\n";
+            continue;
+        }
+        size_t dbFrom = 0;
+        size_t dbSize = 0;
+        prefdbr->decomposeDomainByAminoAcid(i, chunks, &dbFrom, &dbSize);
+        Debug(Debug::INFO) << "Compute chunk " << (i + 1) << " of " << chunks << " from " << dbFrom << " to " << (dbFrom + dbSize) << "\n";
+        std::pair<std::string, std::string> chunkDb = checkpoint.getChunkDb(i);
+        run(chunkDb.first, chunkDb.second, dbFrom, dbSize, true);
+        checkpoint.commit(i, true);
+    }
+    DBWriter::mergeResults(outDB, outDBIndex, checkpoint.startMerge());
+    checkpoint.finish();
 }
 
 void Alignment::run(const std::string &outDB, const std::string &outDBIndex, const size_t dbFrom, const size_t dbSize, bool merge) {
@@ -269,6 +302,10 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
     }
     size_t iterations = static_cast<size_t>(ceil(static_cast<double>(dbSize) / static_cast<double>(flushSize)));
 
+    // a query that shares its sequence and its prefilter list with an earlier query gets its results when those are written
+    // the prefilter only writes shared lists if the keys are not part of the results
+    const bool fanOutQueries = prefDuplicates->getDuplicateCount() > 0 && sameQTDB == false && includeIdentity == false;
+
     size_t alignmentsNum = 0;
     size_t totalPassedNum = 0;
     for (size_t i = 0; i < iterations; i++) {
@@ -276,6 +313,28 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
         size_t bucketSize = std::min(dbSize - (i * flushSize), flushSize);
         Debug::Progress progress(bucketSize);
 
+        std::vector<char> fannedOut(fanOutQueries ? bucketSize : 0, 0);
+        for (size_t id = start; fanOutQueries && id < (start + bucketSize); id++) {
+            const size_t rep = prefDuplicates->getRepresentative(id);
+            if (rep == id || rep < start || rep >= start + bucketSize) {
+                continue;
+            }
+            const size_t qId = qdbr->getId(prefdbr->getDbKey(id));
+            const size_t qRepId = qdbr->getId(prefdbr->getDbKey(rep));
+            fannedOut[id - start] = (qId != UINT_MAX && qRepId != UINT_MAX
+                                     && queryDuplicates->getRepresentative(qId) == queryDuplicates->getRepresentative(qRepId));
+        }
+
+        // longest first by query length x prefilter list length, expensive queries are split across threads
+        QueryScheduler scheduler(start, bucketSize, threads);
+        for (size_t id = start; id < (start + bucketSize); id++) {
+            scheduler.setCost(id, (fanOutQueries && fannedOut[id - start]) ? 0 : estimateAlignmentCost(id));
+        }
+        scheduler.sortByCost();
+        const size_t splitCost = (threads > 1) ? std::max(scheduler.getTotalCost() / (2 * threads), (size_t) 1) : SIZE_MAX;
+        std::vector<AlignmentThreadContext> contexts(threads);
+        scheduler.start();
+
 #pragma omp parallel num_threads(threads)
         {
             unsigned int thread_idx = 0;
@@ -307,86 +366,104 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
             std::string queryToWrap;
             queryToWrap.reserve(maxSeqLen * 2);
 
+            // tasks of a split query run on whichever thread picks them up and use that thread's context
+            AlignmentThreadContext &context = contexts[thread_idx];
+            context.qSeq = &qSeq;
+            context.dbSeq = &dbSeq;
+            context.matcher = &matcher;
+            context.queryToWrap = &queryToWrap;
+            std::vector<AlignmentHit> splitHits;
+            std::vector<SplitHitResult> splitResults;
+
             const char* words[10];
 
-#pragma omp for schedule(dynamic, 5) reduction(+: alignmentsNum, totalPassedNum)
-            for (size_t id = start; id < (start + bucketSize); id++) {
+#pragma omp for schedule(dynamic, 1) reduction(+: alignmentsNum, totalPassedNum)
+            for (size_t queryIdx = 0; queryIdx < bucketSize; queryIdx++) {
+                size_t id = scheduler.getId(queryIdx);
                 progress.updateProgress();
+                if (fanOutQueries && fannedOut[id - start]) {
+                    continue;
+                }
 
                 // get the prefiltering list
                 char *data, *origData;
                 data = origData = prefdbr->getData(id, thread_idx);
                 unsigned int queryDbKey = prefdbr->getDbKey(id);
                 size_t origQueryLen = 0;
+                size_t qId = SIZE_MAX;
                 // only load query data if data != \0
                 if (*data != '\0') {
-                    size_t qId = qdbr->getId(queryDbKey);
-                    char *querySeqData = qdbr->getData(qId, thread_idx);
-                    if (querySeqData == NULL) {
-                        Debug(Debug::ERROR) << "Query sequence " << queryDbKey
-                                            << " is required in the prefiltering, but is not contained in the query sequence database.\nPlease check your database.\n";
-                        EXIT(EXIT_FAILURE);
-                    }
-                    size_t queryLen = qdbr->getSeqLen(qId);
-                    origQueryLen = queryLen;
-                    if (wrappedScoring) {
-                        queryToWrap = std::string(querySeqData, queryLen);
-                        queryToWrap = queryToWrap + queryToWrap;
-                        querySeqData = (char*)(queryToWrap).c_str();
-                        queryLen = origQueryLen*2;
-                    }
-
-                    qSeq.mapSequence(qId, queryDbKey, querySeqData, queryLen);
-                    matcher.initQuery(&qSeq);
+                    qId = qdbr->getId(queryDbKey);
+                    origQueryLen = initQuery(context, qId, queryDbKey, thread_idx);
                 }
 
                 // parse the prefiltering list and calculate a Smith-Waterman alignment for each sequence in the list
                 size_t passedNum = 0;
                 unsigned int rejected = 0;
-                while (*data != '\0' && passedNum < maxAccept && rejected < maxReject) {
-                    Util::parseKey(data, buffer);
-                    const unsigned int dbKey = (unsigned int) strtoul(buffer, NULL, 10);
-                    size_t elements = Util::getWordsOfLine(data, words, 10);
-
-                    short diagonal = 0;
-                    bool isReverse = false;
-                    // Prefilter result (need to make this better)
-                    if (elements == 3) {
-                        hit_t hit = QueryMatcher::parsePrefilterHit(data);
-                        isReverse = reversePrefilterResult && (hit.prefScore < 0);
-                        diagonal = static_cast<short>(hit.diagonal);
+                if (scheduler.getCost(id) >= splitCost) {
+                    // align the hits in waves of tasks that idle threads can steal, then accept them in list order
+                    // exactly like below, so that the results do not depend on how the list was split
+                    splitHits.clear();
+                    while (*data != '\0') {
+                        splitHits.emplace_back();
+                        data = parseHit(data, splitHits.back(), buffer, words);
                     }
-                    data = Util::skipLine(data);
-
-                    size_t dbId = tdbr->getId(dbKey);
-                    char *dbSeqData = tdbr->getData(dbId, thread_idx);
-                    if (dbSeqData == NULL) {
-                        Debug(Debug::ERROR) << "Sequence " << dbKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
-                        EXIT(EXIT_FAILURE);
+                    splitResults.resize(splitHits.size());
+                    const size_t waveSize = SPLIT_HITS_PER_TASK * 4 * threads;
+                    size_t hitIdx = 0;
+                    while (hitIdx < splitHits.size() && passedNum < maxAccept && rejected < maxReject) {
+                        const size_t waveEnd = std::min(splitHits.size(), hitIdx + waveSize);
+                        for (size_t taskStart = hitIdx; taskStart < waveEnd; taskStart += SPLIT_HITS_PER_TASK) {
+#pragma omp task default(shared) firstprivate(taskStart)
+                            {
+                                unsigned int taskThread = 0;
+#ifdef OPENMP
+                                taskThread = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+                                AlignmentThreadContext &taskContext = contexts[taskThread];
+                                initQuery(taskContext, qId, queryDbKey, taskThread);
+                                const size_t taskEnd = std::min(waveEnd, taskStart + SPLIT_HITS_PER_TASK);
+                                for (size_t hit = taskStart; hit < taskEnd; hit++) {
+                                    SplitHitResult &splitResult = splitResults[hit];
+                                    splitResult.aligned = alignHitOnce(taskContext, splitHits[hit], queryDbKey,
+                                                                       origQueryLen, taskThread, splitResult.res, splitResult.accepted);
+                                }
+                                scheduler.markBusy(taskThread);
+                            }
+                        }
+#pragma omp taskwait
+                        for (; hitIdx < waveEnd && passedNum < maxAccept && rejected < maxReject; hitIdx++) {
+                            if (splitResults[hitIdx].aligned == false) {
+                                rejected++;
+                                continue;
+                            }
+                            alignmentsNum++;
+                            if (splitResults[hitIdx].accepted) {
+                                swResults.emplace_back(splitResults[hitIdx].res);
+                                passedNum++;
+                                totalPassedNum++;
+                                rejected = 0;
+                            } else {
+                                rejected++;
+                            }
+                        }
                     }
-                    dbSeq.mapSequence(dbId, dbKey, dbSeqData, tdbr->getSeqLen(dbId));
+                    // this thread might have run tasks of another query in the meantime
+                    initQuery(context, qId, queryDbKey, thread_idx);
+                }
+                while (*data != '\0' && passedNum < maxAccept && rejected < maxReject) {
+                    AlignmentHit hit;
+                    data = parseHit(data, hit, buffer, words);
 
-                    // check if the sequences could pass the coverage threshold
-                    if (Util::canBeCovered(canCovThr, covMode, static_cast<float>(origQueryLen), static_cast<float>(dbSeq.L)) == false) {
+                    Matcher::result_t res;
+                    bool accepted = false;
+                    if (alignHitOnce(context, hit, queryDbKey, origQueryLen, thread_idx, res, accepted) == false) {
                         rejected++;
                         continue;
                     }
-
-                    const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
-
-                    // calculate Smith-Waterman alignment
-
-                    Matcher::result_t res = matcher.getSWResult(&dbSeq, static_cast<int>(diagonal), isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring);
                     alignmentsNum++;
 
-                    if (isIdentity) {
-                        // set coverage and seqid of identity
-                        res.qcov = 1.0f;
-                        res.dbcov = 1.0f;
-                        res.seqId = 1.0f;
-                    }
-
-                    if (checkCriteria(res, isIdentity, evalThr, seqIdThr, alnLenThr, covMode, covThr)) {
+                    if (accepted) {
                         swResults.emplace_back(res);
                         passedNum++;
                         totalPassedNum++;
@@ -452,6 +529,7 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                     }
                     qSeq.mapSequence(dbId, topHitKey, qSeqData + topHit.dbStartPos, topHit.dbEndPos - topHit.dbStartPos + 1);
                     realigner->initQuery(&qSeq);
+                    context.queryId = SIZE_MAX;
 
                     const double topHitEval = topHit.eval;
                     swRealignResults.clear();
@@ -509,8 +587,15 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                 }
                 dbw.writeData(alnResultsOutString.c_str(), alnResultsOutString.length(), queryDbKey, thread_idx);
                 alnResultsOutString.clear();
+                const bool isRepresentative = fanOutQueries && prefDuplicates->isDuplicate(id) == false;
+                for (unsigned int dupId = isRepresentative ? prefDuplicates->getNext(id) : UINT_MAX; dupId != UINT_MAX; dupId = prefDuplicates->getNext(dupId)) {
+                    if (dupId >= start && dupId < start + bucketSize && fannedOut[dupId - start]) {
+                        dbw.writeDuplicateEntry(prefdbr->getDbKey(dupId), thread_idx);
+                    }
+                }
                 swResults.clear();
                 swRealignResults.clear();
+                scheduler.markBusy(thread_idx);
             }
             if (realigner != NULL && realigner != &matcher) {
                 delete realigner;
@@ -524,6 +609,7 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
 #pragma omp barrier
             }
         }
+        scheduler.printTailUtilization();
     }
     dbw.close(merge);
 
@@ -541,6 +627,123 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
     }
 }
 
+size_t Alignment::estimateAlignmentCost(size_t id) const {
+    // the list is not parsed, its length in bytes stands in for the number of hits
+    const size_t listLen = prefdbr->getEntryLen(id);
+    if (listLen <= 1) {
+        return 0;
+    }
+    size_t qId = qdbr->getId(prefdbr->getDbKey(id));
+    if (qId == UINT_MAX) {
+        return 0;
+    }
+    const size_t queryLen = qdbr->getSeqLen(qId) * (wrappedScoring ? 2 : 1);
+    return queryLen * listLen;
+}
+
+size_t Alignment::initQuery(AlignmentThreadContext &context, size_t qId, unsigned int queryDbKey, unsigned int thread_idx) {
+    if (context.queryId == qId) {
+        return qdbr->getSeqLen(qId);
+    }
+    char *querySeqData = qdbr->getData(qId, thread_idx);
+    if (querySeqData == NULL) {
+        Debug(Debug::ERROR) << "Query sequence " << queryDbKey
+                            << " is required in the prefiltering, but is not contained in the query sequence database.\nPlease check your database.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t queryLen = qdbr->getSeqLen(qId);
+    const size_t origQueryLen = queryLen;
+    if (wrappedScoring) {
+        *context.queryToWrap = std::string(querySeqData, queryLen);
+        *context.queryToWrap = *context.queryToWrap + *context.queryToWrap;
+        querySeqData = (char*)(*context.queryToWrap).c_str();
+        queryLen = origQueryLen*2;
+    }
+
+    context.qSeq->mapSequence(qId, queryDbKey, querySeqData, queryLen);
+    context.matcher->initQuery(context.qSeq);
+    context.queryId = qId;
+    return origQueryLen;
+}
+
+char *Alignment::parseHit(char *data, AlignmentHit &hit, char *buffer, const char **words) const {
+    Util::parseKey(data, buffer);
+    hit.dbKey = (unsigned int) strtoul(buffer, NULL, 10);
+    size_t elements = Util::getWordsOfLine(data, words, 10);
+
+    hit.diagonal = 0;
+    hit.isReverse = false;
+    // Prefilter result (need to make this better)
+    if (elements == 3) {
+        hit_t prefHit = QueryMatcher::parsePrefilterHit(data);
+        hit.isReverse = reversePrefilterResult && (prefHit.prefScore < 0);
+        hit.diagonal = static_cast<short>(prefHit.diagonal);
+    }
+    return Util::skipLine(data);
+}
+
+bool Alignment::alignHit(Matcher &matcher, Sequence &dbSeq, const AlignmentHit &hit, unsigned int queryDbKey,
+                         size_t origQueryLen, unsigned int thread_idx, Matcher::result_t &res, bool &accepted) {
+    size_t dbId = tdbr->getId(hit.dbKey);
+    char *dbSeqData = tdbr->getData(dbId, thread_idx);
+    if (dbSeqData == NULL) {
+        Debug(Debug::ERROR) << "Sequence " << hit.dbKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    dbSeq.mapSequence(dbId, hit.dbKey, dbSeqData, tdbr->getSeqLen(dbId));
+
+    // check if the sequences could pass the coverage threshold
+    if (Util::canBeCovered(canCovThr, covMode, static_cast<float>(origQueryLen), static_cast<float>(dbSeq.L)) == false) {
+        return false;
+    }
+
+    const bool isIdentity = (queryDbKey == hit.dbKey && (includeIdentity || sameQTDB)) ? true : false;
+
+    // calculate Smith-Waterman alignment
+    res = matcher.getSWResult(&dbSeq, static_cast<int>(hit.diagonal), hit.isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring);
+
+    if (isIdentity) {
+        // set coverage and seqid of identity
+        res.qcov = 1.0f;
+        res.dbcov = 1.0f;
+        res.seqId = 1.0f;
+    }
+    accepted = checkCriteria(res, isIdentity, evalThr, seqIdThr, alnLenThr, covMode, covThr);
+    return true;
+}
+
+bool Alignment::alignHitOnce(AlignmentThreadContext &context, const AlignmentHit &hit, unsigned int queryDbKey,
+                             size_t origQueryLen, unsigned int thread_idx, Matcher::result_t &res, bool &accepted) {
+    accepted = false;
+    const bool isIdentity = (queryDbKey == hit.dbKey && (includeIdentity || sameQTDB));
+    size_t targetRep = SIZE_MAX;
+    if (targetDuplicates->getDuplicateCount() > 0 && isIdentity == false) {
+        const size_t dbId = tdbr->getId(hit.dbKey);
+        if (dbId != UINT_MAX) {
+            targetRep = targetDuplicates->getRepresentative(dbId);
+        }
+    }
+    if (targetRep != SIZE_MAX && context.lastQueryId == context.queryId && context.lastTargetRep == targetRep
+        && context.lastHit.diagonal == hit.diagonal
+        && context.lastHit.isReverse == hit.isReverse) {
+        res = context.lastRes;
+        res.dbKey = hit.dbKey;
+        accepted = context.lastAccepted;
+        return context.lastAligned;
+    }
+
+    const bool aligned = alignHit(*context.matcher, *context.dbSeq, hit, queryDbKey, origQueryLen, thread_idx, res, accepted);
+    if (targetRep != SIZE_MAX) {
+        context.lastQueryId = context.queryId;
+        context.lastTargetRep = targetRep;
+        context.lastHit = hit;
+        context.lastAligned = aligned;
+        context.lastAccepted = accepted;
+        context.lastRes = res;
+    }
+    return aligned;
+}
+
 size_t Alignment::estimateHDDMemoryConsumption(int dbSize, int maxSeqs) {
     return 2 * (dbSize * maxSeqs * 21 * 1.75);
 }
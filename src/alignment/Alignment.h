@@ -3,6 +3,7 @@
 
 #include "IndexReader.h"
 #include "DBReader.h"
+#include "EntryDuplicates.h"
 #include "Parameters.h"
 #include "BaseMatrix.h"
 #include "Matcher.h"
@@ -16,8 +17,8 @@ public:
               const Parameters &par, const bool lcaAlign);
     ~Alignment();
 
-    //Non-MPI
-    void run();
+    //Non-MPI, with --checkpoint-chunks chunks of an earlier run with the same fingerprint are skipped
+    void run(size_t checkpointFingerprint);
 
     //MPI function
     void run(const unsigned int mpiRank, const unsigned int mpiNumProc);
@@ -76,6 +77,7 @@ private:
 
     unsigned int threads;
     unsigned int compressed;
+    int checkpointChunks;
 
     const std::string outDB;
     const std::string outDBIndex;
@@ -118,10 +120,68 @@ private:
 
     DBReader<unsigned int> *prefdbr;
 
+    // identical sequences are aligned once, see EntryDuplicates
+    EntryDuplicates *queryDuplicates;
+    EntryDuplicates *targetDuplicates;
+    EntryDuplicates *prefDuplicates;
+
     bool reversePrefilterResult;
 
     static size_t estimateHDDMemoryConsumption(int dbSize, int maxSeqs);
 
+    // number of hits aligned by each task when a query is split across threads
+    static const size_t SPLIT_HITS_PER_TASK = 4;
+
+    struct AlignmentHit {
+        unsigned int dbKey;
+        short diagonal;
+        bool isReverse;
+    };
+
+    struct SplitHitResult {
+        Matcher::result_t res;
+        bool aligned;
+        bool accepted;
+    };
+
+    // per thread alignment state, remembers which query is loaded into qSeq and matcher
+    struct AlignmentThreadContext {
+        Sequence *qSeq;
+        Sequence *dbSeq;
+        Matcher *matcher;
+        std::string *queryToWrap;
+        size_t queryId;
+
+        // last hit aligned by alignHitOnce, a target with the same sequence reuses its result
+        size_t lastQueryId;
+        size_t lastTargetRep;
+        AlignmentHit lastHit;
+        bool lastAligned;
+        bool lastAccepted;
+        Matcher::result_t lastRes;
+
+        AlignmentThreadContext() : qSeq(NULL), dbSeq(NULL), matcher(NULL), queryToWrap(NULL), queryId(SIZE_MAX),
+                                   lastQueryId(SIZE_MAX), lastTargetRep(SIZE_MAX), lastAligned(false), lastAccepted(false) {}
+    };
+
+    // query length times the length of the prefilter list, taken from the index so the list is not read
+    size_t estimateAlignmentCost(size_t id) const;
+
+    // loads the query into the context unless it is already there, returns the unwrapped query length
+    size_t initQuery(AlignmentThreadContext &context, size_t qId, unsigned int queryDbKey, unsigned int thread_idx);
+
+    // parses one prefilter hit and returns the start of the next line
+    char *parseHit(char *data, AlignmentHit &hit, char *buffer, const char **words) const;
+
+    // returns false if the target can not pass the coverage threshold, otherwise aligns it
+    // and sets whether the alignment passes the acceptance criteria
+    bool alignHit(Matcher &matcher, Sequence &dbSeq, const AlignmentHit &hit, unsigned int queryDbKey,
+                  size_t origQueryLen, unsigned int thread_idx, Matcher::result_t &res, bool &accepted);
+
+    // like alignHit with the query of the context, but a duplicate of the previous target is not aligned again
+    bool alignHitOnce(AlignmentThreadContext &context, const AlignmentHit &hit, unsigned int queryDbKey,
+                      size_t origQueryLen, unsigned int thread_idx, Matcher::result_t &res, bool &accepted);
+
     void computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq,
                                      std::vector<Matcher::result_t> &vector, Matcher &matcher,
                                      float covThr, float evalThr, int swMode, int thread_idx);
@@ -2,7 +2,7 @@
 // Written by Martin Steinegger
 //
 // Wrapper for KSW2 aligner.
-// Local banded nucleotide aligner
+// Local banded nucleotide aligner, also used for amino acids (forward strand only)
 //
 #include "Parameters.h"
 #include "DistanceCalculator.h"
@@ -25,6 +25,8 @@ BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t max
     queryRevCompSeq =  static_cast<uint8_t*>(malloc(querySeqRevDataLen + 1));
     queryRevCompSeqRev =  static_cast<uint8_t*>(malloc(querySeqRevDataLen  + 1));
     queryRevCompCharSeq  =  static_cast<char*>(malloc(querySeqRevDataLen + 1));
+    alphabetSize = subMat->alphabetSize;
+    isNucleotide = true;
     mat = new int8_t[subMat->alphabetSize*subMat->alphabetSize];
     this->subMat = (NucleotideMatrix*) subMat;
     for (int i = 0; i < subMat->alphabetSize; i++) {
@@ -60,6 +62,10 @@ void BandedNucleotideAligner::initQuery(Sequence * query){
     }
     SmithWaterman::seq_reverse((int8_t *)querySeqRev, (int8_t *)querySeq, query->L);
     // needed for rev. complement
+    isNucleotide = Parameters::isEqualDbtype(query->getSequenceType(), Parameters::DBTYPE_NUCLEOTIDES);
+    if (isNucleotide == false) {
+        return;
+    }
     for (int pos = query->L - 1; pos > -1; pos--) {
         int res = query->numSequence[pos];
         queryRevCompSeq[(query->L - 1) - pos] = subMat->reverseResidue(res);
@@ -124,7 +130,8 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
         dbUngappedStartPos = alignment.startPos + distanceToDiagonal;
         dbUngappedEndPos = alignment.endPos + distanceToDiagonal;
     }
-    if(qUngappedEndPos-qUngappedStartPos == origQueryLen - 1
+    // amino acid diagonals often span indels without a score drop, they are always realigned
+    if(isNucleotide && qUngappedEndPos-qUngappedStartPos == origQueryLen - 1
        && dbUngappedStartPos == 0 && dbUngappedEndPos == targetSeqObj->L - 1){
         s_align result;
         uint32_t * retCigar = new uint32_t[1];
@@ -168,7 +175,7 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
         queryRevLenToAlign = origQueryLen;
     }
 
-    ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev, targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, flag, &ez);
+    ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev, targetSeqRev + tStartRev, alphabetSize, mat, gapo, gape, 64, zdrop, flag, &ez);
 
     int qStartPos = querySeqObj->L  - ( qStartRev + ez.max_q ) -1;
     int tStartPos = targetSeqObj->L - ( tStartRev + ez.max_t ) -1;
@@ -184,7 +191,7 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
     int queryLenToAlign = querySeqObj->L-qStartPos;
     if (wrappedScoring && queryLenToAlign > origQueryLen)
         queryLenToAlign = origQueryLen;
-    ksw_extz2_sse(0, queryLenToAlign, querySeqAlign+qStartPos, targetSeqObj->L-tStartPos, targetSeq+tStartPos, 5,
+    ksw_extz2_sse(0, queryLenToAlign, querySeqAlign+qStartPos, targetSeqObj->L-tStartPos, targetSeq+tStartPos, alphabetSize,
                   mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
 
     std::string letterCode = "MID";
@@ -193,7 +200,7 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
     if (ez.max_q > ezAlign.max_q && ez.max_t > ezAlign.max_t){
 
         ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev,
-                      targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
+                      targetSeqRev + tStartRev, alphabetSize, mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
 
         retCigar = new uint32_t[ezAlign.n_cigar];
         for(int i = 0; i < ezAlign.n_cigar; i++){
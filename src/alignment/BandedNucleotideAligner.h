@@ -2,7 +2,7 @@
 // Written by Martin Steinegger
 //
 // Wrapper for KSW2 aligner.
-// Local banded nucleotide aligner
+// Local banded nucleotide aligner, also used for amino acids (forward strand only)
 //
 #include <Parameters.h>
 #include <NucleotideMatrix.h>
@@ -38,6 +38,8 @@ private:
     uint8_t * queryRevCompSeqRev;
     Sequence * querySeqObj;
     int8_t * mat;
+    int alphabetSize;
+    bool isNucleotide;
     NucleotideMatrix * subMat;
 //    uint32_t * cigar;
     int gapo;
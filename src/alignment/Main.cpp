@@ -3,6 +3,7 @@
 #include "Debug.h"
 #include "Util.h"
 #include "MMseqsMPI.h"
+#include "ResumableChunks.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -25,7 +26,7 @@ int align(int argc, const char **argv, const Command& command) {
 #ifdef HAVE_MPI
     aln.run(MMseqsMPI::rank, MMseqsMPI::numProc);
 #else
-    aln.run();
+    aln.run(ResumableChunks::fingerprint(par, command));
 #endif
 
     return EXIT_SUCCESS;
@@ -45,7 +46,7 @@ int lcaalign(int argc, const char **argv, const Command& command) {
 #ifdef HAVE_MPI
     aln.run(MMseqsMPI::rank, MMseqsMPI::numProc);
 #else
-    aln.run();
+    aln.run(ResumableChunks::fingerprint(par, command));
 #endif
 
     return EXIT_SUCCESS;
@@ -4,6 +4,7 @@
 #include "DistanceCalculator.h"
 #include "FileUtil.h"
 #include "Timer.h"
+#include "Telemetry.h"
 
 #include <iomanip>
 
@@ -37,7 +38,9 @@ Command *getCommandByName(const char *s) {
 
 int runCommand(Command *p, int argc, const char **argv) {
     Timer timer;
+    Telemetry::start(p->cmd);
     int status = p->commandFunction(argc, argv, *p);
+    Telemetry::finish(status);
     Debug(Debug::INFO) << "Time for processing: " << timer.lap() << "\n";
     return status;
 }
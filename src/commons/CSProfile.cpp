@@ -5,6 +5,10 @@
 #include "CSProfile.h"
 #include "K4000.crf.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 
 ContextLibrary::ContextLibrary(){
     std::string lib((const char *)K4000_crf,  K4000_crf_len);
@@ -24,6 +28,9 @@ ContextLibrary::~ContextLibrary() {
     delete [] context_weights;
     delete [] pc_weights;
     delete [] pc;
+    free(context_weights_t);
+    free(bias_weight_t);
+    free(pc_t);
 }
 
 void ContextLibrary::read(std::string &libStr){
@@ -66,6 +73,32 @@ void ContextLibrary::read(std::string &libStr){
                               << libSize << " profiles but actually has " << k << "!\n";
         EXIT(EXIT_FAILURE);
     }
+    transposeLibrary();
+}
+
+void ContextLibrary::transposeLibrary() {
+    const size_t vecPair = 2 * VECSIZE_FLOAT;
+    libSizePadded = ((libSize + vecPair - 1) / vecPair) * vecPair;
+    const size_t aaSize = Sequence::PROFILE_AA_SIZE + 1;
+    context_weights_t = (float *) mem_align(ALIGN_FLOAT, wlen_ * aaSize * libSizePadded * sizeof(float));
+    bias_weight_t = (float *) mem_align(ALIGN_FLOAT, libSizePadded * sizeof(float));
+    pc_t = (float *) mem_align(ALIGN_FLOAT, Sequence::PROFILE_AA_SIZE * libSizePadded * sizeof(float));
+    memset(context_weights_t, 0, wlen_ * aaSize * libSizePadded * sizeof(float));
+    memset(pc_t, 0, Sequence::PROFILE_AA_SIZE * libSizePadded * sizeof(float));
+    for (size_t k = 0; k < libSizePadded; ++k) {
+        // padding states can never win the log-sum-exp, their posterior becomes 0
+        bias_weight_t[k] = (k < libSize) ? bias_weight[k] : -1e30f;
+    }
+    for (size_t k = 0; k < libSize; ++k) {
+        for (size_t j = 0; j < wlen_; ++j) {
+            for (size_t a = 0; a < aaSize; ++a) {
+                context_weights_t[(j * aaSize + a) * libSizePadded + k] = context_weights[k][j][a];
+            }
+        }
+        for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+            pc_t[a * libSizePadded + k] = pc[k][a];
+        }
+    }
 }
 
 void ContextLibrary::readContextProfile(std::stringstream &in, LibraryReader &reader,
@@ -155,197 +188,6 @@ void ContextLibrary::readContextProfile(std::stringstream &in, LibraryReader &re
     }
 }
 
-inline float CSProfile::computeProfileContextScore(float ** context_weights,
-                                                   const float * counts, const int L,
-                                                   size_t idx, size_t center) {
-    const size_t beg = std::max(0, static_cast<int>(idx - center));
-    const size_t end = std::min(static_cast<size_t>(L), idx + center + 1);
-    simd_float vTotalScore = simdf32_setzero();
-    for(size_t i = beg, j = beg - idx + center; i < end; ++i, ++j) {
-#ifdef AVX2
-        simd_float vContextWeight1 = simdf32_load(&context_weights[j][0]);
-        simd_float vCount1 = simdf32_load(&counts[i * (Sequence::PROFILE_AA_SIZE + 4) + 0]);
-        simd_float vScore1 = simdf32_mul(vContextWeight1, vCount1);
-        simd_float vContextWeight2 = simdf32_load(&context_weights[j][VECSIZE_FLOAT]);
-        simd_float vCount2 = simdf32_load(&counts[i * (Sequence::PROFILE_AA_SIZE + 4) + (VECSIZE_FLOAT)]);
-        simd_float vScore2 = simdf32_mul(vContextWeight2, vCount2);
-        simd_float vContextWeight3 = simdf32_load(&context_weights[j][2*VECSIZE_FLOAT]);
-        simd_float vCount3 = simdf32_load(&counts[i * (Sequence::PROFILE_AA_SIZE + 4) + (2*VECSIZE_FLOAT)]);
-        simd_float vScore3 = simdf32_mul(vContextWeight3, vCount3);
-        vScore1 = simdf32_add(vScore2, vScore1);
-        vScore1 = simdf32_add(vScore3, vScore1);
-        vTotalScore = simdf32_add(vTotalScore, vScore1);
-#else
-        simd_float vContextWeight1 = simdf32_load(&context_weights[j][0]);
-        simd_float vCount1 = simdf32_load(&counts[i * (Sequence::PROFILE_AA_SIZE + 4) + 0]);
-        simd_float vScore1 = simdf32_mul(vContextWeight1, vCount1);
-        simd_float vContextWeight2 = simdf32_load(&context_weights[j][VECSIZE_FLOAT]);
-        simd_float vCount2 = simdf32_load(&counts[i * (Sequence::PROFILE_AA_SIZE + 4) + (VECSIZE_FLOAT)]);
-        simd_float vScore2 = simdf32_mul(vContextWeight2, vCount2);
-        simd_float vContextWeight3 = simdf32_load(&context_weights[j][2*VECSIZE_FLOAT]);
-        simd_float vCount3 = simdf32_load(&counts[i * (Sequence::PROFILE_AA_SIZE + 4) + (2*VECSIZE_FLOAT)]);
-        simd_float vScore3 = simdf32_mul(vContextWeight3, vCount3);
-        simd_float vContextWeight4 = simdf32_load(&context_weights[j][3*VECSIZE_FLOAT]);
-        simd_float vCount4 = simdf32_load(&counts[i * (Sequence::PROFILE_AA_SIZE + 4) + (3*VECSIZE_FLOAT)]);
-        simd_float vScore4 = simdf32_mul(vContextWeight4, vCount4);
-        vScore1 = simdf32_add(vScore1, vScore2);
-        vScore2 = simdf32_add(vScore3, vScore4);
-        vScore1 = simdf32_add(vScore1, vScore2);
-        vTotalScore = simdf32_add(vTotalScore, vScore1);
-#endif
-    }
-    return simdf32_hadd(vTotalScore);
-    //return score;
-}
-
-
-inline float CSProfile::computeSeqContextScore(float ** context_weights,
-                                            const unsigned char * seq, const int L,
-                                            size_t idx, size_t center) {
-    const size_t beg = std::max(0, static_cast<int>(idx - center));
-    const size_t end = std::min(static_cast<size_t >(L), idx + center + 1);
-    const size_t diff = end - beg;
-    float score = 0.0;
-    float score1, score2, score3, score4;
-    size_t j = beg - idx + center;
-    switch(diff){
-        case 1:
-            score += context_weights[j][seq[beg]];
-            break;
-        case 2:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score = score1 + score2;
-            break;
-        case 3:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score = score1 + score2 + score3;
-            break;
-        case 4:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 5:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 6:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 7:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score3 += context_weights[j+6][seq[beg+6]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 8:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score3 += context_weights[j+6][seq[beg+6]];
-            score4 += context_weights[j+7][seq[beg+7]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 9:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score3 += context_weights[j+6][seq[beg+6]];
-            score4 += context_weights[j+7][seq[beg+7]];
-            score1 += context_weights[j+8][seq[beg+8]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 10:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score3 += context_weights[j+6][seq[beg+6]];
-            score4 += context_weights[j+7][seq[beg+7]];
-            score1 += context_weights[j+8][seq[beg+8]];
-            score2 += context_weights[j+9][seq[beg+9]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 11:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score3 += context_weights[j+6][seq[beg+6]];
-            score4 += context_weights[j+7][seq[beg+7]];
-            score1 += context_weights[j+8][seq[beg+8]];
-            score2 += context_weights[j+9][seq[beg+9]];
-            score3 += context_weights[j+10][seq[beg+10]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 12:
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score3 += context_weights[j+6][seq[beg+6]];
-            score4 += context_weights[j+7][seq[beg+7]];
-            score1 += context_weights[j+8][seq[beg+8]];
-            score2 += context_weights[j+9][seq[beg+9]];
-            score3 += context_weights[j+10][seq[beg+10]];
-            score4 += context_weights[j+11][seq[beg+11]];
-            score = score1 + score2 + score3 + score4;
-            break;
-        case 13:
-            //simdi_loadu()
-            score1 = context_weights[j][seq[beg]];
-            score2 = context_weights[j+1][seq[beg+1]];
-            score3 = context_weights[j+2][seq[beg+2]];
-            score4 = context_weights[j+3][seq[beg+3]];
-            score1 += context_weights[j+4][seq[beg+4]];
-            score2 += context_weights[j+5][seq[beg+5]];
-            score3 += context_weights[j+6][seq[beg+6]];
-            score4 += context_weights[j+7][seq[beg+7]];
-            score1 += context_weights[j+8][seq[beg+8]];
-            score2 += context_weights[j+9][seq[beg+9]];
-            score3 += context_weights[j+10][seq[beg+10]];
-            score4 += context_weights[j+11][seq[beg+11]];
-            score1 += context_weights[j+12][seq[beg+12]];
-            score = score1 + score2 + score3 + score4;
-            break;
-    }
-//    for(size_t i = beg, j = beg - idx + center; i < end; ++i, ++j)
-//        score += context_weights[j][seq[i]];
-    return score;
-}
-
-
 float * CSProfile::computeProfileCs(int seqLen, float * count, float * Neff_M, float pca, float pcb){
     return computeProfile<Parameters::DBTYPE_HMM_PROFILE>(NULL, seqLen, count, Neff_M,  0.9, pca, pcb);
 }
@@ -356,80 +198,151 @@ float * CSProfile::computeSequenceCs(unsigned char * numSeq, int seqLen, float p
 
 
 template<int type>
-float * CSProfile::computeProfile(unsigned char * numSeq, int seqLen,
-                                  float * count, float * Neff_M,
-                                  float pTau, float pca, float pcb){
-    //std::cout << "Adding pseudocounts ...\n";
-    const int center = ctxLib->center;
-    // Calculate posterior probability ppi[k] of state k given sequence window
-    // around position 'i'
-    std::fill(maximums, maximums + seqLen, -FLT_MAX);
-    int segmentSize = (seqLen+VECSIZE_FLOAT-1)/VECSIZE_FLOAT;
-    for (size_t k = 0; k < ctxLib->libSize; ++k) {
-        float* ppi = &pp[k * segmentSize * VECSIZE_FLOAT];
-        float bias = ctxLib->bias_weight[k];
-        for (int i = 0; i < seqLen; i++) {
-            float contextScore;
-            if(type == Parameters::DBTYPE_HMM_PROFILE){
-                contextScore = computeProfileContextScore(ctxLib->context_weights[k], count, seqLen, i, center);
-            } else {
-                contextScore = computeSeqContextScore(ctxLib->context_weights[k], numSeq, seqLen, i, center);
+void CSProfile::computeBlock(int start, int end, float * ppBlock) {
+    const size_t ks = ctxLib->libSizePadded;
+    const size_t wlen = ctxLib->wlen_;
+    const size_t rowSize = Sequence::PROFILE_AA_SIZE + 4;
+    const size_t colStride = (Sequence::PROFILE_AA_SIZE + 1) * ks;
+    const float * weights = ctxLib->context_weights_t;
+
+    // Window scores of all states for all positions of the block, a small GEMM of
+    // (positions x window*aa) * (window*aa x states). Each step keeps 4 positions x 2 state
+    // vectors in registers, the weights of these states (~wlen*21*2*VECSIZE_FLOAT floats) stay in L1.
+    // Padded inputs are shifted by center, so position i sees window rows i .. i+wlen-1.
+    for (size_t k = 0; k < ks; k += 2 * VECSIZE_FLOAT) {
+        const simd_float vBias0 = simdf32_load(&ctxLib->bias_weight_t[k]);
+        const simd_float vBias1 = simdf32_load(&ctxLib->bias_weight_t[k + VECSIZE_FLOAT]);
+        for (int i = start; i < end; i += 4) {
+            simd_float acc00 = vBias0, acc01 = vBias1;
+            simd_float acc10 = vBias0, acc11 = vBias1;
+            simd_float acc20 = vBias0, acc21 = vBias1;
+            simd_float acc30 = vBias0, acc31 = vBias1;
+            for (size_t j = 0; j < wlen; ++j) {
+                const float * w = weights + j * colStride + k;
+                if (type == Parameters::DBTYPE_HMM_PROFILE) {
+                    const float * c0 = &paddedCounts[(i + j) * rowSize];
+                    const float * c1 = c0 + rowSize;
+                    const float * c2 = c1 + rowSize;
+                    const float * c3 = c2 + rowSize;
+                    for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+                        const simd_float w0 = simdf32_load(w + a * ks);
+                        const simd_float w1 = simdf32_load(w + a * ks + VECSIZE_FLOAT);
+                        simd_float x = simdf32_set(c0[a]);
+                        acc00 = simdf32_add(acc00, simdf32_mul(x, w0));
+                        acc01 = simdf32_add(acc01, simdf32_mul(x, w1));
+                        x = simdf32_set(c1[a]);
+                        acc10 = simdf32_add(acc10, simdf32_mul(x, w0));
+                        acc11 = simdf32_add(acc11, simdf32_mul(x, w1));
+                        x = simdf32_set(c2[a]);
+                        acc20 = simdf32_add(acc20, simdf32_mul(x, w0));
+                        acc21 = simdf32_add(acc21, simdf32_mul(x, w1));
+                        x = simdf32_set(c3[a]);
+                        acc30 = simdf32_add(acc30, simdf32_mul(x, w0));
+                        acc31 = simdf32_add(acc31, simdf32_mul(x, w1));
+                    }
+                } else {
+                    // one-hot input, the product degenerates to a row lookup
+                    const float * w0 = w + paddedSeq[i + j] * ks;
+                    const float * w1 = w + paddedSeq[i + j + 1] * ks;
+                    const float * w2 = w + paddedSeq[i + j + 2] * ks;
+                    const float * w3 = w + paddedSeq[i + j + 3] * ks;
+                    acc00 = simdf32_add(acc00, simdf32_load(w0));
+                    acc01 = simdf32_add(acc01, simdf32_load(w0 + VECSIZE_FLOAT));
+                    acc10 = simdf32_add(acc10, simdf32_load(w1));
+                    acc11 = simdf32_add(acc11, simdf32_load(w1 + VECSIZE_FLOAT));
+                    acc20 = simdf32_add(acc20, simdf32_load(w2));
+                    acc21 = simdf32_add(acc21, simdf32_load(w2 + VECSIZE_FLOAT));
+                    acc30 = simdf32_add(acc30, simdf32_load(w3));
+                    acc31 = simdf32_add(acc31, simdf32_load(w3 + VECSIZE_FLOAT));
+                }
             }
-            ppi[i] = bias + contextScore;
-            maximums[i] = std::max(maximums[i], ppi[i]);
+            float * out = &ppBlock[(i - start) * ks + k];
+            simdf32_store(out, acc00);
+            simdf32_store(out + VECSIZE_FLOAT, acc01);
+            simdf32_store(out + ks, acc10);
+            simdf32_store(out + ks + VECSIZE_FLOAT, acc11);
+            simdf32_store(out + 2 * ks, acc20);
+            simdf32_store(out + 2 * ks + VECSIZE_FLOAT, acc21);
+            simdf32_store(out + 3 * ks, acc30);
+            simdf32_store(out + 3 * ks + VECSIZE_FLOAT, acc31);
         }
     }
-    // Log-sum-exp trick begins here
-    std::fill(sums, sums + seqLen, 0.0);
-    const float scalingLog2 = 1/log(2.0);
-    simd_float vscalingLog2 = simdf32_set(scalingLog2);
-    for (size_t k = 0; k < ctxLib->libSize; ++k){
-        float* ppi = &pp[k * segmentSize * VECSIZE_FLOAT];
-        for (int i = 0; i < segmentSize; i++) {
-//            // exp(x) = 2^(1/log(2) * x)
-//            // sums[i] += MathUtil::fpow2((ppi[i] - maximums[i]) * scalingLog2);
-//            // http://www.wolframalpha.com/input/?i=exp(x)+%3D++2%5E(y+*+x)+solve+for+y
-            simd_float vppi = simdf32_load(&ppi[i*VECSIZE_FLOAT]);
-            simd_float vmax = simdf32_load(&maximums[i*VECSIZE_FLOAT]);
-            simd_float vsum = simdf32_load(&sums[i*VECSIZE_FLOAT]);
-            simd_float vppi_vmax = simdf32_sub(vppi, vmax);
-            simd_float vppi_vmax_log2 = simdf32_mul(vppi_vmax, vscalingLog2);
-            simd_float vfpow2 = simdf32_fpow2(vppi_vmax_log2);
-            simdf32_store(&sums[i*VECSIZE_FLOAT], simdf32_add(vsum, vfpow2));
 
+    // Posterior probability ppi[k] of state k given the window around position i (log-sum-exp)
+    // and pseudocount vector P(a|X_i) = sum_k ppi[k] * pc[k][a]
+    // exp(x) = 2^(1/log(2) * x)
+    const simd_float vscalingLog2 = simdf32_set(1/log(2.0));
+    float reduce[VECSIZE_FLOAT] __attribute__((aligned(ALIGN_FLOAT)));
+    for (int i = start; i < end; i++) {
+        float * ppi = &ppBlock[(i - start) * ks];
+        simd_float vmax = simdf32_set(-FLT_MAX);
+        for (size_t k = 0; k < ks; k += VECSIZE_FLOAT) {
+            vmax = simdf32_max(vmax, simdf32_load(&ppi[k]));
         }
-    }
-    for (int i = 0; i < seqLen; i++) {
-        maximums[i] = maximums[i] + log(sums[i]);
-    }
-    for (size_t k = 0; k < ctxLib->libSize; ++k) {
-        float* ppi = &pp[k * segmentSize * VECSIZE_FLOAT];
-        for (int i = 0; i < segmentSize; i++) {
-            // ppi[i] = MathUtil::fpow2((ppi[i] - maximums[i]) * scalingLog2);
-            simd_float vppi = simdf32_load(&ppi[i*VECSIZE_FLOAT]);
-            simd_float vmax = simdf32_load(&maximums[i*VECSIZE_FLOAT]);
-            simd_float vppi_vmax = simdf32_sub(vppi, vmax);
-            simd_float vppi_vmax_log2 = simdf32_mul(vppi_vmax, vscalingLog2);
-            simd_float vfpow2 = simdf32_fpow2(vppi_vmax_log2);
-            simdf32_store(&ppi[i*VECSIZE_FLOAT], vfpow2);
+        simdf32_store(reduce, vmax);
+        float maximum = reduce[0];
+        for (int v = 1; v < VECSIZE_FLOAT; ++v) {
+            maximum = std::max(maximum, reduce[v]);
+        }
+        simd_float vMaximum = simdf32_set(maximum);
+        simd_float vsum = simdf32_setzero();
+        for (size_t k = 0; k < ks; k += VECSIZE_FLOAT) {
+            simd_float vppi_vmax = simdf32_sub(simdf32_load(&ppi[k]), vMaximum);
+            vsum = simdf32_add(vsum, simdf32_fpow2(simdf32_mul(vppi_vmax, vscalingLog2)));
+        }
+        simd_float vLogSumExp = simdf32_set(maximum + log(simdf32_hadd(vsum)));
+        for (size_t k = 0; k < ks; k += VECSIZE_FLOAT) {
+            simd_float vppi_vmax = simdf32_sub(simdf32_load(&ppi[k]), vLogSumExp);
+            simdf32_store(&ppi[k], simdf32_fpow2(simdf32_mul(vppi_vmax, vscalingLog2)));
+        }
+        float * pc = &profile[i * (Sequence::PROFILE_AA_SIZE + 4)];
+        for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+            const float * ctxLib_pc = &ctxLib->pc_t[a * ks];
+            simd_float vpc = simdf32_setzero();
+            for (size_t k = 0; k < ks; k += VECSIZE_FLOAT) {
+                vpc = simdf32_add(vpc, simdf32_mul(simdf32_load(&ppi[k]), simdf32_load(&ctxLib_pc[k])));
+            }
+            pc[a] = simdf32_hadd(vpc);
         }
     }
-    // Calculate pseudocount vector P(a|X_i)
-    std::fill(profile, profile + (seqLen * (Sequence::PROFILE_AA_SIZE + 4)), 0.0);
+}
+
+template<int type>
+float * CSProfile::computeProfile(unsigned char * numSeq, int seqLen,
+                                  float * count, float * Neff_M,
+                                  float pTau, float pca, float pcb){
+    const int center = ctxLib->center;
+    const size_t rowSize = Sequence::PROFILE_AA_SIZE + 4;
+    // shift inputs by center and pad with neutral rows, windows are truncated at the sequence ends
+    const size_t paddedLen = seqLen + ctxLib->wlen_ + POS_BLOCK;
+    if (type == Parameters::DBTYPE_HMM_PROFILE) {
+        std::fill(paddedCounts, paddedCounts + paddedLen * rowSize, 0.0f);
+        memcpy(&paddedCounts[center * rowSize], count, seqLen * rowSize * sizeof(float));
+    } else {
+        // X has zero context weight
+        std::fill(paddedSeq, paddedSeq + paddedLen, static_cast<unsigned char>(Sequence::PROFILE_AA_SIZE));
+        memcpy(&paddedSeq[center], numSeq, seqLen * sizeof(unsigned char));
+    }
+    std::fill(profile, profile + (seqLen * rowSize), 0.0);
 
-    for (size_t k = 0; k < ctxLib->libSize; ++k){
-        float* ppi = &pp[k * segmentSize * VECSIZE_FLOAT];
-        float * ctxLib_pc = ctxLib->pc[k];
-        for (int i = 0; i < seqLen; i++) {
-            float *pc = &profile[i * (Sequence::PROFILE_AA_SIZE + 4)];
-            simd_float simd_ppi = simdf32_set(ppi[i]);
-            for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; a += VECSIZE_FLOAT) {
-                //pc[a] += ppi[i] * ctxLib_pc[a];
-                simd_float ctxLib_pc_a = simdf32_load(&ctxLib_pc[a]);
-                simd_float pc_a = simdf32_load(&pc[a]);
-                simd_float pc_res = simdf32_add(pc_a, simdf32_mul(ctxLib_pc_a, simd_ppi));
-                simdf32_store(&pc[a], pc_res);
+    const int blocks = (seqLen + POS_BLOCK - 1) / POS_BLOCK;
+    bool parallel = false;
+#ifdef OPENMP
+    parallel = seqLen >= PARALLEL_MIN_LEN && omp_in_parallel() == 0 && omp_get_max_threads() > 1;
+#endif
+    if (parallel) {
+#pragma omp parallel
+        {
+            float * ppLocal = (float *) mem_align(ALIGN_FLOAT, POS_BLOCK * ctxLib->libSizePadded * sizeof(float));
+#pragma omp for schedule(dynamic, 1)
+            for (int block = 0; block < blocks; ++block) {
+                computeBlock<type>(block * POS_BLOCK, std::min(seqLen, (block + 1) * POS_BLOCK), ppLocal);
             }
+            free(ppLocal);
+        }
+    } else {
+        for (int block = 0; block < blocks; ++block) {
+            computeBlock<type>(block * POS_BLOCK, std::min(seqLen, (block + 1) * POS_BLOCK), pp);
         }
     }
 
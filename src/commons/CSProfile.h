@@ -26,6 +26,11 @@ public:
     float *** context_weights; // k * states * aa
     float ** pc_weights;
     float ** pc;
+    // state-innermost copies used by the vectorized scoring, libSizePadded is a multiple of 2 * VECSIZE_FLOAT
+    size_t libSizePadded;
+    float * context_weights_t; // wlen * (aa + X) * libSizePadded
+    float * bias_weight_t;     // libSizePadded
+    float * pc_t;              // aa * libSizePadded
 
     static ContextLibrary* getContextLibraryInstance()
     {
@@ -50,45 +55,49 @@ private:
     // read context profiles from library
     void readContextProfile(std::stringstream &in, LibraryReader &reader,
                             float ** context_weight, float * pc_weight, float * pc);
+
+    // build the state-innermost copies of weights, bias and pseudocounts
+    void transposeLibrary();
 };
 
 class CSProfile {
     ContextLibrary * ctxLib;
     float * profile;
     float * pp;
-    float * maximums;
-    float * sums;
+    float * paddedCounts;
+    unsigned char * paddedSeq;
 public:
+    // positions scored together, the posterior buffer holds POS_BLOCK * libSizePadded floats
+    static const int POS_BLOCK = 64;
+    // sequences at least this long are split over threads when not called from a parallel region
+    static const int PARALLEL_MIN_LEN = 8 * POS_BLOCK;
 
     CSProfile(size_t maxSeqLen) {
         ctxLib = ContextLibrary::getContextLibraryInstance();
         this->profile = (float * )mem_align(ALIGN_FLOAT, (Sequence::PROFILE_AA_SIZE + 4) * maxSeqLen * sizeof(float));
-        int segmentSize = (maxSeqLen+VECSIZE_FLOAT-1)/VECSIZE_FLOAT;
-        this->pp = (float * ) mem_align(ALIGN_FLOAT, 4000 * segmentSize * VECSIZE_FLOAT * sizeof(float));
-        this->maximums = (float * ) mem_align(ALIGN_FLOAT,  segmentSize * VECSIZE_FLOAT * sizeof(float));
-        this->sums = (float * ) mem_align(ALIGN_FLOAT,  segmentSize * VECSIZE_FLOAT * sizeof(float));
+        this->pp = (float * ) mem_align(ALIGN_FLOAT, POS_BLOCK * ctxLib->libSizePadded * sizeof(float));
+        // window overhang on both sides plus tail of the last position block
+        const size_t paddedLen = maxSeqLen + ctxLib->wlen_ + POS_BLOCK;
+        this->paddedCounts = (float * ) mem_align(ALIGN_FLOAT, (Sequence::PROFILE_AA_SIZE + 4) * paddedLen * sizeof(float));
+        this->paddedSeq = (unsigned char * ) malloc(paddedLen * sizeof(unsigned char));
     };
 
     ~CSProfile(){
         free(profile);
         free(pp);
-        free(maximums);
-        free(sums);
+        free(paddedCounts);
+        free(paddedSeq);
     }
 
-    float computeSeqContextScore(float ** context_weights,
-                              const unsigned char * seq, const int L,
-                              size_t idx, size_t center);
-
-    float computeProfileContextScore(float ** context_weights,
-                                 const float * counts, const int L,
-                                 size_t idx, size_t center);
-
     float * computeProfileCs(int seqLen, float * count, float * Neff_M, float pca, float pcb);
     float * computeSequenceCs(unsigned char * numSeq, int seqLen, float tau);
 private:
     template<int type>
     float * computeProfile(unsigned char * numSeq, int seqLen, float * count, float * Neff_M, float pTau, float pca, float pcb);
+
+    // posterior state probabilities and pseudocount vectors for positions [start, end)
+    template<int type>
+    void computeBlock(int start, int end, float * ppBlock);
 };
 
 
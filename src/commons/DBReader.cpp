@@ -4,7 +4,9 @@
 #include <climits>
 #include <cstring>
 #include <cstddef>
+#include <fstream>
 #include <random>
+#include <type_traits>
 
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -21,13 +23,30 @@
 #include <omp.h>
 #endif
 
+// both files are missing or have the same content
+static bool sameFileContent(const std::string &first, const std::string &second) {
+    const bool firstExists = FileUtil::fileExists(first.c_str());
+    if (firstExists != FileUtil::fileExists(second.c_str())) {
+        return false;
+    }
+    if (firstExists == false) {
+        return true;
+    }
+    MemoryMapped firstData(first, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+    MemoryMapped secondData(second, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+    if (firstData.isValid() == false || secondData.isValid() == false) {
+        return false;
+    }
+    return firstData.size() == secondData.size() && memcmp(firstData.getData(), secondData.getData(), firstData.size()) == 0;
+}
+
 template <typename T>
 DBReader<T>::DBReader(const char* dataFileName_, const char* indexFileName_, int threads, int dataMode) :
 threads(threads), dataMode(dataMode), dataFileName(strdup(dataFileName_)),
         indexFileName(strdup(indexFileName_)), size(0), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0),
         totalDataSize(0), dataSize(0), lastKey(T()), closed(1), dbtype(Parameters::DBTYPE_GENERIC_DB),
         compressedBuffers(NULL), compressedBufferSizes(NULL), index(NULL), id2local(NULL), local2id(NULL),
-        dataMapped(false), accessType(0), externalData(false), didMlock(false)
+        dataMapped(false), accessType(0), externalData(false), didMlock(false), ddict(NULL)
 {}
 
 template <typename T>
@@ -36,7 +55,7 @@ DBReader<T>::DBReader(DBReader<T>::Index *index, size_t size, size_t dataSize, T
         threads(threads), dataMode(USE_INDEX), dataFileName(NULL), indexFileName(NULL),
         size(size), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0), totalDataSize(0), dataSize(dataSize), lastKey(lastKey),
         maxSeqLen(maxSeqLen), closed(1), dbtype(dbType), compressedBuffers(NULL), compressedBufferSizes(NULL), index(index), sortedByOffset(true),
-        id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false)
+        id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false), ddict(NULL)
 {}
 
 template <typename T>
@@ -103,9 +122,30 @@ template <typename T> bool DBReader<T>::open(int accessType){
     this->accessType = accessType;
     if (dataFileName != NULL) {
         dbtype = FileUtil::parseDbType(dataFileName);
+        if (std::is_same<T, unsigned int>::value && (getExtendedDbtype(dbtype) & Parameters::DBTYPE_EXTENDED_LONG_KEYS)) {
+            Debug(Debug::ERROR) << "Database " << dataFileName << " has keys that do not fit into 32 bits and cannot be read by this module. "
+                                << "Please map them to 32-bit keys with renamedbkeys first.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (externalData == false && isFederated(dataFileName)) {
+            federatedMembers = readFederatedManifest(dataFileName);
+        }
     }
     if (dataMode & USE_DATA) {
-        dataFileNames = FileUtil::findDatafiles(dataFileName);
+        if (federatedMembers.empty()) {
+            dataFileNames = FileUtil::findDatafiles(dataFileName);
+        } else {
+            // the data files of all members are addressed as one, like the files of a split DB
+            dataFileNames.clear();
+            for (size_t i = 0; i < federatedMembers.size(); ++i) {
+                std::vector<std::string> memberFiles = FileUtil::findDatafiles(federatedMembers[i].name.c_str());
+                if (memberFiles.empty()) {
+                    Debug(Debug::ERROR) << "No datafile could be found for member " << federatedMembers[i].name << " of " << dataFileName << "!\n";
+                    EXIT(EXIT_FAILURE);
+                }
+                dataFileNames.insert(dataFileNames.end(), memberFiles.begin(), memberFiles.end());
+            }
+        }
         if (dataFileNames.empty()) {
             Debug(Debug::ERROR) << "No datafile could be found for " << dataFileName << "!\n";
             EXIT(EXIT_FAILURE);
@@ -136,42 +176,51 @@ template <typename T> bool DBReader<T>::open(int accessType){
         }
     }
     if (dataMode & USE_LOOKUP || dataMode & USE_LOOKUP_REV) {
-        std::string lookupFilename = (std::string(dataFileName) + ".lookup");
-        MemoryMapped lookupData(lookupFilename, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
-        if (lookupData.isValid() == false) {
-            Debug(Debug::ERROR) << "Cannot open lookup file " << lookupFilename << "!\n";
-            EXIT(EXIT_FAILURE);
+        if (federatedMembers.empty()) {
+            std::string lookupFilename = (std::string(dataFileName) + ".lookup");
+            MemoryMapped lookupData(lookupFilename, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+            if (lookupData.isValid() == false) {
+                Debug(Debug::ERROR) << "Cannot open lookup file " << lookupFilename << "!\n";
+                EXIT(EXIT_FAILURE);
+            }
+            char* lookupDataChar = (char *) lookupData.getData();
+            size_t lookupDataSize = lookupData.size();
+            lookupSize = Util::ompCountLines(lookupDataChar, lookupDataSize, threads);
+            lookup = new(std::nothrow) LookupEntry[this->lookupSize];
+            incrementMemory(sizeof(LookupEntry) * this->lookupSize);
+            readLookup(lookupDataChar, lookupDataSize, lookup);
+            lookupData.close();
+        } else {
+            readFederatedLookup();
         }
-        char* lookupDataChar = (char *) lookupData.getData();
-        size_t lookupDataSize = lookupData.size();
-        lookupSize = Util::ompCountLines(lookupDataChar, lookupDataSize, threads);
-        lookup = new(std::nothrow) LookupEntry[this->lookupSize];
-        incrementMemory(sizeof(LookupEntry) * this->lookupSize);
-        readLookup(lookupDataChar, lookupDataSize, lookup);
         if (dataMode & USE_LOOKUP) {
             SORT_PARALLEL(lookup, lookup + lookupSize, LookupEntry::compareById);
         } else {
             SORT_PARALLEL(lookup, lookup + lookupSize, LookupEntry::compareByAccession);
         }
-        lookupData.close();
     }
     bool isSortedById = false;
     if (externalData == false) {
-        MemoryMapped indexData(indexFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
-        if (!indexData.isValid()){
-            Debug(Debug::ERROR) << "Cannot open index file " << indexFileName << "\n";
-            EXIT(EXIT_FAILURE);
-        }
-        char* indexDataChar = (char *) indexData.getData();
-        size_t indexDataSize = indexData.size();
-        size = Util::ompCountLines(indexDataChar, indexDataSize, threads);
+        bool isSortedById;
+        if (federatedMembers.empty()) {
+            MemoryMapped indexData(indexFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+            if (!indexData.isValid()){
+                Debug(Debug::ERROR) << "Cannot open index file " << indexFileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            char* indexDataChar = (char *) indexData.getData();
+            size_t indexDataSize = indexData.size();
+            size = Util::ompCountLines(indexDataChar, indexDataSize, threads);
 
-        index = new(std::nothrow) Index[size];
-        Util::checkAllocation(index, "Cannot allocate index memory in DBReader");
-        incrementMemory(sizeof(Index) * size);
+            index = new(std::nothrow) Index[size];
+            Util::checkAllocation(index, "Cannot allocate index memory in DBReader");
+            incrementMemory(sizeof(Index) * size);
 
-        bool isSortedById = readIndex(indexDataChar, indexDataSize, index, dataSize);
-        indexData.close();
+            isSortedById = readIndex(indexDataChar, indexDataSize, index, dataSize);
+            indexData.close();
+        } else {
+            isSortedById = readFederatedIndex();
+        }
 
         // sortIndex also handles access modes that don't require sorting
         sortIndex(isSortedById);
@@ -204,16 +253,33 @@ template <typename T> bool DBReader<T>::open(int accessType){
                 EXIT(EXIT_FAILURE);
             }
         }
+        std::string dictionaryFile = dataFileName != NULL ? std::string(dataFileName) + ".zdict" : "";
+        if (federatedMembers.empty() == false) {
+            // all entries are decompressed with one dictionary, so the members have to share it
+            dictionaryFile = federatedMembers[0].name + ".zdict";
+            for (size_t i = 1; i < federatedMembers.size(); ++i) {
+                if (sameFileContent(dictionaryFile, federatedMembers[i].name + ".zdict") == false) {
+                    Debug(Debug::ERROR) << "Members " << federatedMembers[0].name << " and " << federatedMembers[i].name
+                                        << " of " << dataFileName << " were compressed with different dictionaries\n";
+                    EXIT(EXIT_FAILURE);
+                }
+            }
+        }
+        if (dataFileName != NULL && FileUtil::fileExists(dictionaryFile.c_str())) {
+            MemoryMapped dictionary(dictionaryFile, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+            if (dictionary.isValid() == false) {
+                Debug(Debug::ERROR) << "Cannot open dictionary file " << dictionaryFile << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            setDictionary((const char *) dictionary.getData(), dictionary.size());
+            dictionary.close();
+        }
     }
 
     closed = 0;
     return isSortedById;
 }
 
-template<typename T>
-void DBReader<T>::sortIndex(bool) {
-}
-
 template<typename T>
 bool DBReader<T>::isSortedByOffset(){
     return sortedByOffset;
@@ -234,8 +300,9 @@ void DBReader<std::string>::sortIndex(bool isSortedById) {
     }
 }
 
-template<>
-void DBReader<unsigned int>::sortIndex(bool isSortedById) {
+// keys of any integer type
+template<typename T>
+void DBReader<T>::sortIndex(bool isSortedById) {
     // First, we sort the index by IDs and we keep track of the original
     // ordering in mappingToOriginalIndex array
     size_t* mappingToOriginalIndex=NULL;
@@ -490,6 +557,10 @@ template <typename T> void DBReader<T>::close(){
         delete [] compressedBufferSizes;
         delete [] dstream;
     }
+    if (ddict != NULL) {
+        ZSTD_freeDDict(ddict);
+        ddict = NULL;
+    }
 
     if(externalData == false) {
         delete[] index;
@@ -692,6 +763,16 @@ void DBReader<unsigned int>::lookupEntryToBuffer(std::string& buffer, const Look
     buffer.append(1, '\n');
 }
 
+template<>
+void DBReader<size_t>::lookupEntryToBuffer(std::string& buffer, const LookupEntry& entry) {
+    buffer.append(SSTR(entry.id));
+    buffer.append(1, '\t');
+    buffer.append(entry.entryName);
+    buffer.append(1, '\t');
+    buffer.append(SSTR(entry.fileNumber));
+    buffer.append(1, '\n');
+}
+
 template<>
 void DBReader<std::string>::lookupEntryToBuffer(std::string& buffer, const LookupEntry& entry) {
     buffer.append(entry.id);
@@ -782,7 +863,7 @@ bool DBReader<T>::readIndex(char *data, size_t indexDataSize, Index *index, size
     unsigned int localMaxSeqLen = 0;
     size_t localDataSize = 0;
 
-    unsigned int localLastKey = 0;
+    size_t localLastKey = 0;
     const unsigned int BATCH_SIZE = 1048576;
 #pragma omp parallel num_threads(threadCnt) reduction(max: localMaxSeqLen, localLastKey) reduction(+: localDataSize) reduction(min:isSortedById)
     {
@@ -830,6 +911,168 @@ bool DBReader<T>::readIndex(char *data, size_t indexDataSize, Index *index, size
     return isSortedById;
 }
 
+template<typename T>
+bool DBReader<T>::readFederatedIndex() {
+    std::vector<MemoryMapped*> indexData(federatedMembers.size());
+    size = 0;
+    for (size_t i = 0; i < federatedMembers.size(); ++i) {
+        std::string memberIndex = federatedMembers[i].name + ".index";
+        indexData[i] = new MemoryMapped(memberIndex, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+        if (indexData[i]->isValid() == false) {
+            Debug(Debug::ERROR) << "Cannot open index file " << memberIndex << " of " << dataFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        federatedMembers[i].firstEntry = size;
+        federatedMembers[i].entries = Util::ompCountLines((char *) indexData[i]->getData(), indexData[i]->size(), threads);
+        size += federatedMembers[i].entries;
+    }
+
+    index = new(std::nothrow) Index[size];
+    Util::checkAllocation(index, "Cannot allocate index memory in DBReader");
+    incrementMemory(sizeof(Index) * size);
+
+    bool isSortedById = true;
+    size_t totalSize = 0;
+    unsigned int totalMaxSeqLen = 0;
+    size_t totalLastKey = 0;
+    size_t dataOffset = 0;
+    T previousMaxKey = T();
+    bool hasPreviousKey = false;
+    for (size_t i = 0; i < federatedMembers.size(); ++i) {
+        const FederatedMember &member = federatedMembers[i];
+        Index *memberIndex = index + member.firstEntry;
+        size_t memberDataSize = 0;
+        isSortedById &= readIndex((char *) indexData[i]->getData(), indexData[i]->size(), memberIndex, memberDataSize);
+        indexData[i]->close();
+        delete indexData[i];
+
+        for (size_t j = 0; j < member.entries; ++j) {
+            addKeyOffset(&memberIndex[j].id, member.keyOffset);
+            memberIndex[j].offset += dataOffset;
+            totalLastKey = std::max(totalLastKey, indexIdToNum(&memberIndex[j].id));
+        }
+        // keys of a member have to be larger than all keys of the members before it
+        if (member.entries > 0) {
+            T minKey = memberIndex[0].id;
+            T maxKey = memberIndex[0].id;
+            for (size_t j = 1; j < member.entries; ++j) {
+                minKey = std::min(minKey, memberIndex[j].id);
+                maxKey = std::max(maxKey, memberIndex[j].id);
+            }
+            if (hasPreviousKey && (previousMaxKey < minKey) == false) {
+                Debug(Debug::ERROR) << "Keys of member " << member.name << " of " << dataFileName
+                                    << " overlap with the keys of the members before it\n";
+                EXIT(EXIT_FAILURE);
+            }
+            previousMaxKey = maxKey;
+            hasPreviousKey = true;
+        }
+
+        totalSize += memberDataSize;
+        totalMaxSeqLen = std::max(totalMaxSeqLen, maxSeqLen);
+        std::vector<std::string> memberFiles = FileUtil::findDatafiles(member.name.c_str());
+        for (size_t j = 0; j < memberFiles.size(); ++j) {
+            dataOffset += FileUtil::getFileSize(memberFiles[j]);
+        }
+    }
+    dataSize = totalSize;
+    maxSeqLen = totalMaxSeqLen;
+    lastKey = totalLastKey;
+    return isSortedById;
+}
+
+template<typename T>
+void DBReader<T>::readFederatedLookup() {
+    std::vector<MemoryMapped*> lookupData(federatedMembers.size());
+    std::vector<size_t> lookupStart(federatedMembers.size() + 1, 0);
+    for (size_t i = 0; i < federatedMembers.size(); ++i) {
+        std::string lookupFilename = federatedMembers[i].name + ".lookup";
+        lookupData[i] = new MemoryMapped(lookupFilename, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+        if (lookupData[i]->isValid() == false) {
+            Debug(Debug::ERROR) << "Cannot open lookup file " << lookupFilename << " of " << dataFileName << "!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        lookupStart[i + 1] = lookupStart[i] + Util::ompCountLines((char *) lookupData[i]->getData(), lookupData[i]->size(), threads);
+    }
+    lookupSize = lookupStart.back();
+    lookup = new(std::nothrow) LookupEntry[lookupSize];
+    incrementMemory(sizeof(LookupEntry) * lookupSize);
+    for (size_t i = 0; i < federatedMembers.size(); ++i) {
+        readLookup((char *) lookupData[i]->getData(), lookupData[i]->size(), lookup + lookupStart[i]);
+        lookupData[i]->close();
+        delete lookupData[i];
+        for (size_t j = lookupStart[i]; j < lookupStart[i + 1]; ++j) {
+            lookup[j].id += federatedMembers[i].keyOffset;
+        }
+    }
+}
+
+template<typename T>
+bool DBReader<T>::isFederated(const std::string &databaseName) {
+    return FileUtil::fileExists((databaseName + ".federated").c_str());
+}
+
+template<typename T>
+std::vector<typename DBReader<T>::FederatedMember> DBReader<T>::readFederatedManifest(const std::string &databaseName) {
+    std::string manifest = databaseName + ".federated";
+    std::ifstream in(manifest.c_str());
+    if (in.fail()) {
+        Debug(Debug::ERROR) << "Cannot open federated DB manifest " << manifest << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // relative member paths are resolved against the directory of the manifest
+    std::string baseDir = FileUtil::dirName(databaseName);
+    std::vector<FederatedMember> members;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> entry = Util::split(line, "\t");
+        if (entry.size() != 2 || Util::isNumber(entry[0]) == false) {
+            Debug(Debug::ERROR) << "Invalid line in federated DB manifest " << manifest << ": " << line << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        FederatedMember member;
+        member.name = (entry[1][0] == '/') ? entry[1] : baseDir + "/" + entry[1];
+        member.keyOffset = strtoull(entry[0].c_str(), NULL, 10);
+        member.firstEntry = 0;
+        member.entries = 0;
+        if (isFederated(member.name)) {
+            Debug(Debug::ERROR) << "Member " << member.name << " of " << manifest << " is a federated DB itself\n";
+            EXIT(EXIT_FAILURE);
+        }
+        members.push_back(member);
+    }
+    if (members.empty()) {
+        Debug(Debug::ERROR) << "Federated DB manifest " << manifest << " has no members\n";
+        EXIT(EXIT_FAILURE);
+    }
+    return members;
+}
+
+template<typename T>
+void DBReader<T>::writeFederatedManifest(const std::string &databaseName, const std::vector<FederatedMember> &members) {
+    std::string manifest = databaseName + ".federated";
+    FILE *handle = FileUtil::openAndDelete(manifest.c_str(), "w");
+    for (size_t i = 0; i < members.size(); ++i) {
+        fprintf(handle, "%zu\t%s\n", members[i].keyOffset, members[i].name.c_str());
+    }
+    if (fclose(handle) != 0) {
+        Debug(Debug::ERROR) << "Cannot close federated DB manifest " << manifest << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+template<typename T>
+void DBReader<T>::relocateFederatedManifest(const std::string &srcDbName, const std::string &dstDbName) {
+    std::vector<FederatedMember> members = readFederatedManifest(srcDbName);
+    for (size_t i = 0; i < members.size(); ++i) {
+        members[i].name = FileUtil::getRealPathFromSymLink(FileUtil::dirName(members[i].name)) + "/" + FileUtil::baseName(members[i].name);
+    }
+    writeFederatedManifest(dstDbName, members);
+}
+
 template<typename T> T DBReader<T>::getLastKey() {
     return lastKey;
 }
@@ -841,15 +1084,43 @@ void DBReader<std::string>::readIndexId(std::string* id, char* line, const char*
 }
 template<>
 void DBReader<unsigned int>::readIndexId(unsigned int* id, char*, const char** cols) {
-    *id = Util::fast_atoi<unsigned int>(cols[0]);
+    const size_t key = Util::fast_atoi<size_t>(cols[0]);
+    if (key > UINT_MAX) {
+        Debug(Debug::ERROR) << "Key " << key << " in " << indexFileName << " does not fit into 32 bits\n";
+        EXIT(EXIT_FAILURE);
+    }
+    *id = static_cast<unsigned int>(key);
+}
+template<>
+void DBReader<size_t>::readIndexId(size_t* id, char*, const char** cols) {
+    *id = Util::fast_atoi<size_t>(cols[0]);
 }
 
 template<>
-unsigned int DBReader<std::string>::indexIdToNum(std::string * id){
+void DBReader<std::string>::addKeyOffset(std::string*, size_t) {}
+template<>
+void DBReader<unsigned int>::addKeyOffset(unsigned int* id, size_t keyOffset) {
+    if (static_cast<size_t>(*id) + keyOffset > UINT_MAX) {
+        Debug(Debug::ERROR) << "Key " << *id << " with offset " << keyOffset << " does not fit into a database key\n";
+        EXIT(EXIT_FAILURE);
+    }
+    *id += static_cast<unsigned int>(keyOffset);
+}
+template<>
+void DBReader<size_t>::addKeyOffset(size_t* id, size_t keyOffset) {
+    *id += keyOffset;
+}
+
+template<>
+size_t DBReader<std::string>::indexIdToNum(std::string * id){
     return id->size();
 }
 template<>
-unsigned int DBReader<unsigned int>::indexIdToNum(unsigned int * id) {
+size_t DBReader<unsigned int>::indexIdToNum(unsigned int * id) {
+    return *id;
+}
+template<>
+size_t DBReader<size_t>::indexIdToNum(size_t * id) {
     return *id;
 }
 
@@ -986,6 +1257,26 @@ size_t DBReader<T>::findNextOffsetid(size_t id) {
     return nextOffset;
 }
 
+template<typename T>
+void DBReader<T>::setDictionary(const char *data, size_t size) {
+    if (compression != COMPRESSED) {
+        return;
+    }
+    // the digested dictionary is read-only and shared by the streams of all threads
+    ddict = ZSTD_createDDict(data, size);
+    if (ddict == NULL) {
+        Debug(Debug::ERROR) << "Cannot load zstd dictionary of " << (dataFileName != NULL ? dataFileName : "index") << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    for (int i = 0; i < threads; i++) {
+        size_t result = ZSTD_initDStream_usingDDict(dstream[i], ddict);
+        if (ZSTD_isError(result)) {
+            Debug(Debug::ERROR) << "ZSTD_initDStream_usingDDict() error " << ZSTD_getErrorName(result) << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+}
+
 template<typename T>
 int DBReader<T>::isCompressed(int dbtype) {
     return (dbtype & (1 << 31)) ? COMPRESSED : UNCOMPRESSED;
@@ -1060,6 +1351,16 @@ void DBReader<T>::moveDb(const std::string &srcDbName, const std::string &dstDbN
     if (FileUtil::fileExists((srcDbName + ".lookup").c_str())) {
         FileUtil::move((srcDbName + ".lookup").c_str(), (dstDbName + ".lookup").c_str());
     }
+    if (FileUtil::fileExists((srcDbName + ".orfloc").c_str())) {
+        FileUtil::move((srcDbName + ".orfloc").c_str(), (dstDbName + ".orfloc").c_str());
+    }
+    if (FileUtil::fileExists((srcDbName + ".zdict").c_str())) {
+        FileUtil::move((srcDbName + ".zdict").c_str(), (dstDbName + ".zdict").c_str());
+    }
+    if (isFederated(srcDbName)) {
+        relocateFederatedManifest(srcDbName, dstDbName);
+        FileUtil::remove((srcDbName + ".federated").c_str());
+    }
 }
 
 template<typename T>
@@ -1084,10 +1385,31 @@ void DBReader<T>::removeDb(const std::string &databaseName){
     if (FileUtil::fileExists(lookupFile.c_str())) {
         FileUtil::remove(lookupFile.c_str());
     }
+    std::string orfLocationFile = databaseName + ".orfloc";
+    if (FileUtil::fileExists(orfLocationFile.c_str())) {
+        FileUtil::remove(orfLocationFile.c_str());
+    }
+    std::string dictionaryFile = databaseName + ".zdict";
+    if (FileUtil::fileExists(dictionaryFile.c_str())) {
+        FileUtil::remove(dictionaryFile.c_str());
+    }
+    // only the manifest, the members are DBs of their own
+    std::string federatedFile = databaseName + ".federated";
+    if (FileUtil::fileExists(federatedFile.c_str())) {
+        FileUtil::remove(federatedFile.c_str());
+    }
 }
 
 typedef void (*DbAction)(const std::string &, const std::string &);
 void copyLinkDb(const std::string &databaseName, const std::string &outDb, DBFiles::Files dbFilesFlags, DbAction action) {
+    // the data of a federated DB is spread over its members, it can only be taken over together with the index of the members
+    if (((dbFilesFlags & DBFiles::DATA) && (dbFilesFlags & DBFiles::DATA_INDEX) == 0 && DBReader<unsigned int>::isFederated(databaseName))
+        || ((dbFilesFlags & DBFiles::HEADER) && (dbFilesFlags & DBFiles::HEADER_INDEX) == 0 && DBReader<unsigned int>::isFederated(databaseName + "_h"))) {
+        Debug(Debug::ERROR) << "Federated database " << databaseName << " is not supported by this module. "
+                            << "Please merge its members with concatdbs first.\n";
+        EXIT(EXIT_FAILURE);
+    }
+
     if (dbFilesFlags & DBFiles::DATA) {
         std::vector<std::string> names = FileUtil::findDatafiles(databaseName.c_str());
         if (names.size() == 1) {
@@ -1121,6 +1443,9 @@ void copyLinkDb(const std::string &databaseName, const std::string &outDb, DBFil
         { DBFiles::HEADER_DBTYPE, "_h.dbtype"         },
         { DBFiles::LOOKUP,        ".lookup"           },
         { DBFiles::SOURCE,        ".source"           },
+        { DBFiles::ORF_LOCATION,  ".orfloc"           },
+        { DBFiles::DICTIONARY,    ".zdict"            },
+        { DBFiles::HEADER_DICTIONARY, "_h.zdict"      },
         { DBFiles::TAX_MAPPING,   "_mapping"          },
         { DBFiles::TAX_NAMES,     "_names.dmp"        },
         { DBFiles::TAX_NODES,     "_nodes.dmp"        },
@@ -1140,6 +1465,19 @@ void copyLinkDb(const std::string &databaseName, const std::string &outDb, DBFil
             action(file, outDb + suffices[i].suffix);
         }
     }
+
+    // member paths in a manifest are relative to its directory, so it is rewritten instead of linked or copied
+    const DBSuffix manifests[] = {
+        { DBFiles::FEDERATED,        ""   },
+        { DBFiles::HEADER_FEDERATED, "_h" },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(manifests); ++i) {
+        std::string db = databaseName + manifests[i].suffix;
+        if (dbFilesFlags & manifests[i].flag && DBReader<unsigned int>::isFederated(db)) {
+            DBReader<unsigned int>::relocateFederatedManifest(db, outDb + manifests[i].suffix);
+        }
+    }
 }
 
 template<typename T>
@@ -1203,4 +1541,5 @@ void DBReader<T>::decomposeDomainByAminoAcid(size_t worldRank, size_t worldSize,
 }
 
 template class DBReader<unsigned int>;
+template class DBReader<size_t>;
 template class DBReader<std::string>;
@@ -39,12 +39,17 @@ struct DBFiles {
         CA3M_HDR          = (1ull << 16),
         CA3M_HDR_IDX      = (1ull << 17),
         TAX_BINARY        = (1ull << 18),
+        ORF_LOCATION      = (1ull << 19),
+        DICTIONARY        = (1ull << 20),
+        HEADER_DICTIONARY = (1ull << 21),
+        FEDERATED         = (1ull << 22),
+        HEADER_FEDERATED  = (1ull << 23),
 
 
-        GENERIC           = DATA | DATA_INDEX | DATA_DBTYPE,
-        HEADERS           = HEADER | HEADER_INDEX | HEADER_DBTYPE,
+        GENERIC           = DATA | DATA_INDEX | DATA_DBTYPE | FEDERATED,
+        HEADERS           = HEADER | HEADER_INDEX | HEADER_DBTYPE | HEADER_DICTIONARY | HEADER_FEDERATED,
         TAXONOMY          = TAX_MAPPING | TAX_NAMES | TAX_NODES | TAX_MERGED | TAX_BINARY,
-        SEQUENCE_DB       = GENERIC | HEADERS | TAXONOMY | LOOKUP | SOURCE,
+        SEQUENCE_DB       = GENERIC | HEADERS | TAXONOMY | LOOKUP | SOURCE | ORF_LOCATION | DICTIONARY,
         SEQUENCE_ANCILLARY= SEQUENCE_DB & (~GENERIC),
         SEQUENCE_NO_DATA_INDEX = SEQUENCE_DB & (~DATA_INDEX),
 
@@ -147,6 +152,17 @@ public:
         }
     };
 
+    // member of a federated DB
+    // A federated DB <db> consists of <db>.dbtype and the manifest <db>.federated, which lists the member DBs in order
+    // with the offset that is added to their keys. It is opened as if the members were concatenated, without copying them.
+    struct FederatedMember {
+        std::string name;
+        size_t keyOffset;
+        // entries of the member in the index of the federated DB, filled in by open
+        size_t firstEntry;
+        size_t entries;
+    };
+
     // = USE_DATA|USE_INDEX
     DBReader(const char* dataFileName, const char* indexFileName, int threads, int mode);
 
@@ -291,6 +307,20 @@ public:
         return totalDataSize;
     }
 
+    // members of a federated DB or an empty list if the DB is not federated
+    const std::vector<FederatedMember> &getFederatedMembers() const {
+        return federatedMembers;
+    }
+
+    static bool isFederated(const std::string &databaseName);
+
+    static std::vector<FederatedMember> readFederatedManifest(const std::string &databaseName);
+
+    static void writeFederatedManifest(const std::string &databaseName, const std::vector<FederatedMember> &members);
+
+    // writes the manifest of srcDbName for dstDbName with absolute member paths, so that it stays valid in another directory
+    static void relocateFederatedManifest(const std::string &srcDbName, const std::string &dstDbName);
+
     static void moveDatafiles(const std::vector<std::string>& files, const std::string& destination);
 
     static void moveDb(const std::string &srcDbName, const std::string &dstDbName);
@@ -310,7 +340,9 @@ public:
 
     void readIndexId(T* id, char * line, const char** cols);
 
-    unsigned int indexIdToNum(T* id);
+    void addKeyOffset(T* id, size_t keyOffset);
+
+    size_t indexIdToNum(T* id);
 
     void readMmapedDataInMemory();
 
@@ -427,6 +459,10 @@ public:
 
     static int isCompressed(int dbtype);
 
+    // zstd dictionary shared by all compressed entries, read from <data>.zdict on open
+    // readers that were unserialized from an index get it from there
+    void setDictionary(const char *data, size_t size);
+
     void setSequentialAdvice();
 
     void decomposeDomainByAminoAcid(size_t worldRank, size_t worldSize, size_t *startEntry, size_t *numEntries);
@@ -434,6 +470,10 @@ public:
 private:
     void checkClosed() const;
 
+    bool readFederatedIndex();
+
+    void readFederatedLookup();
+
     int threads;
 
     int dataMode;
@@ -481,6 +521,9 @@ private:
     bool externalData;
 
     bool didMlock;
+    ZSTD_DDict *ddict;
+
+    std::vector<FederatedMember> federatedMembers;
 
     // needed to prevent the compiler from optimizing away the loop
     char magicBytes;
@@ -11,6 +11,7 @@
 #define SIMDE_ENABLE_NATIVE_ALIASES
 #include <simde/simde-common.h>
 
+#include <climits>
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
@@ -34,6 +35,7 @@ DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsign
     indexFileNames = new char *[threads];
     compressedBuffers=NULL;
     compressedBufferSizes=NULL;
+    cdict=NULL;
     if((mode & Parameters::WRITER_COMPRESSED_MODE) != 0){
         compressedBuffers = new char*[threads];
         compressedBufferSizes = new size_t[threads];
@@ -48,6 +50,8 @@ DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsign
     std::fill(starts, starts + threads, 0);
     offsets = new size_t[threads];
     std::fill(offsets, offsets + threads, 0);
+    lengths = new size_t[threads];
+    std::fill(lengths, lengths + threads, 0);
     if((mode & Parameters::WRITER_COMPRESSED_MODE) != 0 ){
         datafileMode = "wb+";
     } else {
@@ -55,6 +59,7 @@ DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsign
     }
 
     closed = true;
+    longKeys = false;
 }
 
 size_t DBWriter::addToThreadBuffer(const void *data, size_t itmesize, size_t nitems, int threadIdx) {
@@ -75,6 +80,7 @@ size_t DBWriter::addToThreadBuffer(const void *data, size_t itmesize, size_t nit
 }
 
 DBWriter::~DBWriter() {
+    delete[] lengths;
     delete[] offsets;
     delete[] starts;
     delete[] indexFileNames;
@@ -190,6 +196,14 @@ void DBWriter::open(size_t bufferSize) {
     closed = false;
 }
 
+int DBWriter::setLongKeys(int dbtype, bool longKeys) {
+    if (dbtype == Parameters::DBTYPE_OMIT_FILE) {
+        return dbtype;
+    }
+    dbtype &= ~(static_cast<int>(Parameters::DBTYPE_EXTENDED_LONG_KEYS) << 16);
+    return longKeys ? DBReader<unsigned int>::setExtendedDbtype(dbtype, Parameters::DBTYPE_EXTENDED_LONG_KEYS) : dbtype;
+}
+
 void DBWriter::writeDbtypeFile(const char* path, int dbtype, bool isCompressed) {
     if (dbtype == Parameters::DBTYPE_OMIT_FILE) {
         return;
@@ -240,7 +254,21 @@ void DBWriter::close(bool merge, bool needsSort) {
     mergeResults(dataFileName, indexFileName, (const char **) dataFileNames, (const char **) indexFileNames,
                  threads, merge, ((mode & Parameters::WRITER_LEXICOGRAPHIC_MODE) != 0), needsSort);
 
-    writeDbtypeFile(dataFileName, dbtype, (mode & Parameters::WRITER_COMPRESSED_MODE) != 0);
+    writeDbtypeFile(dataFileName, setLongKeys(dbtype, longKeys), (mode & Parameters::WRITER_COMPRESSED_MODE) != 0);
+    if (cdict != NULL) {
+        std::string dictionaryFile = std::string(dataFileName) + ".zdict";
+        FILE *handle = FileUtil::openAndDelete(dictionaryFile.c_str(), "wb");
+        if (fwrite(dictionary.c_str(), sizeof(char), dictionary.size(), handle) != dictionary.size()) {
+            Debug(Debug::ERROR) << "Cannot write dictionary file " << dictionaryFile << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (fclose(handle) != 0) {
+            Debug(Debug::ERROR) << "Cannot close dictionary file " << dictionaryFile << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        ZSTD_freeCDict(cdict);
+        cdict = NULL;
+    }
 
     for (unsigned int i = 0; i < threads; i++) {
         delete [] dataFilesBuffer[i];
@@ -262,7 +290,14 @@ void DBWriter::writeStart(unsigned int thrIdx) {
         state[thrIdx] = INIT_STATE;
         threadBufferOffset[thrIdx]=0;
         int cLevel = 3;
-        size_t const initResult = ZSTD_initCStream(cstream[thrIdx], cLevel);
+        size_t initResult;
+        if (cdict != NULL) {
+            // the reader knows the dictionary, so neither its id nor the content size need to be in each frame
+            ZSTD_frameParameters frameParams = { 0, 0, 1 };
+            initResult = ZSTD_initCStream_usingCDict_advanced(cstream[thrIdx], cdict, frameParams, ZSTD_CONTENTSIZE_UNKNOWN);
+        } else {
+            initResult = ZSTD_initCStream(cstream[thrIdx], cLevel);
+        }
         if (ZSTD_isError(initResult)) {
             Debug(Debug::ERROR) << "ZSTD_initCStream() error in thread " << thrIdx << ". Error "
                                 << ZSTD_getErrorName(initResult) << "\n";
@@ -278,7 +313,8 @@ size_t DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx
         EXIT(EXIT_FAILURE);
     }
     bool isCompressedDB = (mode & Parameters::WRITER_COMPRESSED_MODE) != 0;
-    if(isCompressedDB && state[thrIdx] == INIT_STATE && dataSize < 60){
+    // with a dictionary even short entries share enough with it to be worth compressing
+    if(isCompressedDB && state[thrIdx] == INIT_STATE && dataSize < (cdict != NULL ? 16 : 60)){
         state[thrIdx] = NOTCOMPRESSED;
     }
     size_t totalWriten = 0;
@@ -319,7 +355,7 @@ size_t DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx
     return totalWriten;
 }
 
-void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte, bool addIndexEntry) {
+void DBWriter::writeEnd(size_t key, unsigned int thrIdx, bool addNullByte, bool addIndexEntry) {
     // close stream
     bool isCompressedDB = (mode & Parameters::WRITER_COMPRESSED_MODE) != 0;
     if(isCompressedDB) {
@@ -385,11 +421,32 @@ void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte,
         if (isCompressedDB && state[thrIdx]==NOTCOMPRESSED) {
             length -= sizeof(unsigned int);
         }
+        lengths[thrIdx] = length;
         writeIndexEntry(key, starts[thrIdx], length, thrIdx);
     }
 }
 
-void DBWriter::writeIndexEntry(unsigned int key, size_t offset, size_t length, unsigned int thrIdx){
+void DBWriter::writeDuplicateEntry(size_t key, unsigned int thrIdx) {
+    writeIndexEntry(key, starts[thrIdx], lengths[thrIdx], thrIdx);
+}
+
+void DBWriter::setDictionary(const char *data, size_t size) {
+    if ((mode & Parameters::WRITER_COMPRESSED_MODE) == 0) {
+        Debug(Debug::ERROR) << "A dictionary can only be used for compressed databases\n";
+        EXIT(EXIT_FAILURE);
+    }
+    dictionary.assign(data, size);
+    cdict = ZSTD_createCDict(dictionary.c_str(), dictionary.size(), 3);
+    if (cdict == NULL) {
+        Debug(Debug::ERROR) << "Cannot create zstd dictionary for " << dataFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+void DBWriter::writeIndexEntry(size_t key, size_t offset, size_t length, unsigned int thrIdx){
+    if (key > UINT_MAX && longKeys == false) {
+        __atomic_store_n(&longKeys, true, __ATOMIC_RELAXED);
+    }
     char buffer[1024];
     size_t len = indexToBuffer(buffer, key, offset, length );
     size_t written = fwrite(buffer, sizeof(char), len, indexFiles[thrIdx]);
@@ -400,15 +457,15 @@ void DBWriter::writeIndexEntry(unsigned int key, size_t offset, size_t length, u
 }
 
 
-void DBWriter::writeData(const char *data, size_t dataSize, unsigned int key, unsigned int thrIdx, bool addNullByte, bool addIndexEntry) {
+void DBWriter::writeData(const char *data, size_t dataSize, size_t key, unsigned int thrIdx, bool addNullByte, bool addIndexEntry) {
     writeStart(thrIdx);
     writeAdd(data, dataSize, thrIdx);
     writeEnd(key, thrIdx, addNullByte, addIndexEntry);
 }
 
-size_t DBWriter::indexToBuffer(char *buff1, unsigned int key, size_t offsetStart, size_t len){
+size_t DBWriter::indexToBuffer(char *buff1, size_t key, size_t offsetStart, size_t len){
     char * basePos = buff1;
-    char * tmpBuff = Itoa::u32toa_sse2(static_cast<uint32_t>(key), buff1);
+    char * tmpBuff = (key <= UINT_MAX) ? Itoa::u32toa_sse2(static_cast<uint32_t>(key), buff1) : Itoa::u64toa_sse2(static_cast<uint64_t>(key), buff1);
     *(tmpBuff-1) = '\t';
     tmpBuff = Itoa::u64toa_sse2(static_cast<uint64_t>(offsetStart), tmpBuff);
     *(tmpBuff-1) = '\t';
@@ -484,6 +541,20 @@ void DBWriter::writeIndexEntryToFile(FILE *outFile, char *buff1, DBReader<unsign
     fwrite(buff1, sizeof(char), (tmpBuff - buff1), outFile);
 }
 
+template <>
+void DBWriter::writeIndexEntryToFile(FILE *outFile, char *buff1, DBReader<size_t>::Index &index){
+    char * tmpBuff = (index.id <= UINT_MAX) ? Itoa::u32toa_sse2((uint32_t)index.id, buff1) : Itoa::u64toa_sse2((uint64_t)index.id, buff1);
+    *(tmpBuff-1) = '\t';
+    size_t currOffset = index.offset;
+    tmpBuff = Itoa::u64toa_sse2(currOffset, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    uint32_t sLen = index.length;
+    tmpBuff = Itoa::u32toa_sse2(sLen,tmpBuff);
+    *(tmpBuff-1) = '\n';
+    *(tmpBuff) = '\0';
+    fwrite(buff1, sizeof(char), (tmpBuff - buff1), outFile);
+}
+
 template <>
 void DBWriter::writeIndexEntryToFile(FILE *outFile, char *buff1, DBReader<std::string>::Index &index)
 {
@@ -510,6 +581,14 @@ void DBWriter::writeIndex(FILE *outFile, size_t indexSize, DBReader<unsigned int
     }
 }
 
+template <>
+void DBWriter::writeIndex(FILE *outFile, size_t indexSize, DBReader<size_t>::Index *index) {
+    char buff1[1024];
+    for (size_t id = 0; id < indexSize; id++) {
+        writeIndexEntryToFile(outFile, buff1, index[id]);
+    }
+}
+
 template <>
 void DBWriter::writeIndex(FILE *outFile, size_t indexSize, DBReader<std::string>::Index *index){
     char buff1[1024];
@@ -621,10 +700,10 @@ void DBWriter::mergeIndex(const char** indexFilenames, unsigned int fileCount, c
     }
     size_t globalOffset = dataSizes[0];
     for (unsigned int fileIdx = 1; fileIdx < fileCount; fileIdx++) {
-        DBReader<unsigned int> reader(indexFilenames[fileIdx], indexFilenames[fileIdx], 1, DBReader<unsigned int>::USE_INDEX);
-        reader.open(DBReader<unsigned int>::HARDNOSORT);
+        DBReader<size_t> reader(indexFilenames[fileIdx], indexFilenames[fileIdx], 1, DBReader<size_t>::USE_INDEX);
+        reader.open(DBReader<size_t>::HARDNOSORT);
         if (reader.getSize() > 0) {
-            DBReader<unsigned int>::Index * index = reader.getIndex();
+            DBReader<size_t>::Index * index = reader.getIndex();
             for (size_t i = 0; i < reader.getSize(); i++) {
                 size_t currOffset = index[i].offset;
                 index[i].offset = globalOffset + currOffset;
@@ -644,10 +723,10 @@ void DBWriter::mergeIndex(const char** indexFilenames, unsigned int fileCount, c
 
 void DBWriter::sortIndex(const char *inFileNameIndex, const char *outFileNameIndex, const bool lexicographicOrder){
     if (lexicographicOrder == false) {
-        // sort the index
-        DBReader<unsigned int> indexReader(inFileNameIndex, inFileNameIndex, 1, DBReader<unsigned int>::USE_INDEX);
-        indexReader.open(DBReader<unsigned int>::NOSORT);
-        DBReader<unsigned int>::Index *index = indexReader.getIndex();
+        // sort the index, keys can be larger than 32 bits
+        DBReader<size_t> indexReader(inFileNameIndex, inFileNameIndex, 1, DBReader<size_t>::USE_INDEX);
+        indexReader.open(DBReader<size_t>::NOSORT);
+        DBReader<size_t>::Index *index = indexReader.getIndex();
         FILE *index_file  = FileUtil::openAndDelete(outFileNameIndex, "w");
         writeIndex(index_file, indexReader.getSize(), index);
         if (fclose(index_file) != 0) {
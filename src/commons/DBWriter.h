@@ -27,11 +27,12 @@ public:
 
     void writeStart(unsigned int thrIdx = 0);
     size_t writeAdd(const char* data, size_t dataSize, unsigned int thrIdx = 0);
-    void writeEnd(unsigned int key, unsigned int thrIdx = 0, bool addNullByte = true, bool addIndexEntry = true);
+    // keys above UINT_MAX are written as they are, the dbtype of the DB is then marked with DBTYPE_EXTENDED_LONG_KEYS
+    void writeEnd(size_t key, unsigned int thrIdx = 0, bool addNullByte = true, bool addIndexEntry = true);
 
-    void writeData(const char *data, size_t dataSize, unsigned int key, unsigned int threadIdx = 0, bool addNullByte = true, bool addIndexEntry = true);
+    void writeData(const char *data, size_t dataSize, size_t key, unsigned int threadIdx = 0, bool addNullByte = true, bool addIndexEntry = true);
 
-    static size_t indexToBuffer(char *buff1, unsigned int key, size_t offsetStart, size_t len);
+    static size_t indexToBuffer(char *buff1, size_t key, size_t offsetStart, size_t len);
 
     void alignToPageSize(int thrIdx = 0);
 
@@ -41,10 +42,26 @@ public:
                              const std::vector<std::pair<std::string, std::string>> &files,
                              bool lexicographicOrder = false);
 
-    void writeIndexEntry(unsigned int key, size_t offset, size_t length, unsigned int thrIdx);
+    void writeIndexEntry(size_t key, size_t offset, size_t length, unsigned int thrIdx);
+
+    // adds an index entry for key that points at the data of the last entry written by this thread,
+    // entries with identical data are stored only once this way (see EntryDuplicates)
+    void writeDuplicateEntry(size_t key, unsigned int thrIdx = 0);
+
+    // true if a key did not fit into 32 bits
+    bool hasLongKeys() const {
+        return longKeys;
+    }
+
+    // sets or clears DBTYPE_EXTENDED_LONG_KEYS in dbtype
+    static int setLongKeys(int dbtype, bool longKeys);
 
     static void writeDbtypeFile(const char* path, int dbtype, bool isCompressed);
 
+    // compress all entries with a shared zstd dictionary (only in compressed mode), it is stored as <data>.zdict
+    // entries are then compressed down to a few bytes, since the dictionary holds what they have in common
+    void setDictionary(const char *data, size_t size);
+
     size_t getStart(unsigned int threadIdx){
         return starts[threadIdx];
     }
@@ -97,17 +114,21 @@ private:
 
     size_t* starts;
     size_t* offsets;
+    size_t* lengths;
     int* state;
     static const int INIT_STATE=0;
     static const int NOTCOMPRESSED=1;
     static const int COMPRESSED=2;
     ZSTD_CStream** cstream;
+    ZSTD_CDict* cdict;
+    std::string dictionary;
 
     const unsigned int threads;
     const size_t mode;
     int dbtype;
 
     bool closed;
+    bool longKeys;
 
     std::string datafileMode;
 
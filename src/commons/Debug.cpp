@@ -1,5 +1,11 @@
 #include "Debug.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 int Debug::debugLevel = Debug::INFO;
 
@@ -9,3 +15,310 @@ void Debug::setDebugLevel (int i) {
     debugLevel = i;
 }
 
+// never destroyed, Debug can still be used from other static destructors
+std::mutex &Debug::outputMutex() {
+    static std::mutex *mutex = new std::mutex;
+    return *mutex;
+}
+
+struct Debug::Progress::State {
+    bool interactive;
+    // processed items at the last render
+    size_t printed;
+    bool started;
+    bool finished;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+    std::thread *worker;
+
+    // lock order is outputMutex() before the state mutex, so the state mutex is dropped while waiting for output
+    void run(Progress *progress) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (stopping == false) {
+            wakeup.wait_for(lock, std::chrono::milliseconds(100));
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> outputLock(Debug::outputMutex());
+                std::lock_guard<std::mutex> stateLock(mutex);
+                progress->render(false);
+            }
+            lock.lock();
+        }
+    }
+};
+
+// all live progress bars, the most recent one is last
+// never destroyed, Debug can still be used from other static destructors
+static std::mutex &registryMutex() {
+    static std::mutex *mutex = new std::mutex;
+    return *mutex;
+}
+
+static std::vector<Debug::Progress *> &registry() {
+    static std::vector<Debug::Progress *> *progresses = new std::vector<Debug::Progress *>;
+    return *progresses;
+}
+
+unsigned int Debug::Progress::nextThreadSlot() {
+    static unsigned int next = 0;
+    return __sync_fetch_and_add(&next, 1) % SLOTS;
+}
+
+Debug::Progress::Progress(size_t totalEntries) {
+    init(totalEntries);
+}
+
+Debug::Progress::Progress() {
+    init(SIZE_MAX);
+}
+
+void Debug::Progress::init(size_t totalEntries) {
+    static TtyCheck check;
+    this->totalEntries = totalEntries;
+    counters = new Slot[SLOTS];
+    for (unsigned int i = 0; i < SLOTS; ++i) {
+        counters[i].count = 0;
+    }
+    state = new State;
+    state->interactive = check.tty;
+    state->printed = 0;
+    state->started = false;
+    state->finished = false;
+    state->stopping = false;
+    state->worker = NULL;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(this);
+    }
+    // nothing would be printed
+    if (Debug::debugLevel >= Debug::INFO) {
+        state->worker = new std::thread(&State::run, state, this);
+    }
+}
+
+Debug::Progress::~Progress() {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        std::vector<Progress *> &progresses = registry();
+        progresses.erase(std::remove(progresses.begin(), progresses.end(), this), progresses.end());
+    }
+    if (state->worker != NULL) {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stopping = true;
+        }
+        state->wakeup.notify_one();
+        state->worker->join();
+        delete state->worker;
+        std::lock_guard<std::mutex> outputLock(Debug::outputMutex());
+        std::lock_guard<std::mutex> lock(state->mutex);
+        render(true);
+    }
+    delete state;
+    delete[] counters;
+}
+
+size_t Debug::Progress::getProcessed() const {
+    size_t processed = 0;
+    for (unsigned int i = 0; i < SLOTS; ++i) {
+        processed += __atomic_load_n(&counters[i].count, __ATOMIC_RELAXED);
+    }
+    return processed;
+}
+
+void Debug::Progress::reset(size_t totalEntries) {
+    std::lock_guard<std::mutex> outputLock(Debug::outputMutex());
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->worker != NULL) {
+        render(true);
+    }
+    for (unsigned int i = 0; i < SLOTS; ++i) {
+        __atomic_store_n(&counters[i].count, 0, __ATOMIC_RELAXED);
+    }
+    this->totalEntries = totalEntries;
+    state->printed = 0;
+    state->started = false;
+    state->finished = false;
+}
+
+void Debug::Progress::flushAll() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::vector<Progress *> &progresses = registry();
+    for (size_t i = 0; i < progresses.size(); ++i) {
+        Progress *progress = progresses[i];
+        if (progress->state->worker == NULL) {
+            continue;
+        }
+        std::lock_guard<std::mutex> progressLock(progress->state->mutex);
+        progress->render(false);
+    }
+}
+
+bool Debug::Progress::getActive(size_t &processed, size_t &total, double &elapsed) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::vector<Progress *> &progresses = registry();
+    if (progresses.empty()) {
+        return false;
+    }
+    Progress *progress = progresses.back();
+    processed = progress->getProcessed();
+    total = progress->totalEntries;
+    elapsed = progress->timer.getTimediff();
+    return true;
+}
+
+// called with the state mutex held
+void Debug::Progress::render(bool final) {
+    size_t processed = getProcessed();
+    if (totalEntries != SIZE_MAX) {
+        processed = std::min(processed, totalEntries);
+    }
+    if (processed == 0 || state->finished || (processed == state->printed && final == false)) {
+        return;
+    }
+    if (totalEntries == SIZE_MAX) {
+        renderUnknownTotal(processed);
+    } else {
+        renderKnownTotal(processed);
+    }
+    state->printed = processed;
+    state->started = true;
+    std::cout << std::flush;
+}
+
+void Debug::Progress::renderUnknownTotal(size_t processed) {
+    std::string line;
+    if (state->interactive == false) {
+        if (state->started == false) {
+            line.push_back('[');
+        }
+        // item ids that were processed since the last render, every 10000th item is marked
+        const size_t first = state->printed;
+        const size_t last = processed - 1;
+        for (size_t id = (first / 10000 + 1) * 10000; id <= last; id += 10000) {
+            if (id % 1000000 == 0) {
+                line.append("\t");
+                line.append(SSTR(id / 1000000));
+                line.append(" Mio. sequences processed\n");
+            } else {
+                line.push_back('=');
+            }
+        }
+    } else {
+        line.push_back('[');
+        line.append(SSTR(processed));
+        line.append("] ");
+        line.append(timer.lapProgress());
+        line.push_back('\r');
+    }
+    std::cout << line;
+}
+
+void Debug::Progress::renderKnownTotal(size_t processed) {
+    const size_t id = processed - 1;
+    const bool done = (processed == totalEntries);
+    const float progress = (totalEntries == 1) ? 1.0 : (static_cast<float>(id) / static_cast<float>(totalEntries - 1));
+    std::string line;
+    if (state->interactive == false) {
+        if (state->started == false) {
+            line.push_back('[');
+        }
+        const size_t prevId = state->printed > 0 ? state->printed - 1 : 0;
+        const float prevProgress = (totalEntries == 1 || state->printed == 0) ? 0.0 : (static_cast<float>(prevId) / static_cast<float>(totalEntries - 1));
+        const int prevPos = BARWIDTH * prevProgress;
+        const int pos = BARWIDTH * progress;
+        line.append(std::max(pos - prevPos, 0), '=');
+        if (done) {
+            line.append("] ");
+            line.append(buildItemString(id));
+            line.push_back(' ');
+            line.append(timer.lapProgress());
+            line.push_back('\n');
+            state->finished = true;
+        }
+        std::cout << line;
+        return;
+    }
+
+    line.push_back('[');
+    const int pos = BARWIDTH * progress;
+    for (int i = 0; i < BARWIDTH; ++i) {
+        if (i < pos) {
+            line.push_back('=');
+        } else if (i == pos) {
+            line.push_back('>');
+        } else {
+            line.push_back(' ');
+        }
+    }
+    char buffer[32];
+    int n = sprintf(buffer, "%.2f", progress * 100.0f);
+    line.append("] ");
+    line.append(buffer, n);
+    line.append("% ");
+    line.append(buildItemString(id));
+    line.push_back(' ');
+    if (id == 0) {
+        line.append("eta -");
+    } else if (done) {
+        line.append(timer.lapProgress());
+    } else {
+        double timeDiff = timer.getTimediff();
+        double eta = (timeDiff / progress * 1.0) - timeDiff;
+        long long sec = (time_t) eta;
+        line.append("eta ");
+        if (sec >= 3600) {
+            line.append(SSTR(sec / 3600));
+            line.append("h ");
+        }
+        if (sec >= 60) {
+            line.append(SSTR((sec % 3600 / 60)));
+            line.append("m ");
+        }
+        line.append(SSTR(sec % 60));
+        // need to overwrite the rest
+        line.append("s       ");
+    }
+    line.push_back(done ? '\n' : '\r');
+    state->finished = done;
+    std::cout << line;
+}
+
+std::string Debug::Progress::buildItemString(size_t id) {
+    std::string line;
+    unsigned int exp = MathUtil::log10(static_cast<unsigned int>(id+1));
+    unsigned int base = 100;
+
+    char appending=' ';
+    switch(exp){
+        case 3:
+        case 4:
+        case 5:
+            base = MathUtil::log10base(1000);
+            appending = 'K';
+            break;
+        case 6:
+        case 7:
+        case 8:
+            base = MathUtil::log10base(1000000);
+            appending = 'M';
+            break;
+        case 9:
+        case 10:
+        case 11:
+            base = MathUtil::log10base(1000000000);
+            appending = 'B';
+    }
+    char fmtbuffer[32];
+    if(exp < 3){
+        int fmtElm = sprintf(fmtbuffer, "%d",  static_cast<int>(id+1));
+        line.append(fmtbuffer, fmtElm);
+    }else{
+        int fmtElm = sprintf(fmtbuffer, "%.2f", static_cast<float>(id+1)/ static_cast<float>(base));
+        line.append(fmtbuffer, fmtElm);
+        line.push_back(appending);
+    }
+    return line;
+}
@@ -8,6 +8,8 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <cstddef>
+#include <climits>
+#include <mutex>
 #include <sys/stat.h>
 
 class TtyCheck {
@@ -68,6 +70,11 @@ public:
     };
 
     ~Debug(){
+        if (level > debugLevel) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(outputMutex());
+        Progress::flushAll();
         if (level <= ERROR && level <= debugLevel){
             std::cout << std::flush;
             if(interactive){
@@ -112,180 +119,71 @@ public:
     }
     static void setDebugLevel(int i);
 
+    // serializes the progress rendering and the printing of finished messages
+    static std::mutex &outputMutex();
+
+    // Progress bar for loops over many small items. Every thread counts into its own cache line, a background
+    // thread aggregates the counters and renders the bar a few times per second. Rendering and anything else
+    // printed through Debug hold outputMutex(), and Debug first renders the pending progress, so the output is
+    // not interleaved.
     class Progress{
-    private:
-        size_t currentPos;
-        size_t prevPrintedId;
-        size_t totalEntries;
-        bool interactive;
-        Timer timer;
+    public:
+        Progress(size_t totalEntries);
+        Progress();
+        ~Progress();
 
-        const static int BARWIDTH = 65;
+        void reset(size_t totalEntries);
 
-        std::string buildItemString(size_t id){
-            std::string line;
-            unsigned int exp = MathUtil::log10(static_cast<unsigned int>(id+1));
-            unsigned int base = 100;
-
-            char appending=' ';
-            switch(exp){
-                case 3:
-                case 4:
-                case 5:
-                    base = MathUtil::log10base(1000);
-                    appending = 'K';
-                    break;
-                case 6:
-                case 7:
-                case 8:
-                    base = MathUtil::log10base(1000000);
-                    appending = 'M';
-                    break;
-                case 9:
-                case 10:
-                case 11:
-                    base = MathUtil::log10base(1000000000);
-                    appending = 'B';
-            }
-            char fmtbuffer[32];
-            if(exp < 3){
-                int fmtElm = sprintf(fmtbuffer, "%d",  static_cast<int>(id+1));
-                line.append(fmtbuffer, fmtElm);
-            }else{
-                int fmtElm = sprintf(fmtbuffer, "%.2f", static_cast<float>(id+1)/ static_cast<float>(base));
-                line.append(fmtbuffer, fmtElm);
-                line.push_back(appending);
-            }
-            return line;
+        void updateProgress(){
+            __atomic_fetch_add(&counters[threadSlot()].count, 1, __ATOMIC_RELAXED);
         }
 
-    public:
-        Progress(size_t totalEntries)
-                :  currentPos(0), prevPrintedId(0), totalEntries(totalEntries){
-            static TtyCheck check;
-            interactive = check.tty;
-        }
+        size_t getProcessed() const;
 
-        Progress() : currentPos(0),  prevPrintedId(0), totalEntries(SIZE_MAX){
-            static TtyCheck check;
-            interactive = check.tty;
+        size_t getTotal() const {
+            return totalEntries;
         }
 
-        void reset(size_t totalEntries) {
-            this->totalEntries = totalEntries;
-            currentPos = 0;
-            prevPrintedId = 0;
-        }
+        // renders all progress bars that have unprinted progress, the caller holds outputMutex()
+        static void flushAll();
 
-        void updateProgress(){
-            size_t id = __sync_fetch_and_add(&currentPos, 1);
-            // if no active terminal exists write dots
-            if(interactive == false){
-                if(totalEntries==SIZE_MAX) {
-                    if(id==0) {
-                        Debug(INFO) << '[';
-                    }
-                    if (id % 1000000 == 0 && id > 0){
-                        Debug(INFO) << "\t" << (id / 1000000) << " Mio. sequences processed\n";
-                        fflush(stdout);
-                    }
-                    else if (id % 10000 == 0 && id > 0) {
-                        Debug(INFO) << "=";
-                        fflush(stdout);
-                    }
-                }else{
-                    if(id==0) {
-                        Debug(INFO) << '[';
-                    }
-                    float progress = (totalEntries==1) ? 1.0 : (static_cast<float>(id) / static_cast<float>(totalEntries-1));
-                    float prevPrintedProgress = (totalEntries==1 || id == 0) ? 0.0 : (static_cast<float>(id-1) / static_cast<float>(totalEntries-1));
-                    int prevPos = BARWIDTH * prevPrintedProgress;
-                    int pos     = BARWIDTH * progress;
-                    for (int write = prevPos; write < pos; write++) {
-                        Debug(INFO) << '=';
-                        fflush(stdout);
-                    }
-
-                    if(id == (totalEntries - 1) ){
-                        Debug(INFO) << "] ";
-                        Debug(INFO) << buildItemString(id);
-                        Debug(INFO) << " ";
-                        Debug(INFO) << timer.lapProgress();
-                        Debug(INFO) << "\n";
-                    }
-                }
-            }else{
-                if(totalEntries==SIZE_MAX){
-                    if(id > prevPrintedId + 100) {
-                        std::string line;
-                        line.push_back('[');
-                        line.append(SSTR(id+1));
-                        line.append("] ");
-                        line.append(timer.lapProgress());
-                        line.push_back('\r');
-                        Debug(Debug::INFO) << line;
-                        fflush(stdout);
-                        prevPrintedId = id;
-                    }
-                }else{
-                    float progress = (totalEntries==1) ? 1.0 : (static_cast<float>(id) / static_cast<float>(totalEntries-1));
-                    float prevPrintedProgress = (totalEntries==1) ? 0.0 : (static_cast<float>(prevPrintedId) / static_cast<float>(totalEntries-1));
-                    if(progress-prevPrintedProgress > 0.01 || id == (totalEntries - 1)  || id == 0 ){
-                        std::string line;
-                        line.push_back('[');
-                        int pos = BARWIDTH * progress;
-                        for (int i = 0; i < BARWIDTH; ++i) {
-                            if (i < pos) {
-                                line.push_back('=');
-                            }else if (i == pos) {
-                                line.push_back('>');
-                            } else {
-                                line.push_back(' ');
-                            }
-                        }
-                        char buffer[32];
-                        int n = sprintf(buffer, "%.2f", progress * 100.0f);
-                        line.append("] ");
-                        line.append(buffer, n);
-                        line.append("% ");
-                        line.append(buildItemString(id));
-                        line.push_back(' ');
-                        if(id == 0){
-                            line.append("eta -");
-                        }else if(id == (totalEntries - 1) ){
-                            line.append(timer.lapProgress());
-                        }else{
-                            double timeDiff = timer.getTimediff();
-                            double eta = (timeDiff/progress * 1.0) - timeDiff;
-                            long long sec = (time_t)eta;
-//                            long long msec = (time_t)((eta - sec) * 1e3);
-//                            std::cout << timeDiff << "\t" << progress << std::endl;
-                            line.append("eta ");
-                            if(sec >= 3600){
-                                line.append(SSTR(sec / 3600));
-                                line.append("h ");
-                            }
-                            if(sec >= 60){
-                                line.append(SSTR( (sec % 3600 / 60)));
-                                line.append("m ");
-                            }
-                            line.append(SSTR(sec % 60));
-                            // need to overwrite the rest
-                            line.append("s       ");
-                        }
-                        //printf("%zu\t%zu\t%f\n", id, totalEntries, progress);
-                        line.push_back((id == (totalEntries - 1) ) ? '\n' : '\r' );
-                        Debug(Debug::INFO) << line;
-                        fflush(stdout);
-                        prevPrintedId=id;
-                    }
-                }
-            }
-        }
-    };
+        // processed and total items (SIZE_MAX if unknown) of the most recently started progress bar
+        static bool getActive(size_t &processed, size_t &total, double &elapsed);
 
+        struct State;
 
+    private:
+        Progress(const Progress &);
+        Progress &operator=(const Progress &);
+
+        struct Slot {
+            size_t count;
+            char padding[64 - sizeof(size_t)];
+        };
+        const static unsigned int SLOTS = 128;
+        const static int BARWIDTH = 65;
 
+        static unsigned int nextThreadSlot();
+        static unsigned int threadSlot() {
+            static __thread unsigned int slot = UINT_MAX;
+            if (slot == UINT_MAX) {
+                slot = nextThreadSlot();
+            }
+            return slot;
+        }
+
+        Slot *counters;
+        size_t totalEntries;
+        Timer timer;
+        State *state;
+
+        void init(size_t totalEntries);
+        void render(bool final);
+        void renderUnknownTotal(size_t processed);
+        void renderKnownTotal(size_t processed);
+        static std::string buildItemString(size_t id);
+        friend struct State;
+    };
 
 private:
     const int level;
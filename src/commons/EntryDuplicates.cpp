@@ -0,0 +1,65 @@
+#include "EntryDuplicates.h"
+#include "Debug.h"
+#include "FastSort.h"
+
+struct EntryLocation {
+    size_t offset;
+    unsigned int length;
+    unsigned int id;
+
+    static bool compareByLocation(const EntryLocation &first, const EntryLocation &second) {
+        if (first.offset != second.offset) {
+            return first.offset < second.offset;
+        }
+        if (first.length != second.length) {
+            return first.length < second.length;
+        }
+        return first.id < second.id;
+    }
+};
+
+EntryDuplicates::EntryDuplicates(DBReader<unsigned int> &reader, bool deduplicated) : duplicateCount(0) {
+    if (deduplicated == false) {
+        return;
+    }
+    const size_t size = reader.getSize();
+
+    // databases without duplicates have increasing offsets almost always, so they are recognized without sorting
+    bool increasing = true;
+    for (size_t id = 1; id < size && increasing; ++id) {
+        increasing = reader.getIndex(id - 1)->offset < reader.getIndex(id)->offset;
+    }
+    if (increasing) {
+        return;
+    }
+
+    std::vector<EntryLocation> locations(size);
+    for (size_t id = 0; id < size; ++id) {
+        const DBReader<unsigned int>::Index *index = reader.getIndex(id);
+        locations[id].offset = index->offset;
+        locations[id].length = index->length;
+        locations[id].id = static_cast<unsigned int>(id);
+    }
+    SORT_PARALLEL(locations.begin(), locations.end(), EntryLocation::compareByLocation);
+
+    representative.resize(size);
+    next.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        const EntryLocation &location = locations[i];
+        next[location.id] = UINT_MAX;
+        if (i > 0 && locations[i - 1].offset == location.offset && locations[i - 1].length == location.length) {
+            representative[location.id] = representative[locations[i - 1].id];
+            next[locations[i - 1].id] = location.id;
+            duplicateCount++;
+        } else {
+            representative[location.id] = location.id;
+        }
+    }
+
+    if (duplicateCount == 0) {
+        std::vector<unsigned int>().swap(representative);
+        std::vector<unsigned int>().swap(next);
+        return;
+    }
+    Debug(Debug::INFO) << duplicateCount << " of " << size << " entries share their data with another entry\n";
+}
@@ -0,0 +1,51 @@
+#ifndef MMSEQS_ENTRYDUPLICATES_H
+#define MMSEQS_ENTRYDUPLICATES_H
+
+// Groups the entries of a database whose index entries point at the same data, e.g. the identical sequences
+// of createdb --dedup. The entry with the smallest id of each group is its representative, work that only
+// depends on the data is done once for the representative and its result is fanned out to the rest of the group.
+// The index itself is the mapping from the keys to the shared data, so it stays valid through every module
+// that rewrites or subsets the index. Only DBs marked with DBTYPE_EXTENDED_DEDUP are scanned, entries that
+// share their data for other reasons (e.g. createsubdb) are treated as distinct.
+
+#include "DBReader.h"
+#include "Parameters.h"
+
+#include <climits>
+#include <cstddef>
+#include <vector>
+
+class EntryDuplicates {
+public:
+    // groups the entries only if deduplicated is set, otherwise every entry is its own representative
+    EntryDuplicates(DBReader<unsigned int> &reader, bool deduplicated);
+
+    static bool isDeduplicated(int dbtype) {
+        return DBReader<unsigned int>::getExtendedDbtype(dbtype) & Parameters::DBTYPE_EXTENDED_DEDUP;
+    }
+
+    // number of entries that are not the representative of their group
+    size_t getDuplicateCount() const {
+        return duplicateCount;
+    }
+
+    bool isDuplicate(size_t id) const {
+        return duplicateCount > 0 && representative[id] != id;
+    }
+
+    size_t getRepresentative(size_t id) const {
+        return (duplicateCount > 0) ? representative[id] : id;
+    }
+
+    // next entry of the group of id in id order, UINT_MAX after the last one
+    unsigned int getNext(size_t id) const {
+        return (duplicateCount > 0) ? next[id] : UINT_MAX;
+    }
+
+private:
+    size_t duplicateCount;
+    std::vector<unsigned int> representative;
+    std::vector<unsigned int> next;
+};
+
+#endif
@@ -351,6 +351,21 @@ void FileUtil::remove(const char * file ) {
     }
 }
 
+void FileUtil::syncFile(const char * file) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Could not open " << file << " for syncing. Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fsync(fd) != 0) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Could not sync " << file << " to disk. Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    close(fd);
+}
+
 void FileUtil::move(const char * src, const char * dst) {
     struct stat srcFileInfo;
     FILE * srcFile = FileUtil::openFileOrDie(src, "rw", true);
@@ -60,6 +60,9 @@ public:
 
     static void move(const char * src, const char * dst);
 
+    // flush the file content to the disk, so it survives a crash of the machine
+    static void syncFile(const char * file);
+
     static int parseDbType(const char *name);
 
     static std::string createTemporaryDirectory(const std::string& basePath, const std::string& subDirectory);
@@ -0,0 +1,274 @@
+#ifndef MMSEQS_GFFREADER_H
+#define MMSEQS_GFFREADER_H
+
+// Parallel GFF loader shared by gff2db and maskbygff.
+// A GFF file is memory mapped, split into one block of whole lines per thread and parsed without locks.
+// Features keep the order of the file, groupBySequence additionally builds per-sequence runs of features
+// sorted by their start, so that all features of a sequence can be processed together.
+
+#include "Debug.h"
+#include "FastSort.h"
+#include "MemoryMapped.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+struct GffFeature {
+    // id of the sequence as returned by the resolver
+    size_t id;
+    // position of the feature in the order of the GFF files
+    size_t index;
+    // 1-based and inclusive, as in the GFF file, start < end
+    unsigned int start;
+    unsigned int end;
+    // line in the GFF file (1-based) for messages
+    unsigned int line;
+    // index of the GFF file
+    unsigned int file;
+    // index into the requested feature types, 0 if all types are read
+    unsigned short type;
+    // '+', '-' or '.' for anything else
+    char strand;
+
+    static bool compareBySequence(const GffFeature &first, const GffFeature &second) {
+        if (first.id != second.id) {
+            return first.id < second.id;
+        }
+        if (first.start != second.start) {
+            return first.start < second.start;
+        }
+        return first.index < second.index;
+    }
+};
+
+class GffReader {
+public:
+    // types is a comma separated list of feature types, empty to read all features
+    GffReader(const std::string &types, unsigned int threads)
+            : types(Util::split(types, ",")), typeCount(this->types.size(), 0), threads(threads) {}
+
+    // resolve is called concurrently with the sequence name and its length and has to return an id of the
+    // sequence below the sequenceCount passed to groupBySequence or SIZE_MAX if the sequence does not exist
+    template <typename Resolver>
+    void read(const std::string &fileName, Resolver &resolve) {
+        MemoryMapped file(fileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+        if (file.isValid() == false) {
+            Debug(Debug::ERROR) << "Could not open GFF file " << fileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        const char *data = (const char *) file.getData();
+        size_t size = file.size();
+
+        // GFF3 can append the sequences after a ##FASTA directive
+        const char *fasta = findFastaDirective(data, size);
+        if (fasta != NULL) {
+            size = fasta - data;
+        }
+
+        // blocks of whole lines, the line offset of every block is needed for the messages
+        std::vector<size_t> blocks(threads + 1, size);
+        blocks[0] = 0;
+        for (size_t i = 1; i < threads; ++i) {
+            size_t pos = std::max(blocks[i - 1], (size / threads) * i);
+            const char *newline = pos < size ? (const char *) memchr(data + pos, '\n', size - pos) : NULL;
+            blocks[i] = (newline == NULL) ? size : (newline - data) + 1;
+        }
+        std::vector<size_t> lineOffset(threads + 1, 0);
+#pragma omp parallel for schedule(static, 1) num_threads(threads)
+        for (size_t i = 0; i < threads; ++i) {
+            lineOffset[i + 1] = std::count(data + blocks[i], data + blocks[i + 1], '\n');
+        }
+        for (size_t i = 1; i < lineOffset.size(); ++i) {
+            lineOffset[i] += lineOffset[i - 1];
+        }
+
+        std::vector<std::vector<GffFeature>> blockFeatures(threads);
+        std::vector<std::vector<size_t>> blockTypeCount(threads, std::vector<size_t>(types.size(), 0));
+#pragma omp parallel for schedule(static, 1) num_threads(threads)
+        for (size_t i = 0; i < threads; ++i) {
+            parseBlock(data + blocks[i], data + blocks[i + 1], lineOffset[i] + 1, resolve, blockFeatures[i], blockTypeCount[i]);
+        }
+        file.close();
+
+        size_t total = features.size();
+        for (size_t i = 0; i < threads; ++i) {
+            total += blockFeatures[i].size();
+            for (size_t j = 0; j < types.size(); ++j) {
+                typeCount[j] += blockTypeCount[i][j];
+            }
+        }
+        const size_t previous = features.size();
+        features.reserve(total);
+        for (size_t i = 0; i < threads; ++i) {
+            features.insert(features.end(), blockFeatures[i].begin(), blockFeatures[i].end());
+        }
+        for (size_t i = previous; i < features.size(); ++i) {
+            features[i].index = i;
+        }
+        fileCount++;
+    }
+
+    // features in the order of the GFF files
+    std::vector<GffFeature> &getFeatures() {
+        return features;
+    }
+
+    // sorts the features by sequence and start, the features of sequence id are in [offsets[id], offsets[id + 1])
+    void groupBySequence(size_t sequenceCount) {
+        SORT_PARALLEL(features.begin(), features.end(), GffFeature::compareBySequence);
+        offsets.assign(sequenceCount + 1, 0);
+        for (size_t i = 0; i < features.size(); ++i) {
+            offsets[features[i].id + 1]++;
+        }
+        for (size_t i = 1; i < offsets.size(); ++i) {
+            offsets[i] += offsets[i - 1];
+        }
+    }
+
+    size_t sequenceBegin(size_t id) const {
+        return offsets[id];
+    }
+
+    size_t sequenceEnd(size_t id) const {
+        return offsets[id + 1];
+    }
+
+    const std::vector<std::string> &getTypes() const {
+        return types;
+    }
+
+    size_t getTypeCount(size_t type) const {
+        return typeCount[type];
+    }
+
+private:
+    std::vector<std::string> types;
+    std::vector<size_t> typeCount;
+    unsigned int threads;
+    unsigned int fileCount = 0;
+
+    std::vector<GffFeature> features;
+    std::vector<size_t> offsets;
+
+    static const char *findFastaDirective(const char *data, size_t size) {
+        const char directive[] = "##FASTA";
+        const size_t directiveLength = sizeof(directive) - 1;
+        if (size >= directiveLength && memcmp(data, directive, directiveLength) == 0) {
+            return data;
+        }
+        const char *pos = data;
+        const char *end = data + size;
+        while ((pos = (const char *) memchr(pos, '\n', end - pos)) != NULL) {
+            pos++;
+            if ((size_t) (end - pos) >= directiveLength && memcmp(pos, directive, directiveLength) == 0) {
+                return pos;
+            }
+        }
+        return NULL;
+    }
+
+    static bool parsePosition(const char *begin, const char *end, unsigned int &value) {
+        if (begin == end || (end - begin) > 10) {
+            return false;
+        }
+        size_t result = 0;
+        for (const char *pos = begin; pos < end; ++pos) {
+            if (*pos < '0' || *pos > '9') {
+                return false;
+            }
+            result = result * 10 + (*pos - '0');
+        }
+        if (result > UINT_MAX) {
+            return false;
+        }
+        value = static_cast<unsigned int>(result);
+        return true;
+    }
+
+    template <typename Resolver>
+    void parseBlock(const char *data, const char *end, size_t line, Resolver &resolve,
+                    std::vector<GffFeature> &result, std::vector<size_t> &localTypeCount) {
+        const char *fields[9];
+        const char *fieldEnds[9];
+        for (; data < end; line++) {
+            const char *newline = (const char *) memchr(data, '\n', end - data);
+            const char *lineEnd = (newline == NULL) ? end : newline;
+            const char *lineStart = data;
+            data = (newline == NULL) ? end : newline + 1;
+            if (lineEnd > lineStart && *(lineEnd - 1) == '\r') {
+                lineEnd--;
+            }
+            // line is a comment or empty
+            if (lineStart == lineEnd || *lineStart == '#') {
+                continue;
+            }
+
+            size_t columns = 0;
+            const char *pos = lineStart;
+            while (columns < 9) {
+                const char *tab = (const char *) memchr(pos, '\t', lineEnd - pos);
+                fields[columns] = pos;
+                fieldEnds[columns] = (tab == NULL) ? lineEnd : tab;
+                columns++;
+                if (tab == NULL) {
+                    break;
+                }
+                pos = tab + 1;
+            }
+            if (columns < 9) {
+                Debug(Debug::WARNING) << "Not enough columns in GFF file in line " << line << "\n";
+                continue;
+            }
+
+            unsigned short type = 0;
+            if (types.empty() == false) {
+                const size_t typeLength = fieldEnds[2] - fields[2];
+                bool found = false;
+                for (size_t i = 0; i < types.size(); ++i) {
+                    if (types[i].size() == typeLength && memcmp(types[i].c_str(), fields[2], typeLength) == 0) {
+                        type = static_cast<unsigned short>(i);
+                        localTypeCount[i]++;
+                        found = true;
+                        break;
+                    }
+                }
+                if (found == false) {
+                    continue;
+                }
+            }
+
+            GffFeature feature;
+            if (parsePosition(fields[3], fieldEnds[3], feature.start) == false
+                || parsePosition(fields[4], fieldEnds[4], feature.end) == false) {
+                Debug(Debug::WARNING) << "Invalid position format in line " << line << "\n";
+                continue;
+            }
+            if (feature.start == 0 || feature.end <= feature.start) {
+                Debug(Debug::WARNING) << "Invalid sequence length in line " << line << "\n";
+                continue;
+            }
+
+            feature.id = resolve(fields[0], static_cast<size_t>(fieldEnds[0] - fields[0]));
+            if (feature.id == SIZE_MAX) {
+                Debug(Debug::ERROR) << "GFF entry not found in database: " << std::string(fields[0], fieldEnds[0] - fields[0]) << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            feature.line = static_cast<unsigned int>(line);
+            feature.file = fileCount;
+            feature.type = type;
+            const bool singleChar = (fieldEnds[6] - fields[6]) == 1;
+            feature.strand = (singleChar && (*fields[6] == '+' || *fields[6] == '-')) ? *fields[6] : '.';
+            result.push_back(feature);
+        }
+    }
+};
+
+#endif
@@ -66,7 +66,7 @@ public:
                 }
                 seqType = Parameters::DBTYPE_INDEX_DB;
             } else {
-                Debug(Debug::WARNING) << "Outdated index version. Please recompute with 'createindex'!\n";
+                Debug(Debug::WARNING) << "Outdated or damaged index. Please recompute with 'createindex'!\n";
                 index->close();
                 delete index;
                 index = NULL;
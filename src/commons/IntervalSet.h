@@ -0,0 +1,88 @@
+#ifndef MMSEQS_INTERVALSET_H
+#define MMSEQS_INTERVALSET_H
+
+// Set of disjoint half-open intervals [start, end). Touching or overlapping intervals are merged on insert,
+// so lookups cost O(log n) plus the number of stored intervals that intersect the queried range.
+// Unlike IntervalArray it does not depend on the sequence length and can report how much of a range is covered.
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+
+class IntervalSet {
+public:
+    typedef std::map<unsigned int, unsigned int>::const_iterator const_iterator;
+
+    void insert(unsigned int start, unsigned int end) {
+        if (start >= end) {
+            return;
+        }
+        std::map<unsigned int, unsigned int>::iterator it = firstTouching(start);
+        while (it != intervals.end() && it->first <= end) {
+            start = std::min(start, it->first);
+            end = std::max(end, it->second);
+            it = intervals.erase(it);
+        }
+        intervals.insert(it, std::make_pair(start, end));
+    }
+
+    // number of positions in [start, end) that are part of the set
+    size_t coveredLength(unsigned int start, unsigned int end) const {
+        size_t covered = 0;
+        if (start >= end) {
+            return covered;
+        }
+        for (const_iterator it = firstTouching(start); it != intervals.end() && it->first < end; ++it) {
+            const unsigned int from = std::max(start, it->first);
+            const unsigned int to = std::min(end, it->second);
+            covered += (to > from) ? (to - from) : 0;
+        }
+        return covered;
+    }
+
+    bool overlaps(unsigned int start, unsigned int end) const {
+        return coveredLength(start, end) > 0;
+    }
+
+    void clear() {
+        intervals.clear();
+    }
+
+    bool empty() const {
+        return intervals.empty();
+    }
+
+    size_t size() const {
+        return intervals.size();
+    }
+
+    const_iterator begin() const {
+        return intervals.begin();
+    }
+
+    const_iterator end() const {
+        return intervals.end();
+    }
+
+private:
+    // first interval that ends at or after start
+    std::map<unsigned int, unsigned int>::iterator firstTouching(unsigned int start) {
+        std::map<unsigned int, unsigned int>::iterator it = intervals.upper_bound(start);
+        if (it != intervals.begin()) {
+            std::map<unsigned int, unsigned int>::iterator prev = it;
+            --prev;
+            if (prev->second >= start) {
+                return prev;
+            }
+        }
+        return it;
+    }
+
+    const_iterator firstTouching(unsigned int start) const {
+        return const_cast<IntervalSet *>(this)->firstTouching(start);
+    }
+
+    std::map<unsigned int, unsigned int> intervals;
+};
+
+#endif
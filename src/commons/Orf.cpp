@@ -37,6 +37,10 @@
 #include "TranslateNucl.h"
 #include "simd.h"
 #include "itoa.h"
+#include "FileUtil.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
 
 #include <climits>
 #include <cstring>
@@ -44,6 +48,10 @@
 #include <cstdlib>
 #include <algorithm>
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 
 const char* Orf::iupacReverseComplementTable =
         "................................................................"
@@ -103,10 +111,8 @@ Orf::~Orf() {
     free(codon);
 }
 
-Matcher::result_t Orf::getFromDatabase(const size_t id, DBReader<unsigned int> & contigsReader, DBReader<unsigned int> & orfHeadersReader, int thread_idx) {
-    char * orfHeader = orfHeadersReader.getData(id, thread_idx);
-    Orf::SequenceLocation orfLocOnContigParsed;
-    orfLocOnContigParsed = Orf::parseOrfHeader(orfHeader);
+Matcher::result_t Orf::getFromDatabase(unsigned int orfKey, DBReader<unsigned int> & contigsReader, const OrfLocationTable & orfLocations, int thread_idx) {
+    Orf::SequenceLocation orfLocOnContigParsed = orfLocations.getLocation(orfKey, thread_idx);
 
     // get contig key and its length in nucleotides
     int contigKey = orfLocOnContigParsed.id;
@@ -455,3 +461,139 @@ size_t Orf::writeOrfHeader(char *buffer, unsigned int key, size_t fromPos, size_
     *(tmpBuff) = '\0';
     return tmpBuff - basePos;
 }
+
+OrfLocationTable::OrfLocationTable() : headerReader(NULL), mapped(NULL), mappedSize(0), records(NULL), recordCount(0) {}
+
+OrfLocationTable::~OrfLocationTable() {
+    close();
+}
+
+void OrfLocationTable::open(const std::string &db, DBReader<unsigned int> *reader) {
+    close();
+    headerReader = reader;
+    std::string tableFile = db + ".orfloc";
+    if (FileUtil::fileExists(tableFile.c_str()) == false) {
+        return;
+    }
+    FILE *file = FileUtil::openFileOrDie(tableFile.c_str(), "r", true);
+    size_t size = 0;
+    char *data = NULL;
+    if (FileUtil::getFileSize(tableFile) >= sizeof(FileHeader)) {
+        data = static_cast<char *>(FileUtil::mmapFile(file, &size));
+    }
+    fclose(file);
+    if (data == NULL) {
+        return;
+    }
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(data);
+    // the header DB was rewritten after the table was created
+    if (headerReader == NULL || size != sizeof(FileHeader) + header->recordCount * sizeof(Record)
+        || header->entries != headerReader->getSize() || header->recordCount != headerReader->getSize()
+        || header->headerDataSize != headerReader->getDataSize() || header->indexHash != hashIndex(*headerReader)) {
+        Debug(Debug::WARNING) << "Ignoring outdated ORF location table " << tableFile << "\n";
+        FileUtil::munmapData(data, size);
+        return;
+    }
+    mapped = data;
+    mappedSize = size;
+    records = reinterpret_cast<const Record *>(data + sizeof(FileHeader));
+    recordCount = header->recordCount;
+}
+
+void OrfLocationTable::close() {
+    if (mapped != NULL) {
+        FileUtil::munmapData(mapped, mappedSize);
+    }
+    mapped = NULL;
+    mappedSize = 0;
+    records = NULL;
+    recordCount = 0;
+    headerReader = NULL;
+}
+
+Orf::SequenceLocation OrfLocationTable::getLocation(unsigned int key, unsigned int thread_idx) const {
+    size_t id = headerReader->getId(key);
+    if (records == NULL || (id != UINT_MAX && records[id].key != key)) {
+        return Orf::parseOrfHeader(headerReader->getData(id, thread_idx));
+    }
+    if (id == UINT_MAX || records[id].contigKey == UINT_MAX) {
+        Orf::SequenceLocation loc(0, 0, false, false, Orf::STRAND_PLUS);
+        loc.id = UINT_MAX;
+        return loc;
+    }
+    const Record &record = records[id];
+    Orf::SequenceLocation loc(record.from, record.to,
+                              record.flags & INCOMPLETE_START, record.flags & INCOMPLETE_END,
+                              (record.flags & STRAND_MINUS) ? Orf::STRAND_MINUS : Orf::STRAND_PLUS);
+    loc.id = record.contigKey;
+    return loc;
+}
+
+uint64_t OrfLocationTable::hashIndex(DBReader<unsigned int> &reader) {
+    // chained over the entries, the previous hash is the seed of the next one
+    uint64_t hash = 0;
+    for (size_t i = 0; i < reader.getSize(); ++i) {
+        const uint64_t entry[2] = { reader.getDbKey(i), reader.getEntryLen(i) };
+        hash = XXH64(entry, sizeof(entry), hash);
+    }
+    return hash;
+}
+
+void OrfLocationTable::writeTable(const std::string &db, unsigned int threads) {
+    std::string headerDb = db + "_h";
+    std::string headerIndex = db + "_h.index";
+    DBReader<unsigned int> reader(headerDb.c_str(), headerIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    reader.open(DBReader<unsigned int>::NOSORT);
+
+    FileHeader header;
+    header.entries = reader.getSize();
+    header.headerDataSize = reader.getDataSize();
+    header.indexHash = hashIndex(reader);
+    header.recordCount = reader.getSize();
+
+    Record missing;
+    missing.key = UINT_MAX;
+    missing.contigKey = UINT_MAX;
+    missing.from = 0;
+    missing.to = 0;
+    missing.flags = 0;
+    std::vector<Record> table(header.recordCount, missing);
+#pragma omp parallel num_threads(threads)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+#pragma omp for schedule(static)
+        for (size_t i = 0; i < reader.getSize(); ++i) {
+            Record &record = table[i];
+            record.key = reader.getDbKey(i);
+            Orf::SequenceLocation loc = Orf::parseOrfHeader(reader.getData(i, thread_idx));
+            if (loc.id == UINT_MAX) {
+                continue;
+            }
+            record.contigKey = loc.id;
+            record.from = static_cast<unsigned int>(loc.from);
+            record.to = static_cast<unsigned int>(loc.to);
+            record.flags = (loc.hasIncompleteStart ? INCOMPLETE_START : 0)
+                           | (loc.hasIncompleteEnd ? INCOMPLETE_END : 0)
+                           | (loc.strand == Orf::STRAND_MINUS ? STRAND_MINUS : 0);
+        }
+    }
+    reader.close();
+
+    std::string tableFile = db + ".orfloc";
+    FILE *file = FileUtil::openAndDelete(tableFile.c_str(), "wb");
+    size_t written = fwrite(&header, sizeof(FileHeader), 1, file);
+    if (header.recordCount > 0) {
+        written += fwrite(table.data(), sizeof(Record), table.size(), file);
+    }
+    if (written != 1 + header.recordCount) {
+        Debug(Debug::ERROR) << "Cannot write ORF location table " << tableFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << tableFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
@@ -6,6 +6,8 @@
 #include "Matcher.h"
 #include "DBReader.h"
 
+class OrfLocationTable;
+
 class Orf
 {
 
@@ -90,7 +92,7 @@ public:
 
     std::pair<const char *, size_t> getSequence(const SequenceLocation &location);
 
-    static Matcher::result_t getFromDatabase(const size_t id, DBReader<unsigned int> & contigsReader, DBReader<unsigned int> & orfHeadersReader, int thread_idx);
+    static Matcher::result_t getFromDatabase(unsigned int orfKey, DBReader<unsigned int> & contigsReader, const OrfLocationTable & orfLocations, int thread_idx);
 
     static SequenceLocation parseOrfHeader(const char *data);
 
@@ -101,6 +103,15 @@ public:
         return iupacReverseComplementTable[static_cast<unsigned char>(c)];
     }
 
+    // writes the reverse complement of sequence[0, length) to result, which must not overlap with sequence
+    static inline void writeReverseComplement(const char *sequence, size_t length, char *result) {
+        const char *table = iupacReverseComplementTable;
+        const unsigned char *source = reinterpret_cast<const unsigned char *>(sequence) + length;
+        for (size_t i = 0; i < length; ++i) {
+            result[i] = table[*(--source)];
+        }
+    }
+
     static size_t writeOrfHeader(char *buffer, unsigned int key, size_t fromPos, size_t toPos, bool hasIncompleteStart,
                                bool hasIncompleteEnd);
 
@@ -117,4 +128,57 @@ private:
     size_t startCodonCount;
 };
 
+// Binary sidecar (<db>.orfloc) with the location of every ORF/fragment of a sequence DB
+// Records have a fixed width and are stored in the internal id order of the header DB, so lookups do not need to parse the ORF header
+class OrfLocationTable {
+public:
+    struct Record {
+        unsigned int key;
+        unsigned int contigKey;
+        unsigned int from;
+        unsigned int to;
+        unsigned int flags;
+    };
+
+    enum Flags {
+        INCOMPLETE_START = (1u << 0),
+        INCOMPLETE_END   = (1u << 1),
+        STRAND_MINUS     = (1u << 2)
+    };
+
+    OrfLocationTable();
+    ~OrfLocationTable();
+
+    // maps <db>.orfloc if it exists and was written for the given header DB, otherwise the ORF headers are parsed
+    void open(const std::string &db, DBReader<unsigned int> *headerReader);
+    void close();
+
+    bool hasTable() const {
+        return records != NULL;
+    }
+
+    // location of the entry with the given key, id is UINT_MAX if the header does not describe an ORF
+    Orf::SequenceLocation getLocation(unsigned int key, unsigned int thread_idx) const;
+
+    // parses all ORF headers of <db>_h once and writes <db>.orfloc
+    static void writeTable(const std::string &db, unsigned int threads);
+
+private:
+    struct FileHeader {
+        size_t entries;
+        size_t headerDataSize;
+        // hash over the key and entry length of every header entry, a rewritten header DB does not match anymore
+        uint64_t indexHash;
+        size_t recordCount;
+    };
+
+    static uint64_t hashIndex(DBReader<unsigned int> &reader);
+
+    DBReader<unsigned int> *headerReader;
+    char *mapped;
+    size_t mappedSize;
+    const Record *records;
+    size_t recordCount;
+};
+
 #endif
@@ -46,6 +46,7 @@ Parameters::Parameters():
         PARAM_MASK_RESIDUES(PARAM_MASK_RESIDUES_ID, "--mask", "Mask residues", "Mask sequences in k-mer stage: 0: w/o low complexity masking, 1: with low complexity masking", typeid(int), (void *) &maskMode, "^[0-1]{1}", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_MASK_PROBABILTY(PARAM_MASK_PROBABILTY_ID, "--mask-prob", "Mask residues probability", "Mask sequences is probablity is above threshold", typeid(float), (void *) &maskProb, "^0(\\.[0-9]+)?|^1(\\.0+)?$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_MASK_LOWER_CASE(PARAM_MASK_LOWER_CASE_ID, "--mask-lower-case", "Mask lower case residues", "Lowercase letters will be excluded from k-mer search 0: include region, 1: exclude region", typeid(int), (void *) &maskLowerCaseMode, "^[0-1]{1}", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_MAX_KMER_ABUNDANCE(PARAM_MAX_KMER_ABUNDANCE_ID, "--max-kmer-abundance", "Max k-mer abundance", "Keep a deterministic subset of about this many target sequences for k-mers occurring in more sequences, 0: keep all", typeid(int), (void *) &maxKmerAbundance, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_MIN_DIAG_SCORE(PARAM_MIN_DIAG_SCORE_ID, "--min-ungapped-score", "Minimum diagonal score", "Accept only matches with ungapped alignment score above threshold", typeid(int), (void *) &minDiagScoreThr, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_K_SCORE(PARAM_K_SCORE_ID, "--k-score", "k-score", "k-mer threshold for generating similar k-mer lists", typeid(MultiParam<SeqProf<int>>), (void *) &kmerScore, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_MAX_SEQS(PARAM_MAX_SEQS_ID, "--max-seqs", "Max results per query", "Maximum results per query sequence allowed to pass the prefilter (affects sensitivity)", typeid(size_t), (void *) &maxResListLen, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER),
@@ -65,6 +66,8 @@ Parameters::Parameters():
         PARAM_PRELOAD_MODE(PARAM_PRELOAD_MODE_ID, "--db-load-mode", "Preload mode", "Database preload mode 0: auto, 1: fread, 2: mmap, 3: mmap+touch", typeid(int), (void *) &preloadMode, "[0-3]{1}", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPACED_KMER_PATTERN(PARAM_SPACED_KMER_PATTERN_ID, "--spaced-kmer-pattern", "Spaced k-mer pattern", "User-specified spaced k-mer pattern", typeid(std::string), (void *) &spacedKmerPattern, "^1[01]*1$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_LOCAL_TMP(PARAM_LOCAL_TMP_ID, "--local-tmp", "Local temporary path", "Path where some of the temporary files will be created", typeid(std::string), (void *) &localTmp, "", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_CHECKPOINT_CHUNKS(PARAM_CHECKPOINT_CHUNKS_ID, "--checkpoint-chunks", "Checkpoint chunks", "Commit the result in this many query chunks to temporary DBs. A restarted run with the same parameters only computes the missing chunks (0: off)", typeid(int), (void *) &checkpointChunks, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_DICTIONARY_SIZE(PARAM_DICTIONARY_SIZE_ID, "--dictionary-size", "Dictionary size", "Train a zstd dictionary of this size on the entries and share it between them. Pays off for many short and similar entries like headers. E.g. 112K, 0: no dictionary", typeid(ByteParser), (void *) &dictionarySize, "^(0|[1-9]{1}[0-9]*(B|K|M|G|T)?)$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
         // alignment
         PARAM_ALIGNMENT_MODE(PARAM_ALIGNMENT_MODE_ID, "--alignment-mode", "Alignment mode", "How to compute the alignment:\n0: automatic\n1: only score and end_pos\n2: also start_pos and cov\n3: also seq.id\n4: only ungapped alignment", typeid(int), (void *) &alignmentMode, "^[0-5]{1}$", MMseqsParameter::COMMAND_ALIGN),
         PARAM_ALIGNMENT_OUTPUT_MODE(PARAM_ALIGNMENT_OUTPUT_MODE_ID, "--alignment-output-mode", "Alignment mode", "How to compute the alignment:\n0: automatic\n1: only score and end_pos\n2: also start_pos and cov\n3: also seq.id\n4: only ungapped alignment\n5: score only (output) cluster format", typeid(int), (void *) &alignmentOutputMode, "^[0-1]{1}$", MMseqsParameter::COMMAND_ALIGN),
@@ -106,6 +109,8 @@ Parameters::Parameters():
         PARAM_WRAPPED_SCORING(PARAM_WRAPPED_SCORING_ID, "--wrapped-scoring", "Allow wrapped scoring", "Double the (nucleotide) query sequence during the scoring process to allow wrapped diagonal scoring around end and start", typeid(bool), (void *) &wrappedScoring, "", MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
         PARAM_FILTER_HITS(PARAM_FILTER_HITS_ID, "--filter-hits", "Remove hits by seq. id. and coverage", "Filter hits by seq.id. and coverage", typeid(bool), (void *) &filterHits, "", MMseqsParameter::COMMAND_EXPERT),
         PARAM_SORT_RESULTS(PARAM_SORT_RESULTS_ID, "--sort-results", "Sort results", "Sort results: 0: no sorting, 1: sort by E-value (Alignment) or seq.id. (Hamming)", typeid(int), (void *) &sortResults, "^[0-1]{1}$", MMseqsParameter::COMMAND_EXPERT),
+        // map
+        PARAM_MAP_MODE(PARAM_MAP_MODE_ID, "--map-mode", "Map mode", "Mapping engine 0: search\n1: exact seed lookup with ungapped-first extension (kmermap), only for amino acid/amino acid or nucleotide/nucleotide", typeid(int), (void *) &mapMode, "^[0-1]{1}$"),
         // result2msa
         PARAM_MSA_FORMAT_MODE(PARAM_MSA_FORMAT_MODE_ID, "--msa-format-mode", "MSA format mode", "Format MSA as: 0: binary cA3M DB\n1: binary ca3m w. consensus DB\n2: aligned FASTA DB\n3: aligned FASTA w. header summary\n4: STOCKHOLM flat file\n5: A3M format\n6: A3M format w. alignment info", typeid(int), (void *) &msaFormatMode, "^[0-6]{1}$"),
         PARAM_ALLOW_DELETION(PARAM_ALLOW_DELETION_ID, "--allow-deletion", "Allow deletions", "Allow deletions in a MSA", typeid(bool), (void *) &allowDeletion, ""),
@@ -147,10 +152,12 @@ Parameters::Parameters():
         PARAM_KMER_PER_SEQ_SCALE(PARAM_KMER_PER_SEQ_SCALE_ID, "--kmer-per-seq-scale", "Scale k-mers per sequence", "Scale k-mer per sequence based on sequence length as kmer-per-seq val + scale x seqlen", typeid(MultiParam<NuclAA<float>>), (void *) &kmersPerSequenceScale, "^0(\\.[0-9]+)?|1(\\.0+)?$", MMseqsParameter::COMMAND_CLUSTLINEAR),
         PARAM_INCLUDE_ONLY_EXTENDABLE(PARAM_INCLUDE_ONLY_EXTENDABLE_ID, "--include-only-extendable", "Include only extendable", "Include only extendable", typeid(bool), (void *) &includeOnlyExtendable, "", MMseqsParameter::COMMAND_CLUSTLINEAR),
         PARAM_IGNORE_MULTI_KMER(PARAM_IGNORE_MULTI_KMER_ID, "--ignore-multi-kmer", "Skip repeating k-mers", "Skip k-mers occurring multiple times (>=2)", typeid(bool), (void *) &ignoreMultiKmer, "", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_SYNCMER_SIZE(PARAM_SYNCMER_SIZE_ID, "--syncmer-size", "Closed syncmer size", "Only pick k-mers that are closed syncmers, i.e. whose smallest s-mer (by hash) is at their start or end. Thins out candidates more evenly along the sequence (0: off, amino acid k-mers without spacing only)", typeid(int), (void *) &syncmerSize, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         PARAM_HASH_SHIFT(PARAM_HASH_SHIFT_ID, "--hash-shift", "Shift hash", "Shift k-mer hash initialization", typeid(int), (void *) &hashShift, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         PARAM_PICK_N_SIMILAR(PARAM_PICK_N_SIMILAR_ID, "--pick-n-sim-kmer", "Add N similar to search", "Add N similar k-mers to search", typeid(int), (void *) &pickNbest, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         PARAM_ADJUST_KMER_LEN(PARAM_ADJUST_KMER_LEN_ID, "--adjust-kmer-len", "Adjust k-mer length", "Adjust k-mer length based on specificity (only for nucleotides)", typeid(bool), (void *) &adjustKmerLength, "", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         PARAM_RESULT_DIRECTION(PARAM_RESULT_DIRECTION_ID, "--result-direction", "Result direction", "result is 0: query, 1: target centric", typeid(int), (void *) &resultDirection, "^[0-1]{1}$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_RESCORE_DB(PARAM_RESCORE_DB_ID, "--rescore-db", "Rescored result DB", "Also write the hits rescored by Hamming distance along their diagonal (as rescorediagonal --rescore-mode 0, seq. id. and coverage at least 0.5) to this DB", typeid(std::string), (void *) &rescoreDb, "", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
 
         // workflow
         PARAM_RUNNER(PARAM_RUNNER_ID, "--mpi-runner", "MPI runner", "Use MPI on compute cluster with this MPI command (e.g. \"mpirun -np 42\")", typeid(std::string), (void *) &runner, "", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
@@ -190,6 +197,7 @@ Parameters::Parameters():
         PARAM_DB_TYPE(PARAM_DB_TYPE_ID, "--dbtype", "Database type", "Database type 0: auto, 1: amino acid 2: nucleotides", typeid(int), (void *) &dbType, "[0-2]{1}"),
         PARAM_CREATEDB_MODE(PARAM_CREATEDB_MODE_ID, "--createdb-mode", "Createdb mode", "Createdb mode 0: copy data, 1: soft link data and write new index (works only with single line fasta/q)", typeid(int), (void *) &createdbMode, "^[0-1]{1}$"),
         PARAM_SHUFFLE(PARAM_SHUFFLE_ID, "--shuffle", "Shuffle input database", "Shuffle input database", typeid(bool), (void *) &shuffleDatabase, ""),
+        PARAM_DEDUP(PARAM_DEDUP_ID, "--dedup", "Deduplicate sequences", "Store identical sequences once, their entries share the data of the first copy. Prefilter and alignment compute each unique sequence once", typeid(bool), (void *) &dedupSequences, "", MMseqsParameter::COMMAND_EXPERT),
         PARAM_WRITE_LOOKUP(PARAM_WRITE_LOOKUP_ID, "--write-lookup", "Write lookup file", "write .lookup file containing mapping from internal id, fasta id and file number", typeid(int), (void *) &writeLookup, "^[0-1]{1}", MMseqsParameter::COMMAND_EXPERT),
         PARAM_USE_HEADER_FILE(PARAM_USE_HEADER_FILE_ID, "--use-header-file", "Use header DB", "use the sequence header DB instead of the body to map the entry keys", typeid(bool), (void *) &useHeaderFile, ""),
         // splitsequence
@@ -282,6 +290,9 @@ Parameters::Parameters():
         // createsubdb, filtertaxseqdb
         PARAM_SUBDB_MODE(PARAM_SUBDB_MODE_ID, "--subdb-mode", "Subdb mode", "Subdb mode 0: copy data 1: soft link data and write index", typeid(int), (void *) &subDbMode, "^[0-1]{1}$"),
         PARAM_ID_MODE(PARAM_ID_MODE_ID, "--id-mode", "Database ID mode", "Select DB entries based on 0: database keys, 1: FASTA identifiers (.lookup)", typeid(int), (void *) &dbIdMode, "^[0-1]{1}$"),
+        // reorderdb
+        PARAM_REORDER_MODE(PARAM_REORDER_MODE_ID, "--reorder-mode", "Reorder mode", "Physical order of the entries, keys stay the same 0: keep order 1: similar k-mer signatures (MinHash) next to each other 2: order of the members in --cluster-db", typeid(int), (void *) &reorderMode, "^[0-2]{1}$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_CLUSTER_DB(PARAM_CLUSTER_DB_ID, "--cluster-db", "Cluster DB", "Clustering result of the sequence DB used by --reorder-mode 2", typeid(std::string), (void *) &clusterDb, "^.*$", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
         PARAM_TAR_INCLUDE(PARAM_TAR_INCLUDE_ID, "--tar-include", "Tar Inclusion Regex", "Include file names based on this regex", typeid(std::string), (void *) &tarInclude, "^.*$"),
         PARAM_TAR_EXCLUDE(PARAM_TAR_EXCLUDE_ID, "--tar-exclude", "Tar Exclusion Regex", "Exclude file names based on this regex", typeid(std::string), (void *) &tarExclude, "^.*$"),
         // unpackdb
@@ -314,6 +325,11 @@ Parameters::Parameters():
     threadsandcompression.push_back(&PARAM_COMPRESSED);
     threadsandcompression.push_back(&PARAM_V);
 
+    // compressdb
+    compressdb.push_back(&PARAM_DICTIONARY_SIZE);
+    compressdb.push_back(&PARAM_THREADS);
+    compressdb.push_back(&PARAM_V);
+
     // alignall
     alignall.push_back(&PARAM_SUB_MAT);
     alignall.push_back(&PARAM_ADD_BACKTRACE);
@@ -376,6 +392,7 @@ Parameters::Parameters():
     align.push_back(&PARAM_GAP_OPEN);
     align.push_back(&PARAM_GAP_EXTEND);
     align.push_back(&PARAM_ZDROP);
+    align.push_back(&PARAM_CHECKPOINT_CHUNKS);
     align.push_back(&PARAM_THREADS);
     align.push_back(&PARAM_COMPRESSED);
     align.push_back(&PARAM_V);
@@ -401,6 +418,7 @@ Parameters::Parameters():
     prefilter.push_back(&PARAM_MASK_RESIDUES);
     prefilter.push_back(&PARAM_MASK_PROBABILTY);
     prefilter.push_back(&PARAM_MASK_LOWER_CASE);
+    prefilter.push_back(&PARAM_MAX_KMER_ABUNDANCE);
     prefilter.push_back(&PARAM_MIN_DIAG_SCORE);
     prefilter.push_back(&PARAM_INCLUDE_IDENTITY);
     prefilter.push_back(&PARAM_SPACED_KMER_MODE);
@@ -409,6 +427,7 @@ Parameters::Parameters():
     prefilter.push_back(&PARAM_PCB);
     prefilter.push_back(&PARAM_SPACED_KMER_PATTERN);
     prefilter.push_back(&PARAM_LOCAL_TMP);
+    prefilter.push_back(&PARAM_CHECKPOINT_CHUNKS);
     prefilter.push_back(&PARAM_THREADS);
     prefilter.push_back(&PARAM_COMPRESSED);
     prefilter.push_back(&PARAM_V);
@@ -453,6 +472,29 @@ Parameters::Parameters():
     rescorediagonal.push_back(&PARAM_COMPRESSED);
     rescorediagonal.push_back(&PARAM_V);
 
+    // kmermap
+    kmermap.push_back(&PARAM_SUB_MAT);
+    kmermap.push_back(&PARAM_K);
+    kmermap.push_back(&PARAM_MAX_SEQS);
+    kmermap.push_back(&PARAM_E);
+    kmermap.push_back(&PARAM_C);
+    kmermap.push_back(&PARAM_COV_MODE);
+    kmermap.push_back(&PARAM_MIN_SEQ_ID);
+    kmermap.push_back(&PARAM_MIN_ALN_LEN);
+    kmermap.push_back(&PARAM_SEQ_ID_MODE);
+    kmermap.push_back(&PARAM_ADD_BACKTRACE);
+    kmermap.push_back(&PARAM_INCLUDE_IDENTITY);
+    kmermap.push_back(&PARAM_NO_COMP_BIAS_CORR);
+    kmermap.push_back(&PARAM_NO_COMP_BIAS_CORR_SCALE);
+    kmermap.push_back(&PARAM_GAP_OPEN);
+    kmermap.push_back(&PARAM_GAP_EXTEND);
+    kmermap.push_back(&PARAM_ZDROP);
+    kmermap.push_back(&PARAM_MAX_SEQ_LEN);
+    kmermap.push_back(&PARAM_PRELOAD_MODE);
+    kmermap.push_back(&PARAM_THREADS);
+    kmermap.push_back(&PARAM_COMPRESSED);
+    kmermap.push_back(&PARAM_V);
+
     // alignbykmer
     alignbykmer.push_back(&PARAM_SUB_MAT);
     alignbykmer.push_back(&PARAM_K);
@@ -546,6 +588,7 @@ Parameters::Parameters():
     convertalignments.push_back(&PARAM_DB_OUTPUT);
     convertalignments.push_back(&PARAM_PRELOAD_MODE);
     convertalignments.push_back(&PARAM_SEARCH_TYPE);
+    convertalignments.push_back(&PARAM_CHECKPOINT_CHUNKS);
     convertalignments.push_back(&PARAM_THREADS);
     convertalignments.push_back(&PARAM_COMPRESSED);
     convertalignments.push_back(&PARAM_V);
@@ -716,6 +759,7 @@ Parameters::Parameters():
     indexdb.push_back(&PARAM_MASK_RESIDUES);
     indexdb.push_back(&PARAM_MASK_PROBABILTY);
     indexdb.push_back(&PARAM_MASK_LOWER_CASE);
+    indexdb.push_back(&PARAM_MAX_KMER_ABUNDANCE);
     indexdb.push_back(&PARAM_SPACED_KMER_MODE);
     indexdb.push_back(&PARAM_SPACED_KMER_PATTERN);
     indexdb.push_back(&PARAM_S);
@@ -752,6 +796,7 @@ Parameters::Parameters():
     // create db
     createdb.push_back(&PARAM_DB_TYPE);
     createdb.push_back(&PARAM_SHUFFLE);
+    createdb.push_back(&PARAM_DEDUP);
     createdb.push_back(&PARAM_CREATEDB_MODE);
     createdb.push_back(&PARAM_WRITE_LOOKUP);
     createdb.push_back(&PARAM_ID_OFFSET);
@@ -908,6 +953,10 @@ Parameters::Parameters():
     kmermatcher.push_back(&PARAM_SPLIT_MEMORY_LIMIT);
     kmermatcher.push_back(&PARAM_INCLUDE_ONLY_EXTENDABLE);
     kmermatcher.push_back(&PARAM_IGNORE_MULTI_KMER);
+    kmermatcher.push_back(&PARAM_SYNCMER_SIZE);
+    kmermatcher.push_back(&PARAM_SEQ_ID_MODE);
+    kmermatcher.push_back(&PARAM_MIN_ALN_LEN);
+    kmermatcher.push_back(&PARAM_RESCORE_DB);
     kmermatcher.push_back(&PARAM_THREADS);
     kmermatcher.push_back(&PARAM_COMPRESSED);
     kmermatcher.push_back(&PARAM_V);
@@ -995,6 +1044,10 @@ Parameters::Parameters():
     concatdbs.push_back(&PARAM_THREADS);
     concatdbs.push_back(&PARAM_V);
 
+    // federatedbs
+    federatedbs.push_back(&PARAM_THREADS);
+    federatedbs.push_back(&PARAM_V);
+
     // extractalignedregion
     extractalignedregion.push_back(&PARAM_COMPRESSED);
     extractalignedregion.push_back(&PARAM_EXTRACT_MODE);
@@ -1063,6 +1116,13 @@ Parameters::Parameters():
     createsubdb.push_back(&PARAM_ID_MODE);
     createsubdb.push_back(&PARAM_V);
 
+    // reorderdb
+    reorderdb.push_back(&PARAM_REORDER_MODE);
+    reorderdb.push_back(&PARAM_CLUSTER_DB);
+    reorderdb.push_back(&PARAM_K);
+    reorderdb.push_back(&PARAM_THREADS);
+    reorderdb.push_back(&PARAM_V);
+
     // renamedbkeys
     renamedbkeys.push_back(&PARAM_SUBDB_MODE);
     renamedbkeys.push_back(&PARAM_THREADS);
@@ -1215,6 +1275,8 @@ Parameters::Parameters():
     createindex = combineList(createindex, translatenucs);
     createindex = combineList(createindex, splitsequence);
     createindex.push_back(&PARAM_STRAND);
+    createindex.push_back(&PARAM_REORDER_MODE);
+    createindex.push_back(&PARAM_CLUSTER_DB);
     createindex.push_back(&PARAM_REMOVE_TMP_FILES);
 
     // createindex workflow
@@ -1289,6 +1351,8 @@ Parameters::Parameters():
     mapworkflow = combineList(prefilter, rescorediagonal);
     mapworkflow = combineList(mapworkflow, extractorfs);
     mapworkflow = combineList(mapworkflow, translatenucs);
+    mapworkflow = combineList(mapworkflow, kmermap);
+    mapworkflow.push_back(&PARAM_MAP_MODE);
     mapworkflow.push_back(&PARAM_START_SENS);
     mapworkflow.push_back(&PARAM_SENS_STEPS);
     mapworkflow.push_back(&PARAM_RUNNER);
@@ -2024,7 +2088,9 @@ void Parameters::checkIfDatabaseIsValid(const Command& command, int argc, const
                         EXIT(EXIT_FAILURE);
                     }
                 }
-                if (db.specialType & DbType::NEED_LOOKUP && FileUtil::fileExists((filenames[fileIdx] + ".lookup").c_str()) == false) {
+                // a federated DB reads the lookup files of its members
+                if (db.specialType & DbType::NEED_LOOKUP && FileUtil::fileExists((filenames[fileIdx] + ".lookup").c_str()) == false
+                    && FileUtil::fileExists((filenames[fileIdx] + ".federated").c_str()) == false) {
                     printParameters(command.cmd, argc, argv, *command.params);
                     Debug(Debug::ERROR) << "Database " << filenames[fileIdx] << " needs a lookup file\n";
                     EXIT(EXIT_FAILURE);
@@ -2175,6 +2241,8 @@ void Parameters::setDefaults() {
     splitAA = false;
     spacedKmerPattern = "";
     localTmp = "";
+    checkpointChunks = 0;
+    dictionarySize = 0;
 
     // search workflow
     numIterations = 1;
@@ -2213,6 +2281,7 @@ void Parameters::setDefaults() {
     maskMode = 1;
     maskProb = 0.9;
     maskLowerCaseMode = 0;
+    maxKmerAbundance = 0;
     minDiagScoreThr = 15;
     spacedKmer = true;
     includeIdentity = false;
@@ -2265,6 +2334,7 @@ void Parameters::setDefaults() {
     // createdb
     createdbMode = SEQUENCE_SPLIT_MODE_HARD;
     shuffleDatabase = true;
+    dedupSequences = false;
     writeLookup = true;
 
     // format alignment
@@ -2349,6 +2419,9 @@ void Parameters::setDefaults() {
     filterHits = false;
     sortResults = false;
 
+    // map
+    mapMode = Parameters::MAP_MODE_SEARCH;
+
     // filterDb
     filterColumn = 1;
     columnToTake = -1;
@@ -2410,10 +2483,12 @@ void Parameters::setDefaults() {
     kmersPerSequenceScale = MultiParam<NuclAA<float>>(NuclAA<float>(0.0, 0.2));
     includeOnlyExtendable = false;
     ignoreMultiKmer = false;
+    syncmerSize = 0;
     hashShift = 67;
     pickNbest = 1;
     adjustKmerLength = false;
     resultDirection = Parameters::PARAM_RESULT_DIRECTION_TARGET;
+    rescoreDb = "";
     // result2stats
     stat = "";
 
@@ -2443,6 +2518,10 @@ void Parameters::setDefaults() {
     subDbMode = Parameters::SUBDB_MODE_HARD;
     dbIdMode = Parameters::ID_MODE_KEYS;
 
+    // reorderdb
+    reorderMode = Parameters::REORDER_MODE_NONE;
+    clusterDb = "";
+
     // tar2db
     tarInclude = ".*";
     tarExclude = "^$";
@@ -86,6 +86,11 @@ public:
     static const unsigned int DBTYPE_EXTENDED_COMPRESSED = 1;
     static const unsigned int DBTYPE_EXTENDED_INDEX_NEED_SRC = 2;
     static const unsigned int DBTYPE_EXTENDED_CONTEXT_PSEUDO_COUNTS = 4;
+    // the index contains keys that do not fit into 32 bits, only DBReader<size_t> can open it
+    // this is a storage format for renamedbkeys, prefilter, kmermatcher and clustering still use 32-bit ids
+    static const unsigned int DBTYPE_EXTENDED_LONG_KEYS = 8;
+    // createdb --dedup stored identical sequences once, several index entries point at the same data
+    static const unsigned int DBTYPE_EXTENDED_DEDUP = 16;
 
     // don't forget to add new database types to DBReader::getDbTypeName and Parameters::PARAM_OUTPUT_DBTYPE
 
@@ -275,6 +280,10 @@ public:
     static const int RESCORE_MODE_END_TO_END_ALIGNMENT = 3;
     static const int RESCORE_MODE_WINDOW_QUALITY_ALIGNMENT = 4;
 
+    // map
+    static const int MAP_MODE_SEARCH = 0;
+    static const int MAP_MODE_SEED = 1;
+
     // combinepvalperset
     static const int AGGREGATION_MODE_MULTIHIT = 0;
     static const int AGGREGATION_MODE_MIN_PVAL = 1;
@@ -292,6 +301,11 @@ public:
     static const int ID_MODE_KEYS = 0;
     static const int ID_MODE_LOOKUP = 1;
 
+    // reorderdb
+    static const int REORDER_MODE_NONE = 0;
+    static const int REORDER_MODE_MINHASH = 1;
+    static const int REORDER_MODE_CLUSTER = 2;
+
     // unpackdb
     static const int UNPACK_NAME_KEY = 0;
     static const int UNPACK_NAME_ACCESSION = 1;
@@ -383,6 +397,7 @@ public:
     int    maskMode;                     // mask low complex areas
     float  maskProb;                     // mask probability
     int    maskLowerCaseMode;            // mask lowercase letters in prefilter and kmermatchers
+    int    maxKmerAbundance;             // down-sample k-mers occurring in more target sequences
 
     int    minDiagScoreThr;              // min diagonal score
     int    spacedKmer;                   // Spaced Kmers
@@ -397,6 +412,8 @@ public:
     int    realignMaxSeqs;               // Max alignments to realign
     std::string spacedKmerPattern;       // User-specified kmer pattern
     std::string localTmp;                // Local temporary path
+    int checkpointChunks;                // Commit the result in chunks that a restarted run skips
+    size_t dictionarySize;               // Size of the zstd dictionary shared by all entries
 
     // ALIGNMENT
     int alignmentMode;                   // alignment mode 0=fastest on parameters,
@@ -474,6 +491,9 @@ public:
     bool globalAlignment;
     int sortResults;
 
+    // map
+    int mapMode;
+
     // result2msa
     int msaFormatMode;
     bool allowDeletion;
@@ -520,10 +540,12 @@ public:
     MultiParam<NuclAA<float>> kmersPerSequenceScale;
     bool includeOnlyExtendable;
     bool ignoreMultiKmer;
+    int syncmerSize;
     int hashShift;
     int pickNbest;
     int adjustKmerLength;
     int resultDirection;
+    std::string rescoreDb;
 
     // indexdb
     int checkCompatible;
@@ -534,6 +556,7 @@ public:
     int dbType;
     int createdbMode;
     bool shuffleDatabase;
+    bool dedupSequences;
 
     // splitsequence
     int sequenceOverlap;
@@ -657,6 +680,10 @@ public:
     int subDbMode;
     int dbIdMode;
 
+    // reorderdb
+    int reorderMode;
+    std::string clusterDb;
+
     // tar2db
     std::string tarInclude;
     std::string tarExclude;
@@ -705,6 +732,7 @@ public:
     PARAMETER(PARAM_MASK_RESIDUES)
     PARAMETER(PARAM_MASK_PROBABILTY)
     PARAMETER(PARAM_MASK_LOWER_CASE)
+    PARAMETER(PARAM_MAX_KMER_ABUNDANCE)
 
     PARAMETER(PARAM_MIN_DIAG_SCORE)
     PARAMETER(PARAM_K_SCORE)
@@ -724,6 +752,8 @@ public:
     PARAMETER(PARAM_PRELOAD_MODE)
     PARAMETER(PARAM_SPACED_KMER_PATTERN)
     PARAMETER(PARAM_LOCAL_TMP)
+    PARAMETER(PARAM_CHECKPOINT_CHUNKS)
+    PARAMETER(PARAM_DICTIONARY_SIZE)
     std::vector<MMseqsParameter*> prefilter;
     std::vector<MMseqsParameter*> ungappedprefilter;
 
@@ -775,6 +805,9 @@ public:
     PARAMETER(PARAM_FILTER_HITS)
     PARAMETER(PARAM_SORT_RESULTS)
 
+    // map
+    PARAMETER(PARAM_MAP_MODE)
+
     // result2msa
     PARAMETER(PARAM_MSA_FORMAT_MODE)
     PARAMETER(PARAM_ALLOW_DELETION)
@@ -821,10 +854,12 @@ public:
     PARAMETER(PARAM_KMER_PER_SEQ_SCALE)
     PARAMETER(PARAM_INCLUDE_ONLY_EXTENDABLE)
     PARAMETER(PARAM_IGNORE_MULTI_KMER)
+    PARAMETER(PARAM_SYNCMER_SIZE)
     PARAMETER(PARAM_HASH_SHIFT)
     PARAMETER(PARAM_PICK_N_SIMILAR)
     PARAMETER(PARAM_ADJUST_KMER_LEN)
     PARAMETER(PARAM_RESULT_DIRECTION)
+    PARAMETER(PARAM_RESCORE_DB)
     // workflow
     PARAMETER(PARAM_RUNNER)
     PARAMETER(PARAM_REUSELATEST)
@@ -867,6 +902,7 @@ public:
     PARAMETER(PARAM_DB_TYPE)
     PARAMETER(PARAM_CREATEDB_MODE)
     PARAMETER(PARAM_SHUFFLE)
+    PARAMETER(PARAM_DEDUP)
     PARAMETER(PARAM_WRITE_LOOKUP)
 
     // convert2fasta
@@ -990,6 +1026,10 @@ public:
     PARAMETER(PARAM_SUBDB_MODE)
     PARAMETER(PARAM_ID_MODE)
 
+    // reorderdb
+    PARAMETER(PARAM_REORDER_MODE)
+    PARAMETER(PARAM_CLUSTER_DB)
+
     // tar2db
     PARAMETER(PARAM_TAR_INCLUDE)
     PARAMETER(PARAM_TAR_EXCLUDE)
@@ -1018,10 +1058,12 @@ public:
     std::vector<MMseqsParameter*> verbandcompression;
     std::vector<MMseqsParameter*> onlythreads;
     std::vector<MMseqsParameter*> threadsandcompression;
+    std::vector<MMseqsParameter*> compressdb;
 
     std::vector<MMseqsParameter*> alignall;
     std::vector<MMseqsParameter*> align;
     std::vector<MMseqsParameter*> rescorediagonal;
+    std::vector<MMseqsParameter*> kmermap;
     std::vector<MMseqsParameter*> alignbykmer;
     std::vector<MMseqsParameter*> createFasta;
     std::vector<MMseqsParameter*> convertprofiledb;
@@ -1078,6 +1120,7 @@ public:
     std::vector<MMseqsParameter*> subtractdbs;
     std::vector<MMseqsParameter*> diff;
     std::vector<MMseqsParameter*> concatdbs;
+    std::vector<MMseqsParameter*> federatedbs;
     std::vector<MMseqsParameter*> mergedbs;
     std::vector<MMseqsParameter*> summarizeheaders;
     std::vector<MMseqsParameter*> prefixid;
@@ -1098,6 +1141,7 @@ public:
     std::vector<MMseqsParameter*> taxonomy;
     std::vector<MMseqsParameter*> easytaxonomy;
     std::vector<MMseqsParameter*> createsubdb;
+    std::vector<MMseqsParameter*> reorderdb;
     std::vector<MMseqsParameter*> renamedbkeys;
     std::vector<MMseqsParameter*> createtaxdb;
     std::vector<MMseqsParameter*> profile2pssm;
@@ -0,0 +1,54 @@
+#include "QueryScheduler.h"
+#include "Debug.h"
+
+#include <algorithm>
+
+struct CompareByCostDesc {
+    CompareByCostDesc(const std::vector<size_t> &costs, size_t from) : costs(costs), from(from) {}
+    bool operator()(size_t first, size_t second) const {
+        return costs[first - from] > costs[second - from];
+    }
+    const std::vector<size_t> &costs;
+    size_t from;
+};
+
+QueryScheduler::QueryScheduler(size_t from, size_t size, unsigned int threads)
+        : from(from), threads(std::max(threads, 1u)), totalCost(0), costs(size, 0), order(size), lastBusy(this->threads, 0.0) {
+    for (size_t i = 0; i < size; ++i) {
+        order[i] = from + i;
+    }
+}
+
+void QueryScheduler::sortByCost() {
+    totalCost = 0;
+    for (size_t i = 0; i < costs.size(); ++i) {
+        totalCost += costs[i];
+    }
+    std::stable_sort(order.begin(), order.end(), CompareByCostDesc(costs, from));
+}
+
+void QueryScheduler::start() {
+    std::fill(lastBusy.begin(), lastBusy.end(), 0.0);
+    timer.reset();
+}
+
+double QueryScheduler::getTailUtilization() const {
+    const double wallTime = *std::max_element(lastBusy.begin(), lastBusy.end());
+    if (wallTime <= 0.0) {
+        return 1.0;
+    }
+    // threads never idle before they run out of work, so everything until their last piece of work was busy
+    const double tailStart = 0.9 * wallTime;
+    double busy = 0.0;
+    for (size_t i = 0; i < lastBusy.size(); ++i) {
+        busy += std::max(0.0, lastBusy[i] - tailStart);
+    }
+    return busy / ((wallTime - tailStart) * threads);
+}
+
+void QueryScheduler::printTailUtilization() const {
+    if (threads < 2) {
+        return;
+    }
+    Debug(Debug::INFO) << "Thread utilization in the last 10% of time: " << static_cast<int>(100.0 * getTailUtilization() + 0.5) << "%\n";
+}
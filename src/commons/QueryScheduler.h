@@ -0,0 +1,66 @@
+#ifndef MMSEQS_QUERYSCHEDULER_H
+#define MMSEQS_QUERYSCHEDULER_H
+
+// Orders the queries of a dynamically scheduled OpenMP loop by an estimated cost, longest first,
+// so that a few expensive queries in the back of the database cannot end up as a long tail.
+// It also remembers when each thread last finished a piece of work to report how well the
+// threads were utilized in the last 10% of the loop's wall time.
+
+#include "Timer.h"
+
+#include <cstddef>
+#include <vector>
+
+class QueryScheduler {
+public:
+    QueryScheduler(size_t from, size_t size, unsigned int threads);
+
+    // thread safe as long as every id is set by a single thread
+    void setCost(size_t id, size_t cost) {
+        costs[id - from] = cost;
+    }
+
+    size_t getCost(size_t id) const {
+        return costs[id - from];
+    }
+
+    // stable, queries with the same cost stay in database order
+    void sortByCost();
+
+    size_t getTotalCost() const {
+        return totalCost;
+    }
+
+    size_t size() const {
+        return order.size();
+    }
+
+    // id of the i-th query to process
+    size_t getId(size_t i) const {
+        return order[i];
+    }
+
+    // starts the clock for the utilization report
+    void start();
+
+    // called by a thread after each query (or part of a query) it processed
+    void markBusy(unsigned int thread) {
+        lastBusy[thread] = timer.getTimediff();
+    }
+
+    // busy thread time in the last 10% of the wall time divided by the available thread time
+    double getTailUtilization() const;
+
+    void printTailUtilization() const;
+
+private:
+    size_t from;
+    unsigned int threads;
+    size_t totalCost;
+    std::vector<size_t> costs;
+    std::vector<size_t> order;
+    std::vector<double> lastBusy;
+    Timer timer;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "ResumableChunks.h"
+#include "Parameters.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <fstream>
+
+ResumableChunks::ResumableChunks(const std::string &outDB, const std::string &outDBIndex, size_t chunks, size_t fingerprint)
+        : outDB(outDB), outDBIndex(outDBIndex), manifest(outDB + ".chunks"), chunks(chunks), fingerprintValue(fingerprint), state(chunks, 0) {
+    std::ifstream in(manifest.c_str());
+    if (in.fail()) {
+        writeHeader();
+        return;
+    }
+
+    std::string line;
+    bool valid = false;
+    if (std::getline(in, line) && in.eof() == false) {
+        std::vector<std::string> header = Util::split(line, "\t");
+        valid = header.size() == 2 && header[0] == SSTR(fingerprint) && header[1] == SSTR(chunks);
+    }
+
+    size_t committed = 0;
+    // a line without newline was not completely written
+    while (valid && std::getline(in, line) && in.eof() == false) {
+        if (line == "merge") {
+            valid = false;
+            break;
+        }
+        std::vector<std::string> entry = Util::split(line, "\t");
+        if (entry.size() != 2) {
+            continue;
+        }
+        const size_t chunk = Util::fast_atoi<size_t>(entry[0].c_str());
+        if (chunk < chunks && state[chunk] == 0) {
+            state[chunk] = (entry[1] == "1") ? 2 : 1;
+            committed++;
+        }
+    }
+    in.close();
+
+    if (valid == false) {
+        Debug(Debug::INFO) << "Checkpoints in " << manifest << " do not match this run or were already being merged. Computing all chunks.\n";
+        std::fill(state.begin(), state.end(), 0);
+        writeHeader();
+        return;
+    }
+    if (committed > 0) {
+        Debug(Debug::INFO) << "Resuming from " << manifest << ": " << committed << " of " << chunks << " chunks are already done\n";
+    }
+}
+
+size_t ResumableChunks::fingerprint(Parameters &par, const Command &command) {
+    // the number of threads and the verbosity do not change the result, a restart on another node may use different ones
+    std::vector<MMseqsParameter*> params = par.removeParameter(*command.params, par.PARAM_THREADS);
+    params = par.removeParameter(params, par.PARAM_V);
+    return par.hashParameter(command.databases, par.filenames, params);
+}
+
+bool ResumableChunks::isDone(size_t chunk) const {
+    if (state[chunk] == 2) {
+        return FileUtil::fileExists(getChunkDb(chunk).second.c_str());
+    }
+    return state[chunk] == 1;
+}
+
+std::pair<std::string, std::string> ResumableChunks::getChunkDb(size_t chunk) const {
+    return Util::createTmpFileNames(outDB, outDBIndex, chunk);
+}
+
+void ResumableChunks::commit(size_t chunk, bool hasResult) {
+    if (hasResult) {
+        std::pair<std::string, std::string> chunkDb = getChunkDb(chunk);
+        std::vector<std::string> dataFiles = FileUtil::findDatafiles(chunkDb.first.c_str());
+        for (size_t i = 0; i < dataFiles.size(); ++i) {
+            FileUtil::syncFile(dataFiles[i].c_str());
+        }
+        FileUtil::syncFile(chunkDb.second.c_str());
+        std::string dbtypeFile = chunkDb.first + ".dbtype";
+        if (FileUtil::fileExists(dbtypeFile.c_str())) {
+            FileUtil::syncFile(dbtypeFile.c_str());
+        }
+    }
+    state[chunk] = hasResult ? 2 : 1;
+    appendLine(SSTR(chunk) + "\t" + (hasResult ? "1" : "0"));
+}
+
+std::vector<std::pair<std::string, std::string>> ResumableChunks::startMerge() {
+    std::vector<std::pair<std::string, std::string>> resultDbs;
+    for (size_t i = 0; i < chunks; ++i) {
+        if (state[i] == 2) {
+            resultDbs.push_back(getChunkDb(i));
+        }
+    }
+    appendLine("merge");
+    return resultDbs;
+}
+
+void ResumableChunks::finish() {
+    if (FileUtil::fileExists(manifest.c_str())) {
+        FileUtil::remove(manifest.c_str());
+    }
+}
+
+void ResumableChunks::writeHeader() {
+    FILE *handle = FileUtil::openAndDelete(manifest.c_str(), "w");
+    fprintf(handle, "%zu\t%zu\n", fingerprintValue, chunks);
+    if (fclose(handle) != 0) {
+        Debug(Debug::ERROR) << "Cannot close checkpoint manifest " << manifest << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    FileUtil::syncFile(manifest.c_str());
+}
+
+void ResumableChunks::appendLine(const std::string &line) {
+    FILE *handle = FileUtil::openFileOrDie(manifest.c_str(), "a", true);
+    fprintf(handle, "%s\n", line.c_str());
+    if (fclose(handle) != 0) {
+        Debug(Debug::ERROR) << "Cannot close checkpoint manifest " << manifest << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    FileUtil::syncFile(manifest.c_str());
+}
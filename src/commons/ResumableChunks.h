@@ -0,0 +1,59 @@
+#ifndef MMSEQS_RESUMABLECHUNKS_H
+#define MMSEQS_RESUMABLECHUNKS_H
+
+// Bookkeeping for modules that process their input in chunks of queries and commit each chunk to its own
+// temporary DB. Committed chunks are recorded in a manifest next to the output (<outDB>.chunks) after their
+// files were synced to disk, so a run that was killed can be restarted with the same command and only
+// computes the missing chunks. The manifest is only trusted if the inputs, the parameters and the number of chunks
+// did not change, otherwise all chunks are recomputed.
+
+#include "Command.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Parameters;
+
+class ResumableChunks {
+public:
+    ResumableChunks(const std::string &outDB, const std::string &outDBIndex, size_t chunks, size_t fingerprint);
+
+    // hash over the input files and all parameters of the command that change the result
+    static size_t fingerprint(Parameters &par, const Command &command);
+
+    size_t size() const {
+        return chunks;
+    }
+
+    // chunk was committed by this or an earlier run and its DB is still there
+    bool isDone(size_t chunk) const;
+
+    std::pair<std::string, std::string> getChunkDb(size_t chunk) const;
+
+    // chunk DB is closed, chunks without result are remembered so that they are not recomputed either
+    void commit(size_t chunk, bool hasResult);
+
+    // DBs of all committed chunks with a result in chunk order
+    // merging modifies the chunk DBs in place, a run that is killed from here on starts over
+    std::vector<std::pair<std::string, std::string>> startMerge();
+
+    // the chunk DBs were merged into the output, forget about them
+    void finish();
+
+private:
+    std::string outDB;
+    std::string outDBIndex;
+    std::string manifest;
+    size_t chunks;
+    size_t fingerprintValue;
+
+    // 0: not committed, 1: committed without result, 2: committed with result
+    std::vector<char> state;
+
+    void writeHeader();
+    void appendLine(const std::string &line);
+};
+
+#endif
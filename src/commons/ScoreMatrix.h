@@ -13,11 +13,14 @@ struct ScoreMatrix {
     size_t rowSize;
     short *score;
     unsigned int *index;
+    // set if score and index point into a memory mapped scoring cache entry
+    void *mapping;
+    size_t mappingSize;
 
-    ScoreMatrix() : elementSize(0), rowSize(0), score(NULL), index(NULL) {}
+    ScoreMatrix() : elementSize(0), rowSize(0), score(NULL), index(NULL), mapping(NULL), mappingSize(0) {}
 
     ScoreMatrix(short *scoreMatrix, unsigned int *indexMatrix, size_t elementSize, size_t rowSize) :
-            elementSize(elementSize), rowSize(rowSize), score(scoreMatrix), index(indexMatrix) {}
+            elementSize(elementSize), rowSize(rowSize), score(scoreMatrix), index(indexMatrix), mapping(NULL), mappingSize(0) {}
 
     bool isValid() {
         return score != NULL && index != NULL;
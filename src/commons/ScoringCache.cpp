@@ -0,0 +1,125 @@
+#include "ScoringCache.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char SCORING_CACHE_MAGIC[8] = {'M', 'M', 'S', 'C', 'A', 'C', 'H', 'E'};
+
+std::string ScoringCache::getCacheDir() {
+    // opt-in only, the extended 3-mer matrices are about half a GB and must not end up in home directories unasked
+    const char *cacheEnv = getenv("MMSEQS_CACHE_DIR");
+    if (cacheEnv == NULL || cacheEnv[0] == '\0') {
+        return "";
+    }
+    return cacheEnv;
+}
+
+uint64_t ScoringCache::hash(const void *data, size_t size, uint64_t seed) {
+    return XXH64(data, size, seed);
+}
+
+std::string ScoringCache::getEntryPath(const std::string &dir, Kind kind, uint64_t key) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "/%u_%016llx.v%u", static_cast<unsigned int>(kind),
+             static_cast<unsigned long long>(key), VERSION);
+    return dir + buffer;
+}
+
+ScoringCache::Entry ScoringCache::map(Kind kind, uint64_t key, size_t expectedSize) {
+    static_assert(sizeof(Header) == 64, "cache header must keep the payload 64 byte aligned");
+    Entry entry;
+    std::string dir = getCacheDir();
+    if (dir.empty()) {
+        return entry;
+    }
+    std::string path = getEntryPath(dir, kind, key);
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == NULL) {
+        return entry;
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0 || static_cast<size_t>(st.st_size) != sizeof(Header) + expectedSize) {
+        fclose(file);
+        return entry;
+    }
+    size_t mappingSize = st.st_size;
+    void *mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    fclose(file);
+    if (mapping == MAP_FAILED) {
+        return entry;
+    }
+    const Header *header = static_cast<const Header *>(mapping);
+    if (memcmp(header->magic, SCORING_CACHE_MAGIC, sizeof(SCORING_CACHE_MAGIC)) != 0
+        || header->version != VERSION || header->kind != static_cast<uint32_t>(kind)
+        || header->key != key || header->payloadSize != expectedSize) {
+        Debug(Debug::WARNING) << "Ignoring invalid scoring cache entry " << path << "\n";
+        munmap(mapping, mappingSize);
+        return entry;
+    }
+    entry.mapping = mapping;
+    entry.mappingSize = mappingSize;
+    entry.payload = static_cast<char *>(mapping) + sizeof(Header);
+    entry.payloadSize = expectedSize;
+    return entry;
+}
+
+void ScoringCache::unmap(Entry &entry) {
+    if (entry.mapping != NULL) {
+        FileUtil::munmapData(entry.mapping, entry.mappingSize);
+    }
+    entry = Entry();
+}
+
+void ScoringCache::store(Kind kind, uint64_t key, const std::vector<std::pair<const char *, size_t>> &payloadParts) {
+    size_t payloadSize = 0;
+    for (size_t i = 0; i < payloadParts.size(); ++i) {
+        payloadSize += payloadParts[i].second;
+    }
+    std::string dir = getCacheDir();
+    if (dir.empty()) {
+        return;
+    }
+    if (FileUtil::directoryExists(dir.c_str()) == false) {
+        if (FileUtil::makeDir(dir.c_str()) == false && FileUtil::directoryExists(dir.c_str()) == false) {
+            Debug(Debug::INFO) << "Cannot create scoring cache directory " << dir << "\n";
+            return;
+        }
+    }
+    // never fill up the disk for a cache
+    if (FileUtil::getFreeSpace(dir.c_str()) < 2 * (payloadSize + sizeof(Header))) {
+        return;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, SCORING_CACHE_MAGIC, sizeof(SCORING_CACHE_MAGIC));
+    header.version = VERSION;
+    header.kind = static_cast<uint32_t>(kind);
+    header.key = key;
+    header.payloadSize = payloadSize;
+
+    std::string path = getEntryPath(dir, kind, key);
+    std::string tmpPath = path + ".tmp." + SSTR(getpid());
+    FILE *file = fopen(tmpPath.c_str(), "w");
+    if (file == NULL) {
+        return;
+    }
+    bool success = fwrite(&header, sizeof(Header), 1, file) == 1;
+    for (size_t i = 0; success && i < payloadParts.size(); ++i) {
+        success = fwrite(payloadParts[i].first, sizeof(char), payloadParts[i].second, file) == payloadParts[i].second;
+    }
+    success = (fclose(file) == 0) && success;
+    if (success == false || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+    }
+}
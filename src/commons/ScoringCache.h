@@ -0,0 +1,70 @@
+#ifndef MMSEQS_SCORINGCACHE_H
+#define MMSEQS_SCORINGCACHE_H
+
+// Versioned on-disk cache for scoring artifacts that are expensive to derive
+// at startup: the cacode lambda/background of matrices without precomputed
+// values and the sorted extended (2-mer/3-mer) score matrices of the prefilter.
+//
+// Entries are keyed by a hash over the data they are derived from (e.g. the final
+// short substitution matrix, which already reflects bit factor, score bias and
+// alphabet reduction), so a changed matrix can never hit a stale entry.
+// The cache is only used if $MMSEQS_CACHE_DIR is set, entries are then stored in that directory.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ScoringCache {
+public:
+    static const unsigned int VERSION = 1;
+
+    enum Kind {
+        LAMBDA_BACKGROUND = 1,
+        EXTENDED_MATRIX = 2
+    };
+
+    struct Entry {
+        char *payload;
+        size_t payloadSize;
+        void *mapping;
+        size_t mappingSize;
+
+        Entry() : payload(NULL), payloadSize(0), mapping(NULL), mappingSize(0) {}
+
+        bool isValid() const {
+            return payload != NULL;
+        }
+    };
+
+    static std::string getCacheDir();
+
+    static uint64_t hash(const void *data, size_t size, uint64_t seed);
+
+    // maps a cache entry read-only, returns an invalid entry on a miss
+    static Entry map(Kind kind, uint64_t key, size_t expectedSize);
+
+    static void unmap(Entry &entry);
+
+    // write is atomic (tmp file + rename), so concurrent jobs can share a cache directory
+    static void store(Kind kind, uint64_t key, const std::vector<std::pair<const char *, size_t>> &payloadParts);
+
+    static void store(Kind kind, uint64_t key, const char *payload, size_t payloadSize) {
+        store(kind, key, std::vector<std::pair<const char *, size_t>>(1, std::make_pair(payload, payloadSize)));
+    }
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t kind;
+        uint64_t key;
+        uint64_t payloadSize;
+        char padding[32];
+    };
+
+    static std::string getEntryPath(const std::string &dir, Kind kind, uint64_t key);
+};
+
+#endif
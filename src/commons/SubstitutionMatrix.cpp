@@ -1,6 +1,7 @@
 #include "SubstitutionMatrix.h"
 #include "Util.h"
 #include "Debug.h"
+#include "ScoringCache.h"
 #include "lambda_calculator.h"
 
 
@@ -396,12 +397,27 @@ void SubstitutionMatrix::readProbMatrix(const std::string &matrixData, const boo
     }
 
     if(hasLambda == false || hasBackground == false){
-        if (estimateLambdaAndBackground(const_cast<const double **>(probMatrix), alphabetSize - ((xIsPositive) ? 0 : 1),
-                                        pBack, lambda) == false) {
-            Debug(Debug::ERROR) << "Computing inverse of substitution matrix failed\n";
-            EXIT(EXIT_FAILURE);
+        // matrices without precomputed values are looked up in the scoring cache by content
+        const size_t cacheSize = sizeof(double) * (alphabetSize + 1);
+        const uint64_t cacheKey = ScoringCache::hash(matrixData.c_str(), matrixData.size(), alphabetSize * 2 + xIsPositive);
+        ScoringCache::Entry entry = ScoringCache::map(ScoringCache::LAMBDA_BACKGROUND, cacheKey, cacheSize);
+        if (entry.isValid()) {
+            memcpy(&lambda, entry.payload, sizeof(double));
+            memcpy(pBack, entry.payload + sizeof(double), sizeof(double) * alphabetSize);
+            ScoringCache::unmap(entry);
+        } else {
+            if (estimateLambdaAndBackground(const_cast<const double **>(probMatrix), alphabetSize - ((xIsPositive) ? 0 : 1),
+                                            pBack, lambda) == false) {
+                Debug(Debug::ERROR) << "Computing inverse of substitution matrix failed\n";
+                EXIT(EXIT_FAILURE);
+            }
+            pBack[static_cast<int>(aa2num[static_cast<int>('X')])]=ANY_BACK;
+
+            std::vector<std::pair<const char *, size_t>> parts;
+            parts.emplace_back((const char *) &lambda, sizeof(double));
+            parts.emplace_back((const char *) pBack, sizeof(double) * alphabetSize);
+            ScoringCache::store(ScoringCache::LAMBDA_BACKGROUND, cacheKey, parts);
         }
-        pBack[static_cast<int>(aa2num[static_cast<int>('X')])]=ANY_BACK;
     }
     if(xIsPositive == false){
         for (int i = 0; i < alphabetSize - 1; i++) {
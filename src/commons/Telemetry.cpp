@@ -0,0 +1,253 @@
+#include "Telemetry.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+struct TelemetryState {
+    int fd;
+    bool ownsFd;
+    std::string module;
+    double interval;
+    Timer timer;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+    std::thread *worker;
+};
+
+// never destroyed, EXIT can end the process while the module runs
+TelemetryState *state = NULL;
+
+int openStream(const char *target) {
+    if (strncmp(target, "fd:", 3) == 0) {
+        return Util::fast_atoi<int>(target + 3);
+    }
+    if (strncmp(target, "unix:", 5) == 0) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(target + 5) >= sizeof(address.sun_path)) {
+            return -1;
+        }
+        strcpy(address.sun_path, target + 5);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) {
+            return -1;
+        }
+        // commands started by workflows must not inherit the telemetry target
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        if (connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    return open(target, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+double now() {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + 1e-6 * time.tv_usec;
+}
+
+// appends "key":value pairs of the resources used by this process so far
+void appendResources(std::string &line) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        const size_t peakRss = usage.ru_maxrss;
+#else
+        const size_t peakRss = usage.ru_maxrss * 1024;
+#endif
+        line.append(",\"peak_rss\":");
+        line.append(SSTR(peakRss));
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), ",\"user_time\":%.3f,\"system_time\":%.3f",
+                 usage.ru_utime.tv_sec + 1e-6 * usage.ru_utime.tv_usec, usage.ru_stime.tv_sec + 1e-6 * usage.ru_stime.tv_usec);
+        line.append(buffer);
+    }
+
+    // only available on Linux
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm != NULL) {
+        size_t pages, residentPages;
+        if (fscanf(statm, "%zu %zu", &pages, &residentPages) == 2) {
+            line.append(",\"rss\":");
+            line.append(SSTR(residentPages * (size_t) sysconf(_SC_PAGESIZE)));
+        }
+        fclose(statm);
+    }
+    FILE *io = fopen("/proc/self/io", "r");
+    if (io != NULL) {
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), io) != NULL) {
+            if (strncmp(buffer, "read_bytes: ", 12) == 0) {
+                line.append(",\"read_bytes\":");
+                line.append(SSTR(strtoull(buffer + 12, NULL, 10)));
+            } else if (strncmp(buffer, "write_bytes: ", 13) == 0) {
+                line.append(",\"write_bytes\":");
+                line.append(SSTR(strtoull(buffer + 13, NULL, 10)));
+            }
+        }
+        fclose(io);
+    }
+}
+
+std::string beginEvent(const char *event) {
+    std::string line;
+    line.append("{\"event\":\"");
+    line.append(event);
+    line.append("\",\"module\":\"");
+    line.append(state->module);
+    line.append("\",\"pid\":");
+    line.append(SSTR(getpid()));
+    line.append(",\"time\":");
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", now());
+    line.append(buffer);
+    line.append(",\"elapsed\":");
+    snprintf(buffer, sizeof(buffer), "%.3f", state->timer.getTimediff());
+    line.append(buffer);
+    return line;
+}
+
+// a single write per line, lines of concurrent modules on a pipe or an O_APPEND file do not mix
+void writeEvent(std::string &line) {
+    line.append("}\n");
+    const char *data = line.c_str();
+    size_t remaining = line.size();
+    while (remaining > 0) {
+        ssize_t written = write(state->fd, data, remaining);
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        remaining -= written;
+    }
+}
+
+void progressEvent() {
+    std::string line = beginEvent("progress");
+    size_t processed, total;
+    double elapsed;
+    if (Debug::Progress::getActive(processed, total, elapsed)) {
+        char buffer[64];
+        line.append(",\"processed\":");
+        line.append(SSTR(processed));
+        if (total != SIZE_MAX) {
+            line.append(",\"total\":");
+            line.append(SSTR(total));
+        }
+        const double rate = elapsed > 0 ? processed / elapsed : 0;
+        snprintf(buffer, sizeof(buffer), ",\"rate\":%.3f", rate);
+        line.append(buffer);
+        if (total != SIZE_MAX && rate > 0 && processed <= total) {
+            snprintf(buffer, sizeof(buffer), ",\"eta\":%.1f", (total - processed) / rate);
+            line.append(buffer);
+        }
+    }
+    appendResources(line);
+    writeEvent(line);
+}
+
+// EXIT ends the process without returning to runCommand
+void exitEvent() {
+    if (state == NULL) {
+        return;
+    }
+    std::string line = beginEvent("end");
+    line.append(",\"status\":null");
+    appendResources(line);
+    writeEvent(line);
+}
+
+void run() {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (state->stopping == false) {
+        if (state->wakeup.wait_for(lock, std::chrono::duration<double>(state->interval)) == std::cv_status::timeout) {
+            progressEvent();
+        }
+    }
+}
+
+}
+
+void Telemetry::start(const char *module) {
+    const char *target = getenv("MMSEQS_TELEMETRY");
+    if (target == NULL || *target == '\0') {
+        return;
+    }
+    int fd = openStream(target);
+    if (fd == -1) {
+        Debug(Debug::WARNING) << "Cannot open telemetry stream " << target << "\n";
+        return;
+    }
+    state = new TelemetryState;
+    state->fd = fd;
+    state->ownsFd = strncmp(target, "fd:", 3) != 0;
+    state->module = module;
+    state->interval = 5.0;
+    const char *interval = getenv("MMSEQS_TELEMETRY_INTERVAL");
+    if (interval != NULL && strtod(interval, NULL) > 0) {
+        state->interval = strtod(interval, NULL);
+    }
+    state->stopping = false;
+
+    std::string line = beginEvent("start");
+    line.append(",\"parent\":");
+    line.append(SSTR(getppid()));
+    const char *depth = getenv("MMSEQS_CALL_DEPTH");
+    line.append(",\"depth\":");
+    line.append(depth != NULL ? depth : "0");
+    writeEvent(line);
+
+    state->worker = new std::thread(run);
+    static bool registered = false;
+    if (registered == false) {
+        atexit(exitEvent);
+        registered = true;
+    }
+}
+
+void Telemetry::finish(int status) {
+    if (state == NULL) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stopping = true;
+    }
+    state->wakeup.notify_one();
+    state->worker->join();
+    delete state->worker;
+
+    std::string line = beginEvent("end");
+    line.append(",\"status\":");
+    line.append(SSTR(status));
+    appendResources(line);
+    writeEvent(line);
+    if (state->ownsFd) {
+        close(state->fd);
+    }
+    delete state;
+    state = NULL;
+}
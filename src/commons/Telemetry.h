@@ -0,0 +1,20 @@
+#ifndef MMSEQS_TELEMETRY_H
+#define MMSEQS_TELEMETRY_H
+
+// Machine readable progress of a module for job schedulers, one JSON object per line.
+// Enabled through the environment variable MMSEQS_TELEMETRY, so that the modules of a workflow report as well:
+//   fd:<n>       write to an inherited file descriptor
+//   unix:<path>  connect to a UNIX stream socket
+//   <path>       append to a file
+// Every module reports a start event, a progress event every MMSEQS_TELEMETRY_INTERVAL seconds (default 5)
+// with the items of the current progress bar, throughput, ETA, memory and I/O, and an end event.
+// A module that does not report for a few intervals is stuck.
+
+class Telemetry {
+public:
+    // called around the module by runCommand
+    static void start(const char *module);
+    static void finish(int status);
+};
+
+#endif
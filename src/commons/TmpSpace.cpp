@@ -0,0 +1,30 @@
+#include "TmpSpace.h"
+#include "FileUtil.h"
+#include "ByteParser.h"
+#include "Debug.h"
+
+#include <cstdint>
+#include <sys/stat.h>
+
+bool TmpSpace::shouldCompress(const std::string &tmpDir, size_t predictedBytes,
+                              const std::string &outputFile, size_t outputBytes) {
+    const size_t freeSpace = FileUtil::getFreeSpace(tmpDir.c_str());
+    if (freeSpace == SIZE_MAX) {
+        return false;
+    }
+    struct stat tmpStat;
+    struct stat outputStat;
+    const std::string outputDir = FileUtil::dirName(outputFile);
+    if (stat(tmpDir.c_str(), &tmpStat) == 0 && stat(outputDir.c_str(), &outputStat) == 0 && tmpStat.st_dev == outputStat.st_dev) {
+        predictedBytes += outputBytes;
+    }
+    Debug(Debug::INFO) << "Predicted tmp space: up to " << ByteParser::format(predictedBytes)
+                       << " of " << ByteParser::format(freeSpace) << " free\n";
+    if (predictedBytes <= freeSpace) {
+        return false;
+    }
+    if (predictedBytes / COMPRESSION_RATIO > freeSpace) {
+        Debug(Debug::WARNING) << "The tmp directory " << tmpDir << " might run out of space even with compressed intermediate results\n";
+    }
+    return true;
+}
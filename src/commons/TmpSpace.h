@@ -0,0 +1,33 @@
+#ifndef MMSEQS_TMPSPACE_H
+#define MMSEQS_TMPSPACE_H
+
+// Predicts how much space the intermediate result DBs of a workflow take in its tmp directory.
+// The prediction is an upper bound that assumes every query fills its result list.
+
+#include <cstddef>
+#include <string>
+
+class TmpSpace {
+public:
+    // zstd shrinks the text result DBs by about this factor
+    static const size_t COMPRESSION_RATIO = 2;
+
+    // a prefilter hit takes ~13 bytes, 21 leaves room for long keys
+    static size_t prefilterResultSize(size_t queries, size_t hitsPerQuery) {
+        return 21 * queries * hitsPerQuery;
+    }
+
+    // an alignment hit takes ~50 bytes, the backtrace adds ~40 bytes for typical protein alignments
+    static size_t alignmentResultSize(size_t queries, size_t hitsPerQuery, bool backtrace) {
+        return (backtrace ? 90 : 50) * queries * hitsPerQuery;
+    }
+
+    // Prints the prediction and returns if the intermediates should be compressed. Compressing costs CPU time in
+    // every step that writes or reads them, so it is only worth it if the uncompressed intermediates do not fit.
+    // The final result is written uncompressed (unless requested) next to outputFile, it needs space too
+    // if it ends up on the same file system as the tmp directory.
+    static bool shouldCompress(const std::string &tmpDir, size_t predictedBytes,
+                               const std::string &outputFile, size_t outputBytes);
+};
+
+#endif
@@ -0,0 +1,503 @@
+#include "DistanceCalculator.h"
+#include "Util.h"
+#include "Parameters.h"
+#include "Matcher.h"
+#include "Alignment.h"
+#include "Debug.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "IndexReader.h"
+#include "NucleotideMatrix.h"
+#include "SubstitutionMatrix.h"
+#include "FastSort.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// Mapping of near-identical sequences. Minimizers of the target DB are kept in one sorted in-memory index,
+// query minimizers are looked up exactly, seeds of a target are chained along a narrow diagonal band
+// and the best chain is extended ungapped first. Only chains that fail the acceptance criteria after the
+// ungapped extension are realigned with the gapped aligner.
+
+struct KmerMapIndexEntry {
+    unsigned long long hash;
+    unsigned int targetId;
+    unsigned int pos;
+
+    static bool compare(const KmerMapIndexEntry &a, const KmerMapIndexEntry &b) {
+        if (a.hash != b.hash) {
+            return a.hash < b.hash;
+        }
+        if (a.targetId != b.targetId) {
+            return a.targetId < b.targetId;
+        }
+        return a.pos < b.pos;
+    }
+
+    static bool compareHash(const KmerMapIndexEntry &a, unsigned long long hash) {
+        return a.hash < hash;
+    }
+};
+
+struct KmerMapMinimizer {
+    unsigned long long hash;
+    unsigned int pos;
+};
+
+struct KmerMapSeed {
+    unsigned int targetId;
+    bool isReverse;
+    int diagonal;
+    unsigned int qPos;
+
+    static bool compare(const KmerMapSeed &a, const KmerMapSeed &b) {
+        if (a.targetId != b.targetId) {
+            return a.targetId < b.targetId;
+        }
+        if (a.isReverse != b.isReverse) {
+            return a.isReverse < b.isReverse;
+        }
+        if (a.diagonal != b.diagonal) {
+            return a.diagonal < b.diagonal;
+        }
+        return a.qPos < b.qPos;
+    }
+};
+
+struct KmerMapChain {
+    unsigned int targetId;
+    bool isReverse;
+    int diagonal;
+    unsigned int seeds;
+
+    static bool compareBySeeds(const KmerMapChain &a, const KmerMapChain &b) {
+        if (a.seeds != b.seeds) {
+            return a.seeds > b.seeds;
+        }
+        return a.targetId < b.targetId;
+    }
+};
+
+// seeds further apart than this many diagonals are not chained
+static const int CHAIN_BAND = 16;
+// tolerance of the seq. id. estimated from the seed count before a chain is realigned with gaps
+static const float CHAIN_SEQID_SLACK = 0.05f;
+
+static inline unsigned long long hashKmer(unsigned long long code) {
+    code ^= code >> 30;
+    code *= 0xbf58476d1ce4e5b9ULL;
+    code ^= code >> 27;
+    code *= 0x94d049bb133111ebULL;
+    code ^= code >> 31;
+    return code;
+}
+
+// (w, k)-minimizers of a sequence, k-mers containing X/N are never selected
+static void extractMinimizers(const char *seq, unsigned int seqLen, const BaseMatrix &subMat, unsigned int bitsPerResidue,
+                              unsigned int kmerSize, unsigned int window,
+                              std::vector<unsigned long long> &hashes, std::vector<KmerMapMinimizer> &minimizers) {
+    minimizers.clear();
+    if (seqLen < kmerSize) {
+        return;
+    }
+    const unsigned char invalid = static_cast<unsigned char>(subMat.alphabetSize - 1);
+    const unsigned long long mask = (1ULL << (bitsPerResidue * kmerSize)) - 1;
+    const unsigned int kmers = seqLen - kmerSize + 1;
+    hashes.resize(kmers);
+    unsigned long long code = 0;
+    unsigned int valid = 0;
+    for (unsigned int i = 0; i < seqLen; ++i) {
+        const unsigned char res = subMat.aa2num[static_cast<int>(seq[i])];
+        if (res >= invalid) {
+            valid = 0;
+            code = 0;
+        } else {
+            code = ((code << bitsPerResidue) | res) & mask;
+            valid++;
+        }
+        if (i + 1 >= kmerSize) {
+            hashes[i + 1 - kmerSize] = (valid >= kmerSize) ? hashKmer(code) : ULLONG_MAX;
+        }
+    }
+
+    // consecutive windows that share their minimum report it only once
+    const unsigned int span = std::min(window, kmers);
+    const unsigned int windows = kmers - span + 1;
+    unsigned int minPos = UINT_MAX;
+    for (unsigned int start = 0; start < windows; ++start) {
+        const unsigned int end = start + span;
+        if (minPos == UINT_MAX || minPos < start) {
+            minPos = start;
+            for (unsigned int j = start + 1; j < end; ++j) {
+                if (hashes[j] < hashes[minPos]) {
+                    minPos = j;
+                }
+            }
+        } else if (hashes[end - 1] < hashes[minPos]) {
+            minPos = end - 1;
+        }
+        if (hashes[minPos] != ULLONG_MAX && (minimizers.empty() || minimizers.back().pos != minPos)) {
+            KmerMapMinimizer minimizer;
+            minimizer.hash = hashes[minPos];
+            minimizer.pos = minPos;
+            minimizers.push_back(minimizer);
+        }
+    }
+}
+
+// best band of each (target, strand) in a sorted seed list, only the better strand is kept per target
+static void chainSeeds(const std::vector<KmerMapSeed> &seeds, std::vector<KmerMapChain> &chains) {
+    chains.clear();
+    size_t groupStart = 0;
+    while (groupStart < seeds.size()) {
+        size_t groupEnd = groupStart + 1;
+        while (groupEnd < seeds.size() && seeds[groupEnd].targetId == seeds[groupStart].targetId
+               && seeds[groupEnd].isReverse == seeds[groupStart].isReverse) {
+            groupEnd++;
+        }
+
+        size_t bestCount = 0;
+        size_t bestFrom = groupStart;
+        size_t bestTo = groupStart;
+        size_t left = groupStart;
+        for (size_t right = groupStart; right < groupEnd; ++right) {
+            while (seeds[right].diagonal - seeds[left].diagonal > CHAIN_BAND) {
+                left++;
+            }
+            if (right - left + 1 > bestCount) {
+                bestCount = right - left + 1;
+                bestFrom = left;
+                bestTo = right + 1;
+            }
+        }
+        // extend along the diagonal with the most seeds in the band
+        int bestDiagonal = seeds[bestFrom].diagonal;
+        size_t bestRun = 0;
+        for (size_t i = bestFrom; i < bestTo;) {
+            size_t j = i + 1;
+            while (j < bestTo && seeds[j].diagonal == seeds[i].diagonal) {
+                j++;
+            }
+            if (j - i > bestRun) {
+                bestRun = j - i;
+                bestDiagonal = seeds[i].diagonal;
+            }
+            i = j;
+        }
+
+        KmerMapChain chain;
+        chain.targetId = seeds[groupStart].targetId;
+        chain.isReverse = seeds[groupStart].isReverse;
+        chain.diagonal = bestDiagonal;
+        chain.seeds = static_cast<unsigned int>(bestCount);
+        if (chains.empty() == false && chains.back().targetId == chain.targetId) {
+            if (chain.seeds > chains.back().seeds) {
+                chains.back() = chain;
+            }
+        } else {
+            chains.push_back(chain);
+        }
+        groupStart = groupEnd;
+    }
+}
+
+int kmermap(int argc, const char **argv, const Command &command) {
+    Parameters &par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    const bool touch = (par.preloadMode != Parameters::PRELOAD_MODE_MMAP);
+    IndexReader tDbrIdx(par.db2, par.threads, IndexReader::SEQUENCES, (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0);
+    DBReader<unsigned int> *tdbr = tDbrIdx.sequenceReader;
+    const int targetSeqType = tDbrIdx.getDbtype();
+
+    const bool sameQTDB = (par.db2.compare(par.db1) == 0);
+    IndexReader *qDbrIdx = NULL;
+    DBReader<unsigned int> *qdbr = NULL;
+    int querySeqType = targetSeqType;
+    if (sameQTDB) {
+        qdbr = tdbr;
+    } else {
+        qDbrIdx = new IndexReader(par.db1, par.threads, IndexReader::SEQUENCES, (touch) ? IndexReader::PRELOAD_INDEX : 0);
+        qdbr = qDbrIdx->sequenceReader;
+        querySeqType = qDbrIdx->getDbtype();
+    }
+
+    const bool isNucleotide = Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES);
+    if (Parameters::isEqualDbtype(querySeqType, targetSeqType) == false
+        || (isNucleotide == false && Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_AMINO_ACIDS) == false)) {
+        Debug(Debug::ERROR) << "kmermap needs two amino acid or two nucleotide sequence databases\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    BaseMatrix *subMat;
+    int gapOpen, gapExtend;
+    if (isNucleotide) {
+        subMat = new NucleotideMatrix(par.scoringMatrixFile.values.nucleotide().c_str(), 1.0, 0.0);
+        gapOpen = par.gapOpen.values.nucleotide();
+        gapExtend = par.gapExtend.values.nucleotide();
+    } else {
+        // keep score bias at 0.0 (improved ROC)
+        subMat = new SubstitutionMatrix(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, 0.0);
+        gapOpen = par.gapOpen.values.aminoacid();
+        gapExtend = par.gapExtend.values.aminoacid();
+    }
+    SubstitutionMatrix::FastMatrix fastMatrix = SubstitutionMatrix::createAsciiSubMat(*subMat);
+
+    const unsigned int bitsPerResidue = isNucleotide ? 2 : 5;
+    const unsigned int maxKmerSize = 64 / bitsPerResidue - 1;
+    unsigned int kmerSize = static_cast<unsigned int>(par.kmerSize);
+    if (kmerSize == 0) {
+        kmerSize = isNucleotide ? 15 : 7;
+    }
+    if (kmerSize > maxKmerSize) {
+        Debug(Debug::ERROR) << "kmermap supports k-mers up to length " << maxKmerSize << " for this sequence type\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const unsigned int window = isNucleotide ? 10 : 4;
+    // repeats and low complexity k-mers would otherwise seed against most of the database
+    const size_t maxOccurrences = std::max(static_cast<size_t>(4) * par.maxResListLen, static_cast<size_t>(64));
+
+    Debug(Debug::INFO) << "Index target minimizers with k = " << kmerSize << " and w = " << window << "\n";
+    std::vector<KmerMapIndexEntry> index;
+    {
+        Debug::Progress progress(tdbr->getSize());
+#pragma omp parallel num_threads(par.threads)
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+            std::vector<unsigned long long> hashes;
+            std::vector<KmerMapMinimizer> minimizers;
+            std::vector<KmerMapIndexEntry> local;
+#pragma omp for schedule(dynamic, 100) nowait
+            for (size_t id = 0; id < tdbr->getSize(); ++id) {
+                progress.updateProgress();
+                const char *seq = tdbr->getData(id, thread_idx);
+                const unsigned int seqLen = static_cast<unsigned int>(tdbr->getSeqLen(id));
+                extractMinimizers(seq, seqLen, *subMat, bitsPerResidue, kmerSize, window, hashes, minimizers);
+                for (size_t i = 0; i < minimizers.size(); ++i) {
+                    KmerMapIndexEntry entry;
+                    entry.hash = minimizers[i].hash;
+                    entry.targetId = static_cast<unsigned int>(id);
+                    entry.pos = minimizers[i].pos;
+                    local.push_back(entry);
+                }
+            }
+#pragma omp critical
+            index.insert(index.end(), local.begin(), local.end());
+        }
+    }
+    SORT_PARALLEL(index.begin(), index.end(), KmerMapIndexEntry::compare);
+    Debug(Debug::INFO) << index.size() << " minimizers in " << tdbr->getSize() << " sequences\n";
+
+    EvalueComputation ungappedEvaluer(tdbr->getAminoAcidDBSize(), subMat);
+    EvalueComputation gappedEvaluer(tdbr->getAminoAcidDBSize(), subMat, gapOpen, gapExtend);
+
+    DBWriter resultWriter(par.db3.c_str(), par.db3Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_ALIGNMENT_RES);
+    resultWriter.open();
+
+    size_t ungappedAccepted = 0;
+    size_t gappedAccepted = 0;
+    Debug::Progress progress(qdbr->getSize());
+#pragma omp parallel num_threads(par.threads) reduction(+:ungappedAccepted, gappedAccepted)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        char buffer[1024 + 32768*4];
+        std::string resultBuffer;
+        resultBuffer.reserve(1024 * 1024);
+        std::string queryBuffer;
+        std::string queryRevBuffer;
+        std::vector<unsigned long long> hashes;
+        std::vector<KmerMapMinimizer> minimizers;
+        std::vector<KmerMapSeed> seeds;
+        std::vector<KmerMapChain> chains;
+        std::vector<Matcher::result_t> alnResults;
+        alnResults.reserve(300);
+
+        Sequence qSeq(par.maxSeqLen, querySeqType, subMat, 0, false, par.compBiasCorrection);
+        Sequence dbSeq(par.maxSeqLen, targetSeqType, subMat, 0, false, par.compBiasCorrection);
+        BandedNucleotideAligner aligner(subMat, par.maxSeqLen, gapOpen, gapExtend, par.zdrop);
+
+#pragma omp for schedule(dynamic, 10)
+        for (size_t queryId = 0; queryId < qdbr->getSize(); ++queryId) {
+            progress.updateProgress();
+            const unsigned int queryKey = qdbr->getDbKey(queryId);
+            char *querySeq = qdbr->getData(queryId, thread_idx);
+            const int queryLen = static_cast<int>(qdbr->getSeqLen(queryId));
+            if (sameQTDB && qdbr->isCompressed()) {
+                queryBuffer.assign(querySeq, queryLen);
+                querySeq = const_cast<char *>(queryBuffer.c_str());
+            }
+            const char *queryRevSeq = NULL;
+            if (isNucleotide) {
+                NucleotideMatrix *nuclMatrix = static_cast<NucleotideMatrix *>(subMat);
+                queryRevBuffer.resize(queryLen);
+                for (int pos = queryLen - 1; pos > -1; pos--) {
+                    unsigned char res = subMat->aa2num[static_cast<int>(querySeq[pos])];
+                    queryRevBuffer[(queryLen - 1) - pos] = subMat->num2aa[nuclMatrix->reverseResidue(res)];
+                }
+                queryRevSeq = queryRevBuffer.c_str();
+            }
+
+            seeds.clear();
+            for (int strand = 0; strand < (isNucleotide ? 2 : 1); ++strand) {
+                const bool isReverse = (strand == 1);
+                extractMinimizers(isReverse ? queryRevSeq : querySeq, queryLen, *subMat, bitsPerResidue, kmerSize, window, hashes, minimizers);
+                for (size_t i = 0; i < minimizers.size(); ++i) {
+                    std::vector<KmerMapIndexEntry>::const_iterator it = std::lower_bound(index.begin(), index.end(), minimizers[i].hash, KmerMapIndexEntry::compareHash);
+                    std::vector<KmerMapIndexEntry>::const_iterator end = it;
+                    while (end != index.end() && end->hash == minimizers[i].hash && static_cast<size_t>(end - it) <= maxOccurrences) {
+                        ++end;
+                    }
+                    if (static_cast<size_t>(end - it) > maxOccurrences) {
+                        continue;
+                    }
+                    for (; it != end; ++it) {
+                        KmerMapSeed seed;
+                        seed.targetId = it->targetId;
+                        seed.isReverse = isReverse;
+                        seed.diagonal = static_cast<int>(minimizers[i].pos) - static_cast<int>(it->pos);
+                        seed.qPos = minimizers[i].pos;
+                        seeds.push_back(seed);
+                    }
+                }
+            }
+            SORT_SERIAL(seeds.begin(), seeds.end(), KmerMapSeed::compare);
+            chainSeeds(seeds, chains);
+            if (chains.size() > static_cast<size_t>(par.maxResListLen)) {
+                std::partial_sort(chains.begin(), chains.begin() + par.maxResListLen, chains.end(), KmerMapChain::compareBySeeds);
+                chains.resize(par.maxResListLen);
+            }
+
+            bool queryInitialized = false;
+            for (size_t i = 0; i < chains.size(); ++i) {
+                const KmerMapChain &chain = chains[i];
+                const unsigned int targetKey = tdbr->getDbKey(chain.targetId);
+                char *targetSeq = tdbr->getData(chain.targetId, thread_idx);
+                const int targetLen = static_cast<int>(tdbr->getSeqLen(chain.targetId));
+                if (Util::canBeCovered(par.covThr, par.covMode, static_cast<float>(queryLen), static_cast<float>(targetLen)) == false) {
+                    continue;
+                }
+                const bool isIdentity = (queryKey == targetKey && (par.includeIdentity || sameQTDB)) ? true : false;
+                const char *querySeqToAlign = chain.isReverse ? queryRevSeq : querySeq;
+
+                // ungapped extension along the chain diagonal, results match rescorediagonal --rescore-mode 2
+                DistanceCalculator::LocalAlignment alignment = DistanceCalculator::ungappedAlignmentByDiagonal(
+                        querySeqToAlign, queryLen, targetSeq, targetLen, chain.diagonal, fastMatrix.matrix, Parameters::RESCORE_MODE_ALIGNMENT);
+                if (alignment.score > 0) {
+                    const unsigned int distanceToDiagonal = alignment.distToDiagonal;
+                    int qStartPos, qEndPos, dbStartPos, dbEndPos;
+                    if (alignment.diagonal >= 0) {
+                        qStartPos = alignment.startPos + distanceToDiagonal;
+                        qEndPos = alignment.endPos + distanceToDiagonal;
+                        dbStartPos = alignment.startPos;
+                        dbEndPos = alignment.endPos;
+                    } else {
+                        qStartPos = alignment.startPos;
+                        qEndPos = alignment.endPos;
+                        dbStartPos = alignment.startPos + distanceToDiagonal;
+                        dbEndPos = alignment.endPos + distanceToDiagonal;
+                    }
+                    const double evalue = ungappedEvaluer.computeEvalue(alignment.score, queryLen);
+                    const int bitScore = static_cast<int>(ungappedEvaluer.computeBitScore(alignment.score) + 0.5);
+                    const int alnLen = (alignment.endPos - alignment.startPos) + 1;
+                    double seqId = 0.0;
+                    if (evalue <= par.evalThr || isIdentity) {
+                        int idCnt = 0;
+                        for (int pos = qStartPos; pos <= qEndPos; pos++) {
+                            char qLetter = querySeqToAlign[pos] & static_cast<unsigned char>(~0x20);
+                            char tLetter = targetSeq[dbStartPos + (pos - qStartPos)] & static_cast<unsigned char>(~0x20);
+                            idCnt += (qLetter == tLetter) ? 1 : 0;
+                        }
+                        seqId = Util::computeSeqId(par.seqIdMode, idCnt, queryLen, targetLen, alnLen);
+                    }
+                    std::string backtrace;
+                    if (par.addBacktrace) {
+                        char *end = Itoa::i32toa_sse2(alnLen, buffer);
+                        backtrace = std::string(buffer, (end - buffer) - 1);
+                        backtrace.push_back('M');
+                    }
+                    const float queryCov = SmithWaterman::computeCov(qStartPos, qEndPos, queryLen);
+                    const float targetCov = SmithWaterman::computeCov(dbStartPos, dbEndPos, targetLen);
+                    if (chain.isReverse) {
+                        qStartPos = queryLen - qStartPos - 1;
+                        qEndPos = queryLen - qEndPos - 1;
+                    }
+                    Matcher::result_t res(targetKey, bitScore, queryCov, targetCov, seqId, evalue, alnLen,
+                                          qStartPos, qEndPos, queryLen, dbStartPos, dbEndPos, targetLen, backtrace);
+                    if (Alignment::checkCriteria(res, isIdentity, par.evalThr, par.seqIdThr, par.alnLenThr, par.covMode, par.covThr)) {
+                        alnResults.emplace_back(res);
+                        ungappedAccepted++;
+                        continue;
+                    }
+                }
+
+                // a share of s minimizers implies a seq. id. of about s^(1/k), chains far below --min-seq-id
+                // or with a single seed are not worth a gapped alignment
+                const float sharedMinimizers = std::min(1.0f, chain.seeds * (window + 1) / (2.0f * std::min(queryLen, targetLen)));
+                const float chainSeqId = powf(sharedMinimizers, 1.0f / kmerSize);
+                if (isIdentity == false && (chain.seeds < 2 || chainSeqId < par.seqIdThr - CHAIN_SEQID_SLACK)) {
+                    continue;
+                }
+                if (queryInitialized == false) {
+                    qSeq.mapSequence(queryId, queryKey, querySeq, queryLen);
+                    aligner.initQuery(&qSeq);
+                    queryInitialized = true;
+                }
+                // banded extension around the chain diagonal, same as align for nucleotides
+                dbSeq.mapSequence(chain.targetId, targetKey, targetSeq, targetLen);
+                std::string backtrace;
+                s_align gapped = aligner.align(&dbSeq, chain.diagonal, chain.isReverse, backtrace, &gappedEvaluer);
+                delete[] gapped.cigar;
+                const int alnLen = static_cast<int>(backtrace.size());
+                const float seqId = Util::computeSeqId(par.seqIdMode, gapped.identicalAACnt, queryLen, targetLen, alnLen);
+                const int bitScore = static_cast<int>(gappedEvaluer.computeBitScore(gapped.score1) + 0.5);
+                // reverse strand hits report flipped query positions like the ungapped ones
+                const int qStartPos = chain.isReverse ? queryLen - gapped.qStartPos1 - 1 : gapped.qStartPos1;
+                const int qEndPos = chain.isReverse ? queryLen - gapped.qEndPos1 - 1 : gapped.qEndPos1;
+                Matcher::result_t res(targetKey, bitScore, gapped.qCov, gapped.tCov, seqId, gapped.evalue, alnLen,
+                                      qStartPos, qEndPos, queryLen, gapped.dbStartPos1, gapped.dbEndPos1, targetLen,
+                                      par.addBacktrace ? Matcher::compressAlignment(backtrace) : "");
+                if (isIdentity) {
+                    res.qcov = 1.0f;
+                    res.dbcov = 1.0f;
+                    res.seqId = 1.0f;
+                }
+                if (Alignment::checkCriteria(res, isIdentity, par.evalThr, par.seqIdThr, par.alnLenThr, par.covMode, par.covThr)) {
+                    alnResults.emplace_back(res);
+                    gappedAccepted++;
+                }
+            }
+
+            if (alnResults.size() > 1) {
+                SORT_SERIAL(alnResults.begin(), alnResults.end(), Matcher::compareHits);
+            }
+            for (size_t i = 0; i < alnResults.size(); ++i) {
+                size_t len = Matcher::resultToBuffer(buffer, alnResults[i], par.addBacktrace, false);
+                resultBuffer.append(buffer, len);
+            }
+            resultWriter.writeData(resultBuffer.c_str(), resultBuffer.length(), queryKey, thread_idx);
+            resultBuffer.clear();
+            alnResults.clear();
+        }
+    }
+    resultWriter.close();
+    Debug(Debug::INFO) << ungappedAccepted << " hits accepted after ungapped extension, " << gappedAccepted << " after gapped alignment\n";
+
+    delete[] fastMatrix.matrix;
+    delete[] fastMatrix.matrixData;
+    delete subMat;
+    if (qDbrIdx != NULL) {
+        delete qDbrIdx;
+    }
+    return EXIT_SUCCESS;
+}
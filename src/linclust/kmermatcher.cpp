@@ -15,6 +15,7 @@
 #include "MarkovKmerScore.h"
 #include "FileUtil.h"
 #include "FastSort.h"
+#include "DistanceCalculator.h"
 
 #include <sys/stat.h>
 #include <sys/mman.h>
@@ -37,17 +38,78 @@ uint64_t hashUInt64(uint64_t in, uint64_t seed) {
     return XXH64(&in, sizeof(uint64_t), seed);
 }
 
-template <typename T>
-KmerPosition<T> *initKmerPositionMemory(size_t size) {
-    KmerPosition<T> * hashSeqPair = new(std::nothrow) KmerPosition<T>[size + 1];
+// Rolling version of Indexer::int2index for contiguous k-mers:
+// idx(p+1) = (idx(p) - s[p]) / base + s[p+k] * base^(k-1)
+// The division is always exact, so it is done as a shift by the power of two in base followed
+// by a multiplication with the inverse of its odd part modulo 2^64. This is only correct as long
+// as no index (X residues included) overflows 64 bits, check isExact before using it.
+class RollingKmerIndex {
+public:
+    RollingKmerIndex(size_t base, size_t kmerSize) : shift(0), inverse(1), highestPower(1), isExact(true) {
+        size_t largestIndex = 1;
+        for (size_t i = 0; i < kmerSize; i++) {
+            // residues range from 0 to base (X)
+            if (largestIndex > SIZE_T_MAX / (base + 1)) {
+                isExact = false;
+            }
+            largestIndex *= (base + 1);
+            highestPower = (i > 0) ? highestPower * base : 1;
+        }
+        size_t odd = base;
+        while (odd > 0 && (odd & 1) == 0) {
+            odd >>= 1;
+            shift++;
+        }
+        // Newton iteration doubles the correct low bits each round, odd * odd == 1 (mod 8)
+        inverse = odd;
+        for (int i = 0; i < 5; i++) {
+            inverse *= 2 - odd * inverse;
+        }
+    }
+
+    inline size_t next(size_t kmerIdx, unsigned char leaving, unsigned char entering) const {
+        return ((kmerIdx - leaving) >> shift) * inverse + entering * highestPower;
+    }
+
+    bool exact() const {
+        return isExact;
+    }
+
+private:
+    unsigned int shift;
+    size_t inverse;
+    size_t highestPower;
+    bool isExact;
+};
+
+struct ScoreBelow {
+    ScoreBelow(unsigned int threshold) : threshold(threshold) {}
+    bool operator()(const SequencePosition &kmer) const {
+        return kmer.score < threshold;
+    }
+    unsigned int threshold;
+};
+
+// closed syncmer: the smallest s-mer hash of the k-mer sits at its first or last s-mer
+static inline bool isClosedSyncmer(const unsigned short *smerHashes, int pos, int smerPerKmer) {
+    unsigned short minHash = smerHashes[pos];
+    for (int i = 1; i < smerPerKmer; i++) {
+        minHash = std::min(minHash, smerHashes[pos + i]);
+    }
+    return smerHashes[pos] == minHash || smerHashes[pos + smerPerKmer - 1] == minHash;
+}
+
+template <typename T, typename KmerPos>
+KmerPos *initKmerPositionMemory(size_t size) {
+    KmerPos * hashSeqPair = new(std::nothrow) KmerPos[size + 1];
     Util::checkAllocation(hashSeqPair, "Can not allocate memory");
-    size_t pageSize = Util::getPageSize()/sizeof(KmerPosition<T>);
+    size_t pageSize = Util::getPageSize()/sizeof(KmerPos);
 #pragma omp parallel
     {
 #pragma omp for schedule(static)
         for (size_t page = 0; page < size+1; page += pageSize) {
             size_t readUntil = std::min(size+1, page + pageSize) - page;
-            memset(hashSeqPair+page, 0xFF, sizeof(KmerPosition<T>)* readUntil);
+            memset(hashSeqPair+page, 0xFF, sizeof(KmerPos)* readUntil);
         }
     }
     return hashSeqPair;
@@ -74,10 +136,11 @@ void maskSequence(int maskMode, int maskLowerCase, float maskProb, Sequence &seq
     }
 }
 
-template <int TYPE, typename T>
-std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
+template <int TYPE, typename T, typename KmerPos>
+std::pair<size_t, size_t> fillKmerPositionArray(KmerPos * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
                                                 Parameters & par, BaseMatrix * subMat, bool hashWholeSequence,
-                                                size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution){
+                                                size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                T * seqLens){
     size_t offset = 0;
     int querySeqType  =  seqDbr.getDbtype();
     size_t longestKmer = par.kmerSize;
@@ -93,6 +156,15 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
         three = ExtendedSubstitutionMatrix::calcScoreMatrix(*subMat, 3);
     }
 
+    // contiguous amino acid k-mers are indexed by a rolling update instead of nextKmer + int2index
+    const RollingKmerIndex rollingIdx(subMat->alphabetSize - 1, par.kmerSize);
+    const bool useRollingIdx = TYPE == Parameters::DBTYPE_AMINO_ACIDS && rollingIdx.exact()
+                               && par.spacedKmer == false && par.spacedKmerPattern.empty()
+                               && par.adjustKmerLength == false;
+    // kmermatcher checked that syncmers are only requested for such k-mers
+    const int syncmerSize = useRollingIdx ? par.syncmerSize : 0;
+    const RollingKmerIndex rollingSmerIdx(subMat->alphabetSize - 1, std::max(syncmerSize, 1));
+
     Debug::Progress progress(seqDbr.getSize());
 #pragma omp parallel
     {
@@ -100,8 +172,13 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 #ifdef OPENMP
         thread_idx = static_cast<unsigned int>(omp_get_thread_num());
 #endif
+        // only the bins of picked up k-mers are reset after each sequence
         unsigned short * scoreDist= new unsigned short[65536];
         unsigned int * hierarchicalScoreDist= new unsigned int[128];
+        memset(scoreDist, 0, sizeof(unsigned short) * 65536);
+        memset(hierarchicalScoreDist, 0, sizeof(unsigned int) * 128);
+        std::vector<unsigned short> smerHashes;
+        const unsigned char xIdx = subMat->aa2num[static_cast<int>('X')];
 
         const int adjustedKmerSize = (par.adjustKmerLength) ? std::min( par.kmerSize+5, 23) :   par.kmerSize;
         Sequence seq(par.maxSeqLen, querySeqType, subMat, adjustedKmerSize, par.spacedKmer, false, true, par.spacedKmerPattern);
@@ -113,7 +190,7 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
         Indexer idxer(subMat->alphabetSize - 1,  par.kmerSize);
         const unsigned int BUFFER_SIZE = 1048576;
         size_t bufferPos = 0;
-        KmerPosition<T> * threadKmerBuffer = new KmerPosition<T>[BUFFER_SIZE];
+        KmerPos * threadKmerBuffer = new KmerPos[BUFFER_SIZE];
         SequencePosition * kmers = (SequencePosition *) malloc((par.pickNbest * (par.maxSeqLen + 1) + 1) * sizeof(SequencePosition));
         size_t kmersArraySize = par.maxSeqLen;
         const size_t flushSize = 100000000;
@@ -125,10 +202,11 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 #pragma omp for schedule(dynamic, 100)
             for (size_t id = start; id < (start + bucketSize); id++) {
                 progress.updateProgress();
-                memset(scoreDist, 0, sizeof(unsigned short) * 65536);
-                memset(hierarchicalScoreDist, 0, sizeof(unsigned int) * 128);
 
                 seq.mapSequence(id, seqDbr.getDbKey(id), seqDbr.getData(id, thread_idx), seqDbr.getSeqLen(id));
+                if (seqLens != NULL) {
+                    seqLens[seq.getDbKey()] = seq.L;
+                }
 
                 size_t seqHash =  SIZE_T_MAX;
                 //TODO, how to handle this in reverse?
@@ -141,7 +219,50 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 
                 size_t seqKmerCount = 0;
                 unsigned int seqId = seq.getDbKey();
-                while (seq.hasNextKmer()) {
+                if (useRollingIdx && seq.L >= par.kmerSize) {
+                    const unsigned char *numSeq = seq.numSequence;
+                    const int kmerSize = par.kmerSize;
+                    const int smerPerKmer = kmerSize - syncmerSize + 1;
+                    if (syncmerSize > 0) {
+                        smerHashes.resize(seq.L);
+                        size_t smerIdx = idxer.int2index(numSeq, 0, syncmerSize);
+                        smerHashes[0] = static_cast<unsigned short>(hashUInt64(smerIdx, par.hashShift + 1));
+                        for (int pos = 1; pos + syncmerSize <= seq.L; pos++) {
+                            smerIdx = rollingSmerIdx.next(smerIdx, numSeq[pos - 1], numSeq[pos + syncmerSize - 1]);
+                            smerHashes[pos] = static_cast<unsigned short>(hashUInt64(smerIdx, par.hashShift + 1));
+                        }
+                    }
+                    // same k-mers, positions and order as the nextKmer loop below
+                    int lastX = -1;
+                    for (int pos = 0; pos < kmerSize - 1; pos++) {
+                        lastX = (numSeq[pos] == xIdx) ? pos : lastX;
+                    }
+                    size_t kmerIdx = idxer.int2index(numSeq, 0, kmerSize);
+                    for (int pos = 0; pos + kmerSize <= seq.L; pos++) {
+                        if (pos > 0) {
+                            kmerIdx = rollingIdx.next(kmerIdx, numSeq[pos - 1], numSeq[pos + kmerSize - 1]);
+                        }
+                        lastX = (numSeq[pos + kmerSize - 1] == xIdx) ? pos + kmerSize - 1 : lastX;
+                        if (lastX >= pos) {
+                            continue;
+                        }
+                        if (syncmerSize > 0 && isClosedSyncmer(smerHashes.data(), pos, smerPerKmer) == false) {
+                            continue;
+                        }
+                        const unsigned short hash = hashUInt64(kmerIdx, par.hashShift);
+                        (kmers + seqKmerCount)->kmer = kmerIdx;
+                        (kmers + seqKmerCount)->pos = pos;
+                        (kmers + seqKmerCount)->score = hash;
+                        scoreDist[hash]++;
+                        hierarchicalScoreDist[hash >> 9]++;
+                        seqKmerCount++;
+                        if (seqKmerCount >= kmersArraySize) {
+                            kmersArraySize = seq.getMaxLen();
+                            kmers = (SequencePosition *) realloc(kmers, (par.pickNbest * (kmersArraySize + 1) + 1) * sizeof(SequencePosition));
+                        }
+                    }
+                }
+                while (useRollingIdx == false && seq.hasNextKmer()) {
                     unsigned char *kmer = (unsigned char*) seq.nextKmer();
                     if(seq.kmerContainsX()){
                         continue;
@@ -239,10 +360,10 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 
                 // add k-mer to represent the identity
                 if (static_cast<unsigned short>(seqHash) >= hashStartRange && static_cast<unsigned short>(seqHash) <= hashEndRange) {
-                    threadKmerBuffer[bufferPos].kmer = seqHash;
+                    threadKmerBuffer[bufferPos].kmer = KmerPos::sequenceHashKey(seqHash);
                     threadKmerBuffer[bufferPos].id = seqId;
                     threadKmerBuffer[bufferPos].pos = 0;
-                    threadKmerBuffer[bufferPos].seqLen = seq.L;
+                    threadKmerBuffer[bufferPos].setSeqLen(seq.L);
                     if(hashDistribution != NULL){
                         __sync_fetch_and_add(&hashDistribution[static_cast<unsigned short>(seqHash)], 1);
                     }
@@ -251,7 +372,7 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                         size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
                         if(writeOffset + bufferPos < kmerArraySize){
                             if(kmerArray!=NULL){
-                                memcpy(kmerArray + writeOffset, threadKmerBuffer, sizeof(KmerPosition<T>) * bufferPos);
+                                memcpy(kmerArray + writeOffset, threadKmerBuffer, sizeof(KmerPos) * bufferPos);
                             }
                         } else{
                             Debug(Debug::ERROR) << "Kmer array overflow. currKmerArrayOffset="<< writeOffset
@@ -263,15 +384,26 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                     }
                 }
 
+                // the histograms are clean for the next sequence once they are read
+                for (size_t kmerIdx = 0; kmerIdx < seqKmerCount; kmerIdx++) {
+                    scoreDist[(kmers + kmerIdx)->score] = 0;
+                    hierarchicalScoreDist[(kmers + kmerIdx)->score >> 9] = 0;
+                }
+
+                size_t candidateKmerCount = seqKmerCount;
                 if(par.ignoreMultiKmer){
+                    // k-mers at or above the threshold are never picked, so only the ones below have to be sorted.
+                    // Repeated k-mers share their hash and therefore stay together.
+                    SequencePosition *candidateEnd = std::partition(kmers, kmers + seqKmerCount, ScoreBelow(threshold));
+                    candidateKmerCount = candidateEnd - kmers;
                     if(TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
-                        SORT_SERIAL(kmers, kmers + seqKmerCount, SequencePosition::compareByScoreReverse);
+                        SORT_SERIAL(kmers, candidateEnd, SequencePosition::compareByScoreReverse);
                     }else{
-                        SORT_SERIAL(kmers, kmers + seqKmerCount, SequencePosition::compareByScore);
+                        SORT_SERIAL(kmers, candidateEnd, SequencePosition::compareByScore);
                     }
                 }
                 size_t selectedKmer = 0;
-                for (size_t kmerIdx = 0; kmerIdx < seqKmerCount && selectedKmer < kmerConsidered; kmerIdx++) {
+                for (size_t kmerIdx = 0; kmerIdx < candidateKmerCount && selectedKmer < kmerConsidered; kmerIdx++) {
 
                     /* skip repeated kmer */
                     if (par.ignoreMultiKmer) {
@@ -279,15 +411,15 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                         if (TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
                             kmer = BIT_SET(kmer, 63);
                         }
-                        if (kmerIdx + 1 < seqKmerCount) {
+                        if (kmerIdx + 1 < candidateKmerCount) {
                             size_t nextKmer = (kmers + kmerIdx + 1)->kmer;
                             if (TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
                                 nextKmer = BIT_SET(nextKmer, 63);
                             }
                             if (kmer == nextKmer) {
-                                while (kmer == nextKmer && kmerIdx < seqKmerCount) {
+                                while (kmer == nextKmer && kmerIdx < candidateKmerCount) {
                                     kmerIdx++;
-                                    if(kmerIdx >= seqKmerCount)
+                                    if(kmerIdx >= candidateKmerCount)
                                         break;
                                     nextKmer = (kmers + kmerIdx)->kmer;
                                     if (TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
@@ -296,7 +428,7 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                                 }
                             }
                         }
-                        if(kmerIdx >= seqKmerCount)
+                        if(kmerIdx >= candidateKmerCount)
                             break;
                     }
 
@@ -316,10 +448,10 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 //                                tmpKmerIdx=BIT_CLEAR(tmpKmerIdx, 63);
 //                                std::cout << seqId << "\t" << (kmers + kmerIdx)->score << "\t" << tmpKmerIdx << std::endl;
 //                            }
-                            threadKmerBuffer[bufferPos].kmer = (kmers + kmerIdx)->kmer;
+                            threadKmerBuffer[bufferPos].kmer = KmerPos::kmerKey((kmers + kmerIdx)->kmer);
                             threadKmerBuffer[bufferPos].id = seqId;
                             threadKmerBuffer[bufferPos].pos = (kmers + kmerIdx)->pos;
-                            threadKmerBuffer[bufferPos].seqLen = seq.L;
+                            threadKmerBuffer[bufferPos].setSeqLen(seq.L);
                             bufferPos++;
                             if(hashDistribution != NULL){
                                 __sync_fetch_and_add(&hashDistribution[(kmers + kmerIdx)->score], 1);
@@ -330,7 +462,7 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                                 if(writeOffset + bufferPos < kmerArraySize){
                                     if(kmerArray!=NULL) {
                                         memcpy(kmerArray + writeOffset, threadKmerBuffer,
-                                               sizeof(KmerPosition<T>) * bufferPos);
+                                               sizeof(KmerPos) * bufferPos);
                                     }
                                 } else{
                                     Debug(Debug::ERROR) << "Kmer array overflow. currKmerArrayOffset="<< writeOffset
@@ -361,7 +493,7 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
         if(bufferPos > 0){
             size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
             if(kmerArray != NULL){
-                memcpy(kmerArray+writeOffset, threadKmerBuffer, sizeof(KmerPosition<T>) * bufferPos);
+                memcpy(kmerArray+writeOffset, threadKmerBuffer, sizeof(KmerPos) * bufferPos);
             }
         }
         free(kmers);
@@ -385,18 +517,36 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 }
 
 template <typename T>
-KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t hashEndRange, std::string splitFile,
-                                DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat) {
+void sortByKmerAndLength(KmerPosition<T> *kmers, size_t kmerCount, bool isNucleotide, const T *) {
+    if(isNucleotide) {
+        SORT_PARALLEL(kmers, kmers + kmerCount, KmerPosition<T>::compareRepSequenceAndIdAndPosReverse);
+    }else{
+        SORT_PARALLEL(kmers, kmers + kmerCount, KmerPosition<T>::compareRepSequenceAndIdAndPos);
+    }
+}
+
+template <typename T>
+void sortByKmerAndLength(KmerPositionCompact<T> *kmers, size_t kmerCount, bool isNucleotide, const T *seqLens) {
+    if(isNucleotide) {
+        SORT_PARALLEL(kmers, kmers + kmerCount, typename KmerPositionCompact<T>::CompareRepSequenceAndIdAndPosReverse(seqLens));
+    }else{
+        SORT_PARALLEL(kmers, kmers + kmerCount, typename KmerPositionCompact<T>::CompareRepSequenceAndIdAndPos(seqLens));
+    }
+}
 
-    KmerPosition<T> * hashSeqPair = initKmerPositionMemory<T>(totalKmers);
+template <typename T, typename KmerPos>
+KmerPos * doComputation(size_t totalKmers, size_t hashStartRange, size_t hashEndRange, std::string splitFile,
+                        DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat, T * seqLens) {
+
+    KmerPos * hashSeqPair = initKmerPositionMemory<T, KmerPos>(totalKmers);
     size_t elementsToSort;
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
+        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T, KmerPos>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL, seqLens);
         elementsToSort = ret.first;
         par.kmerSize = ret.second;
         Debug(Debug::INFO) << "\nAdjusted k-mer length " << par.kmerSize << "\n";
     }else{
-        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
+        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T, KmerPos>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL, seqLens);
         elementsToSort = ret.first;
     }
     if(hashEndRange == SIZE_T_MAX){
@@ -405,29 +555,25 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
 
     Debug(Debug::INFO) << "Sort kmer ";
     Timer timer;
-    if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPosReverse);
-    }else{
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPos);
-    }
+    sortByKmerAndLength(hashSeqPair, elementsToSort, Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES), seqLens);
     Debug(Debug::INFO) << timer.lap() << "\n";
 
     // assign rep. sequence to same kmer members
     // The longest sequence is the first since we sorted by kmer, seq.Len and id
     size_t writePos;
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        writePos = assignGroup<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr);
+        writePos = assignGroup<Parameters::DBTYPE_NUCLEOTIDES, T, KmerPos>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr, seqLens);
     }else{
-        writePos = assignGroup<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr);
+        writePos = assignGroup<Parameters::DBTYPE_AMINO_ACIDS, T, KmerPos>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr, seqLens);
     }
 
     // sort by rep. sequence (stored in kmer) and sequence id
     Debug(Debug::INFO) << "Sort by rep. sequence ";
     timer.reset();
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse);
+        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPos::compareRepSequenceAndIdAndDiagReverse);
     }else{
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiag);
+        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPos::compareRepSequenceAndIdAndDiag);
     }
     //kx::radix_sort(hashSeqPair, hashSeqPair + elementsToSort, SequenceComparision());
 //    for(size_t i = 0; i < writePos; i++){
@@ -437,9 +583,9 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
 
     if(hashEndRange != SIZE_T_MAX){
         if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-            writeKmersToDisk<Parameters::DBTYPE_NUCLEOTIDES, KmerEntryRev, T>(splitFile, hashSeqPair, writePos + 1);
+            writeKmersToDisk<Parameters::DBTYPE_NUCLEOTIDES, KmerEntryRev, T, KmerPos>(splitFile, hashSeqPair, writePos + 1);
         }else{
-            writeKmersToDisk<Parameters::DBTYPE_AMINO_ACIDS, KmerEntry, T>(splitFile, hashSeqPair, writePos + 1);
+            writeKmersToDisk<Parameters::DBTYPE_AMINO_ACIDS, KmerEntry, T, KmerPos>(splitFile, hashSeqPair, writePos + 1);
         }
         delete [] hashSeqPair;
         hashSeqPair = NULL;
@@ -447,35 +593,37 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
     return hashSeqPair;
 }
 
-template <int TYPE, typename T>
-size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr) {
+template <int TYPE, typename T, typename KmerPos>
+size_t assignGroup(KmerPos *hashSeqPair, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr,
+                   const T *seqLens) {
     size_t writePos=0;
     size_t prevHash = hashSeqPair[0].kmer;
     size_t repSeqId = hashSeqPair[0].id;
     if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-        bool isReverse = (BIT_CHECK(hashSeqPair[0].kmer, 63) == false);
-        repSeqId = (isReverse) ? BIT_CLEAR(repSeqId, 63) : BIT_SET(repSeqId, 63);
-        prevHash = BIT_SET(prevHash, 63);
+        bool isReverse = (BIT_CHECK(hashSeqPair[0].kmer, KmerPos::REVERSE_BIT) == false);
+        repSeqId = (isReverse) ? BIT_CLEAR(repSeqId, KmerPos::REVERSE_BIT) : BIT_SET(repSeqId, KmerPos::REVERSE_BIT);
+        prevHash = BIT_SET(prevHash, KmerPos::REVERSE_BIT);
     }
     size_t prevHashStart = 0;
     size_t prevSetSize = 0;
-    T queryLen=hashSeqPair[0].seqLen;
+    T queryLen=KmerPos::getSeqLen(hashSeqPair[0], seqLens);
     bool repIsReverse = false;
     T repSeq_i_pos = hashSeqPair[0].pos;
     for (size_t elementIdx = 0; elementIdx < splitKmerCount+1; elementIdx++) {
         size_t currKmer = hashSeqPair[elementIdx].kmer;
         if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-            currKmer = BIT_SET(currKmer, 63);
+            currKmer = BIT_SET(currKmer, KmerPos::REVERSE_BIT);
         }
         if (prevHash != currKmer) {
             for (size_t i = prevHashStart; i < elementIdx; i++) {
                 size_t kmer = hashSeqPair[i].kmer;
                 if(TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
-                    kmer = BIT_SET(hashSeqPair[i].kmer, 63);
+                    kmer = BIT_SET(hashSeqPair[i].kmer, KmerPos::REVERSE_BIT);
                 }
-                size_t rId = (kmer != SIZE_T_MAX) ? ((prevSetSize == 1) ? SIZE_T_MAX : repSeqId) : SIZE_T_MAX;
+                size_t rId = (kmer != KmerPos::EMPTY_KMER) ? ((prevSetSize == 1) ? SIZE_T_MAX : repSeqId) : SIZE_T_MAX;
                 // remove singletones from set
                 if(rId != SIZE_T_MAX){
+                    T targetLen = KmerPos::getSeqLen(hashSeqPair[i], seqLens);
                     int diagonal = repSeq_i_pos - hashSeqPair[i].pos;
                     if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
                         //  00 No problem here both are forward
@@ -483,7 +631,7 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
                         //  10 Same here, we can revert query to match the not inverted target
                         //  11 Both are reverted so no problem!
                         //  So we need just 1 bit of information to encode all four states
-                        bool targetIsReverse = (BIT_CHECK(hashSeqPair[i].kmer, 63) == false);
+                        bool targetIsReverse = (BIT_CHECK(hashSeqPair[i].kmer, KmerPos::REVERSE_BIT) == false);
                         bool queryNeedsToBeRev = false;
                         // we now need 2 byte of information (00),(01),(10),(11)
                         // we need to flip the coordinates of the query
@@ -500,13 +648,13 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
                             // we just need to offset the position to the forward strand
                         }else if (repIsReverse == true && targetIsReverse == true){
                             queryPos = (queryLen - 1) - repSeq_i_pos;
-                            targetPos = (hashSeqPair[i].seqLen - 1) - hashSeqPair[i].pos;
+                            targetPos = (targetLen - 1) - hashSeqPair[i].pos;
                             queryNeedsToBeRev = false;
                             // query is not revers but target k-mer is reverse
                             // instead of reverting the target, we revert the query and offset the the query/target position
                         }else if (repIsReverse == false && targetIsReverse == true){
                             queryPos = (queryLen - 1) - repSeq_i_pos;
-                            targetPos = (hashSeqPair[i].seqLen - 1) - hashSeqPair[i].pos;
+                            targetPos = (targetLen - 1) - hashSeqPair[i].pos;
                             queryNeedsToBeRev = true;
                             // both are forward, everything is good here
                         }else{
@@ -515,53 +663,53 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
                             queryNeedsToBeRev = false;
                         }
                         diagonal = queryPos - targetPos;
-                        rId = (queryNeedsToBeRev) ? BIT_CLEAR(rId, 63) : BIT_SET(rId, 63);
+                        rId = (queryNeedsToBeRev) ? BIT_CLEAR(rId, KmerPos::REVERSE_BIT) : BIT_SET(rId, KmerPos::REVERSE_BIT);
                     }
 //                    std::cout << diagonal << "\t" << repSeq_i_pos << "\t" << hashSeqPair[i].pos << std::endl;
 
 
-                    bool canBeExtended = diagonal < 0 || (diagonal > (queryLen - hashSeqPair[i].seqLen));
+                    bool canBeExtended = diagonal < 0 || (diagonal > (queryLen - targetLen));
                     bool canBecovered = Util::canBeCovered(covThr, covMode,
                                                            static_cast<float>(queryLen),
-                                                           static_cast<float>(hashSeqPair[i].seqLen));
+                                                           static_cast<float>(targetLen));
                     if((includeOnlyExtendable == false && canBecovered) || (canBeExtended && includeOnlyExtendable ==true )){
                         hashSeqPair[writePos].kmer = rId;
                         hashSeqPair[writePos].pos = diagonal;
-                        hashSeqPair[writePos].seqLen = hashSeqPair[i].seqLen;
+                        hashSeqPair[writePos].setSeqLen(targetLen);
                         hashSeqPair[writePos].id = hashSeqPair[i].id;
                         writePos++;
                     }
                 }
 //                hashSeqPair[i].kmer = SIZE_T_MAX;
-                hashSeqPair[i].kmer = (i != writePos - 1) ? SIZE_T_MAX : hashSeqPair[i].kmer;
+                hashSeqPair[i].kmer = (i != writePos - 1) ? KmerPos::EMPTY_KMER : hashSeqPair[i].kmer;
             }
             prevSetSize = 0;
             prevHashStart = elementIdx;
             repSeqId = hashSeqPair[elementIdx].id;
             if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-                repIsReverse = (BIT_CHECK(hashSeqPair[elementIdx].kmer, 63) == 0);
-                repSeqId = (repIsReverse) ? repSeqId : BIT_SET(repSeqId, 63);
+                repIsReverse = (BIT_CHECK(hashSeqPair[elementIdx].kmer, KmerPos::REVERSE_BIT) == 0);
+                repSeqId = (repIsReverse) ? repSeqId : BIT_SET(repSeqId, KmerPos::REVERSE_BIT);
             }
-            queryLen = hashSeqPair[elementIdx].seqLen;
+            queryLen = KmerPos::getSeqLen(hashSeqPair[elementIdx], seqLens);
             repSeq_i_pos = hashSeqPair[elementIdx].pos;
         }
-        if (hashSeqPair[elementIdx].kmer == SIZE_T_MAX) {
+        if (hashSeqPair[elementIdx].kmer == KmerPos::EMPTY_KMER) {
             break;
         }
         prevSetSize++;
         prevHash = hashSeqPair[elementIdx].kmer;
         if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-            prevHash = BIT_SET(prevHash, 63);
+            prevHash = BIT_SET(prevHash, KmerPos::REVERSE_BIT);
         }
     }
 
     return writePos;
 }
 
-template size_t assignGroup<0, short>(KmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr);
-template size_t assignGroup<0, int>(KmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr);
-template size_t assignGroup<1, short>(KmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr);
-template size_t assignGroup<1, int>(KmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr);
+template size_t assignGroup<0, short>(KmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, const short *seqLens);
+template size_t assignGroup<0, int>(KmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, const int *seqLens);
+template size_t assignGroup<1, short>(KmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, const short *seqLens);
+template size_t assignGroup<1, int>(KmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, const int *seqLens);
 
 void setLinearFilterDefault(Parameters *p) {
     p->covThr = 0.8;
@@ -584,13 +732,38 @@ size_t computeKmerCount(DBReader<unsigned int> &reader, size_t KMER_SIZE, size_t
     return totalKmers;
 }
 
-template <typename T>
+template <typename T, typename KmerPos>
 size_t computeMemoryNeededLinearfilter(size_t totalKmer) {
-    return sizeof(KmerPosition<T>) * totalKmer;
+    return sizeof(KmerPos) * totalKmer;
 }
 
+static_assert(sizeof(KmerPositionCompact<short>) == 12, "compact k-mer has to be packed into 12 byte");
+static_assert(sizeof(KmerPositionCompact<int>) == 14, "compact k-mer has to be packed into 14 byte");
 
-template <typename T>
+// KmerPositionCompact can only be used if all k-mer indices fit into its key
+bool fitsCompactKmerPosition(Parameters &par, int seqType) {
+    const size_t maxKmerIdx = KmerPositionCompact<short>::MAX_KMER_IDX;
+    if (Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_NUCLEOTIDES)) {
+        // two bit per nucleotide, k-mers can be extended up to 23 by --adjust-kmer-len
+        const int longestKmer = (par.adjustKmerLength) ? std::min(par.kmerSize + 5, 23) : par.kmerSize;
+        return 2 * longestKmer <= 46;
+    }
+    if (Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_AMINO_ACIDS) == false) {
+        return false;
+    }
+    // the indexer skips k-mers with X
+    const size_t base = par.alphabetSize.values.aminoacid() - 1;
+    size_t kmerCount = 1;
+    for (int i = 0; i < par.kmerSize; i++) {
+        if (kmerCount > maxKmerIdx / base) {
+            return false;
+        }
+        kmerCount *= base;
+    }
+    return kmerCount - 1 <= maxKmerIdx;
+}
+
+template <typename T, typename KmerPos>
 int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
 
     int querySeqType = seqDbr.getDbtype();
@@ -615,18 +788,24 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     float kmersPerSequenceScale = (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) ?
                                         par.kmersPerSequenceScale.values.nucleotide() : par.kmersPerSequenceScale.values.aminoacid();
     size_t totalKmers = computeKmerCount(seqDbr, par.kmerSize, par.kmersPerSequence, kmersPerSequenceScale);
-    size_t totalSizeNeeded = computeMemoryNeededLinearfilter<T>(totalKmers);
+    size_t totalSizeNeeded = computeMemoryNeededLinearfilter<T, KmerPos>(totalKmers);
+    // the compact k-mers look up the sequence length by key
+    T *seqLens = NULL;
+    if (KmerPos::HAS_SEQ_LEN == false) {
+        seqLens = new T[seqDbr.getLastKey() + 1];
+        memoryLimit -= std::min(memoryLimit / 2, sizeof(T) * (seqDbr.getLastKey() + 1));
+    }
     // compute splits
     size_t splits = static_cast<size_t>(std::ceil(static_cast<float>(totalSizeNeeded) / memoryLimit));
     size_t totalKmersPerSplit = std::max(static_cast<size_t>(1024+1),
-                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(KmerPosition<T>))+1);
+                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(KmerPos))+1);
 
-    std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<T>(par, subMat, seqDbr, totalKmersPerSplit, splits);
+    std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<T, KmerPos>(par, subMat, seqDbr, totalKmersPerSplit, splits);
     if(splits > 1){
         Debug(Debug::INFO) << "Process file into " << hashRanges.size() << " parts\n";
     }
     std::vector<std::string> splitFiles;
-    KmerPosition<T> *hashSeqPair = NULL;
+    KmerPos *hashSeqPair = NULL;
 
     size_t mpiRank = 0;
 #ifdef HAVE_MPI
@@ -649,7 +828,7 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
 
     for(size_t split = fromSplit; split < fromSplit+splitCount; split++) {
         std::string splitFileName = par.db2 + "_split_" +SSTR(split);
-        hashSeqPair = doComputation<T>(totalKmers, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat);
+        hashSeqPair = doComputation<T, KmerPos>(totalKmers, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat, seqLens);
     }
     MPI_Barrier(MPI_COMM_WORLD);
     if(mpiRank == 0){
@@ -665,7 +844,7 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
 
         std::string splitFileNameDone = splitFileName + ".done";
         if(FileUtil::fileExists(splitFileNameDone.c_str()) == false){
-            hashSeqPair = doComputation<T>(totalKmersPerSplit, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat);
+            hashSeqPair = doComputation<T, KmerPos>(totalKmersPerSplit, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat, seqLens);
         }
 
         splitFiles.push_back(splitFileName);
@@ -674,18 +853,37 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     if(mpiRank == 0){
         std::vector<char> repSequence(seqDbr.getLastKey()+1);
         std::fill(repSequence.begin(), repSequence.end(), false);
+        // the groups are rescored while they are written, this needs the sequences again
+        // and is worth writing with all threads
+        const bool rescore = (par.rescoreDb.empty() == false);
+        const unsigned int writerThreads = (rescore) ? static_cast<unsigned int>(par.threads) : 1;
+        const int resultDbType = (Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) ? Parameters::DBTYPE_PREFILTER_REV_RES : Parameters::DBTYPE_PREFILTER_RES;
         // write result
-        DBWriter dbw(par.db2.c_str(), par.db2Index.c_str(), 1, par.compressed,
-                     (Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) ? Parameters::DBTYPE_PREFILTER_REV_RES : Parameters::DBTYPE_PREFILTER_RES );
+        DBWriter dbw(par.db2.c_str(), par.db2Index.c_str(), writerThreads, par.compressed, resultDbType);
         dbw.open();
 
+        DBWriter *rescoreDbw = NULL;
+        std::vector<KmerHitRescorer *> rescorers;
+        if (rescore) {
+            seqDbr.remapData();
+            std::string rescoreDbIndex = par.rescoreDb + ".index";
+            rescoreDbw = new DBWriter(par.rescoreDb.c_str(), rescoreDbIndex.c_str(), writerThreads, par.compressed, resultDbType);
+            rescoreDbw->open();
+            for (unsigned int thread = 0; thread < writerThreads; thread++) {
+                rescorers.push_back(new KmerHitRescorer(seqDbr, subMat, par, *rescoreDbw, thread));
+            }
+        }
+
         Timer timer;
         if(splits > 1) {
-            seqDbr.unmapData();
+            if (rescore == false) {
+                seqDbr.unmapData();
+            }
+            KmerHitRescorer *rescorer = (rescore) ? rescorers[0] : NULL;
             if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-                mergeKmerFilesAndOutput<Parameters::DBTYPE_NUCLEOTIDES, KmerEntryRev>(dbw, splitFiles, repSequence);
+                mergeKmerFilesAndOutput<Parameters::DBTYPE_NUCLEOTIDES, KmerEntryRev>(dbw, splitFiles, repSequence, rescorer);
             }else{
-                mergeKmerFilesAndOutput<Parameters::DBTYPE_AMINO_ACIDS, KmerEntry>(dbw, splitFiles, repSequence);
+                mergeKmerFilesAndOutput<Parameters::DBTYPE_AMINO_ACIDS, KmerEntry>(dbw, splitFiles, repSequence, rescorer);
             }
             for(size_t i = 0; i < splitFiles.size(); i++){
                 FileUtil::remove(splitFiles[i].c_str());
@@ -693,16 +891,20 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
                 FileUtil::remove(splitFilesDone.c_str());
             }
         } else {
+            KmerHitRescorer **rescorerPtr = (rescore) ? rescorers.data() : NULL;
+            // only the filled part of the array is split between the writer threads
+            size_t filledKmers = std::partition_point(hashSeqPair, hashSeqPair + totalKmersPerSplit,
+                                                      [](const KmerPos &kmer) { return kmer.kmer != KmerPos::EMPTY_KMER; }) - hashSeqPair;
             if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-                writeKmerMatcherResult<Parameters::DBTYPE_NUCLEOTIDES>(dbw, hashSeqPair, totalKmersPerSplit, repSequence, 1);
+                writeKmerMatcherResult<Parameters::DBTYPE_NUCLEOTIDES, T, KmerPos>(dbw, hashSeqPair, filledKmers, repSequence, writerThreads, rescorerPtr);
             }else{
-                writeKmerMatcherResult<Parameters::DBTYPE_AMINO_ACIDS>(dbw, hashSeqPair, totalKmersPerSplit, repSequence, 1);
+                writeKmerMatcherResult<Parameters::DBTYPE_AMINO_ACIDS, T, KmerPos>(dbw, hashSeqPair, filledKmers, repSequence, writerThreads, rescorerPtr);
             }
         }
         Debug(Debug::INFO) << "Time for fill: " << timer.lap() << "\n";
         // add missing entries to the result (needed for clustering)
 
-#pragma omp parallel num_threads(1)
+#pragma omp parallel num_threads(writerThreads)
         {
             unsigned int thread_idx = 0;
 #ifdef OPENMP
@@ -719,9 +921,20 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
                     h.seqId = dbKey;
                     int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
                     dbw.writeData(buffer, len, dbKey, thread_idx);
+                    if (rescore) {
+                        rescorers[thread_idx]->startGroup(dbKey);
+                        rescorers[thread_idx]->writeGroup();
+                    }
                 }
             }
         }
+        if (rescore) {
+            for (size_t i = 0; i < rescorers.size(); i++) {
+                delete rescorers[i];
+            }
+            rescoreDbw->close(false, false);
+            delete rescoreDbw;
+        }
         dbw.close(false, false);
     }
     // free memory
@@ -729,11 +942,14 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     if(hashSeqPair){
         delete [] hashSeqPair;
     }
+    if (seqLens != NULL) {
+        delete [] seqLens;
+    }
 
     return EXIT_SUCCESS;
 }
 
-template <typename T>
+template <typename T, typename KmerPos>
 std::vector<std::pair<size_t, size_t>> setupKmerSplits(Parameters &par, BaseMatrix * subMat, DBReader<unsigned int> &seqDbr, size_t totalKmers, size_t splits){
     std::vector<std::pair<size_t, size_t>> hashRanges;
     if (splits > 1) {
@@ -742,9 +958,9 @@ std::vector<std::pair<size_t, size_t>> setupKmerSplits(Parameters &par, BaseMatr
         size_t * hashDist = new size_t[USHRT_MAX+1];
         memset(hashDist, 0 , sizeof(size_t) * (USHRT_MAX+1));
         if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-            fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
+            fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T, KmerPos>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
         }else{
-            fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
+            fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T, KmerPos>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
         }
         seqDbr.remapData();
         // figure out if machine has enough memory to run this job
@@ -755,7 +971,7 @@ std::vector<std::pair<size_t, size_t>> setupKmerSplits(Parameters &par, BaseMatr
             }
         }
         if(maxBucketSize > totalKmers){
-            Debug(Debug::INFO) << "Not enough memory to run the kmermatcher. Minimum is at least " << maxBucketSize* sizeof(KmerPosition<T>) << " bytes\n";
+            Debug(Debug::INFO) << "Not enough memory to run the kmermatcher. Minimum is at least " << maxBucketSize* sizeof(KmerPos) << " bytes\n";
             EXIT(EXIT_FAILURE);
         }
         // define splits
@@ -792,13 +1008,33 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
     setKmerLengthAndAlphabet(par, seqDbr.getAminoAcidDBSize(), querySeqType);
     std::vector<MMseqsParameter *> *params = command.params;
     par.printParameters(command.cmd, argc, argv, *params);
+    if (par.syncmerSize > 0) {
+        if (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES) || par.spacedKmer
+            || par.spacedKmerPattern.empty() == false || par.adjustKmerLength) {
+            Debug(Debug::ERROR) << "Closed syncmers are only supported for amino acid k-mers without spacing\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (par.syncmerSize >= par.kmerSize) {
+            Debug(Debug::ERROR) << "Syncmer size " << par.syncmerSize << " has to be smaller than the k-mer length " << par.kmerSize << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
     Debug(Debug::INFO) << "Database size: " << seqDbr.getSize() << " type: " << seqDbr.getDbTypeName() << "\n";
 
+    const bool compactKmers = fitsCompactKmerPosition(par, querySeqType);
     if (seqDbr.getMaxSeqLen() < SHRT_MAX) {
-        kmermatcherInner<short>(par, seqDbr);
+        if (compactKmers) {
+            kmermatcherInner<short, KmerPositionCompact<short>>(par, seqDbr);
+        } else {
+            kmermatcherInner<short, KmerPosition<short>>(par, seqDbr);
+        }
     }
     else {
-        kmermatcherInner<int>(par, seqDbr);
+        if (compactKmers) {
+            kmermatcherInner<int, KmerPositionCompact<int>>(par, seqDbr);
+        } else {
+            kmermatcherInner<int, KmerPosition<int>>(par, seqDbr);
+        }
     }
 
     seqDbr.close();
@@ -806,21 +1042,100 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
     return EXIT_SUCCESS;
 }
 
-template <int TYPE, typename T>
+KmerHitRescorer::KmerHitRescorer(DBReader<unsigned int> &seqDbr, BaseMatrix *subMat, Parameters &par,
+                                 DBWriter &writer, unsigned int thread)
+        : seqDbr(seqDbr), subMat(subMat), writer(writer), thread(thread),
+        // hamming distance does not work well with seq. id or coverage < 0.5 since it does not have an e-value criteria
+          seqIdThr(std::max(0.5f, par.seqIdThr)), covThr(std::max(0.5f, par.covThr)),
+          covMode(par.covMode), seqIdMode(par.seqIdMode), alnLenThr(par.alnLenThr),
+          isNucleotide(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)),
+          repKey(UINT_MAX), repId(UINT_MAX), repLen(0) {
+    result.reserve(1000000);
+}
+
+void KmerHitRescorer::startGroup(unsigned int key) {
+    repKey = key;
+    repId = UINT_MAX;
+    result.clear();
+    // the identity always aligns with full seq. id. on the main diagonal
+    hit_t identity;
+    identity.seqId = key;
+    identity.prefScore = 100;
+    identity.diagonal = 0;
+    char buffer[100];
+    int len = QueryMatcher::prefilterHitToBuffer(buffer, identity);
+    result.append(buffer, len);
+}
+
+void KmerHitRescorer::addHit(const hit_t &hit) {
+    // most groups have no members, only fetch the representative for the others
+    if (repId == UINT_MAX) {
+        repId = seqDbr.getId(repKey);
+        repLen = static_cast<int>(seqDbr.getSeqLen(repId));
+        repSeq.assign(seqDbr.getData(repId, thread), repLen);
+        repRevSeq.clear();
+    }
+    const bool isReverse = isNucleotide && hit.prefScore < 0;
+    if (isReverse && repRevSeq.empty()) {
+        NucleotideMatrix *nuclMatrix = (NucleotideMatrix *) subMat;
+        repRevSeq.resize(repLen);
+        for (int pos = repLen - 1; pos > -1; pos--) {
+            unsigned char res = subMat->aa2num[static_cast<int>(repSeq[pos])];
+            repRevSeq[(repLen - 1) - pos] = subMat->num2aa[nuclMatrix->reverseResidue(res)];
+        }
+    }
+    const char *querySeq = isReverse ? repRevSeq.c_str() : repSeq.c_str();
+
+    unsigned int targetId = seqDbr.getId(hit.seqId);
+    int targetLen = static_cast<int>(seqDbr.getSeqLen(targetId));
+    if (Util::canBeCovered(covThr, covMode, static_cast<float>(repLen), static_cast<float>(targetLen)) == false) {
+        return;
+    }
+    const char *targetSeq = seqDbr.getData(targetId, thread);
+    DistanceCalculator::LocalAlignment alignment = DistanceCalculator::computeUngappedAlignment(
+            querySeq, repLen, targetSeq, targetLen, hit.diagonal, NULL, Parameters::RESCORE_MODE_HAMMING);
+    const int diagonalLen = alignment.diagonalLen;
+    double seqId = Util::computeSeqId(seqIdMode, alignment.score, repLen, targetLen, diagonalLen);
+    float queryCov = static_cast<float>(diagonalLen) / static_cast<float>(repLen);
+    float targetCov = static_cast<float>(diagonalLen) / static_cast<float>(targetLen);
+
+    const bool isIdentity = (repId == targetId);
+    bool hasCov = Util::hasCoverage(covThr, covMode, queryCov, targetCov);
+    bool hasSeqId = seqId >= (seqIdThr - std::numeric_limits<float>::epsilon());
+    bool hasAlnLen = (diagonalLen >= alnLenThr);
+    if (isIdentity || (hasAlnLen && hasCov && hasSeqId)) {
+        hit_t rescored;
+        rescored.seqId = hit.seqId;
+        rescored.prefScore = 100 * seqId;
+        rescored.prefScore = (isReverse) ? -rescored.prefScore : rescored.prefScore;
+        rescored.diagonal = alignment.diagonal;
+        char buffer[100];
+        int len = QueryMatcher::prefilterHitToBuffer(buffer, rescored);
+        result.append(buffer, len);
+    }
+}
+
+void KmerHitRescorer::writeGroup() {
+    writer.writeData(result.c_str(), result.length(), repKey, thread);
+    result.clear();
+}
+
+template <int TYPE, typename T, typename KmerPos>
 void writeKmerMatcherResult(DBWriter & dbw,
-                            KmerPosition<T> *hashSeqPair, size_t totalKmers,
-                            std::vector<char> &repSequence, size_t threads) {
+                            KmerPos *hashSeqPair, size_t totalKmers,
+                            std::vector<char> &repSequence, size_t threads,
+                            KmerHitRescorer **rescorers) {
     std::vector<size_t> threadOffsets;
     size_t splitSize = totalKmers/threads;
     threadOffsets.push_back(0);
     for(size_t thread = 1; thread < threads; thread++){
         size_t kmer = hashSeqPair[thread*splitSize].kmer;
         size_t repSeqId = static_cast<size_t>(kmer);
-        repSeqId=BIT_SET(repSeqId, 63);
+        repSeqId=BIT_SET(repSeqId, KmerPos::REVERSE_BIT);
         bool wasSet = false;
         for(size_t pos = thread*splitSize; pos < totalKmers; pos++){
             size_t currSeqId = hashSeqPair[pos].kmer;
-            currSeqId=BIT_SET(currSeqId, 63);
+            currSeqId=BIT_SET(currSeqId, KmerPos::REVERSE_BIT);
             if(repSeqId != currSeqId){
                 wasSet = true;
                 threadOffsets.push_back(pos);
@@ -828,12 +1143,13 @@ void writeKmerMatcherResult(DBWriter & dbw,
             }
         }
         if(wasSet == false){
-            threadOffsets.push_back(totalKmers - 1 );
+            threadOffsets.push_back(totalKmers);
         }
     }
     threadOffsets.push_back(totalKmers);
 #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
     for(size_t thread = 0; thread < threads; thread++){
+        KmerHitRescorer * rescorer = (rescorers != NULL) ? rescorers[thread] : NULL;
         std::string prefResultsOutString;
         prefResultsOutString.reserve(100000000);
         char buffer[100];
@@ -841,17 +1157,20 @@ void writeKmerMatcherResult(DBWriter & dbw,
         unsigned int writeSets = 0;
         size_t kmerPos=0;
         size_t repSeqId = SIZE_T_MAX;
-        for(kmerPos = threadOffsets[thread]; kmerPos < threadOffsets[thread+1] && hashSeqPair[kmerPos].kmer != SIZE_T_MAX; kmerPos++){
+        for(kmerPos = threadOffsets[thread]; kmerPos < threadOffsets[thread+1] && hashSeqPair[kmerPos].kmer != KmerPos::EMPTY_KMER; kmerPos++){
             size_t currKmer = hashSeqPair[kmerPos].kmer;
             int reverMask = 0;
             if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-                reverMask  = BIT_CHECK(currKmer, 63)==false;
-                currKmer = BIT_CLEAR(currKmer, 63);
+                reverMask  = BIT_CHECK(currKmer, KmerPos::REVERSE_BIT)==false;
+                currKmer = BIT_CLEAR(currKmer, KmerPos::REVERSE_BIT);
             }
             if(repSeqId != currKmer) {
                 if (writeSets > 0) {
                     repSequence[repSeqId] = true;
                     dbw.writeData(prefResultsOutString.c_str(), prefResultsOutString.length(), repSeqId, thread);
+                    if (rescorer != NULL) {
+                        rescorer->writeGroup();
+                    }
                 }else{
                     if(repSeqId != SIZE_T_MAX) {
                         repSequence[repSeqId] = false;
@@ -867,6 +1186,9 @@ void writeKmerMatcherResult(DBWriter & dbw,
                 int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
                 // TODO: error handling for len
                 prefResultsOutString.append(buffer, len);
+                if (rescorer != NULL) {
+                    rescorer->startGroup(repSeqId);
+                }
             }
             unsigned int targetId = hashSeqPair[kmerPos].id;
             T diagonal = hashSeqPair[kmerPos].pos;
@@ -889,7 +1211,7 @@ void writeKmerMatcherResult(DBWriter & dbw,
                     diagonal = hashSeqPair[kmerPos+kmerOffset].pos;
                     maxDiagonal = diagonalCnt;
                     if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-                        bestReverMask = BIT_CHECK(hashSeqPair[kmerPos+kmerOffset].kmer, 63) == false;
+                        bestReverMask = BIT_CHECK(hashSeqPair[kmerPos+kmerOffset].kmer, KmerPos::REVERSE_BIT) == false;
                     }
                 }
                 prevDiagonal = hashSeqPair[kmerPos+kmerOffset].pos;
@@ -909,12 +1231,18 @@ void writeKmerMatcherResult(DBWriter & dbw,
             h.diagonal = diagonal;
             int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
             prefResultsOutString.append(buffer, len);
+            if (rescorer != NULL) {
+                rescorer->addHit(h);
+            }
             lastTargetId = targetId;
             writeSets++;
         }
         if (writeSets > 0) {
             repSequence[repSeqId] = true;
             dbw.writeData(prefResultsOutString.c_str(), prefResultsOutString.length(), repSeqId, thread);
+            if (rescorer != NULL) {
+                rescorer->writeGroup();
+            }
         }else{
             if(repSeqId != SIZE_T_MAX) {
                 repSequence[repSeqId] = false;
@@ -946,7 +1274,8 @@ size_t queueNextEntry(KmerPositionQueue &queue, int file, size_t offsetPos, T *e
 template <int TYPE, typename T>
 void mergeKmerFilesAndOutput(DBWriter & dbw,
                              std::vector<std::string> tmpFiles,
-                             std::vector<char> &repSequence) {
+                             std::vector<char> &repSequence,
+                             KmerHitRescorer *rescorer) {
     Debug(Debug::INFO) << "Merge splits ... ";
 
     const int fileCnt = tmpFiles.size();
@@ -997,6 +1326,9 @@ void mergeKmerFilesAndOutput(DBWriter & dbw,
             int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
             prefResultsOutString.append(buffer, len);
         }
+        if (rescorer != NULL) {
+            rescorer->startGroup(currRepSeq);
+        }
     }
 
 //    while(queue.empty() == false) {
@@ -1013,6 +1345,9 @@ void mergeKmerFilesAndOutput(DBWriter & dbw,
             offsetPos[res.file] = queueNextEntry<TYPE,T>(queue, res.file, offsetPos[res.file],
                                                          entries[res.file], entrySizes[res.file]);
             dbw.writeData(prefResultsOutString.c_str(), prefResultsOutString.length(), res.repSeq, 0);
+            if (rescorer != NULL) {
+                rescorer->writeGroup();
+            }
             if(hasRepSeq){
                 repSequence[res.repSeq]=true;
             }
@@ -1036,6 +1371,12 @@ void mergeKmerFilesAndOutput(DBWriter & dbw,
                     int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
                     prefResultsOutString.append(buffer, len);
                 }
+                if (rescorer != NULL) {
+                    rescorer->startGroup(currRepSeq);
+                }
+            } else {
+                // all splits are consumed
+                break;
             }
         }
 
@@ -1083,6 +1424,9 @@ void mergeKmerFilesAndOutput(DBWriter & dbw,
         h.diagonal =  bestDiagonal;
         int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
         prefResultsOutString.append(buffer, len);
+        if (rescorer != NULL) {
+            rescorer->addHit(h);
+        }
     }
     for(size_t file = 0; file < tmpFiles.size(); file++) {
         if (fclose(files[file]) != 0) {
@@ -1104,8 +1448,8 @@ void mergeKmerFilesAndOutput(DBWriter & dbw,
 }
 
 
-template <int TYPE, typename T, typename seqLenType>
-void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *hashSeqPair, size_t totalKmers) {
+template <int TYPE, typename T, typename seqLenType, typename KmerPos>
+void writeKmersToDisk(std::string tmpFile, KmerPos *hashSeqPair, size_t totalKmers) {
     size_t repSeqId = SIZE_T_MAX;
     size_t lastTargetId = SIZE_T_MAX;
     seqLenType lastDiagonal=0;
@@ -1120,10 +1464,10 @@ void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *hashSeqPair
     T nullEntry;
     nullEntry.seqId=UINT_MAX;
     nullEntry.diagonal=0;
-    for(size_t kmerPos = 0; kmerPos < totalKmers && hashSeqPair[kmerPos].kmer != SIZE_T_MAX; kmerPos++){
+    for(size_t kmerPos = 0; kmerPos < totalKmers && hashSeqPair[kmerPos].kmer != KmerPos::EMPTY_KMER; kmerPos++){
         size_t currKmer=hashSeqPair[kmerPos].kmer;
         if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-            currKmer = BIT_CLEAR(currKmer, 63);
+            currKmer = BIT_CLEAR(currKmer, KmerPos::REVERSE_BIT);
         }
         if(repSeqId != currKmer) {
             if (writeSets > 0 && elemenetCnt > 0) {
@@ -1140,7 +1484,7 @@ void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *hashSeqPair
             writeBuffer[bufferPos].score = 0;
             writeBuffer[bufferPos].diagonal = 0;
             if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-                bool isReverse = BIT_CHECK(hashSeqPair[kmerPos].kmer, 63)==false;
+                bool isReverse = BIT_CHECK(hashSeqPair[kmerPos].kmer, KmerPos::REVERSE_BIT)==false;
                 writeBuffer[bufferPos].setReverse(isReverse);
             }
             bufferPos++;
@@ -1156,12 +1500,12 @@ void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *hashSeqPair
             lastTargetId = hashSeqPair[kmerPos].id;
             lastDiagonal = hashSeqPair[kmerPos].pos;
             if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
-                bool isReverse  = BIT_CHECK(hashSeqPair[kmerPos].kmer, 63)==false;
+                bool isReverse  = BIT_CHECK(hashSeqPair[kmerPos].kmer, KmerPos::REVERSE_BIT)==false;
                 forward += isReverse == false;
                 reverse += isReverse == true;
             }
             kmerPos++;
-        }while(targetId == hashSeqPair[kmerPos].id && hashSeqPair[kmerPos].pos == diagonal && kmerPos < totalKmers && hashSeqPair[kmerPos].kmer != SIZE_T_MAX);
+        }while(targetId == hashSeqPair[kmerPos].id && hashSeqPair[kmerPos].pos == diagonal && kmerPos < totalKmers && hashSeqPair[kmerPos].kmer != KmerPos::EMPTY_KMER);
         kmerPos--;
 
         elemenetCnt++;
@@ -1189,12 +1533,15 @@ void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *hashSeqPair
         Debug(Debug::ERROR) << "Cannot close file " << tmpFile << "\n";
         EXIT(EXIT_FAILURE);
     }
+    // a restarted run skips splits with a .done marker, the split has to be on disk before the marker
+    FileUtil::syncFile(tmpFile.c_str());
     std::string fileName = tmpFile + ".done";
     FILE* done = FileUtil::openFileOrDie(fileName.c_str(),"w", false);
     if (fclose(done) != 0) {
         Debug(Debug::ERROR) << "Cannot close file " << fileName << "\n";
         EXIT(EXIT_FAILURE);
     }
+    FileUtil::syncFile(fileName.c_str());
 }
 
 void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqTyp) {
@@ -1228,20 +1575,20 @@ void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqTy
 }
 
 template std::pair<size_t, size_t>  fillKmerPositionArray<0, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, short * seqLens);
 template std::pair<size_t, size_t>  fillKmerPositionArray<1, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, short * seqLens);
 template std::pair<size_t, size_t>  fillKmerPositionArray<2, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, short * seqLens);
 template std::pair<size_t, size_t>  fillKmerPositionArray<0, int>(KmerPosition<int> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, int * seqLens);
 template std::pair<size_t, size_t>  fillKmerPositionArray<1, int>(KmerPosition <int>* kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, int * seqLens);
 template std::pair<size_t, size_t>  fillKmerPositionArray<2, int>(KmerPosition< int> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, int * seqLens);
 
-template KmerPosition<short> *initKmerPositionMemory(size_t size);
-template KmerPosition<int> *initKmerPositionMemory(size_t size);
+template KmerPosition<short> *initKmerPositionMemory<short>(size_t size);
+template KmerPosition<int> *initKmerPositionMemory<int>(size_t size);
 
 template size_t computeMemoryNeededLinearfilter<short>(size_t totalKmer);
 template size_t computeMemoryNeededLinearfilter<int>(size_t totalKmer);
@@ -53,6 +53,27 @@ struct __attribute__((__packed__))KmerPosition {
     T seqLen;
     T pos;
 
+    // bit 63 of the k-mer (and later the rep. sequence) marks forward nucleotide k-mers
+    static const size_t EMPTY_KMER = static_cast<size_t>(-1);
+    static const unsigned int REVERSE_BIT = 63;
+    static const bool HAS_SEQ_LEN = true;
+
+    static size_t kmerKey(size_t kmer) {
+        return kmer;
+    }
+
+    static size_t sequenceHashKey(size_t hash) {
+        return hash;
+    }
+
+    static T getSeqLen(const KmerPosition<T> &kmer, const T *) {
+        return kmer.seqLen;
+    }
+
+    void setSeqLen(T len) {
+        seqLen = len;
+    }
+
     static bool compareRepSequenceAndIdAndPos(const KmerPosition<T> &first, const KmerPosition<T> &second){
         if(first.kmer < second.kmer )
             return true;
@@ -131,6 +152,123 @@ struct __attribute__((__packed__))KmerPosition {
 };
 
 
+// Compact variant of KmerPosition for the k-mer array of kmermatcher (12 instead of 16 byte for short,
+// 14 instead of 20 byte for int). The key keeps 48 bit: k-mer indices have to be below 2^46, bit 46 marks
+// the whole sequence hash and bit 47 takes over the role of bit 63. The sequence length is not stored
+// but looked up by id in a table filled by fillKmerPositionArray.
+template <typename T>
+struct __attribute__((__packed__)) KmerPositionCompact {
+    size_t kmer : 48;
+    unsigned int id;
+    T pos;
+
+    static const size_t EMPTY_KMER = (1ULL << 48) - 1;
+    static const unsigned int REVERSE_BIT = 47;
+    static const unsigned int SEQUENCE_HASH_BIT = 46;
+    static const size_t MAX_KMER_IDX = (1ULL << 46) - 1;
+    static const bool HAS_SEQ_LEN = false;
+
+    static size_t kmerKey(size_t kmer) {
+        return BIT_CHECK(kmer, 63) ? BIT_SET(BIT_CLEAR(kmer, 63), REVERSE_BIT) : kmer;
+    }
+
+    static size_t sequenceHashKey(size_t hash) {
+        size_t key = BIT_SET(hash & MAX_KMER_IDX, SEQUENCE_HASH_BIT);
+        return BIT_CHECK(hash, 63) ? BIT_SET(key, REVERSE_BIT) : key;
+    }
+
+    static T getSeqLen(const KmerPositionCompact<T> &kmer, const T *seqLens) {
+        // assignGroup also reads the empty entry behind the last k-mer
+        return (kmer.id != UINT_MAX) ? seqLens[kmer.id] : 0;
+    }
+
+    void setSeqLen(T) {
+        ;
+    }
+
+    class CompareRepSequenceAndIdAndPos {
+    public:
+        CompareRepSequenceAndIdAndPos(const T *seqLens) : seqLens(seqLens) {}
+
+        bool operator()(const KmerPositionCompact<T> &first, const KmerPositionCompact<T> &second) const {
+            return compare(first, second, first.kmer, second.kmer, seqLens);
+        }
+
+    private:
+        const T *seqLens;
+    };
+
+    class CompareRepSequenceAndIdAndPosReverse {
+    public:
+        CompareRepSequenceAndIdAndPosReverse(const T *seqLens) : seqLens(seqLens) {}
+
+        bool operator()(const KmerPositionCompact<T> &first, const KmerPositionCompact<T> &second) const {
+            return compare(first, second, BIT_SET(first.kmer, REVERSE_BIT), BIT_SET(second.kmer, REVERSE_BIT), seqLens);
+        }
+
+    private:
+        const T *seqLens;
+    };
+
+    static bool compareRepSequenceAndIdAndDiagReverse(const KmerPositionCompact<T> &first, const KmerPositionCompact<T> &second){
+        size_t firstKmer  = BIT_SET(first.kmer, REVERSE_BIT);
+        size_t secondKmer = BIT_SET(second.kmer, REVERSE_BIT);
+        if(firstKmer < secondKmer)
+            return true;
+        if(secondKmer < firstKmer)
+            return false;
+        if(first.id < second.id)
+            return true;
+        if(second.id < first.id)
+            return false;
+        if(first.pos < second.pos)
+            return true;
+        if(second.pos < first.pos)
+            return false;
+        return false;
+    }
+
+    static bool compareRepSequenceAndIdAndDiag(const KmerPositionCompact<T> &first, const KmerPositionCompact<T> &second){
+        if(first.kmer < second.kmer)
+            return true;
+        if(second.kmer < first.kmer)
+            return false;
+        if(first.id < second.id)
+            return true;
+        if(second.id < first.id)
+            return false;
+        if(first.pos < second.pos)
+            return true;
+        if(second.pos < first.pos)
+            return false;
+        return false;
+    }
+
+private:
+    // same order as KmerPosition::compareRepSequenceAndIdAndPos, the longest sequence comes first
+    static bool compare(const KmerPositionCompact<T> &first, const KmerPositionCompact<T> &second,
+                        size_t firstKmer, size_t secondKmer, const T *seqLens) {
+        if(firstKmer < secondKmer)
+            return true;
+        if(secondKmer < firstKmer)
+            return false;
+        T firstLen = seqLens[first.id];
+        T secondLen = seqLens[second.id];
+        if(firstLen > secondLen)
+            return true;
+        if(secondLen > firstLen)
+            return false;
+        if(first.id < second.id)
+            return true;
+        if(second.id < first.id)
+            return false;
+        if(first.pos < second.pos)
+            return true;
+        if(second.pos < first.pos)
+            return false;
+        return false;
+    }
+};
 
 struct __attribute__((__packed__)) KmerEntry {
     unsigned int seqId;
@@ -192,11 +330,10 @@ public:
 };
 
 
-template  <int TYPE, typename T>
-size_t assignGroup(KmerPosition<T> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr);
+template  <int TYPE, typename T, typename KmerPos = KmerPosition<T>>
+size_t assignGroup(KmerPos *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr,
+                   const T *seqLens = NULL);
 
-template <int TYPE, typename T>
-void mergeKmerFilesAndOutput(DBWriter & dbw, std::vector<std::string> tmpFiles, std::vector<char> &repSequence);
 
 typedef std::priority_queue<FileKmerPosition, std::vector<FileKmerPosition>, CompareResultBySeqId> KmerPositionQueue;
 
@@ -205,34 +342,77 @@ size_t queueNextEntry(KmerPositionQueue &queue, int file, size_t offsetPos, T *e
 
 void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqType);
 
-template <int TYPE, typename T, typename seqLenType>
-void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *kmers, size_t totalKmers);
+template <int TYPE, typename T, typename seqLenType, typename KmerPos = KmerPosition<seqLenType>>
+void writeKmersToDisk(std::string tmpFile, KmerPos *kmers, size_t totalKmers);
+
+struct hit_t;
+
+// Rescores the k-mer hits of a group by their Hamming distance along the diagonal
+// while the group is written, like rescorediagonal --rescore-mode 0 on the result.
+// One instance per thread. The representative is copied at the first member hit of
+// a group, since getData reuses the thread buffer for compressed databases.
+class KmerHitRescorer {
+public:
+    KmerHitRescorer(DBReader<unsigned int> &seqDbr, BaseMatrix *subMat, Parameters &par,
+                    DBWriter &writer, unsigned int thread);
+
+    // starts the result of repKey with its identity hit
+    void startGroup(unsigned int repKey);
+    void addHit(const hit_t &hit);
+    void writeGroup();
+
+private:
+    DBReader<unsigned int> &seqDbr;
+    BaseMatrix *subMat;
+    DBWriter &writer;
+    const unsigned int thread;
+    const float seqIdThr;
+    const float covThr;
+    const int covMode;
+    const int seqIdMode;
+    const int alnLenThr;
+    const bool isNucleotide;
+
+    unsigned int repKey;
+    unsigned int repId;
+    int repLen;
+    std::string repSeq;
+    std::string repRevSeq;
+    std::string result;
+};
+
+template <int TYPE, typename T, typename KmerPos = KmerPosition<T>>
+void writeKmerMatcherResult(DBWriter & dbw, KmerPos *hashSeqPair, size_t totalKmers,
+                            std::vector<char> &repSequence, size_t threads,
+                            KmerHitRescorer **rescorers = NULL);
 
 template <int TYPE, typename T>
-void writeKmerMatcherResult(DBWriter & dbw, KmerPosition<T> *hashSeqPair, size_t totalKmers,
-                            std::vector<char> &repSequence, size_t threads);
+void mergeKmerFilesAndOutput(DBWriter & dbw, std::vector<std::string> tmpFiles, std::vector<char> &repSequence,
+                             KmerHitRescorer *rescorer = NULL);
 
 
 template <typename T>
 KmerPosition<T> * doComputation(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
                                 DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
                                 size_t KMER_SIZE, size_t chooseTopKmer, float chooseTopKmerScale = 0.0);
-template <typename T>
-KmerPosition<T> *initKmerPositionMemory(size_t size);
+template <typename T, typename KmerPos = KmerPosition<T>>
+KmerPos *initKmerPositionMemory(size_t size);
 
-template <int TYPE, typename T>
-std::pair<size_t, size_t>  fillKmerPositionArray(KmerPosition<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
+// seqLens (indexed by key) receives the sequence lengths if not NULL, KmerPositionCompact needs them
+template <int TYPE, typename T, typename KmerPos = KmerPosition<T>>
+std::pair<size_t, size_t>  fillKmerPositionArray(KmerPos * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence,
-                                                 size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                 size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                 T * seqLens = NULL);
 
 
 void maskSequence(int maskMode, int maskLowerCase,
                   Sequence &seq, int maskLetter, ProbabilityMatrix * probMatrix);
 
-template <typename T>
+template <typename T, typename KmerPos = KmerPosition<T>>
 size_t computeMemoryNeededLinearfilter(size_t totalKmer);
 
-template <typename T>
+template <typename T, typename KmerPos = KmerPosition<T>>
 std::vector<std::pair<size_t, size_t>> setupKmerSplits(Parameters &par, BaseMatrix * subMat, DBReader<unsigned int> &seqDbr, size_t totalKmers, size_t splits);
 
 size_t computeKmerCount(DBReader<unsigned int> &reader, size_t KMER_SIZE, size_t chooseTopKmer,
@@ -1,5 +1,6 @@
 #include "ExtendedSubstitutionMatrix.h"
 #include "Indexer.h"
+#include "ScoringCache.h"
 #include "Util.h"
 #include "simd.h"
 
@@ -18,6 +19,37 @@ struct sort_by_score {
 };
 
 ScoreMatrix ExtendedSubstitutionMatrix::calcScoreMatrix(const BaseMatrix& matrix, const size_t kmerSize){
+    // the extended matrix only depends on the final short matrix, which already
+    // contains bit factor, score bias and alphabet reduction
+    const size_t alphabetSize = matrix.alphabetSize;
+    uint64_t key = ScoringCache::hash(&alphabetSize, sizeof(size_t), kmerSize);
+    for (size_t i = 0; i < alphabetSize; i++) {
+        key = ScoringCache::hash(matrix.subMatrix[i], alphabetSize * sizeof(short), key);
+    }
+
+    size_t size = pow(alphabetSize, kmerSize);
+    size_t row_size = size / MAX_ALIGN_INT;
+    row_size = (row_size + 1) * MAX_ALIGN_INT;
+    const size_t scoreSize = size * row_size * sizeof(short);
+    const size_t indexSize = size * row_size * sizeof(unsigned int);
+
+    ScoringCache::Entry entry = ScoringCache::map(ScoringCache::EXTENDED_MATRIX, key, scoreSize + indexSize);
+    if (entry.isValid()) {
+        ScoreMatrix cached((short *) entry.payload, (unsigned int *) (entry.payload + scoreSize), size, row_size);
+        cached.mapping = entry.mapping;
+        cached.mappingSize = entry.mappingSize;
+        return cached;
+    }
+
+    ScoreMatrix result = computeScoreMatrix(matrix, kmerSize);
+    std::vector<std::pair<const char *, size_t>> parts;
+    parts.emplace_back((const char *) result.score, scoreSize);
+    parts.emplace_back((const char *) result.index, indexSize);
+    ScoringCache::store(ScoringCache::EXTENDED_MATRIX, key, parts);
+    return result;
+}
+
+ScoreMatrix ExtendedSubstitutionMatrix::computeScoreMatrix(const BaseMatrix& matrix, const size_t kmerSize){
     short ** subMatrix = matrix.subMatrix;
     const size_t alphabetSize = matrix.alphabetSize;
     size_t size = pow(alphabetSize, kmerSize);
@@ -69,8 +101,16 @@ ScoreMatrix ExtendedSubstitutionMatrix::calcScoreMatrix(const BaseMatrix& matrix
 }
 
 void ExtendedSubstitutionMatrix::freeScoreMatrix(ScoreMatrix& matrix) {
-    free(matrix.score);
-    free(matrix.index);
+    if (matrix.mapping != NULL) {
+        ScoringCache::Entry entry;
+        entry.mapping = matrix.mapping;
+        entry.mappingSize = matrix.mappingSize;
+        ScoringCache::unmap(entry);
+    } else {
+        free(matrix.score);
+        free(matrix.index);
+    }
+    matrix = ScoreMatrix();
 }
 
 short ExtendedSubstitutionMatrix::calcScore(unsigned char * i_seq, unsigned char * j_seq,size_t seq_size, short **subMatrix){
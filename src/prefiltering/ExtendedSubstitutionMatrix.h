@@ -10,7 +10,9 @@
 class ExtendedSubstitutionMatrix
 {
 public:
+    // served from the scoring cache if available, computed and stored otherwise
     static ScoreMatrix calcScoreMatrix(const BaseMatrix& matrix, const size_t kmerSize);
+    static ScoreMatrix computeScoreMatrix(const BaseMatrix& matrix, const size_t kmerSize);
     static void freeScoreMatrix(ScoreMatrix& matrix);
 
     static short calcScore(unsigned char * i_seq, unsigned char * j_seq,size_t seq_size,short **subMatrix);
@@ -53,7 +53,8 @@ public:
 void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedLookup,
                                 SequenceLookup **unmaskedLookup,BaseMatrix &subMat, Sequence *seq,
                                 DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbTo, int kmerThr,
-                                bool mask, bool maskLowerCaseMode, float maskProb) {
+                                bool mask, bool maskLowerCaseMode, float maskProb,
+                                size_t maxKmerAbundance, const EntryDuplicates *duplicates) {
     Debug(Debug::INFO) << "Index table: counting k-mers\n";
 
     const bool isProfile = Parameters::isEqualDbtype(seq->getSeqType(), Parameters::DBTYPE_HMM_PROFILE);
@@ -117,6 +118,7 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
             unsigned int qKey = dbr->getDbKey(id);
 
             s.mapSequence(id - dbFrom, qKey, seqData, dbr->getSeqLen(id));
+            const bool isDuplicate = (duplicates != NULL && duplicates->isDuplicate(id));
             if(s.getMaxLen() >= bufferSize ){
                 buffer = static_cast<unsigned int*>(realloc(buffer, s.getMaxLen() * sizeof(unsigned int)));
                 bufferSize = seq->getMaxLen();
@@ -124,7 +126,9 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
             // count similar or exact k-mers based on sequence type
             if (isProfile) {
                 // Find out if we should also mask profiles
-                totalKmerCount += indexTable->addSimilarKmerCount(&s, generator);
+                if (isDuplicate == false) {
+                    totalKmerCount += indexTable->addSimilarKmerCount(&s, generator);
+                }
                 (*unmaskedLookup)->addSequence(s.numConsensusSequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
             } else {
                 // Do not mask if column state sequences are used
@@ -159,7 +163,9 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
                     (*maskedLookup)->addSequence(s.numSequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
                 }
 
-                totalKmerCount += indexTable->addKmerCount(&s, &idxer, buffer, kmerThr, idScoreLookup);
+                if (isDuplicate == false) {
+                    totalKmerCount += indexTable->addKmerCount(&s, &idxer, buffer, kmerThr, idScoreLookup);
+                }
             }
         }
 
@@ -187,19 +193,56 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
 
     dbr->remapData();
 
-    //TODO find smart way to remove extrem k-mers without harming huge protein families
-//    size_t lowSelectiveResidues = 0;
-//    const float dbSize = static_cast<float>(dbTo - dbFrom);
-//    for(size_t kmerIdx = 0; kmerIdx < indexTable->getTableSize(); kmerIdx++){
-//        size_t res = (size_t) indexTable->getOffset(kmerIdx);
-//        float selectivityOfKmer = (static_cast<float>(res)/dbSize);
-//        if(selectivityOfKmer > 0.005){
-//            indexTable->getOffset()[kmerIdx] = 0;
-//            lowSelectiveResidues += res;
-//        }
-//    }
-//    Debug(Debug::INFO) << "Index table: Remove "<< lowSelectiveResidues <<" none selective residues\n";
-//    Debug(Debug::INFO) << "Index table: init... from "<< dbFrom << " to "<< dbTo << "\n";
+    // repeats and low complexity k-mers that escaped the masking produce huge sequence lists that dominate the
+    // matching time, only a deterministic sample of their sequences is kept
+    if (maxKmerAbundance > 0) {
+        const size_t cappedEntries = indexTable->capKmerAbundance(maxKmerAbundance);
+        if (indexTable->getCappedKmerCount() > 0) {
+            Debug(Debug::INFO) << "Index table: down-sample " << indexTable->getCappedKmerCount()
+                               << " k-mers occurring in more than " << maxKmerAbundance << " sequences\n";
+            Debug::Progress progressCapped(dbTo - dbFrom);
+            size_t sampledEntries = 0;
+            #pragma omp parallel
+            {
+                unsigned int thread_idx = 0;
+#ifdef OPENMP
+                thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+                Sequence s(seq->getMaxLen(), seq->getSeqType(), &subMat, seq->getKmerSize(), seq->isSpaced(), false, true, seq->getUserSpacedKmerPattern());
+                Indexer idxer(static_cast<unsigned int>(indexTable->getAlphabetSize()), seq->getKmerSize());
+                unsigned int *buffer = static_cast<unsigned int*>(malloc(seq->getMaxLen() * sizeof(unsigned int)));
+                KmerGenerator *generator = NULL;
+                if (isProfile) {
+                    generator = new KmerGenerator(seq->getKmerSize(), indexTable->getAlphabetSize(), kmerThr);
+                    generator->setDivideStrategy(s.profile_matrix);
+                }
+
+                #pragma omp for schedule(dynamic, 100) reduction(+:sampledEntries)
+                for (size_t id = dbFrom; id < dbTo; id++) {
+                    s.resetCurrPos();
+                    progressCapped.updateProgress();
+                    if (duplicates != NULL && duplicates->isDuplicate(id)) {
+                        continue;
+                    }
+
+                    unsigned int qKey = dbr->getDbKey(id);
+                    if (isProfile) {
+                        s.mapSequence(id - dbFrom, qKey, dbr->getData(id, thread_idx), dbr->getSeqLen(id));
+                        sampledEntries += indexTable->addSimilarKmerCount(&s, generator, true);
+                    } else {
+                        s.mapSequence(id - dbFrom, qKey, sequenceLookup->getSequence(id - dbFrom));
+                        sampledEntries += indexTable->addKmerCount(&s, &idxer, buffer, kmerThr, idScoreLookup, true);
+                    }
+                }
+
+                if (generator != NULL) {
+                    delete generator;
+                }
+                free(buffer);
+            }
+            Debug(Debug::INFO) << "Index table: removed " << (cappedEntries - sampledEntries) << " of " << totalKmerCount << " entries\n";
+        }
+    }
 
     indexTable->initMemory(info->tableSize);
     indexTable->init();
@@ -228,6 +271,9 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
         for (size_t id = dbFrom; id < dbTo; id++) {
             s.resetCurrPos();
             progress2.updateProgress();
+            if (duplicates != NULL && duplicates->isDuplicate(id)) {
+                continue;
+            }
 
             unsigned int qKey = dbr->getDbKey(id);
             if (isProfile) {
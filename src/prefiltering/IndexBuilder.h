@@ -2,12 +2,15 @@
 #define MMSEQS_INDEXBUILDER_H
 
 #include "IndexTable.h"
+#include "EntryDuplicates.h"
 
 class IndexBuilder {
 public:
+    // the k-mers of duplicates are not indexed, they only get the hits of their representative fanned out
     static void fillDatabase(IndexTable *indexTable, SequenceLookup **maskedLookup, SequenceLookup **unmaskedLookup,
                              BaseMatrix &subMat, Sequence *seq,
-                             DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbTo, int kmerThr, bool mask, bool maskLowerCaseMode, float maskProb);
+                             DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbTo, int kmerThr, bool mask, bool maskLowerCaseMode, float maskProb,
+                             size_t maxKmerAbundance = 0, const EntryDuplicates *duplicates = NULL);
 };
 
 #endif
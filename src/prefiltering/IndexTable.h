@@ -62,12 +62,29 @@ struct __attribute__((__packed__)) IndexEntryLocalTmp {
     }
 };
 
+// k-mer that occurred in more target sequences than allowed by --max-kmer-abundance
+// its sequence list only keeps a deterministic subset of about maxAbundance sequences
+struct __attribute__((__packed__)) IndexKmerAbundance {
+    unsigned int kmer;
+    // number of sequences containing the k-mer before down-sampling
+    unsigned int abundance;
+
+    IndexKmerAbundance(unsigned int kmer, unsigned int abundance) : kmer(kmer), abundance(abundance) {}
+
+    IndexKmerAbundance() {}
+
+    static bool compareByKmer(const IndexKmerAbundance &first, unsigned int kmer) {
+        return first.kmer < kmer;
+    }
+};
+
 class IndexTable {
 public:
     IndexTable(int alphabetSize, int kmerSize, bool externalData)
             : tableSize(MathUtil::ipow<size_t>(alphabetSize, kmerSize)), alphabetSize(alphabetSize),
               kmerSize(kmerSize), externalData(externalData), tableEntriesNum(0), size(0),
-              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL) {
+              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL),
+              maxAbundance(0), cappedKmers(NULL), cappedKmerCount(0) {
         if (externalData == false) {
             offsets = new(std::nothrow) size_t[tableSize + 1];
             Util::checkAllocation(offsets, "Can not allocate entries memory in IndexTable");
@@ -94,7 +111,8 @@ public:
     }
 
     // count k-mers in the sequence, so enough memory for the sequence lists can be allocated in the end
-    size_t addSimilarKmerCount(Sequence* s, KmerGenerator* kmerGenerator){
+    // cappedOnly only counts the sampled entries of capped k-mers after capKmerAbundance
+    size_t addSimilarKmerCount(Sequence* s, KmerGenerator* kmerGenerator, bool cappedOnly = false){
         s->resetCurrPos();
         std::vector<unsigned int> seqKmerPosBuffer;
 
@@ -115,7 +133,7 @@ public:
         unsigned int prevKmerIdx = UINT_MAX;
         for(size_t i = 0; i < seqKmerPosBuffer.size(); i++){
             unsigned int kmerIdx = seqKmerPosBuffer[i];
-            if(prevKmerIdx != kmerIdx){
+            if(prevKmerIdx != kmerIdx && (cappedOnly == false || isSampledCappedKmer(kmerIdx, s->getDbKey()))){
                 //table[kmerIdx] += 1;
                 // size increases by one
                 __sync_fetch_and_add(&(offsets[kmerIdx]), 1);
@@ -128,7 +146,7 @@ public:
 
     // count k-mers in the sequence, so enough memory for the sequence lists can be allocated in the end
     size_t addKmerCount(Sequence *s, Indexer *idxer, unsigned int *seqKmerPosBuffer,
-                        int threshold, char *diagonalScore) {
+                        int threshold, char *diagonalScore, bool cappedOnly = false) {
         s->resetCurrPos();
         size_t countKmer = 0;
         bool removeX = (Parameters::isEqualDbtype(s->getSequenceType(), Parameters::DBTYPE_NUCLEOTIDES) ||
@@ -158,7 +176,7 @@ public:
         unsigned int prevKmerIdx = UINT_MAX;
         for(size_t i = 0; i < countKmer; i++){
             unsigned int kmerIdx = seqKmerPosBuffer[i];
-            if(prevKmerIdx != kmerIdx){
+            if(prevKmerIdx != kmerIdx && (cappedOnly == false || isSampledCappedKmer(kmerIdx, s->getDbKey()))){
                 //table[kmerIdx] += 1;
                 // size increases by one
                 __sync_fetch_and_add(&(offsets[kmerIdx]), 1);
@@ -169,6 +187,45 @@ public:
         return countUniqKmer;
     }
 
+    // down-sample the sequence lists of k-mers that were counted in more than maxAbundance sequences
+    // the counts of these k-mers are reset and have to be counted again with cappedOnly
+    // returns the number of removed entries
+    size_t capKmerAbundance(size_t maxAbundance) {
+        this->maxAbundance = maxAbundance;
+        ownedCappedKmers.clear();
+        size_t removedEntries = 0;
+        for (size_t i = 0; i < tableSize; i++) {
+            if (offsets[i] > maxAbundance) {
+                const unsigned int abundance = static_cast<unsigned int>(std::min(offsets[i], static_cast<size_t>(UINT_MAX)));
+                ownedCappedKmers.push_back(IndexKmerAbundance(static_cast<unsigned int>(i), abundance));
+                removedEntries += offsets[i];
+                offsets[i] = 0;
+            }
+        }
+        cappedKmers = ownedCappedKmers.data();
+        cappedKmerCount = ownedCappedKmers.size();
+        return removedEntries;
+    }
+
+    // init the capped k-mers from an index
+    void initKmerAbundance(IndexKmerAbundance *data, size_t count, bool copy) {
+        if (copy) {
+            ownedCappedKmers.assign(data, data + count);
+            cappedKmers = ownedCappedKmers.data();
+        } else {
+            cappedKmers = data;
+        }
+        cappedKmerCount = count;
+    }
+
+    IndexKmerAbundance *getCappedKmers() {
+        return cappedKmers;
+    }
+
+    size_t getCappedKmerCount() {
+        return cappedKmerCount;
+    }
+
     // get list of DB sequences containing this k-mer
     inline IndexEntryLocal *getDBSeqList(size_t kmer, size_t *matchedListSize) {
         const ptrdiff_t diff = offsets[kmer + 1] - offsets[kmer];
@@ -285,6 +342,9 @@ public:
         Debug(Debug::INFO) << "Entries:          " << entrySize << "\n";
         Debug(Debug::INFO) << "DB size:          " << (entrySize * sizeof(IndexEntryLocal) + tableSize * sizeof(size_t))/1024/1024 << " MB\n";
         Debug(Debug::INFO) << "Avg k-mer size:   " << avgKmer << "\n";
+        if (cappedKmerCount > 0) {
+            Debug(Debug::INFO) << "Capped k-mers:    " << cappedKmerCount << "\n";
+        }
         Debug(Debug::INFO) << "Top " << top_N << " k-mers\n";
         for (size_t j = 0; j < top_N; j++) {
             Debug(Debug::INFO) << "    ";
@@ -327,7 +387,7 @@ public:
         unsigned int prevKmer = UINT_MAX;
         for(size_t pos = 0; pos < kmerPos; pos++){
             unsigned int kmerIdx = (*buffer)[pos].kmer;
-            if(kmerIdx != prevKmer){
+            if(kmerIdx != prevKmer && (cappedKmerCount == 0 || isKmerEntryKept(kmerIdx, s->getDbKey()))){
                 size_t offset = __sync_fetch_and_add(&(offsets[kmerIdx]), 1);
                 IndexEntryLocal *entry = &entries[offset];
                 entry->seqId      = (*buffer)[pos].seqId;
@@ -383,7 +443,7 @@ public:
         unsigned int prevKmer = UINT_MAX;
         for(size_t pos = 0; pos < kmerPos; pos++){
             unsigned int kmerIdx = (*buffer)[pos].kmer;
-            if(kmerIdx != prevKmer){
+            if(kmerIdx != prevKmer && (cappedKmerCount == 0 || isKmerEntryKept(kmerIdx, s->getDbKey()))){
                 size_t offset = __sync_fetch_and_add(&(offsets[kmerIdx]), 1);
                 IndexEntryLocal *entry = &entries[offset];
                 entry->seqId      = (*buffer)[pos].seqId;
@@ -480,5 +540,40 @@ protected:
 
     // sequence lookup
     SequenceLookup *sequenceLookup;
+
+    // k-mers with down-sampled sequence lists sorted by k-mer
+    size_t maxAbundance;
+    IndexKmerAbundance *cappedKmers;
+    size_t cappedKmerCount;
+    std::vector<IndexKmerAbundance> ownedCappedKmers;
+
+    inline const IndexKmerAbundance *findCappedKmer(size_t kmer) const {
+        const IndexKmerAbundance *end = cappedKmers + cappedKmerCount;
+        const IndexKmerAbundance *it = std::lower_bound(static_cast<const IndexKmerAbundance *>(cappedKmers), end, static_cast<unsigned int>(kmer), IndexKmerAbundance::compareByKmer);
+        return (it != end && it->kmer == kmer) ? it : NULL;
+    }
+
+    // keeps about maxAbundance of abundance sequences, the choice only depends on the sequence key so that it is the
+    // same in both passes and does not depend on the order the sequences are processed in
+    // a sequence that is kept in one list is kept in all lists of equal or lower abundance, so sequences that only
+    // share repeats with the query are dropped from all of their lists instead of surviving through one of them
+    inline bool isSampled(unsigned int key, unsigned int abundance) const {
+        uint64_t hash = key;
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+        hash = hash ^ (hash >> 31);
+        // hash / 2^64 < maxAbundance / abundance
+        return (hash >> 32) * abundance < (static_cast<uint64_t>(maxAbundance) << 32);
+    }
+
+    inline bool isSampledCappedKmer(unsigned int kmer, unsigned int key) const {
+        const IndexKmerAbundance *capped = findCappedKmer(kmer);
+        return capped != NULL && isSampled(key, capped->abundance);
+    }
+
+    inline bool isKmerEntryKept(unsigned int kmer, unsigned int key) const {
+        const IndexKmerAbundance *capped = findCappedKmer(kmer);
+        return capped == NULL || isSampled(key, capped->abundance);
+    }
 };
 #endif
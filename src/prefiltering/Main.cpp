@@ -5,6 +5,7 @@
 #include "DBReader.h"
 #include "Timer.h"
 #include "FileUtil.h"
+#include "ResumableChunks.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -55,7 +56,7 @@ int prefilter(int argc, const char **argv, const Command& command) {
     }
     pref.runMpiSplits(par.db3, par.db3Index, par.localTmp, runRandomId);
 #else
-    pref.runAllSplits(par.db3, par.db3Index);
+    pref.runAllSplits(par.db3, par.db3Index, ResumableChunks::fingerprint(par, command));
 #endif
 
     return EXIT_SUCCESS;
@@ -13,6 +13,9 @@
 #include "Parameters.h"
 #include "MemoryMapped.h"
 #include "FastSort.h"
+#include "QueryScheduler.h"
+#include "ResumableChunks.h"
+#include "TmpSpace.h"
 #include <sys/mman.h>
 
 #ifdef OPENMP
@@ -29,14 +32,18 @@ Prefiltering::Prefiltering(const std::string &queryDB,
         queryDBIndex(queryDBIndex),
         targetDB(targetDB),
         targetDBIndex(targetDBIndex),
+        segmentReader(NULL),
         splits(par.split),
         kmerSize(par.kmerSize),
         spacedKmerPattern(par.spacedKmerPattern),
         localTmp(par.localTmp),
+        checkpointChunks(par.checkpointChunks),
+        checkpoint(NULL),
         spacedKmer(par.spacedKmer != 0),
         maskMode(par.maskMode),
         maskLowerCaseMode(par.maskLowerCaseMode),
         maskProb(par.maskProb),
+        maxKmerAbundance(par.maxKmerAbundance),
         splitMode(par.splitMode),
         scoringMatrixFile(par.scoringMatrixFile),
         seedScoringMatrixFile(par.seedScoringMatrixFile),
@@ -116,6 +123,12 @@ Prefiltering::Prefiltering(const std::string &queryDB,
                         Debug(Debug::WARNING) << "Current search will use  --spaced-kmer-mode " << data.spacedKmer << "\n";
                     }
                 }
+                if(par.prefilter[i]->uniqid == par.PARAM_MAX_KMER_ABUNDANCE.uniqid) {
+                    if (data.maxKmerAbundance != maxKmerAbundance) {
+                        Debug(Debug::WARNING) << "Index was created with --max-kmer-abundance " << data.maxKmerAbundance << " but the prefilter was called with --max-kmer-abundance " << maxKmerAbundance << "!\n";
+                        Debug(Debug::WARNING) << "Current search will use --max-kmer-abundance " << data.maxKmerAbundance << "\n";
+                    }
+                }
                 if(par.prefilter[i]->uniqid == par.PARAM_NO_COMP_BIAS_CORR.uniqid) {
                     if (data.compBiasCorr != aaBiasCorrection && Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_HMM_PROFILE)) {
                         Debug(Debug::WARNING) << "Index was created with --comp-bias-corr " << data.compBiasCorr << " please recreate index with --comp-bias-corr " << aaBiasCorrection << "!\n";
@@ -137,6 +150,7 @@ Prefiltering::Prefiltering(const std::string &queryDB,
             // the query database could have longer sequences than the target database, do not cut them short
             maxSeqLen = std::max(maxSeqLen, (size_t)data.maxSeqLength);
             aaBiasCorrection = data.compBiasCorr;
+            maxKmerAbundance = data.maxKmerAbundance;
 
             if (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_HMM_PROFILE) &&
                 Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_HMM_PROFILE)) {
@@ -152,13 +166,43 @@ Prefiltering::Prefiltering(const std::string &queryDB,
             spacedKmerPattern = PrefilteringIndexReader::getSpacedPattern(tidxdbr);
             seedScoringMatrixFile = MultiParam<NuclAA<std::string>>(PrefilteringIndexReader::getSubstitutionMatrix(tidxdbr));
         } else {
-            Debug(Debug::ERROR) << "Outdated index version. Please recompute it with 'createindex'!\n";
+            Debug(Debug::ERROR) << "Outdated or damaged index. Please recompute it with 'createindex'!\n";
             EXIT(EXIT_FAILURE);
         }
     } else {
         tdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
         tdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
         templateDBIsIndex = false;
+
+        // a federated target DB is searched member by member if at least one of them has a precomputed index
+        const std::vector<DBReader<unsigned int>::FederatedMember> &members = tdbr->getFederatedMembers();
+        if (members.size() > 1 && splitMode != Parameters::QUERY_DB_SPLIT) {
+            size_t indexedMembers = 0;
+            for (size_t i = 0; i < members.size(); ++i) {
+                segmentIndexes.push_back(PrefilteringIndexReader::searchForIndex(members[i].name));
+                indexedMembers += segmentIndexes.back().empty() ? 0 : 1;
+            }
+            if (indexedMembers > 0) {
+                Debug(Debug::INFO) << "Searching " << members.size() << " members of the federated target database, "
+                                   << indexedMembers << " with a precomputed index\n";
+                splitMode = Parameters::TARGET_DB_SPLIT;
+                if (preloadMode == Parameters::PRELOAD_MODE_AUTO) {
+                    preloadMode = sensitivity > 6.0 ? Parameters::PRELOAD_MODE_FREAD : Parameters::PRELOAD_MODE_MMAP_TOUCH;
+                }
+                for (size_t i = 0; i < segmentIndexes.size() && kmerSize == 0; ++i) {
+                    if (segmentIndexes[i].empty() == false) {
+                        DBReader<unsigned int> reader(segmentIndexes[i].c_str(), (segmentIndexes[i] + ".index").c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+                        reader.open(DBReader<unsigned int>::NOSORT);
+                        if (PrefilteringIndexReader::checkIfIndexFile(&reader)) {
+                            kmerSize = PrefilteringIndexReader::getMetadata(&reader).kmerSize;
+                        }
+                        reader.close();
+                    }
+                }
+            } else {
+                segmentIndexes.clear();
+            }
+        }
     }
 
     // restrict amount of allocated memory if all results are requested
@@ -184,11 +228,28 @@ Prefiltering::Prefiltering(const std::string &queryDB,
         qdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
     }
     Debug(Debug::INFO) << "Query database size: " << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
+    targetDuplicates = new EntryDuplicates(*tdbr, EntryDuplicates::isDeduplicated(tdbr->getDbtype()));
+    queryDuplicates = (qdbr == tdbr) ? targetDuplicates : new EntryDuplicates(*qdbr, EntryDuplicates::isDeduplicated(qdbr->getDbtype()));
+
+    if (segmentIndexes.empty() == false) {
+        setupSegmentSplits(memoryLimit);
+        if (splits != 0 && splits != static_cast<int>(segmentSplits.size())) {
+            Debug(Debug::WARNING) << "Ignoring --split " << splits << ", the federated target database is searched in "
+                                  << segmentSplits.size() << " splits by member\n";
+        }
+        splits = segmentSplits.size();
+    }
 
     setupSplit(*tdbr, alphabetSize - 1, querySeqType,
                threads, templateDBIsIndex, memoryLimit, qdbr->getSize(),
                maxResListLen, kmerSize, splits, splitMode);
 
+    // query splits are independent, so more of them only cost the merge at the end
+    // target splits are bound by memory and used as they are
+    if (checkpointChunks > 0 && splitMode == Parameters::QUERY_DB_SPLIT) {
+        splits = std::max(splits, static_cast<int>(std::min(static_cast<size_t>(checkpointChunks), qdbr->getSize())));
+    }
+
     if(Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_NUCLEOTIDES) == false){
         const bool isProfileSearch = Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_HMM_PROFILE) ||
                                      Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_HMM_PROFILE);
@@ -222,6 +283,11 @@ Prefiltering::Prefiltering(const std::string &queryDB,
 }
 
 Prefiltering::~Prefiltering() {
+    if (queryDuplicates != targetDuplicates) {
+        delete queryDuplicates;
+    }
+    delete targetDuplicates;
+
     if (sameQTDB == false) {
         qdbr->close();
         delete qdbr;
@@ -234,6 +300,7 @@ Prefiltering::~Prefiltering() {
     if (sequenceLookup != NULL) {
         delete sequenceLookup;
     }
+    closeSegmentIndex();
 
     tdbr->close();
     delete tdbr;
@@ -495,12 +562,125 @@ ScoreMatrix Prefiltering::getScoreMatrix(const BaseMatrix& matrix, const size_t
 
 }
 
+void Prefiltering::setupSegmentSplits(size_t memoryLimit) {
+    const std::vector<DBReader<unsigned int>::FederatedMember> &members = tdbr->getFederatedMembers();
+    for (size_t i = 0; i < members.size(); ++i) {
+        const DBReader<unsigned int>::FederatedMember &member = members[i];
+        size_t residues = 0;
+        for (size_t id = member.firstEntry; id < member.firstEntry + member.entries; ++id) {
+            residues += tdbr->getSeqLen(id);
+        }
+        const int memberKmerSize = (kmerSize == 0) ? IndexTable::computeKmerSize(residues) : kmerSize;
+
+        size_t parts = 1;
+        while (parts <= member.entries
+               && estimateMemoryConsumption(static_cast<int>(parts), member.entries, residues, maxResListLen, alphabetSize - 1,
+                                            memberKmerSize, querySeqType, threads) > 0.9 * memoryLimit) {
+            parts++;
+        }
+        if (parts > 1 && segmentIndexes[i].empty() == false) {
+            Debug(Debug::WARNING) << "Index " << segmentIndexes[i] << " needs more than " << ByteParser::format(memoryLimit)
+                                  << " main memory. Avoid using the index.\n";
+            parts = 1;
+        } else if (parts > member.entries) {
+            Debug(Debug::ERROR) << "Cannot fit member " << member.name << " into " << ByteParser::format(memoryLimit)
+                                << ". Please use a computer with more main memory.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (parts == 1) {
+            SegmentSplit split = { i, member.firstEntry, member.entries, true };
+            segmentSplits.push_back(split);
+            continue;
+        }
+
+        // same decomposition by residues as decomposeDomainByAminoAcid, restricted to the entries of the member
+        Debug(Debug::INFO) << "Member " << member.name << " does not fit into memory, searching it in " << parts << " splits\n";
+        const size_t chunkSize = (residues + parts - 1) / parts;
+        SegmentSplit split = { i, member.firstEntry, 0, false };
+        size_t assigned = 0;
+        for (size_t id = member.firstEntry; id < member.firstEntry + member.entries; ++id) {
+            if (assigned >= chunkSize) {
+                segmentSplits.push_back(split);
+                split.dbFrom = id;
+                split.dbSize = 0;
+                assigned = 0;
+            }
+            assigned += tdbr->getSeqLen(id);
+            split.dbSize++;
+        }
+        segmentSplits.push_back(split);
+    }
+}
+
+DBReader<unsigned int> *Prefiltering::openSegmentIndex(size_t member) {
+    const std::string &indexDB = segmentIndexes[member];
+    if (indexDB.empty()) {
+        return NULL;
+    }
+    DBReader<unsigned int> *reader = new DBReader<unsigned int>(indexDB.c_str(), (indexDB + ".index").c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+    reader->open(DBReader<unsigned int>::NOSORT);
+
+    std::string incompatible;
+    if (PrefilteringIndexReader::checkIfIndexFile(reader) == false) {
+        incompatible = "version";
+    } else {
+        PrefilteringIndexData data = PrefilteringIndexReader::getMetadata(reader);
+        const size_t entries = tdbr->getFederatedMembers()[member].entries;
+        if (data.splits != 1) {
+            incompatible = "splits";
+        } else if (data.kmerSize != kmerSize) {
+            incompatible = "kmerSize";
+        } else if (data.alphabetSize != alphabetSize) {
+            incompatible = "alphabetSize";
+        } else if (data.seqType != targetSeqType) {
+            incompatible = "seqType";
+        } else if ((data.spacedKmer != 0) != spacedKmer || PrefilteringIndexReader::getSpacedPattern(reader) != spacedKmerPattern) {
+            incompatible = "spacedKmerPattern";
+        } else if ((data.compBiasCorr != 0) != aaBiasCorrection) {
+            incompatible = "compBiasCorrection";
+        } else if (data.mask != (maskMode > 0)) {
+            incompatible = "maskMode";
+        } else if (data.maxKmerAbundance != maxKmerAbundance) {
+            incompatible = "maxKmerAbundance";
+        } else if (Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_HMM_PROFILE)) {
+            // profile indexes depend on the k-mer threshold of the search
+            incompatible = "seqType";
+        } else if (PrefilteringIndexReader::getSubstitutionMatrixName(reader) != kmerSubMat->matrixName) {
+            incompatible = "seedScoringMatrixFile";
+        } else if (*((size_t *) reader->getDataUncompressed(reader->getId(PrefilteringIndexReader::SEQCOUNT))) != entries) {
+            incompatible = "sequences";
+        }
+    }
+    if (incompatible.empty() == false) {
+        Debug(Debug::WARNING) << "Index " << indexDB << " does not match this search (" << incompatible << "). Building the index table of the member instead.\n";
+        reader->close();
+        delete reader;
+        return NULL;
+    }
+    return reader;
+}
+
+void Prefiltering::closeSegmentIndex() {
+    if (segmentReader != NULL) {
+        segmentReader->close();
+        delete segmentReader;
+        segmentReader = NULL;
+    }
+}
+
 void Prefiltering::getIndexTable(int split, size_t dbFrom, size_t dbSize) {
-    if (templateDBIsIndex == true) {
-        indexTable = PrefilteringIndexReader::getIndexTable(split, tidxdbr, preloadMode);
+    // the tables of the previous member were already freed
+    closeSegmentIndex();
+    if (segmentSplits.empty() == false && segmentSplits[split].useIndex) {
+        segmentReader = openSegmentIndex(segmentSplits[split].member);
+    }
+    if (templateDBIsIndex == true || segmentReader != NULL) {
+        DBReader<unsigned int> *indexReader = templateDBIsIndex ? tidxdbr : segmentReader;
+        const int indexSplit = templateDBIsIndex ? split : 0;
+        indexTable = PrefilteringIndexReader::getIndexTable(indexSplit, indexReader, preloadMode);
         // only the ungapped alignment needs the sequence lookup, we can save quite some memory here
         if (diagonalScoring) {
-            sequenceLookup = PrefilteringIndexReader::getSequenceLookup(split, tidxdbr, preloadMode);
+            sequenceLookup = PrefilteringIndexReader::getSequenceLookup(indexSplit, indexReader, preloadMode);
         }
     } else {
         Timer timer;
@@ -519,7 +699,7 @@ void Prefiltering::getIndexTable(int split, size_t dbFrom, size_t dbSize) {
         SequenceLookup **unmaskedLookup = maskMode == 0 ? &sequenceLookup : NULL;
 
         Debug(Debug::INFO) << "Index table k-mer threshold: " << localKmerThr << " at k-mer size " << kmerSize << " \n";
-        IndexBuilder::fillDatabase(indexTable, maskedLookup, unmaskedLookup, *kmerSubMat,  &tseq, tdbr, dbFrom, dbFrom + dbSize, localKmerThr, maskMode, maskLowerCaseMode, maskProb);
+        IndexBuilder::fillDatabase(indexTable, maskedLookup, unmaskedLookup, *kmerSubMat,  &tseq, tdbr, dbFrom, dbFrom + dbSize, localKmerThr, maskMode, maskLowerCaseMode, maskProb, maxKmerAbundance, targetDuplicates);
 
         // sequenceLookup has to be temporarily present to speed up masking
         // afterwards its not needed anymore without diagonal scoring
@@ -549,8 +729,16 @@ bool Prefiltering::isSameQTDB() {
     return (queryDB.compare(targetDB) == 0 || (match == true));
 }
 
-void Prefiltering::runAllSplits(const std::string &resultDB, const std::string &resultDBIndex) {
+void Prefiltering::runAllSplits(const std::string &resultDB, const std::string &resultDBIndex, size_t checkpointFingerprint) {
+    if (checkpointChunks > 0 && splits > 1) {
+        checkpoint = new ResumableChunks(resultDB, resultDBIndex, splits, checkpointFingerprint);
+    }
     runSplits(resultDB, resultDBIndex, 0, splits, false);
+    if (checkpoint != NULL) {
+        checkpoint->finish();
+        delete checkpoint;
+        checkpoint = NULL;
+    }
 }
 
 #ifdef HAVE_MPI
@@ -667,12 +855,21 @@ int Prefiltering::runSplits(const std::string &resultDB, const std::string &resu
         // splits template database into x sequence steps
         std::vector<std::pair<std::string, std::string> > splitFiles;
         for (size_t i = fromSplit; i < (fromSplit + splitProcessCount); i++) {
+            if (checkpoint != NULL && checkpoint->isDone(i)) {
+                Debug(Debug::INFO) << "Skip prefiltering step " << (i + 1) << " of " << splits << ", it was committed by an earlier run\n";
+                continue;
+            }
             std::pair<std::string, std::string> filenamePair = Util::createTmpFileNames(resultDB, resultDBIndex, i);
-            if (runSplit(filenamePair.first.c_str(), filenamePair.second.c_str(), i, merge)) {
+            bool hasSplitResult = runSplit(filenamePair.first.c_str(), filenamePair.second.c_str(), i, merge);
+            if (checkpoint != NULL) {
+                checkpoint->commit(i, hasSplitResult);
+            } else if (hasSplitResult) {
                 splitFiles.push_back(filenamePair);
-
             }
         }
+        if (checkpoint != NULL) {
+            splitFiles = checkpoint->startMerge();
+        }
         if (splitFiles.size() > 0) {
             mergePrefilterSplits(resultDB, resultDBIndex, splitFiles);
             if (splitFiles.size() > 1) {
@@ -714,7 +911,12 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
 
     // create index table based on split parameter
     if (splitMode == Parameters::TARGET_DB_SPLIT) {
-        tdbr->decomposeDomainByAminoAcid(split, splits, &dbFrom, &dbSize);
+        if (segmentSplits.empty()) {
+            tdbr->decomposeDomainByAminoAcid(split, splits, &dbFrom, &dbSize);
+        } else {
+            dbFrom = segmentSplits[split].dbFrom;
+            dbSize = segmentSplits[split].dbSize;
+        }
         if (dbSize == 0) {
             return false;
         }
@@ -771,6 +973,24 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     Debug(Debug::INFO) << "Target db start " << (dbFrom + 1) << " to " << dbFrom + dbSize << "\n";
     Debug::Progress progress(querySize);
 
+    // a duplicate query gets the hits of its representative when they are written, if both are in this split
+    // with the same query and target DB the keys of the two are swapped in the hits, since each includes itself
+    // otherwise keys must not be part of the result
+    const bool fanOutQueries = queryDuplicates->getDuplicateCount() > 0 && (sameQTDB || includeIdentical == false);
+    std::vector<char> fannedOut(fanOutQueries ? querySize : 0, 0);
+    for (size_t id = queryFrom; fanOutQueries && id < queryFrom + querySize; id++) {
+        const size_t rep = queryDuplicates->getRepresentative(id);
+        fannedOut[id - queryFrom] = (rep != id && rep >= queryFrom && rep < queryFrom + querySize);
+    }
+
+    // the number of k-mers and with it the matching work grows with the query length
+    QueryScheduler scheduler(queryFrom, querySize, localThreads);
+    for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
+        scheduler.setCost(id, (fanOutQueries && fannedOut[id - queryFrom]) ? 0 : qdbr->getSeqLen(id));
+    }
+    scheduler.sortByCost();
+    scheduler.start();
+
 #pragma omp parallel num_threads(localThreads)
     {
         unsigned int thread_idx = 0;
@@ -793,10 +1013,15 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         char buffer[128];
         std::string result;
         result.reserve(1000000);
+        std::vector<hit_t> hits;
 
-#pragma omp for schedule(dynamic, 2) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow, trancatedCounter)
-        for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
+#pragma omp for schedule(dynamic, 1) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow, trancatedCounter)
+        for (size_t i = 0; i < querySize; i++) {
+            size_t id = scheduler.getId(i);
             progress.updateProgress();
+            if (fanOutQueries && fannedOut[id - queryFrom]) {
+                continue;
+            }
             // get query sequence
             char *seqData = qdbr->getData(id, thread_idx);
             unsigned int qKey = qdbr->getDbKey(id);
@@ -819,7 +1044,9 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
             std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES);
             size_t resultSize = prefResults.second;
             const float queryLength = static_cast<float>(qdbr->getSeqLen(id));
-            for (size_t i = 0; i < resultSize; i++) {
+            const size_t identityId = (targetSeqId != UINT_MAX) ? targetSeqId + dbFrom : SIZE_MAX;
+            // the hits are sorted by score and the duplicates of a target follow it, so the list is cut like the unfanned one
+            for (size_t i = 0; i < resultSize && hits.size() < maxResListLen; i++) {
                 hit_t *res = prefResults.first + i;
                 // correct the 0 indexed sequence id again to its real identifier
                 size_t targetSeqId1 = res->seqId + dbFrom;
@@ -838,14 +1065,53 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
                         continue;
                     }
                 }
+                hits.emplace_back(*res);
+
+                // duplicates of the target were not indexed, only the identity hit can reach one directly
+                if (targetDuplicates->isDuplicate(targetSeqId1) == false) {
+                    for (unsigned int dupId = targetDuplicates->getNext(targetSeqId1); dupId != UINT_MAX && hits.size() < maxResListLen; dupId = targetDuplicates->getNext(dupId)) {
+                        if (dupId != identityId) {
+                            hits.emplace_back(*res);
+                            hits.back().seqId = tdbr->getDbKey(dupId);
+                        }
+                    }
+                }
+            }
 
-                // write prefiltering results to a string
-                int len = QueryMatcher::prefilterHitToBuffer(buffer, *res);
+            // write prefiltering results to a string
+            for (size_t i = 0; i < hits.size(); i++) {
+                int len = QueryMatcher::prefilterHitToBuffer(buffer, hits[i]);
                 result.append(buffer, len);
             }
             tmpDbw.writeData(result.c_str(), result.length(), qKey, thread_idx);
             result.clear();
 
+            const bool isRepresentative = fanOutQueries && queryDuplicates->isDuplicate(id) == false;
+            for (unsigned int dupId = isRepresentative ? queryDuplicates->getNext(id) : UINT_MAX; dupId != UINT_MAX; dupId = queryDuplicates->getNext(dupId)) {
+                if (dupId < queryFrom || dupId >= queryFrom + querySize) {
+                    continue;
+                }
+                const unsigned int dupKey = qdbr->getDbKey(dupId);
+                if (sameQTDB) {
+                    for (size_t i = 0; i < hits.size(); i++) {
+                        hit_t hit = hits[i];
+                        if (hit.seqId == qKey) {
+                            hit.seqId = dupKey;
+                        } else if (hit.seqId == dupKey) {
+                            hit.seqId = qKey;
+                        }
+                        int len = QueryMatcher::prefilterHitToBuffer(buffer, hit);
+                        result.append(buffer, len);
+                    }
+                    tmpDbw.writeData(result.c_str(), result.length(), dupKey, thread_idx);
+                    result.clear();
+                } else {
+                    tmpDbw.writeDuplicateEntry(dupKey, thread_idx);
+                }
+                notEmpty[dupId - queryFrom] = (resultSize != 0);
+            }
+            hits.clear();
+
             // update statistics counters
             if (resultSize != 0) {
                 notEmpty[id - queryFrom] = 1;
@@ -862,6 +1128,7 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
                 realResSize += std::min(resultSize, maxResListLen);
                 reslens[thread_idx]->emplace_back(resultSize);
             }
+            scheduler.markBusy(thread_idx);
         } // step end
     }
 
@@ -880,6 +1147,7 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         }
 
         printStatistics(stats, reslens, localThreads, empty, maxResListLen);
+        scheduler.printTailUtilization();
     }
 
     if (splitMode == Parameters::TARGET_DB_SPLIT && splits == 1) {
@@ -1071,9 +1339,8 @@ size_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t
 }
 
 size_t Prefiltering::estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen) {
-    // 21 bytes is roughly the size of an entry
     // 2x because the merge doubles the hdd demand
-    return 2 * (21 * dbSize * maxResListLen);
+    return 2 * TmpSpace::prefilterResultSize(dbSize, maxResListLen);
 }
 
 std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr,
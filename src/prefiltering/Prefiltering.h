@@ -8,11 +8,14 @@
 #include "ScoreMatrix.h"
 #include "PrefilteringIndexReader.h"
 #include "QueryMatcher.h"
+#include "EntryDuplicates.h"
 
 #include <string>
 #include <list>
 #include <utility>
 
+class ResumableChunks;
+
 class Prefiltering {
 public:
     Prefiltering(
@@ -25,7 +28,8 @@ public:
 
     ~Prefiltering();
 
-    void runAllSplits(const std::string &resultDB, const std::string &resultDBIndex);
+    // with --checkpoint-chunks every split is committed on its own and splits of an earlier run with the same fingerprint are skipped
+    void runAllSplits(const std::string &resultDB, const std::string &resultDBIndex, size_t checkpointFingerprint);
 
 #ifdef HAVE_MPI
     void runMpiSplits(const std::string &resultDB, const std::string &resultDBIndex, const std::string &localTmpPath, const int runRandomId);
@@ -60,6 +64,25 @@ private:
     DBReader<unsigned int> *tidxdbr;
     bool sameQTDB;
 
+    // identical sequences are matched once, their hits are fanned out to the duplicates when the results are written
+    EntryDuplicates *queryDuplicates;
+    EntryDuplicates *targetDuplicates;
+
+    // precomputed index of every member of a federated target DB, empty if the member has none
+    // every member is searched in at least one target split, the reader of the current split has to stay open while its table is used
+    std::vector<std::string> segmentIndexes;
+    DBReader<unsigned int> *segmentReader;
+
+    // target split of a federated target DB, members that do not fit into memory are searched in several of them
+    struct SegmentSplit {
+        size_t member;
+        size_t dbFrom;
+        size_t dbSize;
+        // the split covers the whole member and can use its precomputed index
+        bool useIndex;
+    };
+    std::vector<SegmentSplit> segmentSplits;
+
     BaseMatrix *kmerSubMat;
     BaseMatrix *ungappedSubMat;
     ScoreMatrix _2merSubMatrix;
@@ -72,12 +95,15 @@ private:
     int kmerSize;
     std::string spacedKmerPattern;
     std::string localTmp;
+    int checkpointChunks;
+    ResumableChunks *checkpoint;
     bool spacedKmer;
     int alphabetSize;
     bool templateDBIsIndex;
     int maskMode;
     int maskLowerCaseMode;
     float maskProb;
+    int maxKmerAbundance;
     int splitMode;
     int kmerThr;
     MultiParam<NuclAA<std::string>> scoringMatrixFile;
@@ -120,6 +146,14 @@ private:
     // needed for index lookup
     void getIndexTable(int split, size_t dbFrom, size_t dbSize);
 
+    // one target split per member of a federated target DB, members without index that do not fit into memory are split further
+    void setupSegmentSplits(size_t memoryLimit);
+
+    // opens the precomputed index of a federated member, NULL if it does not exist or was built with other settings
+    DBReader<unsigned int> *openSegmentIndex(size_t member);
+
+    void closeSegmentIndex();
+
     void printStatistics(const statistics_t &stats, std::list<int> **reslens,
                          unsigned int resLensSize, size_t empty, size_t maxResults);
 
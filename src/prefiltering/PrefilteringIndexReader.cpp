@@ -3,9 +3,16 @@
 #include "Prefiltering.h"
 #include "ExtendedSubstitutionMatrix.h"
 #include "FileUtil.h"
+#include "MemoryMapped.h"
 #include "IndexBuilder.h"
 #include "Parameters.h"
 
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include <utility>
+#include <vector>
+
 extern const char* index_version_compatible;
 unsigned int PrefilteringIndexReader::VERSION = 0;
 unsigned int PrefilteringIndexReader::META = 1;
@@ -24,6 +31,7 @@ unsigned int PrefilteringIndexReader::SEQCOUNT = 13;
 unsigned int PrefilteringIndexReader::SEQINDEXDATA = 14;
 unsigned int PrefilteringIndexReader::SEQINDEXDATASIZE = 15;
 unsigned int PrefilteringIndexReader::SEQINDEXSEQOFFSET = 16;
+unsigned int PrefilteringIndexReader::SECTIONS = 17;
 unsigned int PrefilteringIndexReader::HDR1INDEX = 18;
 unsigned int PrefilteringIndexReader::HDR1DATA = 19;
 unsigned int PrefilteringIndexReader::HDR2INDEX = 20;
@@ -32,6 +40,9 @@ unsigned int PrefilteringIndexReader::GENERATOR = 22;
 unsigned int PrefilteringIndexReader::SPACEDPATTERN = 23;
 unsigned int PrefilteringIndexReader::ALNINDEX = 24;
 unsigned int PrefilteringIndexReader::ALNDATA = 25;
+unsigned int PrefilteringIndexReader::HDR1DICT = 26;
+unsigned int PrefilteringIndexReader::HDR2DICT = 27;
+unsigned int PrefilteringIndexReader::KMERABUNDANCE = 28;
 
 extern const char* version;
 
@@ -40,7 +51,55 @@ bool PrefilteringIndexReader::checkIfIndexFile(DBReader<unsigned int>* reader) {
     if(version == NULL){
         return false;
     }
-    return (strncmp(version, index_version_compatible, strlen(index_version_compatible)) == 0 ) ? true : false;
+    if (strncmp(version, index_version_compatible, strlen(index_version_compatible)) != 0) {
+        return false;
+    }
+    return checkSections(reader);
+}
+
+bool PrefilteringIndexReader::checkSections(DBReader<unsigned int> *dbr) {
+    size_t id = dbr->getId(SECTIONS);
+    // index was written without a table of contents
+    if (id == UINT_MAX) {
+        return true;
+    }
+    // the table of contents is written last
+    if (dbr->getOffset(id) + dbr->getEntryLen(id) > dbr->getTotalDataSize()) {
+        Debug(Debug::WARNING) << "Index " << dbr->getDataFileName() << " is truncated\n";
+        return false;
+    }
+    const PrefilteringIndexSection *sections = (const PrefilteringIndexSection *) dbr->getDataUncompressed(id);
+    const size_t count = (dbr->getEntryLen(id) - 1) / sizeof(PrefilteringIndexSection);
+    for (size_t i = 0; i < count; ++i) {
+        size_t sectionId = dbr->getId(sections[i].key);
+        if (sectionId == UINT_MAX
+            || dbr->getEntryLen(sectionId) != sections[i].size + 1
+            || dbr->getOffset(sectionId) + sections[i].size > dbr->getTotalDataSize()) {
+            Debug(Debug::WARNING) << "Index " << dbr->getDataFileName() << " is truncated or damaged (section " << sections[i].key << ")\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+void PrefilteringIndexReader::verifySection(DBReader<unsigned int> *dbr, size_t id) {
+    size_t tocId = dbr->getId(SECTIONS);
+    if (tocId == UINT_MAX) {
+        return;
+    }
+    const unsigned int key = dbr->getDbKey(id);
+    const PrefilteringIndexSection *sections = (const PrefilteringIndexSection *) dbr->getDataUncompressed(tocId);
+    const size_t count = (dbr->getEntryLen(tocId) - 1) / sizeof(PrefilteringIndexSection);
+    for (size_t i = 0; i < count; ++i) {
+        if (sections[i].key != key) {
+            continue;
+        }
+        if (XXH64(dbr->getDataUncompressed(id), sections[i].size, 0) != sections[i].checksum) {
+            Debug(Debug::ERROR) << "Section " << key << " of index " << dbr->getDataFileName() << " is damaged. Please recompute it with 'createindex'!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        return;
+    }
 }
 
 std::string PrefilteringIndexReader::indexName(const std::string &outDB) {
@@ -49,6 +108,69 @@ std::string PrefilteringIndexReader::indexName(const std::string &outDB) {
     return result;
 }
 
+// every section starts at a page boundary, so it can be mapped and touched on its own
+static void writeSection(DBWriter &writer, std::vector<PrefilteringIndexSection> &sections,
+                         const char *data, size_t size, unsigned int key, unsigned int file) {
+    writer.writeData(data, size, key, file);
+    writer.alignToPageSize(file);
+    PrefilteringIndexSection section = { key, size, XXH64(data, size, 0) };
+    sections.push_back(section);
+}
+
+// an index entry that points to the data of an already written section
+static void writeAliasSection(DBWriter &writer, std::vector<PrefilteringIndexSection> &sections,
+                              unsigned int key, unsigned int target, size_t offset, unsigned int file) {
+    for (size_t i = 0; i < sections.size(); ++i) {
+        if (sections[i].key == target) {
+            writer.writeIndexEntry(key, offset, sections[i].size + 1, file);
+            PrefilteringIndexSection section = { key, sections[i].size, sections[i].checksum };
+            sections.push_back(section);
+            return;
+        }
+    }
+}
+
+// writes the index and the data of a DB as two sections, returns the offsets of both
+static std::pair<size_t, size_t> writeDbSections(DBWriter &writer, std::vector<PrefilteringIndexSection> &sections,
+                                                 DBReader<unsigned int> *dbr, unsigned int indexKey, unsigned int dataKey, unsigned int file) {
+    const size_t offsetIndex = writer.getOffset(file);
+    char *index = DBReader<unsigned int>::serialize(*dbr);
+    writeSection(writer, sections, index, DBReader<unsigned int>::indexMemorySize(*dbr), indexKey, file);
+    free(index);
+
+    const size_t offsetData = writer.getOffset(file);
+    XXH64_state_t state;
+    XXH64_reset(&state, 0);
+    writer.writeStart(file);
+    for (size_t fileIdx = 0; fileIdx < dbr->getDataFileCnt(); fileIdx++) {
+        writer.writeAdd(dbr->getDataForFile(fileIdx), dbr->getDataSizeForFile(fileIdx), file);
+        XXH64_update(&state, dbr->getDataForFile(fileIdx), dbr->getDataSizeForFile(fileIdx));
+    }
+    writer.writeEnd(dataKey, file);
+    writer.alignToPageSize(file);
+    PrefilteringIndexSection section = { dataKey, dbr->getTotalDataSize(), XXH64_digest(&state) };
+    sections.push_back(section);
+    return std::make_pair(offsetIndex, offsetData);
+}
+
+// copies the zstd dictionary of a dictionary-compressed DB, returns the offset of the section or SIZE_MAX if there is none
+static size_t writeDictionarySection(DBWriter &writer, std::vector<PrefilteringIndexSection> &sections,
+                                     DBReader<unsigned int> *dbr, unsigned int key, unsigned int file) {
+    std::string dictionaryFile = std::string(dbr->getDataFileName()) + ".zdict";
+    if (FileUtil::fileExists(dictionaryFile.c_str()) == false) {
+        return SIZE_MAX;
+    }
+    MemoryMapped dictionary(dictionaryFile, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+    if (dictionary.isValid() == false) {
+        Debug(Debug::ERROR) << "Cannot open dictionary file " << dictionaryFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const size_t offset = writer.getOffset(file);
+    writeSection(writer, sections, (const char *) dictionary.getData(), dictionary.size(), key, file);
+    dictionary.close();
+    return offset;
+}
+
 void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
                                               DBReader<unsigned int> *dbr1, DBReader<unsigned int> *dbr2,
                                               DBReader<unsigned int> *hdbr1, DBReader<unsigned int> *hdbr2,
@@ -56,7 +178,8 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
                                               BaseMatrix *subMat, int maxSeqLen,
                                               bool hasSpacedKmer, const std::string &spacedKmerPattern,
                                               bool compBiasCorrection, int alphabetSize, int kmerSize,
-                                              int maskMode, int maskLowerCase, float maskProb, int kmerThr, int splits) {
+                                              int maskMode, int maskLowerCase, float maskProb, int kmerThr, int splits,
+                                              int maxKmerAbundance) {
 
     const int SPLIT_META = splits > 1 ? 0 : 0;
     const int SPLIT_SEQS = splits > 1 ? 1 : 0;
@@ -65,9 +188,10 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
     DBWriter writer(outDB.c_str(), std::string(outDB).append(".index").c_str(), splits > 1 ? splits + 2 : 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_INDEX_DB);
     writer.open();
 
+    std::vector<PrefilteringIndexSection> sections;
+
     Debug(Debug::INFO) << "Write VERSION (" << VERSION << ")\n";
-    writer.writeData((char *) index_version_compatible, strlen(index_version_compatible) * sizeof(char), VERSION, SPLIT_META);
-    writer.alignToPageSize(SPLIT_META);
+    writeSection(writer, sections, index_version_compatible, strlen(index_version_compatible) * sizeof(char), VERSION, SPLIT_META);
 
     Debug(Debug::INFO) << "Write META (" << META << ")\n";
     const int biasCorr = compBiasCorrection ? 1 : 0;
@@ -77,10 +201,9 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
     const int headers2 = (hdbr2 != NULL) ? 1 : 0;
     const int seqType = dbr1->getDbtype();
     const int srcSeqType = (dbr2 !=NULL) ? dbr2->getDbtype() : seqType;
-    int metadata[] = {maxSeqLen, kmerSize, biasCorr, alphabetSize, mask, spacedKmer, kmerThr, seqType, srcSeqType, headers1, headers2, splits};
+    int metadata[] = {maxSeqLen, kmerSize, biasCorr, alphabetSize, mask, spacedKmer, kmerThr, seqType, srcSeqType, headers1, headers2, splits, maxKmerAbundance};
     char *metadataptr = (char *) &metadata;
-    writer.writeData(metadataptr, sizeof(metadata), META, SPLIT_META);
-    writer.alignToPageSize(SPLIT_META);
+    writeSection(writer, sections, metadataptr, sizeof(metadata), META, SPLIT_META);
 
     if (Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_HMM_PROFILE) == false) {
         int alphabetSize = subMat->alphabetSize;
@@ -91,117 +214,60 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
 
         char* serialized3mer = ScoreMatrix::serialize(s3);
         Debug(Debug::INFO) << "Write SCOREMATRIX3MER (" << SCOREMATRIX3MER << ")\n";
-        writer.writeData(serialized3mer, ScoreMatrix::size(s3), SCOREMATRIX3MER, SPLIT_META);
-        writer.alignToPageSize(SPLIT_META);
+        writeSection(writer, sections, serialized3mer, ScoreMatrix::size(s3), SCOREMATRIX3MER, SPLIT_META);
         ExtendedSubstitutionMatrix::freeScoreMatrix(s3);
         free(serialized3mer);
 
         char* serialized2mer = ScoreMatrix::serialize(s2);
         Debug(Debug::INFO) << "Write SCOREMATRIX2MER (" << SCOREMATRIX2MER << ")\n";
-        writer.writeData(serialized2mer, ScoreMatrix::size(s2), SCOREMATRIX2MER, SPLIT_META);
-        writer.alignToPageSize(SPLIT_META);
+        writeSection(writer, sections, serialized2mer, ScoreMatrix::size(s2), SCOREMATRIX2MER, SPLIT_META);
         ExtendedSubstitutionMatrix::freeScoreMatrix(s2);
         free(serialized2mer);
     }
 
     Debug(Debug::INFO) << "Write SCOREMATRIXNAME (" << SCOREMATRIXNAME << ")\n";
     char* subData = BaseMatrix::serialize(subMat->matrixName, subMat->matrixData);
-    writer.writeData(subData, BaseMatrix::memorySize(subMat->matrixName, subMat->matrixData), SCOREMATRIXNAME, SPLIT_META);
-    writer.alignToPageSize(SPLIT_META);
+    writeSection(writer, sections, subData, BaseMatrix::memorySize(subMat->matrixName, subMat->matrixData), SCOREMATRIXNAME, SPLIT_META);
     free(subData);
 
-    if (spacedKmerPattern.empty() != false) {
+    if (spacedKmerPattern.empty() == false) {
         Debug(Debug::INFO) << "Write SPACEDPATTERN (" << SPACEDPATTERN << ")\n";
-        writer.writeData(spacedKmerPattern.c_str(), spacedKmerPattern.length(), SPACEDPATTERN, SPLIT_META);
-        writer.alignToPageSize(SPLIT_META);
+        writeSection(writer, sections, spacedKmerPattern.c_str(), spacedKmerPattern.length(), SPACEDPATTERN, SPLIT_META);
     }
 
     Debug(Debug::INFO) << "Write GENERATOR (" << GENERATOR << ")\n";
-    writer.writeData(version, strlen(version), GENERATOR, SPLIT_META);
-    writer.alignToPageSize(SPLIT_META);
-
-    Debug(Debug::INFO) << "Write DBR1INDEX (" << DBR1INDEX << ")\n";
-    char* data = DBReader<unsigned int>::serialize(*dbr1);
-    size_t offsetIndex = writer.getOffset(SPLIT_SEQS);
-    writer.writeData(data, DBReader<unsigned int>::indexMemorySize(*dbr1), DBR1INDEX, SPLIT_SEQS);
-    writer.alignToPageSize(SPLIT_SEQS);
-
-    Debug(Debug::INFO) << "Write DBR1DATA (" << DBR1DATA << ")\n";
-    size_t offsetData = writer.getOffset(SPLIT_SEQS);
-    writer.writeStart(SPLIT_SEQS);
-    for(size_t fileIdx = 0; fileIdx < dbr1->getDataFileCnt(); fileIdx++) {
-        writer.writeAdd(dbr1->getDataForFile(fileIdx), dbr1->getDataSizeForFile(fileIdx), SPLIT_SEQS);
-    }
-    writer.writeEnd(DBR1DATA, SPLIT_SEQS);
-    writer.alignToPageSize(SPLIT_SEQS);
-    free(data);
+    writeSection(writer, sections, version, strlen(version), GENERATOR, SPLIT_META);
 
+    Debug(Debug::INFO) << "Write DBR1INDEX (" << DBR1INDEX << ") and DBR1DATA (" << DBR1DATA << ")\n";
+    std::pair<size_t, size_t> offsets = writeDbSections(writer, sections, dbr1, DBR1INDEX, DBR1DATA, SPLIT_SEQS);
     if (dbr2 == NULL) {
-        writer.writeIndexEntry(DBR2INDEX, offsetIndex, DBReader<unsigned int>::indexMemorySize(*dbr1)+1, SPLIT_SEQS);
-        writer.writeIndexEntry(DBR2DATA,  offsetData,  dbr1->getTotalDataSize()+1, SPLIT_SEQS);
+        writeAliasSection(writer, sections, DBR2INDEX, DBR1INDEX, offsets.first, SPLIT_SEQS);
+        writeAliasSection(writer, sections, DBR2DATA, DBR1DATA, offsets.second, SPLIT_SEQS);
     } else {
-        Debug(Debug::INFO) << "Write DBR2INDEX (" << DBR2INDEX << ")\n";
-        data = DBReader<unsigned int>::serialize(*dbr2);
-        writer.writeData(data, DBReader<unsigned int>::indexMemorySize(*dbr2), DBR2INDEX, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-        Debug(Debug::INFO) << "Write DBR2DATA (" << DBR2DATA << ")\n";
-        writer.writeStart(SPLIT_SEQS);
-        for(size_t fileIdx = 0; fileIdx < dbr2->getDataFileCnt(); fileIdx++) {
-            writer.writeAdd(dbr2->getDataForFile(fileIdx), dbr2->getDataSizeForFile(fileIdx), SPLIT_SEQS);
-        }
-        writer.writeEnd(DBR2DATA, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-        free(data);
+        Debug(Debug::INFO) << "Write DBR2INDEX (" << DBR2INDEX << ") and DBR2DATA (" << DBR2DATA << ")\n";
+        writeDbSections(writer, sections, dbr2, DBR2INDEX, DBR2DATA, SPLIT_SEQS);
     }
 
     if (hdbr1 != NULL) {
-        Debug(Debug::INFO) << "Write HDR1INDEX (" << HDR1INDEX << ")\n";
-        data = DBReader<unsigned int>::serialize(*hdbr1);
-        size_t offsetIndex = writer.getOffset(SPLIT_SEQS);
-        writer.writeData(data, DBReader<unsigned int>::indexMemorySize(*hdbr1), HDR1INDEX, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-
-        Debug(Debug::INFO) << "Write HDR1DATA (" << HDR1DATA << ")\n";
-        size_t offsetData = writer.getOffset(SPLIT_SEQS);
-        writer.writeStart(SPLIT_SEQS);
-        for(size_t fileIdx = 0; fileIdx < hdbr1->getDataFileCnt(); fileIdx++) {
-            writer.writeAdd(hdbr1->getDataForFile(fileIdx), hdbr1->getDataSizeForFile(fileIdx), SPLIT_SEQS);
-        }
-        writer.writeEnd(HDR1DATA, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-        free(data);
+        Debug(Debug::INFO) << "Write HDR1INDEX (" << HDR1INDEX << ") and HDR1DATA (" << HDR1DATA << ")\n";
+        offsets = writeDbSections(writer, sections, hdbr1, HDR1INDEX, HDR1DATA, SPLIT_SEQS);
+        const size_t offsetDictionary = writeDictionarySection(writer, sections, hdbr1, HDR1DICT, SPLIT_SEQS);
         if (hdbr2 == NULL) {
-            writer.writeIndexEntry(HDR2INDEX, offsetIndex, DBReader<unsigned int>::indexMemorySize(*hdbr1)+1, SPLIT_SEQS);
-            writer.writeIndexEntry(HDR2DATA,  offsetData, hdbr1->getTotalDataSize()+1, SPLIT_SEQS);
+            writeAliasSection(writer, sections, HDR2INDEX, HDR1INDEX, offsets.first, SPLIT_SEQS);
+            writeAliasSection(writer, sections, HDR2DATA, HDR1DATA, offsets.second, SPLIT_SEQS);
+            if (offsetDictionary != SIZE_MAX) {
+                writeAliasSection(writer, sections, HDR2DICT, HDR1DICT, offsetDictionary, SPLIT_SEQS);
+            }
         }
     }
     if (hdbr2 != NULL) {
-        Debug(Debug::INFO) << "Write HDR2INDEX (" << HDR2INDEX << ")\n";
-        data = DBReader<unsigned int>::serialize(*hdbr2);
-        writer.writeData(data, DBReader<unsigned int>::indexMemorySize(*hdbr2), HDR2INDEX, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-        Debug(Debug::INFO) << "Write HDR2DATA (" << HDR2DATA << ")\n";
-        writer.writeStart(SPLIT_SEQS);
-        for(size_t fileIdx = 0; fileIdx < hdbr2->getDataFileCnt(); fileIdx++) {
-            writer.writeAdd(hdbr2->getDataForFile(fileIdx), hdbr2->getDataSizeForFile(fileIdx), SPLIT_SEQS);
-        }
-        writer.writeEnd(HDR2DATA, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-        free(data);
+        Debug(Debug::INFO) << "Write HDR2INDEX (" << HDR2INDEX << ") and HDR2DATA (" << HDR2DATA << ")\n";
+        writeDbSections(writer, sections, hdbr2, HDR2INDEX, HDR2DATA, SPLIT_SEQS);
+        writeDictionarySection(writer, sections, hdbr2, HDR2DICT, SPLIT_SEQS);
     }
     if (alndbr != NULL) {
-        Debug(Debug::INFO) << "Write ALNINDEX (" << ALNINDEX << ")\n";
-        data = DBReader<unsigned int>::serialize(*alndbr);
-        writer.writeData(data, DBReader<unsigned int>::indexMemorySize(*alndbr), ALNINDEX, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-        Debug(Debug::INFO) << "Write ALNDATA (" << ALNDATA << ")\n";
-        writer.writeStart(SPLIT_SEQS);
-        for(size_t fileIdx = 0; fileIdx < alndbr->getDataFileCnt(); fileIdx++) {
-            writer.writeAdd(alndbr->getDataForFile(fileIdx), alndbr->getDataSizeForFile(fileIdx), SPLIT_SEQS);
-        }
-        writer.writeEnd(ALNDATA, SPLIT_SEQS);
-        writer.alignToPageSize(SPLIT_SEQS);
-        free(data);
+        Debug(Debug::INFO) << "Write ALNINDEX (" << ALNINDEX << ") and ALNDATA (" << ALNDATA << ")\n";
+        writeDbSections(writer, sections, alndbr, ALNINDEX, ALNDATA, SPLIT_SEQS);
     }
 
     Sequence seq(maxSeqLen, seqType, subMat, kmerSize, hasSpacedKmer, compBiasCorrection, true, spacedKmerPattern);
@@ -210,6 +276,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
             (Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_NUCLEOTIDES) || Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_AMINO_ACIDS))
                 ? alphabetSize -1: alphabetSize;
 
+    const EntryDuplicates duplicates(*dbr1, EntryDuplicates::isDeduplicated(dbr1->getDbtype()));
     for (int s = 0; s < splits; s++) {
         size_t dbFrom = 0;
         size_t dbSize = 0;
@@ -223,7 +290,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         IndexBuilder::fillDatabase(&indexTable,
                                    (maskMode == 1 || maskLowerCase == 1) ? &sequenceLookup : NULL,
                                    (maskMode == 0 ) ? &sequenceLookup : NULL,
-                                   *subMat, &seq, dbr1, dbFrom, dbFrom + dbSize, kmerThr, maskMode, maskLowerCase, maskProb);
+                                   *subMat, &seq, dbr1, dbFrom, dbFrom + dbSize, kmerThr, maskMode, maskLowerCase, maskProb, maxKmerAbundance, &duplicates);
         indexTable.printStatistics(subMat->num2aa);
 
         if (sequenceLookup == NULL) {
@@ -236,49 +303,53 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         Debug(Debug::INFO) << "Write ENTRIES (" << (keyOffset + ENTRIES) << ")\n";
         char *entries = (char *) indexTable.getEntries();
         size_t entriesSize = indexTable.getTableEntriesNum() * indexTable.getSizeOfEntry();
-        writer.writeData(entries, entriesSize, (keyOffset + ENTRIES), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writeSection(writer, sections, entries, entriesSize, (keyOffset + ENTRIES), SPLIT_INDX + s);
 
         // save the size
         Debug(Debug::INFO) << "Write ENTRIESOFFSETS (" << (keyOffset + ENTRIESOFFSETS) << ")\n";
         char *offsets = (char*)indexTable.getOffsets();
         size_t offsetsSize = (indexTable.getTableSize() + 1) * sizeof(size_t);
-        writer.writeData(offsets, offsetsSize, (keyOffset + ENTRIESOFFSETS), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writeSection(writer, sections, offsets, offsetsSize, (keyOffset + ENTRIESOFFSETS), SPLIT_INDX + s);
+
+        if (indexTable.getCappedKmerCount() > 0) {
+            Debug(Debug::INFO) << "Write KMERABUNDANCE (" << (keyOffset + KMERABUNDANCE) << ")\n";
+            char *cappedKmers = (char *) indexTable.getCappedKmers();
+            size_t cappedKmersSize = indexTable.getCappedKmerCount() * sizeof(IndexKmerAbundance);
+            writeSection(writer, sections, cappedKmers, cappedKmersSize, (keyOffset + KMERABUNDANCE), SPLIT_INDX + s);
+        }
         indexTable.deleteEntries();
 
         Debug(Debug::INFO) << "Write SEQINDEXDATASIZE (" << (keyOffset + SEQINDEXDATASIZE) << ")\n";
         int64_t seqindexDataSize = sequenceLookup->getDataSize();
         char *seqindexDataSizePtr = (char *) &seqindexDataSize;
-        writer.writeData(seqindexDataSizePtr, 1 * sizeof(int64_t), (keyOffset + SEQINDEXDATASIZE), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writeSection(writer, sections, seqindexDataSizePtr, 1 * sizeof(int64_t), (keyOffset + SEQINDEXDATASIZE), SPLIT_INDX + s);
 
         size_t *sequenceOffsets = sequenceLookup->getOffsets();
         size_t sequenceCount = sequenceLookup->getSequenceCount();
         Debug(Debug::INFO) << "Write SEQINDEXSEQOFFSET (" << (keyOffset + SEQINDEXSEQOFFSET) << ")\n";
-        writer.writeData((char *) sequenceOffsets, (sequenceCount + 1) * sizeof(size_t), (keyOffset + SEQINDEXSEQOFFSET), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writeSection(writer, sections, (char *) sequenceOffsets, (sequenceCount + 1) * sizeof(size_t), (keyOffset + SEQINDEXSEQOFFSET), SPLIT_INDX + s);
 
         Debug(Debug::INFO) << "Write SEQINDEXDATA (" << (keyOffset + SEQINDEXDATA) << ")\n";
-        writer.writeData(sequenceLookup->getData(), (sequenceLookup->getDataSize() + 1) * sizeof(char), (keyOffset + SEQINDEXDATA), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writeSection(writer, sections, sequenceLookup->getData(), (sequenceLookup->getDataSize() + 1) * sizeof(char), (keyOffset + SEQINDEXDATA), SPLIT_INDX + s);
         delete sequenceLookup;
 
         // ENTRIESNUM
         Debug(Debug::INFO) << "Write ENTRIESNUM (" << (keyOffset + ENTRIESNUM) << ")\n";
         uint64_t entriesNum = indexTable.getTableEntriesNum();
         char *entriesNumPtr = (char *) &entriesNum;
-        writer.writeData(entriesNumPtr, 1 * sizeof(uint64_t), (keyOffset + ENTRIESNUM), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writeSection(writer, sections, entriesNumPtr, 1 * sizeof(uint64_t), (keyOffset + ENTRIESNUM), SPLIT_INDX + s);
 
         // SEQCOUNT
         Debug(Debug::INFO) << "Write SEQCOUNT (" << (keyOffset + SEQCOUNT) << ")\n";
         size_t tablesize = indexTable.getSize();
         char *tablesizePtr = (char *) &tablesize;
-        writer.writeData(tablesizePtr, 1 * sizeof(size_t), (keyOffset + SEQCOUNT), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writeSection(writer, sections, tablesizePtr, 1 * sizeof(size_t), (keyOffset + SEQCOUNT), SPLIT_INDX + s);
     }
 
+    Debug(Debug::INFO) << "Write SECTIONS (" << SECTIONS << ")\n";
+    writer.writeData((char *) sections.data(), sections.size() * sizeof(PrefilteringIndexSection), SECTIONS, SPLIT_META);
+    writer.alignToPageSize(SPLIT_META);
+
     writer.close(false);
 }
 
@@ -304,6 +375,11 @@ DBReader<unsigned int> *PrefilteringIndexReader::openNewHeaderReader(DBReader<un
     reader->open(DBReader<unsigned int>::NOSORT);
     reader->setData(data, dataSize);
     reader->setMode(DBReader<unsigned int>::USE_DATA);
+
+    size_t dictionaryId = dbr->getId(dataIdx == HDR2DATA ? HDR2DICT : HDR1DICT);
+    if (dictionaryId != UINT_MAX) {
+        reader->setDictionary(dbr->getData(dictionaryId, 0), dbr->getEntryLen(dictionaryId) - 1);
+    }
     return reader;
 }
 
@@ -364,6 +440,9 @@ SequenceLookup *PrefilteringIndexReader::getSequenceLookup(unsigned int split, D
     size_t sequenceCount = *((size_t *)dbr->getDataUncompressed(sequenceCountId));
 
     if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
+        // the sections are read completely for the copy, checking them costs little on top
+        verifySection(dbr, id);
+        verifySection(dbr, seqOffsetsId);
         SequenceLookup *sequenceLookup = new SequenceLookup(sequenceCount, seqDataSize);
         sequenceLookup->initLookupByExternalDataCopy(seqData, (size_t *) seqOffsetsData);
         return sequenceLookup;
@@ -405,9 +484,24 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
         adjustAlphabetSize = data.alphabetSize;
     }
 
+    // only written if k-mers were down-sampled
+    size_t kmerAbundanceId = dbr->getId(splitOffset + KMERABUNDANCE);
+    IndexKmerAbundance *kmerAbundanceData = NULL;
+    size_t kmerAbundanceCount = 0;
+    if (kmerAbundanceId != UINT_MAX) {
+        kmerAbundanceData = (IndexKmerAbundance *) dbr->getDataUncompressed(kmerAbundanceId);
+        kmerAbundanceCount = (dbr->getEntryLen(kmerAbundanceId) - 1) / sizeof(IndexKmerAbundance);
+    }
+
     if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
+        verifySection(dbr, entriesDataId);
+        verifySection(dbr, entriesOffsetsDataId);
         IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, false);
         table->initTableByExternalDataCopy(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+        if (kmerAbundanceId != UINT_MAX) {
+            verifySection(dbr, kmerAbundanceId);
+            table->initKmerAbundance(kmerAbundanceData, kmerAbundanceCount, true);
+        }
         return table;
     }
 
@@ -420,6 +514,9 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
 
     IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, true);
     table->initTableByExternalData(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+    if (kmerAbundanceId != UINT_MAX) {
+        table->initKmerAbundance(kmerAbundanceData, kmerAbundanceCount, false);
+    }
     return table;
 }
 
@@ -480,6 +577,9 @@ PrefilteringIndexData PrefilteringIndexReader::getMetadata(DBReader<unsigned int
     data.headers2 = meta[10];
     // Keep compatible to index version 15, where meta[11] would have been zero due to the alignment padding
     data.splits = meta[11] == 0 ? 1 : meta[11];
+    // older indices were written without the abundance cap
+    const size_t metaSize = dbr->getEntryLen(dbr->getId(META)) - 1;
+    data.maxKmerAbundance = metaSize >= 13 * sizeof(int) ? meta[12] : 0;
 
     return data;
 }
@@ -532,6 +632,7 @@ ScoreMatrix PrefilteringIndexReader::get2MerScoreMatrix(DBReader<unsigned int> *
 
     char *data = dbr->getDataUncompressed(id);
     if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
+        verifySection(dbr, id);
         return ScoreMatrix::unserializeCopy(data, meta.alphabetSize-1, 2);
     }
 
@@ -552,6 +653,7 @@ ScoreMatrix PrefilteringIndexReader::get3MerScoreMatrix(DBReader<unsigned int> *
 
     char *data = dbr->getDataUncompressed(id);
     if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
+        verifySection(dbr, id);
         return ScoreMatrix::unserializeCopy(data, meta.alphabetSize-1, 3);
     }
 
@@ -5,6 +5,7 @@
 #include "IndexTable.h"
 #include "DBReader.h"
 #include <string>
+#include <stdint.h>
 
 struct PrefilteringIndexData {
     int maxSeqLength;
@@ -19,6 +20,14 @@ struct PrefilteringIndexData {
     int headers1;
     int headers2;
     int splits;
+    int maxKmerAbundance;
+};
+
+// entry of the table of contents (SECTIONS), size excludes the terminating null byte of the entry
+struct PrefilteringIndexSection {
+    uint64_t key;
+    uint64_t size;
+    uint64_t checksum;
 };
 
 
@@ -46,10 +55,14 @@ public:
     static unsigned int HDR1DATA;
     static unsigned int HDR2INDEX;
     static unsigned int HDR2DATA;
+    static unsigned int HDR1DICT;
+    static unsigned int HDR2DICT;
+    static unsigned int KMERABUNDANCE;
     static unsigned int GENERATOR;
     static unsigned int SPACEDPATTERN;
     static unsigned int ALNINDEX;
     static unsigned int ALNDATA;
+    static unsigned int SECTIONS;
 
     static bool checkIfIndexFile(DBReader<unsigned int> *reader);
     static std::string indexName(const std::string &outDB);
@@ -59,7 +72,8 @@ public:
                                 DBReader<unsigned int> *hdbr1, DBReader<unsigned int> *hdbr2,
                                 DBReader<unsigned int> *alndbr,
                                 BaseMatrix *seedSubMat, int maxSeqLen, bool spacedKmer, const std::string &spacedKmerPattern,
-                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int maskLowerCase, float maskProb, int kmerThr, int splits);
+                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int maskLowerCase, float maskProb, int kmerThr, int splits,
+                                int maxKmerAbundance);
 
     static DBReader<unsigned int> *openNewHeaderReader(DBReader<unsigned int>*dbr, unsigned int dataIdx, unsigned int indexIdx, int threads, bool touchIndex, bool touchData);
 
@@ -89,6 +103,10 @@ public:
 
 private:
     static void printMeta(int *meta);
+
+    static bool checkSections(DBReader<unsigned int> *dbr);
+
+    static void verifySection(DBReader<unsigned int> *dbr, size_t id);
 };
 
 #endif
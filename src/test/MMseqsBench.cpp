@@ -0,0 +1,531 @@
+// mmseqs-bench: synthetic data, kernel microbenchmarks and end-to-end stage timings
+// Results are written as JSON so that runs on the same machine can be compared across commits.
+//
+// mmseqs-bench generate <o:fastaFile> [options]
+// mmseqs-bench micro <tmpDir> [options]
+// mmseqs-bench stages <mmseqsBinary> <tmpDir> [options]
+#include "Parameters.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "ExtendedSubstitutionMatrix.h"
+#include "KmerGenerator.h"
+#include "CacheFriendlyOperations.h"
+#include "IndexTable.h"
+#include "SequenceLookup.h"
+#include "UngappedAlignment.h"
+#include "Matcher.h"
+#include "EvalueComputation.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+#include "Timer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+const char* binary_name = "mmseqs-bench";
+extern const char* version;
+
+struct BenchOptions {
+    bool nucleotide = false;
+    size_t families = 200;
+    size_t members = 5;
+    size_t queriesPerFamily = 1;
+    float identity = 0.7f;
+    float indelRate = 0.02f;
+    double lengthMean = 300.0;
+    double lengthSd = 100.0;
+    size_t minLength = 30;
+    unsigned int seed = 1;
+    unsigned int threads = 1;
+    double minTime = 1.0;
+    std::string json;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string type;
+    size_t iterations;
+    double seconds;
+    size_t items;
+    std::string unit;
+};
+
+struct SyntheticDb {
+    std::vector<std::string> names;
+    std::vector<std::string> sequences;
+    std::vector<size_t> family;
+};
+
+// Generates families of homologous sequences. Each family has a random root sequence with a length drawn
+// from a log-normal distribution. Members are copies of the root with (1 - identity) substitutions and
+// indels at the given rate.
+class SyntheticGenerator {
+public:
+    SyntheticGenerator(const BenchOptions &opt, unsigned int seed) : opt(opt), rng(seed), unit(0.0, 1.0) {
+        if (opt.nucleotide) {
+            alphabet = "ACGT";
+            cumulative = {0.25, 0.5, 0.75, 1.0};
+        } else {
+            // Robinson & Robinson background frequencies
+            alphabet = "ARNDCQEGHILKMFPSTWYV";
+            const double freq[20] = {0.07805, 0.05129, 0.04487, 0.05364, 0.01925, 0.04264, 0.06295,
+                                     0.07377, 0.02199, 0.05142, 0.09019, 0.05744, 0.02243, 0.03856,
+                                     0.05203, 0.07120, 0.05841, 0.01330, 0.03216, 0.06441};
+            double sum = 0.0;
+            for (size_t i = 0; i < 20; ++i) {
+                sum += freq[i];
+            }
+            double acc = 0.0;
+            for (size_t i = 0; i < 20; ++i) {
+                acc += freq[i] / sum;
+                cumulative.push_back(acc);
+            }
+            cumulative.back() = 1.0;
+        }
+        const double variance = std::log(1.0 + (opt.lengthSd * opt.lengthSd) / (opt.lengthMean * opt.lengthMean));
+        length = std::lognormal_distribution<double>(std::log(opt.lengthMean) - variance / 2.0, std::sqrt(variance));
+    }
+
+    char residue() {
+        const double r = unit(rng);
+        for (size_t i = 0; i < cumulative.size(); ++i) {
+            if (r < cumulative[i]) {
+                return alphabet[i];
+            }
+        }
+        return alphabet[alphabet.size() - 1];
+    }
+
+    std::string root() {
+        const size_t len = std::max(opt.minLength, static_cast<size_t>(length(rng)));
+        std::string seq(len, 'A');
+        for (size_t i = 0; i < len; ++i) {
+            seq[i] = residue();
+        }
+        return seq;
+    }
+
+    std::string mutate(const std::string &parent) {
+        std::string child;
+        child.reserve(parent.size() + 16);
+        for (size_t i = 0; i < parent.size(); ++i) {
+            const double r = unit(rng);
+            if (r < opt.indelRate / 2.0) {
+                continue;
+            }
+            if (r < opt.indelRate) {
+                child.push_back(residue());
+            }
+            child.push_back(unit(rng) < opt.identity ? parent[i] : residue());
+        }
+        if (child.empty()) {
+            child.push_back(residue());
+        }
+        return child;
+    }
+
+    void generate(SyntheticDb &targets, SyntheticDb *queries) {
+        for (size_t f = 0; f < opt.families; ++f) {
+            const std::string familyRoot = root();
+            for (size_t m = 0; m < opt.members; ++m) {
+                targets.names.push_back("fam" + SSTR(f) + "_mem" + SSTR(m));
+                targets.sequences.push_back(mutate(familyRoot));
+                targets.family.push_back(f);
+            }
+            if (queries == NULL) {
+                continue;
+            }
+            for (size_t q = 0; q < opt.queriesPerFamily; ++q) {
+                queries->names.push_back("fam" + SSTR(f) + "_query" + SSTR(q));
+                queries->sequences.push_back(mutate(familyRoot));
+                queries->family.push_back(f);
+            }
+        }
+    }
+
+private:
+    const BenchOptions &opt;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> unit;
+    std::lognormal_distribution<double> length;
+    std::string alphabet;
+    std::vector<double> cumulative;
+};
+
+static void writeFasta(const std::string &file, const SyntheticDb &db) {
+    FILE *handle = FileUtil::openFileOrDie(file.c_str(), "w", false);
+    for (size_t i = 0; i < db.sequences.size(); ++i) {
+        fprintf(handle, ">%s\n", db.names[i].c_str());
+        for (size_t pos = 0; pos < db.sequences[i].size(); pos += 80) {
+            fprintf(handle, "%s\n", db.sequences[i].substr(pos, 80).c_str());
+        }
+    }
+    if (fclose(handle) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << file << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+// repeats the kernel until minTime passed, the kernel returns the number of processed items
+static BenchResult measure(const std::string &name, const std::string &unit, double minTime, const std::function<size_t()> &kernel) {
+    BenchResult result;
+    result.name = name;
+    result.type = "micro";
+    result.unit = unit;
+    result.iterations = 0;
+    result.items = 0;
+    // warm up caches and allocations
+    kernel();
+    Timer timer;
+    do {
+        result.items += kernel();
+        result.iterations++;
+        result.seconds = timer.getTimediff();
+    } while (result.seconds < minTime);
+    Debug(Debug::INFO) << name << ": " << (result.items / result.seconds) << " " << unit << "/s\n";
+    return result;
+}
+
+static void runMicro(const std::string &tmpDir, const BenchOptions &opt, std::vector<BenchResult> &results) {
+    if (opt.nucleotide) {
+        Debug(Debug::WARNING) << "Kernel benchmarks use amino acid sequences\n";
+    }
+    BenchOptions aaOpt = opt;
+    aaOpt.nucleotide = false;
+    SyntheticGenerator generator(aaOpt, opt.seed);
+    SyntheticDb db;
+    generator.generate(db, NULL);
+    size_t maxLen = 0;
+    size_t residues = 0;
+    for (size_t i = 0; i < db.sequences.size(); ++i) {
+        maxLen = std::max(maxLen, db.sequences[i].size());
+        residues += db.sequences[i].size();
+    }
+    maxLen += 1;
+
+    Parameters &par = Parameters::getInstance();
+    par.initMatrices();
+    const int kmerSize = 6;
+    SubstitutionMatrix kmerSubMat(par.seedScoringMatrixFile.values.aminoacid().c_str(), 8.0, -0.2f);
+    SubstitutionMatrix alnSubMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, par.scoreBias);
+
+    std::vector<Sequence *> sequences(db.sequences.size());
+    for (size_t i = 0; i < db.sequences.size(); ++i) {
+        sequences[i] = new Sequence(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &kmerSubMat, kmerSize, false, false);
+        sequences[i]->mapSequence(i, i, db.sequences[i].c_str(), db.sequences[i].size());
+    }
+
+    // k-mer generation: similar k-mer lists for every position
+    {
+        ScoreMatrix two = ExtendedSubstitutionMatrix::calcScoreMatrix(kmerSubMat, 2);
+        ScoreMatrix three = ExtendedSubstitutionMatrix::calcScoreMatrix(kmerSubMat, 3);
+        // k-mer score threshold of -s 5.7 with k = 6
+        KmerGenerator kmerGenerator(kmerSize, kmerSubMat.alphabetSize, 112);
+        kmerGenerator.setDivideStrategy(&three, &two);
+        Sequence seq(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &kmerSubMat, kmerSize, false, false);
+        const size_t count = std::min(db.sequences.size(), static_cast<size_t>(50));
+        results.push_back(measure("kmer_generation", "kmers", opt.minTime, [&]() {
+            size_t kmers = 0;
+            for (size_t i = 0; i < count; ++i) {
+                seq.mapSequence(i, i, db.sequences[i].c_str(), db.sequences[i].size());
+                while (seq.hasNextKmer()) {
+                    kmerGenerator.generateKmerList(seq.nextKmer());
+                    kmers++;
+                }
+            }
+            return kmers;
+        }));
+        ExtendedSubstitutionMatrix::freeScoreMatrix(three);
+        ExtendedSubstitutionMatrix::freeScoreMatrix(two);
+    }
+
+    // diagonal counting: k-mer hits of one query grouped by target and diagonal
+    {
+        const size_t positions = 500;
+        const size_t hitsPerPosition = 200;
+        std::mt19937 rng(opt.seed);
+        std::vector<IndexEntryLocal> hits(positions * hitsPerPosition);
+        for (size_t i = 0; i < hits.size(); ++i) {
+            hits[i].seqId = rng() % db.sequences.size();
+            hits[i].position_j = rng() % 1000;
+        }
+        std::vector<IndexEntryLocal *> hitsByPosition(positions + 1);
+        for (size_t i = 0; i <= positions; ++i) {
+            hitsByPosition[i] = hits.data() + i * hitsPerPosition;
+        }
+        std::vector<CounterResult> output(hits.size());
+        CacheFriendlyOperations<2048> counter(db.sequences.size(), hits.size() / 2048);
+        results.push_back(measure("diagonal_counting", "hits", opt.minTime, [&]() {
+            counter.findDuplicates(hitsByPosition.data(), output.data(), output.size(), 0, positions - 1, true);
+            return hits.size();
+        }));
+    }
+
+    // ungapped alignment of the first sequence against all targets on the main diagonal
+    {
+        SequenceLookup lookup(db.sequences.size(), residues);
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            lookup.addSequence(sequences[i]);
+        }
+        UngappedAlignment ungapped(maxLen, &kmerSubMat, &lookup);
+        std::vector<CounterResult> hits(db.sequences.size());
+        std::vector<float> compositionBias(maxLen);
+        SubstitutionMatrix::calcLocalAaBiasCorrection(&kmerSubMat, sequences[0]->numSequence, sequences[0]->L, compositionBias.data(), 1.0);
+        results.push_back(measure("ungapped", "cells", opt.minTime, [&]() {
+            for (size_t i = 0; i < hits.size(); ++i) {
+                hits[i].id = i;
+                hits[i].diagonal = 0;
+                hits[i].count = 0;
+            }
+            ungapped.processQuery(sequences[0], compositionBias.data(), hits.data(), hits.size());
+            return static_cast<size_t>(sequences[0]->L) * db.sequences.size();
+        }));
+    }
+
+    // striped Smith-Waterman score and with traceback against the query's family members
+    {
+        EvalueComputation evaluer(residues, &alnSubMat, par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid());
+        Matcher matcher(Parameters::DBTYPE_AMINO_ACIDS, Parameters::DBTYPE_AMINO_ACIDS, maxLen, &alnSubMat, &evaluer, par.compBiasCorrection, par.compBiasCorrectionScale,
+                        par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid(), 0.0, par.zdrop);
+        Sequence query(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &alnSubMat, 0, false, par.compBiasCorrection);
+        Sequence target(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &alnSubMat, 0, false, par.compBiasCorrection);
+        query.mapSequence(0, 0, db.sequences[0].c_str(), db.sequences[0].size());
+        matcher.initQuery(&query);
+        const size_t count = std::min(db.sequences.size(), static_cast<size_t>(100));
+        const unsigned int modes[2] = {Matcher::SCORE_ONLY, Matcher::SCORE_COV_SEQID};
+        const char *names[2] = {"striped_sw", "traceback"};
+        for (size_t m = 0; m < 2; ++m) {
+            results.push_back(measure(names[m], "cells", opt.minTime, [&]() {
+                size_t cells = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    target.mapSequence(i, i, db.sequences[i].c_str(), db.sequences[i].size());
+                    matcher.getSWResult(&target, INT_MAX, false, 0, 0.0, FLT_MAX, modes[m], Parameters::SEQ_ID_ALN_LEN, false);
+                    cells += static_cast<size_t>(query.L) * target.L;
+                }
+                return cells;
+            }));
+        }
+    }
+
+    // DB write and read, plain and compressed
+    const std::string dbName = tmpDir + "/bench_db";
+    const int compressedModes[2] = {0, 1};
+    const char *writeNames[2] = {"db_write", "db_write_compressed"};
+    const char *readNames[2] = {"db_read", "db_read_compressed"};
+    for (size_t c = 0; c < 2; ++c) {
+        results.push_back(measure(writeNames[c], "bytes", opt.minTime, [&]() {
+            // silence the merge message of every iteration
+            const int debugLevel = Debug::debugLevel;
+            Debug::setDebugLevel(Debug::WARNING);
+            DBWriter writer(dbName.c_str(), (dbName + ".index").c_str(), 1, compressedModes[c], Parameters::DBTYPE_AMINO_ACIDS);
+            writer.open();
+            for (size_t i = 0; i < db.sequences.size(); ++i) {
+                writer.writeData(db.sequences[i].c_str(), db.sequences[i].size(), i, 0);
+            }
+            writer.close(true);
+            Debug::setDebugLevel(debugLevel);
+            return residues;
+        }));
+        results.push_back(measure(readNames[c], "bytes", opt.minTime, [&]() {
+            DBReader<unsigned int> reader(dbName.c_str(), (dbName + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+            reader.open(DBReader<unsigned int>::NOSORT);
+            size_t bytes = 0;
+            for (size_t i = 0; i < reader.getSize(); ++i) {
+                const char *data = reader.getData(i, 0);
+                bytes += strlen(data);
+            }
+            reader.close();
+            return bytes;
+        }));
+    }
+    FileUtil::remove(dbName.c_str());
+    FileUtil::remove((dbName + ".index").c_str());
+    FileUtil::remove((dbName + ".dbtype").c_str());
+
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        delete sequences[i];
+    }
+}
+
+static void runStages(const std::string &mmseqs, const std::string &tmpDir, const BenchOptions &opt, std::vector<BenchResult> &results) {
+    if (opt.nucleotide) {
+        Debug(Debug::ERROR) << "Stage benchmarks only support amino acid sequences\n";
+        EXIT(EXIT_FAILURE);
+    }
+    SyntheticGenerator generator(opt, opt.seed);
+    SyntheticDb targets;
+    SyntheticDb queries;
+    generator.generate(targets, &queries);
+    writeFasta(tmpDir + "/targets.fasta", targets);
+    writeFasta(tmpDir + "/queries.fasta", queries);
+    size_t residues = 0;
+    for (size_t i = 0; i < targets.sequences.size(); ++i) {
+        residues += targets.sequences[i].size();
+    }
+
+    const std::string t = tmpDir + "/";
+    const std::string common = " --threads " + SSTR(opt.threads) + " -v 1";
+    struct Stage {
+        const char *name;
+        std::string args;
+        size_t items;
+        const char *unit;
+    };
+    const Stage stages[] = {
+        {"createdb", "createdb " + t + "targets.fasta " + t + "targetDB -v 1", residues, "residues"},
+        {"createdb_query", "createdb " + t + "queries.fasta " + t + "queryDB -v 1", queries.sequences.size(), "sequences"},
+        {"createindex", "createindex " + t + "targetDB " + t + "tmp" + common, residues, "residues"},
+        {"prefilter", "prefilter " + t + "queryDB " + t + "targetDB " + t + "prefDB" + common, queries.sequences.size(), "queries"},
+        {"align", "align " + t + "queryDB " + t + "targetDB " + t + "prefDB " + t + "alnDB" + common, queries.sequences.size(), "queries"},
+        {"convertalis", "convertalis " + t + "queryDB " + t + "targetDB " + t + "alnDB " + t + "aln.m8" + common, queries.sequences.size(), "queries"},
+        {"cluster", "cluster " + t + "targetDB " + t + "cluDB " + t + "tmp" + common, targets.sequences.size(), "sequences"},
+        {"linclust", "linclust " + t + "targetDB " + t + "linDB " + t + "tmp" + common, targets.sequences.size(), "sequences"},
+    };
+    for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); ++i) {
+        const std::string cmd = mmseqs + " " + stages[i].args;
+        Timer timer;
+        const int status = system(cmd.c_str());
+        const double seconds = timer.getTimediff();
+        if (status != 0) {
+            Debug(Debug::ERROR) << "Stage " << stages[i].name << " failed: " << cmd << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        BenchResult result;
+        result.name = stages[i].name;
+        result.type = "stage";
+        result.iterations = 1;
+        result.seconds = seconds;
+        result.items = stages[i].items;
+        result.unit = stages[i].unit;
+        results.push_back(result);
+        Debug(Debug::INFO) << stages[i].name << ": " << seconds << "s\n";
+    }
+}
+
+static std::string jsonEscape(const std::string &in) {
+    std::string out;
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '"' || in[i] == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(in[i]);
+    }
+    return out;
+}
+
+static void writeJson(const std::string &mode, const BenchOptions &opt, const std::vector<BenchResult> &results) {
+    FILE *out = opt.json.empty() ? stdout : FileUtil::openFileOrDie(opt.json.c_str(), "w", false);
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": \"%s\",\n", jsonEscape(version).c_str());
+    fprintf(out, "  \"mode\": \"%s\",\n", mode.c_str());
+    fprintf(out, "  \"timestamp\": %lld,\n", static_cast<long long>(time(NULL)));
+    fprintf(out, "  \"threads\": %u,\n", opt.threads);
+    fprintf(out, "  \"seed\": %u,\n", opt.seed);
+    fprintf(out, "  \"families\": %zu,\n", opt.families);
+    fprintf(out, "  \"members\": %zu,\n", opt.members);
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"type\": \"%s\", \"iterations\": %zu, \"seconds\": %.6f, \"items\": %zu, \"unit\": \"%s\", \"throughput\": %.3f}%s\n",
+                jsonEscape(r.name).c_str(), r.type.c_str(), r.iterations, r.seconds, r.items, r.unit.c_str(),
+                r.seconds > 0 ? r.items / r.seconds : 0.0, (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout && fclose(out) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << opt.json << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+static void usage() {
+    Debug(Debug::INFO) << "usage: mmseqs-bench generate <o:fastaFile> [options]\n"
+                          "       mmseqs-bench micro <tmpDir> [options]\n"
+                          "       mmseqs-bench stages <mmseqsBinary> <tmpDir> [options]\n\n"
+                          "options:\n"
+                          "  --nucleotide          generate nucleotide instead of amino acid sequences\n"
+                          "  --families INT        number of sequence families [200]\n"
+                          "  --members INT         sequences per family [5]\n"
+                          "  --queries INT         queries per family for stages [1]\n"
+                          "  --identity FLOAT      identity of members to the family root [0.7]\n"
+                          "  --indel-rate FLOAT    insertion and deletion rate per residue [0.02]\n"
+                          "  --length-mean FLOAT   mean of the log-normal length distribution [300]\n"
+                          "  --length-sd FLOAT     standard deviation of the length distribution [100]\n"
+                          "  --min-length INT      minimum sequence length [30]\n"
+                          "  --seed INT            random seed [1]\n"
+                          "  --threads INT         threads for stages [1]\n"
+                          "  --min-time FLOAT      minimum seconds per kernel benchmark [1]\n"
+                          "  --json FILE           write results to file instead of stdout\n";
+}
+
+int main(int argc, const char **argv) {
+    std::vector<std::string> positional;
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--nucleotide") {
+            opt.nucleotide = true;
+        } else if (arg == "--families" && hasValue) {
+            opt.families = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--members" && hasValue) {
+            opt.members = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--queries" && hasValue) {
+            opt.queriesPerFamily = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--identity" && hasValue) {
+            opt.identity = strtof(argv[++i], NULL);
+        } else if (arg == "--indel-rate" && hasValue) {
+            opt.indelRate = strtof(argv[++i], NULL);
+        } else if (arg == "--length-mean" && hasValue) {
+            opt.lengthMean = strtod(argv[++i], NULL);
+        } else if (arg == "--length-sd" && hasValue) {
+            opt.lengthSd = strtod(argv[++i], NULL);
+        } else if (arg == "--min-length" && hasValue) {
+            opt.minLength = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--seed" && hasValue) {
+            opt.seed = strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--threads" && hasValue) {
+            opt.threads = std::max(1ul, strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--min-time" && hasValue) {
+            opt.minTime = strtod(argv[++i], NULL);
+        } else if (arg == "--json" && hasValue) {
+            opt.json = argv[++i];
+        } else if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-') {
+            Debug(Debug::ERROR) << "Unknown option " << arg << "\n";
+            usage();
+            return EXIT_FAILURE;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (opt.families == 0 || opt.members == 0 || opt.lengthMean <= 0.0 || opt.lengthSd < 0.0) {
+        Debug(Debug::ERROR) << "--families, --members and --length-mean have to be positive\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<BenchResult> results;
+    if (positional.size() == 2 && positional[0] == "generate") {
+        SyntheticGenerator generator(opt, opt.seed);
+        SyntheticDb db;
+        generator.generate(db, NULL);
+        writeFasta(positional[1], db);
+        return EXIT_SUCCESS;
+    } else if (positional.size() == 2 && positional[0] == "micro") {
+        runMicro(positional[1], opt, results);
+    } else if (positional.size() == 3 && positional[0] == "stages") {
+        runStages(positional[1], positional[2], opt, results);
+    } else {
+        usage();
+        return EXIT_FAILURE;
+    }
+    writeJson(positional[0], opt, results);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstdlib>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_dbreaderlongkeys";
+
+// writes sparse keys on both sides of 2^32 with two writer threads, so that the index merge sees them too,
+// and reads them back by key
+int main (int, const char**) {
+    std::vector<size_t> keys;
+    keys.push_back(0);
+    keys.push_back(17);
+    keys.push_back(UINT_MAX - 1);
+    keys.push_back(UINT_MAX);
+    keys.push_back(static_cast<size_t>(UINT_MAX) + 1);
+    keys.push_back(static_cast<size_t>(UINT_MAX) + 4096);
+    keys.push_back(1ull << 33);
+    keys.push_back((1ull << 40) + 3);
+
+    DBWriter writer("longKeys", "longKeys.index", 2, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_GENERIC_DB);
+    writer.open();
+    // reverse order, the merged index has to be sorted by the 64-bit key
+    for (size_t i = keys.size(); i > 0; --i) {
+        std::string entry = "entry " + SSTR(keys[i - 1]) + "\n";
+        writer.writeData(entry.c_str(), entry.length(), keys[i - 1], i % 2);
+    }
+    writer.close();
+
+    int errors = 0;
+    DBReader<size_t> reader("longKeys", "longKeys.index", 1, DBReader<size_t>::USE_INDEX | DBReader<size_t>::USE_DATA);
+    reader.open(DBReader<size_t>::NOSORT);
+    if ((DBReader<size_t>::getExtendedDbtype(reader.getDbtype()) & Parameters::DBTYPE_EXTENDED_LONG_KEYS) == 0) {
+        std::cout << "Missing long key flag in dbtype" << std::endl;
+        errors++;
+    }
+    if (reader.getSize() != keys.size()) {
+        std::cout << "Expected " << keys.size() << " entries, found " << reader.getSize() << std::endl;
+        errors++;
+    }
+    for (size_t i = 0; i < keys.size() && i < reader.getSize(); ++i) {
+        std::string expected = "entry " + SSTR(keys[i]) + "\n";
+        size_t id = reader.getId(keys[i]);
+        if (reader.getDbKey(i) != keys[i] || id != i || expected != reader.getData(id, 0)) {
+            std::cout << "Key " << keys[i] << " did not survive the round trip" << std::endl;
+            errors++;
+        } else {
+            std::cout << keys[i] << "\t" << reader.getData(id, 0);
+        }
+    }
+    if (reader.getId(static_cast<size_t>(UINT_MAX) + 2) != UINT_MAX) {
+        std::cout << "Key that was not written was found" << std::endl;
+        errors++;
+    }
+    reader.close();
+
+    // keys that fit into 32 bits keep the dbtype readable by DBReader<unsigned int>
+    DBWriter shortWriter("shortKeys", "shortKeys.index", 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_GENERIC_DB);
+    shortWriter.open();
+    shortWriter.writeData("entry\n", 6, UINT_MAX, 0);
+    shortWriter.close();
+    DBReader<unsigned int> shortReader("shortKeys", "shortKeys.index", 1, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+    shortReader.open(DBReader<unsigned int>::NOSORT);
+    if (DBReader<unsigned int>::getExtendedDbtype(shortReader.getDbtype()) & Parameters::DBTYPE_EXTENDED_LONG_KEYS) {
+        std::cout << "32-bit keys were flagged as long keys" << std::endl;
+        errors++;
+    }
+    if (shortReader.getDbKey(0) != UINT_MAX) {
+        std::cout << "Key " << UINT_MAX << " did not survive the round trip" << std::endl;
+        errors++;
+    }
+    shortReader.close();
+
+    DBReader<size_t>::removeDb("longKeys");
+    DBReader<unsigned int>::removeDb("shortKeys");
+
+    std::cout << (errors == 0 ? "Round trip passed" : "Round trip failed") << std::endl;
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -13,11 +13,136 @@
 #include "Sequence.h"
 #include "SubstitutionMatrix.h"
 #include "MultipleAlignment.h"
+#include "CSProfile.h"
+#include "MathUtil.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
 
 const char* binary_name = "test_pssm";
 
+// straightforward double precision version of CSProfile::computeProfile, one state and one window position at a time
+std::vector<float> csProfileScalar(ContextLibrary *ctxLib, unsigned char *numSeq, int seqLen,
+                                   float *count, float *Neff_M, float pTau, float pca, float pcb) {
+    const size_t rowSize = Sequence::PROFILE_AA_SIZE + 4;
+    const int center = ctxLib->center;
+    std::vector<float> profile(seqLen * rowSize, 0.0f);
+    std::vector<double> pp(ctxLib->libSize);
+    for (int i = 0; i < seqLen; ++i) {
+        const int beg = std::max(0, i - center);
+        const int end = std::min(seqLen, i + center + 1);
+        double maximum = -DBL_MAX;
+        for (size_t k = 0; k < ctxLib->libSize; ++k) {
+            double score = ctxLib->bias_weight[k];
+            for (int l = beg; l < end; ++l) {
+                const float *weights = ctxLib->context_weights[k][l - i + center];
+                if (count != NULL) {
+                    for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+                        score += weights[a] * count[l * rowSize + a];
+                    }
+                } else {
+                    score += weights[numSeq[l]];
+                }
+            }
+            pp[k] = score;
+            maximum = std::max(maximum, score);
+        }
+        double sum = 0.0;
+        for (size_t k = 0; k < ctxLib->libSize; ++k) {
+            sum += exp(pp[k] - maximum);
+        }
+        double pc[Sequence::PROFILE_AA_SIZE] = { 0.0 };
+        for (size_t k = 0; k < ctxLib->libSize; ++k) {
+            const double posterior = exp(pp[k] - maximum) / sum;
+            for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+                pc[a] += posterior * ctxLib->pc[k][a];
+            }
+        }
+        double total = 0.0;
+        for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+            total += pc[a];
+        }
+        const double tau = (count != NULL) ? std::min(1.0, pca / (1.0 + Neff_M[i] / pcb)) : pTau;
+        double mixed[Sequence::PROFILE_AA_SIZE];
+        double mixedTotal = 0.0;
+        for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+            mixed[a] = tau * pc[a] / total;
+            if (count != NULL) {
+                mixed[a] += (1.0 - tau) * count[i * rowSize + a] / Neff_M[i];
+            } else if (numSeq[i] == a) {
+                mixed[a] += 1.0 - tau;
+            }
+            mixedTotal += mixed[a];
+        }
+        for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+            profile[i * rowSize + a] = mixed[a] / mixedTotal;
+        }
+    }
+    return profile;
+}
+
+float maxProfileDifference(const float *profile, const std::vector<float> &reference, int seqLen) {
+    const size_t rowSize = Sequence::PROFILE_AA_SIZE + 4;
+    float maxDiff = 0.0f;
+    for (int i = 0; i < seqLen; ++i) {
+        for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+            maxDiff = std::max(maxDiff, std::fabs(profile[i * rowSize + a] - reference[i * rowSize + a]));
+        }
+    }
+    return maxDiff;
+}
+
+// compares the vectorized context-specific pseudocounts against csProfileScalar, for sequences and for profiles
+bool compareCsProfile() {
+    const size_t rowSize = Sequence::PROFILE_AA_SIZE + 4;
+    // the vectorized version uses an approximate exp, its error is well below this
+    const float tolerance = 1e-4f;
+    ContextLibrary *ctxLib = ContextLibrary::getContextLibraryInstance();
+    const int lengths[] = { 1, 5, 63, 64, 65, 300, 2000 };
+    const int maxLen = 2000;
+    CSProfile csProfile(maxLen);
+    srand(1);
+    bool ok = true;
+    for (size_t n = 0; n < sizeof(lengths) / sizeof(lengths[0]); ++n) {
+        const int seqLen = lengths[n];
+        std::vector<unsigned char> numSeq(seqLen);
+        for (int i = 0; i < seqLen; ++i) {
+            // every 50th residue is an X
+            numSeq[i] = (i % 50 == 49) ? Sequence::PROFILE_AA_SIZE : rand() % Sequence::PROFILE_AA_SIZE;
+        }
+        std::vector<float> reference = csProfileScalar(ctxLib, numSeq.data(), seqLen, NULL, NULL, 0.9, 0.0, 0.0);
+        float diff = maxProfileDifference(csProfile.computeSequenceCs(numSeq.data(), seqLen, 0.9), reference, seqLen);
+        std::cout << "CSProfile sequence length " << seqLen << " max difference " << diff << std::endl;
+        ok = ok && diff < tolerance;
+
+        std::vector<float> count(seqLen * rowSize, 0.0f);
+        std::vector<float> Neff_M(seqLen);
+        for (int i = 0; i < seqLen; ++i) {
+            float sum = 0.0f;
+            for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+                count[i * rowSize + a] = static_cast<float>(rand()) / RAND_MAX;
+                sum += count[i * rowSize + a];
+            }
+            for (size_t a = 0; a < Sequence::PROFILE_AA_SIZE; ++a) {
+                count[i * rowSize + a] /= sum;
+            }
+            Neff_M[i] = 1.0f + (rand() % 100) / 10.0f;
+        }
+        reference = csProfileScalar(ctxLib, NULL, seqLen, count.data(), Neff_M.data(), 0.0, 1.4, 1.5);
+        diff = maxProfileDifference(csProfile.computeProfileCs(seqLen, count.data(), Neff_M.data(), 1.4, 1.5), reference, seqLen);
+        std::cout << "CSProfile profile length " << seqLen << " max difference " << diff << std::endl;
+        ok = ok && diff < tolerance;
+    }
+    return ok;
+}
+
 int main (int, const char**) {
     Parameters& par = Parameters::getInstance();
+    if (compareCsProfile() == false) {
+        std::cout << "Vectorized CSProfile differs from the scalar reference" << std::endl;
+        return EXIT_FAILURE;
+    }
     SubstitutionMatrix subMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, 0.0);
     std::cout << "Subustitution matrix:";
     SubstitutionMatrix::print(subMat.subMatrix,subMat.num2aa,subMat.alphabetSize);
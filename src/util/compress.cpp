@@ -2,11 +2,42 @@
 #include "DBReader.h"
 #include "DBWriter.h"
 #include "Debug.h"
+#include "zdict.h"
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
+// zstd recommends about 100 times the dictionary size as training input, take evenly spaced entries up to that
+static void trainDictionary(DBReader<unsigned int> &reader, DBWriter &writer, size_t dictionarySize) {
+    const size_t maxSampleSize = 100 * dictionarySize;
+    size_t totalSize = 0;
+    for (size_t i = 0; i < reader.getSize(); ++i) {
+        totalSize += std::max(reader.getEntryLen(i), static_cast<size_t>(1)) - 1;
+    }
+    const size_t step = std::max(totalSize / std::max(maxSampleSize, static_cast<size_t>(1)), static_cast<size_t>(1));
+
+    std::string samples;
+    std::vector<size_t> sampleSizes;
+    for (size_t i = 0; i < reader.getSize() && samples.size() < maxSampleSize; i += step) {
+        size_t length = std::max(reader.getEntryLen(i), static_cast<size_t>(1)) - 1;
+        if (length == 0) {
+            continue;
+        }
+        samples.append(reader.getData(i, 0), length);
+        sampleSizes.push_back(length);
+    }
+
+    std::string dictionary(dictionarySize, '\0');
+    size_t result = ZDICT_trainFromBuffer(&dictionary[0], dictionary.size(), samples.data(), sampleSizes.data(), sampleSizes.size());
+    if (ZDICT_isError(result)) {
+        Debug(Debug::WARNING) << "Cannot train dictionary: " << ZDICT_getErrorName(result) << ". Compressing without dictionary.\n";
+        return;
+    }
+    Debug(Debug::INFO) << "Trained dictionary of " << result << " bytes on " << sampleSizes.size() << " entries\n";
+    writer.setDictionary(dictionary.data(), result);
+}
+
 int doCompression(int argc, const char **argv, const Command& command, bool shouldCompress) {
     Parameters& par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, 0, 0);
@@ -26,6 +57,9 @@ int doCompression(int argc, const char **argv, const Command& command, bool shou
     dbtype = shouldCompress ? dbtype | (1 << 31) : dbtype & ~(1 << 31);
     DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, shouldCompress, dbtype);
     writer.open();
+    if (shouldCompress == true && par.dictionarySize > 0) {
+        trainDictionary(reader, writer, par.dictionarySize);
+    }
     Debug::Progress progress(reader.getSize());
 
 #pragma omp parallel
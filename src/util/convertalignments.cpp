@@ -12,6 +12,7 @@
 #include "MemoryMapped.h"
 #include "NcbiTaxonomy.h"
 #include "MappingReader.h"
+#include "ResumableChunks.h"
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include <zstd.h>
@@ -140,6 +141,18 @@ std::map<unsigned int, std::string> readSetToSource(const std::string& file) {
     return mapping;
 }
 
+// writes the converted alignments of the entries [dbFrom, dbFrom + dbSize) of alnDbr
+static void writeAlignments(Parameters &par, int format, bool addColumnHeaders, const std::vector<int> &outcodes, bool sameDB,
+                            bool needSequenceDB, bool needBacktrace, bool needFullHeaders, bool needTaxonomy, bool needTaxonomyMapping,
+                            NcbiTaxonomy *t, MappingReader *mapping,
+                            std::map<unsigned int, unsigned int> &qKeyToSet, std::map<unsigned int, unsigned int> &tKeyToSet,
+                            std::map<unsigned int, std::string> &qSetToSource, std::map<unsigned int, std::string> &tSetToSource,
+                            IndexReader &qDbr, IndexReader &qDbrHeader, IndexReader *tDbr, IndexReader *tDbrHeader,
+                            bool queryNucs, bool targetNucs, bool isTranslatedSearch, bool queryProfile, bool targetProfile,
+                            SubstitutionMatrix *subMat, EvalueComputation *evaluer, const TranslateNucl &translateNucl,
+                            DBReader<unsigned int> &alnDbr, size_t localThreads, bool isDb,
+                            size_t dbFrom, size_t dbSize, DBWriter &resultWriter);
+
 int convertalignments(int argc, const char **argv, const Command &command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, 0, 0);
@@ -197,7 +210,8 @@ int convertalignments(int argc, const char **argv, const Command &command) {
     }
 
     IndexReader qDbr(par.db1, par.threads,  IndexReader::SRC_SEQUENCES, (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0, dbaccessMode);
-    IndexReader qDbrHeader(par.db1, par.threads, IndexReader::SRC_HEADERS , (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0);
+    // headers are only read for queries and targets with hits, so only their index is preloaded
+    IndexReader qDbrHeader(par.db1, par.threads, IndexReader::SRC_HEADERS , (touch) ? IndexReader::PRELOAD_INDEX : 0);
 
     IndexReader *tDbr;
     IndexReader *tDbrHeader;
@@ -206,7 +220,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         tDbrHeader= &qDbrHeader;
     } else {
         tDbr = new IndexReader(par.db2, par.threads, IndexReader::SRC_SEQUENCES, (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0, dbaccessMode);
-        tDbrHeader = new IndexReader(par.db2, par.threads, IndexReader::SRC_HEADERS, (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0);
+        tDbrHeader = new IndexReader(par.db2, par.threads, IndexReader::SRC_HEADERS, (touch) ? IndexReader::PRELOAD_INDEX : 0);
     }
 
     bool queryNucs = Parameters::isEqualDbtype(qDbr.sequenceReader->getDbtype(), Parameters::DBTYPE_NUCLEOTIDES);
@@ -260,12 +274,88 @@ int convertalignments(int argc, const char **argv, const Command &command) {
 
     const bool shouldCompress = par.dbOut == true && par.compressed == true;
     const int dbType = par.dbOut == true ? Parameters::DBTYPE_GENERIC_DB : Parameters::DBTYPE_OMIT_FILE;
-    DBWriter resultWriter(par.db4.c_str(), par.db4Index.c_str(), localThreads, shouldCompress, dbType);
-    resultWriter.open();
-
     const bool isDb = par.dbOut;
     TranslateNucl translateNucl(static_cast<TranslateNucl::GenCode>(par.translationTable));
 
+    // every chunk is a complete output for a range of queries that is committed on its own
+    size_t chunks = 1;
+    if (par.checkpointChunks > 1) {
+        if (format == Parameters::FORMAT_ALIGNMENT_SAM || format == Parameters::FORMAT_ALIGNMENT_HTML) {
+            Debug(Debug::WARNING) << "--checkpoint-chunks is not supported for SAM and HTML output and will be ignored\n";
+        } else {
+            chunks = std::min(static_cast<size_t>(par.checkpointChunks), alnDbr.getSize());
+        }
+    }
+    ResumableChunks *checkpoint = NULL;
+    if (chunks > 1) {
+        checkpoint = new ResumableChunks(par.db4, par.db4Index, chunks, ResumableChunks::fingerprint(par, command));
+    }
+
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        size_t dbFrom = 0;
+        size_t dbSize = alnDbr.getSize();
+        std::pair<std::string, std::string> outDb = std::make_pair(par.db4, par.db4Index);
+        if (checkpoint != NULL) {
+            if (checkpoint->isDone(chunk)) {
+                Debug(Debug::INFO) << "Skip chunk " << (chunk + 1) << " of " << chunks << ", it was committed by an earlier run\n";
+                continue;
+            }
+            alnDbr.decomposeDomainByAminoAcid(chunk, chunks, &dbFrom, &dbSize);
+            outDb = checkpoint->getChunkDb(chunk);
+        }
+        DBWriter resultWriter(outDb.first.c_str(), outDb.second.c_str(), localThreads, shouldCompress, dbType);
+        resultWriter.open();
+
+        writeAlignments(par, format, addColumnHeaders && chunk == 0, outcodes, sameDB,
+                        needSequenceDB, needBacktrace, needFullHeaders, needTaxonomy, needTaxonomyMapping,
+                        t, mapping, qKeyToSet, tKeyToSet, qSetToSource, tSetToSource,
+                        qDbr, qDbrHeader, tDbr, tDbrHeader,
+                        queryNucs, targetNucs, isTranslatedSearch, queryProfile, targetProfile,
+                        subMat, evaluer, translateNucl, alnDbr, localThreads, isDb,
+                        dbFrom, dbSize, resultWriter);
+        // tsv output
+        resultWriter.close(true);
+        if (checkpoint != NULL) {
+            checkpoint->commit(chunk, true);
+        }
+    }
+    if (checkpoint != NULL) {
+        DBWriter::mergeResults(par.db4, par.db4Index, checkpoint->startMerge());
+        checkpoint->finish();
+        delete checkpoint;
+    }
+    if (isDb == false) {
+        FileUtil::remove(par.db4Index.c_str());
+    }
+    if (needTaxonomy) {
+        delete t;
+    }
+    if (mapping != NULL) {
+        delete mapping;
+    }
+    alnDbr.close();
+    if (sameDB == false) {
+        delete tDbr;
+        delete tDbrHeader;
+    }
+    if (needSequenceDB) {
+        delete evaluer;
+    }
+    delete subMat;
+
+    return EXIT_SUCCESS;
+}
+
+static void writeAlignments(Parameters &par, int format, bool addColumnHeaders, const std::vector<int> &outcodes, bool sameDB,
+                            bool needSequenceDB, bool needBacktrace, bool needFullHeaders, bool needTaxonomy, bool needTaxonomyMapping,
+                            NcbiTaxonomy *t, MappingReader *mapping,
+                            std::map<unsigned int, unsigned int> &qKeyToSet, std::map<unsigned int, unsigned int> &tKeyToSet,
+                            std::map<unsigned int, std::string> &qSetToSource, std::map<unsigned int, std::string> &tSetToSource,
+                            IndexReader &qDbr, IndexReader &qDbrHeader, IndexReader *tDbr, IndexReader *tDbrHeader,
+                            bool queryNucs, bool targetNucs, bool isTranslatedSearch, bool queryProfile, bool targetProfile,
+                            SubstitutionMatrix *subMat, EvalueComputation *evaluer, const TranslateNucl &translateNucl,
+                            DBReader<unsigned int> &alnDbr, size_t localThreads, bool isDb,
+                            size_t dbFrom, size_t dbSize, DBWriter &resultWriter) {
     if (format == Parameters::FORMAT_ALIGNMENT_SAM) {
         char buffer[1024];
         unsigned int lastKey = tDbr->sequenceReader->getLastKey();
@@ -320,7 +410,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         resultWriter.writeData(header.c_str(), header.length(), 0, 0, false, false);
     }
 
-    Debug::Progress progress(alnDbr.getSize());
+    Debug::Progress progress(dbSize);
 #pragma omp parallel num_threads(localThreads)
     {
         unsigned int thread_idx = 0;
@@ -350,7 +440,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         const TaxonNode * taxonNode = NULL;
 
 #pragma omp  for schedule(dynamic, 10)
-        for (size_t i = 0; i < alnDbr.getSize(); i++) {
+        for (size_t i = dbFrom; i < (dbFrom + dbSize); i++) {
             progress.updateProgress();
 
             const unsigned int queryKey = alnDbr.getDbKey(i);
@@ -778,27 +868,4 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         const char* endBlock = "]);</script>";
         resultWriter.writeData(endBlock, strlen(endBlock), 0, localThreads - 1, false, false);
     }
-    // tsv output
-    resultWriter.close(true);
-    if (isDb == false) {
-        FileUtil::remove(par.db4Index.c_str());
-    }
-    if (needTaxonomy) {
-        delete t;
-    }
-    if (mapping != NULL) {
-        delete mapping;
-    }
-    alnDbr.close();
-    if (sameDB == false) {
-        delete tDbr;
-        delete tDbrHeader;
-    }
-    if (needSequenceDB) {
-        delete evaluer;
-    }
-    delete subMat;
-
-    return EXIT_SUCCESS;
 }
-
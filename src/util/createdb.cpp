@@ -12,6 +12,19 @@
 #include "KSeqWrapper.h"
 #include "itoa.h"
 
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include <unordered_map>
+
+// data of the first copy of a sequence, later copies only get an index entry pointing at it
+// a second hash with another seed has to match too, so that two sequences with the same 64-bit key are not merged
+struct UniqueSequence {
+    size_t offset;
+    size_t length;
+    uint64_t check;
+};
+
 int createdb(int argc, const char **argv, const Command& command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, Parameters::PARSE_VARIADIC, 0);
@@ -57,6 +70,13 @@ int createdb(int argc, const char **argv, const Command& command) {
         par.createdbMode = Parameters::SEQUENCE_SPLIT_MODE_HARD;
     }
 
+    // the shuffled splits are renumbered by their offsets, shared offsets would mix up the keys of sequences and headers
+    if (par.dedupSequences && par.shuffleDatabase) {
+        Debug(Debug::WARNING) << "Shuffle database cannot be combined with --dedup 1\n";
+        Debug(Debug::WARNING) << "We recompute with --shuffle 0\n";
+        par.shuffleDatabase = false;
+    }
+
     const unsigned int shuffleSplits = par.shuffleDatabase ? 32 : 1;
     if (par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT && par.compressed) {
         Debug(Debug::WARNING) << "Compressed database cannot be combined with --createdb-mode 0\n";
@@ -95,6 +115,8 @@ int createdb(int argc, const char **argv, const Command& command) {
     seqWriter.open();
     size_t headerFileOffset = 0;
     size_t seqFileOffset = 0;
+    std::unordered_map<uint64_t, UniqueSequence> uniqueSequences;
+    size_t duplicateSequences = 0;
 
     size_t fileCount = filenames.size();
     DBReader<unsigned int>* reader = NULL;
@@ -218,16 +240,41 @@ int createdb(int argc, const char **argv, const Command& command) {
             // Finally write down the entry
             unsigned int splitIdx = id % shuffleSplits;
             sourceLookup[splitIdx].emplace_back(fileIdx);
+            // +2 to emulate the \n\0
+            const size_t seqLength = e.sequence.l + 2;
+            uint64_t seqHash = 0;
+            uint64_t seqCheck = 0;
+            bool isDuplicate = false;
+            if (par.dedupSequences) {
+                seqHash = XXH64(e.sequence.s, e.sequence.l, 0);
+                seqCheck = XXH64(e.sequence.s, e.sequence.l, 1);
+                std::unordered_map<uint64_t, UniqueSequence>::const_iterator it = uniqueSequences.find(seqHash);
+                if (it != uniqueSequences.end() && it->second.length == seqLength && it->second.check == seqCheck) {
+                    seqWriter.writeIndexEntry(id, it->second.offset, it->second.length, splitIdx);
+                    duplicateSequences++;
+                    isDuplicate = true;
+                }
+            }
             if (par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT) {
-                // +2 to emulate the \n\0
                 hdrWriter.writeIndexEntry(id, headerFileOffset + e.headerOffset, (e.sequenceOffset-e.headerOffset)+1, 0);
-                seqWriter.writeIndexEntry(id, seqFileOffset + e.sequenceOffset, e.sequence.l+2, 0);
+                if (isDuplicate == false) {
+                    seqWriter.writeIndexEntry(id, seqFileOffset + e.sequenceOffset, seqLength, 0);
+                }
             } else {
                 hdrWriter.writeData(header.c_str(), header.length(), id, splitIdx);
-                seqWriter.writeStart(splitIdx);
-                seqWriter.writeAdd(e.sequence.s, e.sequence.l, splitIdx);
-                seqWriter.writeAdd(&newline, 1, splitIdx);
-                seqWriter.writeEnd(id, splitIdx, true);
+                if (isDuplicate == false) {
+                    seqWriter.writeStart(splitIdx);
+                    seqWriter.writeAdd(e.sequence.s, e.sequence.l, splitIdx);
+                    seqWriter.writeAdd(&newline, 1, splitIdx);
+                    seqWriter.writeEnd(id, splitIdx, true);
+                }
+            }
+            if (par.dedupSequences && isDuplicate == false) {
+                UniqueSequence unique;
+                unique.offset = (par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT) ? (seqFileOffset + e.sequenceOffset) : seqWriter.getStart(splitIdx);
+                unique.length = seqLength;
+                unique.check = seqCheck;
+                uniqueSequences.emplace(seqHash, unique);
             }
 
             entries_num++;
@@ -242,6 +289,10 @@ int createdb(int argc, const char **argv, const Command& command) {
         }
     }
     Debug(Debug::INFO) << "\n";
+    if (par.dedupSequences) {
+        Debug(Debug::INFO) << "Stored " << uniqueSequences.size() << " unique sequences, " << duplicateSequences << " duplicates point at their first copy\n";
+        std::unordered_map<uint64_t, UniqueSequence>().swap(uniqueSequences);
+    }
     if (fclose(source) != 0) {
         Debug(Debug::ERROR) << "Cannot close file " << sourceFile << "\n";
         EXIT(EXIT_FAILURE);
@@ -256,6 +307,10 @@ int createdb(int argc, const char **argv, const Command& command) {
         }
         seqWriter.writeDbtypeFile(seqWriter.getDataFileName(), dbType ,par.compressed);
     }
+    // modules only look for entries that share their data in DBs with this flag
+    if (duplicateSequences > 0) {
+        seqWriter.writeDbtypeFile(seqWriter.getDataFileName(), DBReader<unsigned int>::setExtendedDbtype(dbType, Parameters::DBTYPE_EXTENDED_DEDUP), par.compressed);
+    }
     Debug(Debug::INFO) << "Database type: " << Parameters::getDbTypeName(dbType) << "\n";
     if (dbInput == true) {
         reader->close();
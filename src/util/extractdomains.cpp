@@ -8,6 +8,7 @@
 #include "MathUtil.h"
 #include "Domain.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 
@@ -49,7 +50,7 @@ double computeEvalue(unsigned int queryLength, int score) {
     return K * 1 * queryLength * std::exp(-lambdaLin * score);
 }
 
-int scoreSubAlignment(std::string query, std::string target, unsigned int qStart, unsigned int qEnd,
+int scoreSubAlignment(const std::string &query, const std::string &target, unsigned int qStart, unsigned int qEnd,
                       unsigned int tStart, unsigned int tEnd, const SubstitutionMatrix &matrix) {
     int rawScore = 0;
     int maxScore = 0;
@@ -159,44 +160,57 @@ std::vector<Domain> mapMsa(const std::string &msa, const std::vector<Domain> &do
             hasFirst = true;
         }
 
+        const unsigned int length = static_cast<unsigned int>(std::count_if(sequence.begin(), sequence.end(), isalpha));
+
+        // withoutInsertion[i] is the query position before column i (lower case letters are insertions)
+        // nextResidue[i] is the first column at or after i that is not a gap
+        const size_t columns = sequence.length();
+        std::vector<unsigned int> withoutInsertion(columns + 1);
+        std::vector<unsigned int> nextResidue(columns + 1);
+        withoutInsertion[0] = 0;
+        for (size_t i = 0; i < columns; ++i) {
+            withoutInsertion[i + 1] = withoutInsertion[i] + (islower(sequence[i]) ? 0 : 1);
+        }
+        nextResidue[columns] = columns;
+        for (size_t i = columns; i > 0; --i) {
+            const char c = sequence[i - 1];
+            nextResidue[i - 1] = (c != '-' && c != '.') ? (i - 1) : nextResidue[i];
+        }
+
         for(std::vector<Domain>::const_iterator it = domains.begin(); it != domains.end(); ++it) {
             const Domain &domain = *it;
-            unsigned int length = static_cast<unsigned int>(std::count_if(sequence.begin(), sequence.end(), isalpha));
-
-            bool foundStart = false;
-            unsigned int domainStart = 0;
-
-            unsigned int posWithoutInsertion = 0;
-            unsigned int queryDomainOffset = 0;
-            for(size_t aa_pos = 0; aa_pos < sequence.length(); aa_pos++){
-                const char c = sequence[aa_pos];
-                if ((c != '-' && c != '.') && foundStart == false
-                    && posWithoutInsertion >= domain.qStart
-                    && posWithoutInsertion <= domain.qEnd) {
-                    foundStart = true;
-                    domainStart = aa_pos;
-                    queryDomainOffset = posWithoutInsertion - domain.qStart;
-                }
 
-                if (islower(c) == false) {
-                    posWithoutInsertion++;
+            // first residue column that maps into [qStart, qEnd]
+            size_t domainStart = std::lower_bound(withoutInsertion.begin(), withoutInsertion.end() - 1, domain.qStart) - withoutInsertion.begin();
+            domainStart = nextResidue[domainStart];
+            if (domainStart >= columns || withoutInsertion[domainStart] > domain.qEnd) {
+                continue;
+            }
+            // last column before the query position reaches qEnd
+            const size_t endBound = std::lower_bound(withoutInsertion.begin() + domainStart + 1, withoutInsertion.end(), domain.qEnd) - withoutInsertion.begin();
+            if (endBound > columns || withoutInsertion[endBound] != domain.qEnd) {
+                continue;
+            }
+            size_t domainEnd = endBound - 1;
+
+            // if the full range is rejected, each insertion column directly after it is tried on its own
+            while (true) {
+                const unsigned int end = std::min(static_cast<unsigned int>(domainEnd), length - 1);
+                float domainCov = MathUtil::getCoverage(domainStart, end, domain.tLength);
+                int score = scoreSubAlignment(querySequence, sequence, withoutInsertion[domainStart], domain.qEnd,
+                                              domainStart, end, matrix);
+                double domainEvalue = domain.eValue + computeEvalue(length, score);
+                if (domainCov > minCoverage && domainEvalue < eValThreshold) {
+                    result.emplace_back(name, domainStart, end, length,
+                                        domain.target, domain.tStart, domain.tEnd, domain.tLength,
+                                        domainEvalue);
+                    break;
                 }
-
-                if (posWithoutInsertion == domain.qEnd && foundStart == true) {
-                    foundStart = false;
-                    unsigned int domainEnd = std::min(static_cast<unsigned int >(aa_pos), length - 1);
-                    float domainCov = MathUtil::getCoverage(domainStart, domainEnd, domain.tLength);
-                    int score = scoreSubAlignment(querySequence, sequence, domain.qStart + queryDomainOffset, domain.qEnd,
-                                                  domainStart, domainEnd, matrix);
-                    double domainEvalue = domain.eValue + computeEvalue(length, score);
-//                std::cout << name <<  "\t" << domainStart <<  "\t" << domainEnd << "\t" << domainEvalue << "\t" << score << std::endl;
-                    if (domainCov > minCoverage && domainEvalue < eValThreshold) {
-                        result.emplace_back(name, domainStart, domainEnd, length,
-                                            domain.target, domain.tStart, domain.tEnd, domain.tLength,
-                                            domainEvalue);
-                        break;
-                    }
+                domainStart = domainEnd + 1;
+                if (domainStart >= columns || islower(sequence[domainStart]) == false) {
+                    break;
                 }
+                domainEnd = domainStart;
             }
         }
     }
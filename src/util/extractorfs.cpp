@@ -154,6 +154,7 @@ int extractorfs(int argc, const char **argv, const Command& command) {
         }
     }
     DBReader<unsigned int>::softlinkDb(par.db1, par.db2, DBFiles::SOURCE);
+    OrfLocationTable::writeTable(par.db2, par.threads);
 
     return EXIT_SUCCESS;
 }
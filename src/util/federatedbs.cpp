@@ -0,0 +1,111 @@
+#include "Parameters.h"
+#include "FileUtil.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <climits>
+
+typedef DBReader<unsigned int>::FederatedMember FederatedMember;
+
+// members are stored with absolute paths, so that the manifest stays valid if the working directory changes
+static std::string absolutePath(const std::string &path) {
+    if (path.empty() == false && path[0] == '/') {
+        return path;
+    }
+    return FileUtil::getCurrentWorkingDirectory() + "/" + path;
+}
+
+// appends the members of db to members, a federated input is flattened into its members
+static void addMembers(const std::string &db, size_t keyOffset, std::vector<FederatedMember> &members) {
+    if (DBReader<unsigned int>::isFederated(db)) {
+        std::vector<FederatedMember> inner = DBReader<unsigned int>::readFederatedManifest(db);
+        for (size_t i = 0; i < inner.size(); ++i) {
+            inner[i].name = absolutePath(inner[i].name);
+            inner[i].keyOffset += keyOffset;
+            members.push_back(inner[i]);
+        }
+        return;
+    }
+    FederatedMember member;
+    member.name = absolutePath(db);
+    member.keyOffset = keyOffset;
+    member.firstEntry = 0;
+    member.entries = 0;
+    members.push_back(member);
+}
+
+int federatedbs(int argc, const char **argv, const Command &command) {
+    Parameters &par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, Parameters::PARSE_VARIADIC, 0);
+
+    const std::string outDb = par.filenames.back();
+    par.filenames.pop_back();
+
+    // all inputs are read before anything is written, so that the output can be one of the federated inputs
+    std::vector<FederatedMember> members;
+    std::vector<FederatedMember> headerMembers;
+    bool hasHeaders = true;
+    int dbtype = 0;
+    int headerDbtype = 0;
+    size_t keyOffset = 0;
+    for (size_t i = 0; i < par.filenames.size(); ++i) {
+        const std::string &db = par.filenames[i];
+        const int inputDbtype = FileUtil::parseDbType(db.c_str());
+        if (i == 0) {
+            dbtype = inputDbtype;
+        } else if (inputDbtype != dbtype) {
+            Debug(Debug::ERROR) << "Database " << db << " has type " << Parameters::getDbTypeName(inputDbtype)
+                                << " but " << par.filenames[0] << " has type " << Parameters::getDbTypeName(dbtype) << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (db == outDb && DBReader<unsigned int>::isFederated(db) == false) {
+            Debug(Debug::ERROR) << "Output database " << outDb << " can only be an input if it is a federated database\n";
+            EXIT(EXIT_FAILURE);
+        }
+
+        // the keys of the next member start after the largest key of this one
+        DBReader<unsigned int> reader(db.c_str(), (db + ".index").c_str(), par.threads, DBReader<unsigned int>::USE_INDEX);
+        reader.open(DBReader<unsigned int>::NOSORT);
+        const size_t nextKeyOffset = keyOffset + static_cast<size_t>(reader.getLastKey()) + 1;
+        if (reader.getSize() == 0) {
+            Debug(Debug::WARNING) << "Database " << db << " is empty\n";
+        }
+        reader.close();
+
+        addMembers(db, keyOffset, members);
+        const std::string headerDb = db + "_h";
+        if (hasHeaders && FileUtil::fileExists((headerDb + ".dbtype").c_str())) {
+            const int inputHeaderDbtype = FileUtil::parseDbType(headerDb.c_str());
+            if (i == 0) {
+                headerDbtype = inputHeaderDbtype;
+            }
+            hasHeaders = (inputHeaderDbtype == headerDbtype);
+            addMembers(headerDb, keyOffset, headerMembers);
+        } else {
+            hasHeaders = false;
+        }
+        keyOffset = nextKeyOffset;
+    }
+    if (keyOffset - 1 > UINT_MAX) {
+        Debug(Debug::ERROR) << "Keys of the federated database do not fit into a database key\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DBReader<unsigned int>::removeDb(outDb);
+    DBReader<unsigned int>::writeFederatedManifest(outDb, members);
+    DBWriter::writeDbtypeFile(outDb.c_str(), dbtype, (dbtype & (1 << 31)) != 0);
+    Debug(Debug::INFO) << "Federated database " << outDb << " with " << members.size() << " members\n";
+
+    const std::string outHeaderDb = outDb + "_h";
+    DBReader<unsigned int>::removeDb(outHeaderDb);
+    if (hasHeaders) {
+        DBReader<unsigned int>::writeFederatedManifest(outHeaderDb, headerMembers);
+        DBWriter::writeDbtypeFile(outHeaderDb.c_str(), headerDbtype, (headerDbtype & (1 << 31)) != 0);
+    } else {
+        Debug(Debug::WARNING) << "Not all members have a header database, " << outHeaderDb << " is not written\n";
+    }
+
+    return EXIT_SUCCESS;
+}
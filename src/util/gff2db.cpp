@@ -6,10 +6,27 @@
 #include "Orf.h"
 #include "Parameters.h"
 
+#include "GffReader.h"
+
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
+// maps the sequence names of the GFF to their lookup id, the name is needed again for the new lookup
+struct LookupResolver {
+    LookupResolver(DBReader<unsigned int> &reader) : reader(reader) {}
+
+    size_t operator()(const char *name, size_t length) {
+        size_t lookupId = reader.getLookupIdByAccession(std::string(name, length));
+        if (lookupId == SIZE_MAX || reader.getId(reader.getLookupKey(lookupId)) == UINT_MAX) {
+            return SIZE_MAX;
+        }
+        return lookupId;
+    }
+
+    DBReader<unsigned int> &reader;
+};
+
 int gff2db(int argc, const char **argv, const Command &command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, Parameters::PARSE_VARIADIC, 0);
@@ -31,10 +48,6 @@ int gff2db(int argc, const char **argv, const Command &command) {
     std::string outHdrIndex = outDb + "_h.index";
     DBWriter headerWriter(outHdr.c_str(), outHdrIndex.c_str(), par.threads, par.compressed, Parameters::DBTYPE_GENERIC_DB);
     headerWriter.open();
-    std::string outLookup = outDb + ".lookup";
-    std::string outLookupIndex = outDb + ".lookup.index";
-    DBWriter lookupWriter(outLookup.c_str(), outLookupIndex.c_str(), par.threads, 0, Parameters::DBTYPE_OMIT_FILE);
-    lookupWriter.open();
 
     FILE *source = FileUtil::openAndDelete((outDb + ".source").c_str(), "w");
     for (size_t i = 0; i < par.filenames.size(); ++i) {
@@ -48,164 +61,130 @@ int gff2db(int argc, const char **argv, const Command &command) {
         return EXIT_FAILURE;
     }
 
-    const std::vector<std::string> features = Util::split(par.gffType, ",");
-    if (features.empty()) {
+    GffReader gff(par.gffType, par.threads);
+    if (gff.getTypes().empty()) {
         Debug(Debug::WARNING) << "No feature types given. All features will be extracted\n";
     }
-    std::vector<size_t> featureCount(features.size(), 0);
 
     if (par.filenames.size() < reader.getSize()) {
         Debug(Debug::WARNING) << "Not enough GFF files are provided. Some results might be omitted\n";
     }
 
-    unsigned int entries_num = 0;
-    Debug::Progress progress(par.filenames.size());
+    LookupResolver resolve(reader);
+    for (size_t i = 0; i < par.filenames.size(); ++i) {
+        gff.read(par.filenames[i], resolve);
+    }
+
+    // keys follow the order of the GFF files, so they do not depend on the number of threads
+    std::vector<GffFeature> &features = gff.getFeatures();
+    std::vector<unsigned int> fileIndex(features.size());
+    for (size_t i = 0, idx = 0; i < features.size(); ++i) {
+        idx = (i > 0 && features[i].file != features[i - 1].file) ? 0 : idx;
+        fileIndex[i] = idx++;
+    }
+
+    // every thread formats a contiguous block of keys, the blocks are written in order
+    std::vector<std::string> lookupBuffers(par.threads);
 #pragma omp parallel
     {
-        int thread_idx = 0;
+        unsigned int thread_idx = 0;
 #ifdef OPENMP
-        thread_idx = omp_get_thread_num();
+        thread_idx = (unsigned int) omp_get_thread_num();
 #endif
-
         char buffer[32768];
-        const char* fields[255];
+#pragma omp for schedule(static)
+        for (size_t i = 0; i < features.size(); ++i) {
+            const GffFeature &feature = features[i];
+            std::string name = reader.getLookupEntryName(feature.id);
+            size_t from = feature.start;
+            size_t to = feature.end;
+            if (feature.strand != '+') {
+                std::swap(from, to);
+            }
+            int len = snprintf(buffer, sizeof(buffer), "%zu\t%s_%u_%zu_%zu\t%u\n", i, name.c_str(), fileIndex[i], from, to, feature.file);
+            lookupBuffers[thread_idx].append(buffer, std::min(static_cast<size_t>(len), sizeof(buffer) - 1));
+        }
+    }
+    FILE *lookupFile = FileUtil::openAndDelete((outDb + ".lookup").c_str(), "w");
+    for (size_t i = 0; i < lookupBuffers.size(); ++i) {
+        if (fwrite(lookupBuffers[i].c_str(), sizeof(char), lookupBuffers[i].size(), lookupFile) != lookupBuffers[i].size()) {
+            Debug(Debug::ERROR) << "Cannot write to file " << outDb << ".lookup\n";
+            return EXIT_FAILURE;
+        }
+        std::string().swap(lookupBuffers[i]);
+    }
+    if (fclose(lookupFile) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << outDb << ".lookup\n";
+        return EXIT_FAILURE;
+    }
 
-        std::string revStr;
+    // every sequence is read once, all of its features are extracted by the same thread
+    gff.groupBySequence(reader.getLookupSize());
+    Debug::Progress progress(reader.getLookupSize());
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+        char buffer[1024];
+        std::vector<char> revStr;
         revStr.reserve(par.maxSeqLen + 1);
 
-        std::vector<size_t> localFeatureCount(features.size(), 0);
-
-#pragma omp for schedule(dynamic, 1) nowait
-        for (size_t i = 0; i < par.filenames.size(); ++i) {
+#pragma omp for schedule(dynamic, 1)
+        for (size_t lookupId = 0; lookupId < reader.getLookupSize(); ++lookupId) {
             progress.updateProgress();
-            MemoryMapped file(par.filenames[i], MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
-            if (!file.isValid()) {
-                Debug(Debug::ERROR) << "Could not open GFF file " << par.filenames[i] << "\n";
-                EXIT(EXIT_FAILURE);
+            if (gff.sequenceBegin(lookupId) == gff.sequenceEnd(lookupId)) {
+                continue;
             }
-            char *data = (char *) file.getData();
-            size_t idx = 0;
-            while (*data != '\0') {
-                // line is a comment or empty
-                if (*data == '#' || *data == '\n') {
-                    data = Util::skipLine(data);
-                    continue;
-                }
-
-                const size_t columns = Util::getFieldsOfLine(data, fields, 255);
-                data = Util::skipLine(data);
-                if (columns < 9) {
-                    Debug(Debug::WARNING) << "Not enough columns in GFF file\n";
-                    continue;
-                }
-
-                if (features.empty() == false) {
-                    bool shouldSkip = true;
-                    std::string type(fields[2], fields[3] - fields[2] - 1);
-                    for (size_t i = 0; i < features.size(); ++i) {
-                        if (type.compare(features[i]) == 0) {
-                            localFeatureCount[i]++;
-                            shouldSkip = false;
-                            break;
-                        }
-                    }
-                    if (shouldSkip) {
-                        continue;
-                    }
-                }
-                size_t start = Util::fast_atoi<size_t>(fields[3]);
-                size_t end = Util::fast_atoi<size_t>(fields[4]);
-                if (start == end) {
-                    Debug(Debug::WARNING) << "Invalid sequence length in line " << idx << "\n";
-                    continue;
-                }
-                std::string strand(fields[6], fields[7] - fields[6] - 1);
-                std::string name(fields[0], fields[1] - fields[0] - 1);
-                size_t lookupId = reader.getLookupIdByAccession(name);
-                if (lookupId == SIZE_MAX) {
-                    Debug(Debug::ERROR) << "GFF entry not found in database lookup: " << name << "\n";
-                    EXIT(EXIT_FAILURE);
-                }
-                unsigned int lookupKey = reader.getLookupKey(lookupId);
-                size_t seqId = reader.getId(lookupKey);
-                if (seqId == UINT_MAX) {
-                    Debug(Debug::ERROR) << "GFF entry not found in sequence database: " << name << "\n";
-                    EXIT(EXIT_FAILURE);
+            const unsigned int seqKey = reader.getLookupKey(lookupId);
+            const size_t id = reader.getId(seqKey);
+            const char *seq = reader.getData(id, thread_idx);
+            const size_t seqLen = reader.getSeqLen(id);
+            for (size_t j = gff.sequenceBegin(lookupId); j < gff.sequenceEnd(lookupId); ++j) {
+                const GffFeature &feature = features[j];
+                const unsigned int key = static_cast<unsigned int>(feature.index);
+                if (feature.end > seqLen) {
+                    Debug(Debug::WARNING) << "Feature in line " << feature.line << " ends after its sequence\n";
                 }
+                const size_t end = std::min(static_cast<size_t>(feature.end), seqLen);
+                const size_t length = (feature.start <= end) ? end - feature.start + 1 : 0;
 
-                unsigned int key = __sync_fetch_and_add(&(entries_num), 1);
                 size_t bufferLen;
-                if (strand == "+") {
-                    bufferLen = Orf::writeOrfHeader(buffer, lookupKey, start, end, 0, 0);
+                if (feature.strand == '+') {
+                    bufferLen = Orf::writeOrfHeader(buffer, seqKey, feature.start, feature.end, 0, 0);
                 } else {
-                    bufferLen = Orf::writeOrfHeader(buffer, lookupKey, end, start, 0, 0);
+                    bufferLen = Orf::writeOrfHeader(buffer, seqKey, feature.end, feature.start, 0, 0);
                 }
                 headerWriter.writeData(buffer, bufferLen, key, thread_idx);
 
-                char *seq = reader.getData(seqId, thread_idx);
-                //check the strand instead of end - start 
-                ssize_t length = end - start + 1;
                 writer.writeStart(thread_idx);
-                if (strand == "+") {
-                    size_t len = snprintf(buffer, sizeof(buffer), "%u\t%s_%zu_%zu_%zu\t%zu\n", key, name.c_str(), idx, start, end, i);
-                    lookupWriter.writeData(buffer, len, thread_idx, false, false);
-                    writer.writeAdd(seq + start - 1 , length, thread_idx);
+                if (feature.strand == '+') {
+                    writer.writeAdd(seq + feature.start - 1, length, thread_idx);
                 } else {
-                    size_t len = snprintf(buffer, sizeof(buffer), "%u\t%s_%zu_%zu_%zu\t%zu\n", key, name.c_str(), idx, end, start, i);
-                    lookupWriter.writeData(buffer, len, thread_idx, false, false);
-                    for (size_t i = end - 1 ; i >= end - length; i--) {
-                        revStr.append(1, Orf::complement(seq[i]));
-                    }
-                    writer.writeAdd(revStr.c_str(), revStr.size(), thread_idx);
-                    revStr.clear();
+                    revStr.resize(length);
+                    Orf::writeReverseComplement(seq + feature.start - 1, length, revStr.data());
+                    writer.writeAdd(revStr.data(), revStr.size(), thread_idx);
                 }
                 writer.writeAdd("\n", 1, thread_idx);
                 writer.writeEnd(key, thread_idx);
-                idx++;
             }
-            file.close();
-        }
-#pragma omp critical
-        for (size_t i = 0; i < features.size(); ++i) {
-            featureCount[i] += localFeatureCount[i];
         }
     }
-    lookupWriter.close(true);
-    FileUtil::remove(lookupWriter.getIndexFileName());
     headerWriter.close(true);
     writer.close(true);
     headerReader.close();
     reader.close();
-    if (Debug::debugLevel >= Debug::INFO && features.size() > 0) {
+    if (Debug::debugLevel >= Debug::INFO && gff.getTypes().size() > 0) {
         Debug(Debug::INFO) << "Found these feature types and counts:\n";
-        for (size_t i = 0; i < features.size(); ++i) {
-            Debug(Debug::INFO) << " - " << features[i] << ": " << featureCount[i] << "\n";
+        for (size_t i = 0; i < gff.getTypes().size(); ++i) {
+            Debug(Debug::INFO) << " - " << gff.getTypes()[i] << ": " << gff.getTypeCount(i) << "\n";
         }
     } else {
-        Debug(Debug::INFO) << (entries_num + 1) << " features were extracted\n";
+        Debug(Debug::INFO) << features.size() << " features were extracted\n";
     }
 
-    if (par.filenames.size() > 1 && par.threads > 1) {
-    // make identifiers stable
-#pragma omp parallel
-        {
-#pragma omp single
-            {
-#pragma omp task
-                {
-                    DBWriter::createRenumberedDB(outHdr, outHdrIndex, "", "");
-                }
-
-#pragma omp task
-                {
-                    DBWriter::createRenumberedDB(outDb, outDbIndex, outDb, outDbIndex);
-                }
-            }
-        }
-    }
+    OrfLocationTable::writeTable(outDb, par.threads);
 
     return EXIT_SUCCESS;
 }
-
-
-
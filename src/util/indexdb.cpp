@@ -36,6 +36,8 @@ std::string findIncompatibleParameter(DBReader<unsigned int>& index, const Param
     }
     if (meta.spacedKmer != par.spacedKmer)
         return "spacedKmer";
+    if (meta.maxKmerAbundance != par.maxKmerAbundance)
+        return "maxKmerAbundance";
     if (BaseMatrix::unserializeName(par.seedScoringMatrixFile.values.aminoacid().c_str()) != PrefilteringIndexReader::getSubstitutionMatrixName(&index) &&
         BaseMatrix::unserializeName(par.seedScoringMatrixFile.values.nucleotide().c_str()) != PrefilteringIndexReader::getSubstitutionMatrixName(&index))
         return "seedScoringMatrixFile";
@@ -155,7 +157,7 @@ int indexdb(int argc, const char **argv, const Command &command) {
         PrefilteringIndexReader::createIndexFile(indexDB, &dbr, dbr2, &hdbr1, hdbr2, alndbr, seedSubMat, par.maxSeqLen,
                                                  par.spacedKmer, par.spacedKmerPattern, par.compBiasCorrection,
                                                  seedSubMat->alphabetSize, par.kmerSize, par.maskMode, par.maskLowerCaseMode,
-                                                 par.maskProb, kmerScore, par.split);
+                                                 par.maskProb, kmerScore, par.split, par.maxKmerAbundance);
 
         if (hdbr2 != NULL) {
             hdbr2->close();
@@ -1,11 +1,36 @@
 #include <string>
-#include <fstream>
 #include <climits>
+#include <algorithm>
 
 #include "DBReader.h"
 #include "DBWriter.h"
 #include "Debug.h"
 #include "Util.h"
+#include "GffReader.h"
+#include "FastSort.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// the index is not sorted by name (NOSORT keeps the order of the input), so names are resolved through a sorted copy
+struct NameResolver {
+    NameResolver(DBReader<std::string> &reader) {
+        names.reserve(reader.getSize());
+        for (size_t i = 0; i < reader.getSize(); ++i) {
+            names.emplace_back(reader.getDbKey(i), i);
+        }
+        SORT_PARALLEL(names.begin(), names.end());
+    }
+
+    size_t operator()(const char *name, size_t length) {
+        std::pair<std::string, size_t> value(std::string(name, length), 0);
+        std::vector<std::pair<std::string, size_t>>::const_iterator it = std::lower_bound(names.begin(), names.end(), value);
+        return (it != names.end() && it->first == value.first) ? it->second : SIZE_MAX;
+    }
+
+    std::vector<std::pair<std::string, size_t>> names;
+};
 
 int maskbygff(int argc, const char **argv, const Command& command) {
     Parameters& par = Parameters::getInstance();
@@ -15,91 +40,53 @@ int maskbygff(int argc, const char **argv, const Command& command) {
                                  DBReader<std::string>::USE_DATA | DBReader<std::string>::USE_WRITABLE);
     reader.open(DBReader<std::string>::NOSORT);
 
-    bool shouldCompareType = par.gffType.length() > 0;
-
-    size_t entries_num = 0;
-
-    std::ifstream  gffFile(par.db1);
-    std::string gffLine;
-    while(std::getline(gffFile, gffLine)) {
-        entries_num++;
-
-        // line is a comment
-        if(gffLine.find_first_of("#", 0, 1) != std::string::npos) {
-            continue;
-        }
-
-        std::vector<std::string> fields = Util::split(gffLine, "\t");
-
-        // gff has always 9 fields
-        if(fields.size() != 9) {
-            Debug(Debug::WARNING) << "Invalid GFF format in line " << entries_num << "!";
-            continue;
-        }
-
-        std::string name(fields[0]);
-
-        std::string type(fields[2]);
-
-        if(shouldCompareType && type.compare(par.gffType) != 0) {
-            continue;
-        }
-
-        char* rest;
-        size_t start = strtoull(fields[3].c_str(), &rest, 10);
-        if ((rest != fields[3].c_str() && *rest != '\0') || errno == ERANGE) {
-            Debug(Debug::WARNING) << "Invalid start position format in line " << entries_num << "!\n";
-            continue;
-        }
-        size_t end = strtoull(fields[4].c_str(), &rest, 10);
-        if ((rest != fields[4].c_str() && *rest != '\0') || errno == ERANGE) {
-            Debug(Debug::WARNING) << "Invalid end position format in line " << entries_num << "!\n";
-            continue;
-        }
+    GffReader gff(par.gffType, par.threads);
+    NameResolver resolve(reader);
+    gff.read(par.db1, resolve);
+    gff.groupBySequence(reader.getSize());
+    const std::vector<GffFeature> &features = gff.getFeatures();
 
-        // gff start and end are supposed to be 1-indexed
-        if (end <= start || end == 0 || start == 0) {
-            Debug(Debug::WARNING) << "Invalid sequence length in line " << entries_num << "!\n";
-            continue;
-        }
-
-        // so 0-index them now
-        start -= 1;
-        end -= 1;
-
-        size_t id = reader.getId(name);
-        if(id == UINT_MAX) {
-            Debug(Debug::ERROR) << "GFF entry not found in input database: " << name << "!\n";
-            return EXIT_FAILURE;
-        }
-
-        char* body = reader.getData(id, 0);
-        for (char* i = body + start; i <= body + end; ++i)
-        {
-            *i = 'X';
-        }
-
-    }
-    gffFile.close();
-
-    DBWriter writer(par.db3.c_str(), par.db3Index.c_str(), 1, par.compressed, reader.getDbtype());
+    DBWriter writer(par.db3.c_str(), par.db3Index.c_str(), par.threads, par.compressed, reader.getDbtype());
     writer.open();
 
     DBReader<std::string> headerReader(par.hdr2.c_str(), par.hdr2Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
     headerReader.open(DBReader<std::string>::NOSORT);
 
-    DBWriter headerWriter(par.hdr3.c_str(), par.hdr3Index.c_str(), 1, par.compressed, Parameters::DBTYPE_GENERIC_DB);
+    DBWriter headerWriter(par.hdr3.c_str(), par.hdr3Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_GENERIC_DB);
     headerWriter.open();
 
-    for(size_t i = 0; i < reader.getSize(); ++i ) {
-        unsigned int id = par.identifierOffset + i;
-
-        // ignore nulls
-        writer.writeData(reader.getData(i, 0), reader.getEntryLen(i) - 1, id);
-        headerWriter.writeData(headerReader.getData(i, 0), headerReader.getEntryLen(i) - 1, id);
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+
+#pragma omp for schedule(dynamic, 10)
+        for (size_t i = 0; i < reader.getSize(); ++i) {
+            char *body = reader.getData(i, thread_idx);
+            const size_t length = reader.getSeqLen(i);
+            // features are sorted by start, overlapping ones are merged so that every residue is masked only once
+            size_t maskedEnd = 0;
+            for (size_t j = gff.sequenceBegin(i); j < gff.sequenceEnd(i); ++j) {
+                // 1-based and inclusive to 0-based and half-open
+                const size_t start = std::max(static_cast<size_t>(features[j].start - 1), maskedEnd);
+                const size_t end = std::min(static_cast<size_t>(features[j].end), length);
+                if (start < end) {
+                    std::fill(body + start, body + end, 'X');
+                    maskedEnd = end;
+                }
+            }
+
+            unsigned int id = par.identifierOffset + i;
+            // ignore nulls
+            writer.writeData(body, reader.getEntryLen(i) - 1, id, thread_idx);
+            headerWriter.writeData(headerReader.getData(i, thread_idx), headerReader.getEntryLen(i) - 1, id, thread_idx);
+        }
     }
-    headerWriter.close();
-    writer.close();
+    // merge any kind of sequence database
+    headerWriter.close(true);
+    writer.close(true);
     headerReader.close();
     reader.close();
 
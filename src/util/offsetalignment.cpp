@@ -10,6 +10,8 @@
 #include "IndexReader.h"
 #include "FileUtil.h"
 
+#include <queue>
+
 #ifdef OPENMP
 #include <omp.h>
 #endif
@@ -77,8 +79,6 @@ void chainAlignmentHits(std::vector<Matcher::result_t> &results, std::vector<Mat
     }
 }
 
-//
-
 // We have serval options to consider
 // Update query and target
 //   Nucl/Nucl
@@ -87,90 +87,182 @@ void chainAlignmentHits(std::vector<Matcher::result_t> &results, std::vector<Mat
 //   Prot/Nucl
 // query update
 //   Nucl/Prot
+void updateHitOffset(Matcher::result_t &res, const Orf::SequenceLocation *qloc,
+                     const OrfLocationTable &tOrfLocations, bool targetNeedsUpdate, bool isNucleotideSearch, int thread_idx) {
+    res.queryOrfStartPos = -1;
+    res.queryOrfEndPos = -1;
+    res.dbOrfStartPos = -1;
+    res.dbOrfEndPos = -1;
+    if (targetNeedsUpdate == true || qloc == NULL) {
+        Orf::SequenceLocation tloc = tOrfLocations.getLocation(res.dbKey, thread_idx);
+        res.dbKey   = (tloc.id != UINT_MAX) ? tloc.id : res.dbKey;
+        size_t from = (tloc.id != UINT_MAX) ? tloc.from : (tloc.strand == Orf::STRAND_MINUS) ? res.dbLen - 1 : 0;
+
+        int dbStartPos = isNucleotideSearch ? res.dbStartPos : res.dbStartPos * 3;
+        int dbEndPos   = isNucleotideSearch ? res.dbEndPos : res.dbEndPos * 3;
+        res.dbOrfStartPos = from;
+        res.dbOrfEndPos = tloc.to;
+        if (tloc.strand == Orf::STRAND_MINUS) {
+            res.dbStartPos = from - dbStartPos;
+            res.dbEndPos   = from - dbEndPos;
+            // account for last orf
+            //  GGCACC
+            //  GGCA
+            //     ^
+            //     last codon position
+            //  GGCACC
+            //    GGCA
+            //    ^
+            //     last codon position
+            if(isNucleotideSearch == false){
+                res.dbEndPos = res.dbEndPos - 2;
+            }
+        } else {
+            res.dbStartPos = from + dbStartPos;
+            res.dbEndPos   = from + dbEndPos;
+            if(isNucleotideSearch == false){
+                res.dbEndPos = res.dbEndPos + 2;
+            }
+        }
+    }
+    if (qloc != NULL) {
+        int qStartPos = isNucleotideSearch ? res.qStartPos : res.qStartPos * 3;
+        int qEndPos   = isNucleotideSearch ? res.qEndPos : res.qEndPos * 3;
+
+        size_t from = (qloc->id != UINT_MAX) ? qloc->from : (qloc->strand == Orf::STRAND_MINUS) ? 0 : res.qLen - 1;
+        res.queryOrfStartPos = from;
+        res.queryOrfEndPos =  qloc->to;
+
+        if (qloc->strand == Orf::STRAND_MINUS && qloc->id != UINT_MAX) {
+            res.qStartPos  = from - qStartPos;
+            res.qEndPos    = from - qEndPos;
+            if(isNucleotideSearch == false){
+                res.qEndPos = res.qEndPos - 2;
+            }
+        } else {
+            res.qStartPos  = from + qStartPos;
+            res.qEndPos    = from + qEndPos;
+            if(isNucleotideSearch == false){
+                res.qEndPos = res.qEndPos + 2;
+            }
+        }
+    }
+}
+
 void updateOffset(char* data, std::vector<Matcher::result_t> &results, const Orf::SequenceLocation *qloc,
-                  IndexReader& tOrfDBr, bool targetNeedsUpdate, bool isNucleotideSearch, int thread_idx) {
+                  const OrfLocationTable &tOrfLocations, bool targetNeedsUpdate, bool isNucleotideSearch, int thread_idx) {
     size_t startPos = results.size();
     Matcher::readAlignmentResults(results, data, true);
     size_t endPos = results.size();
     for (size_t i = startPos; i < endPos; i++) {
-        Matcher::result_t &res = results[i];
-        res.queryOrfStartPos = -1;
-        res.queryOrfEndPos = -1;
-        res.dbOrfStartPos = -1;
-        res.dbOrfEndPos = -1;
-        if (targetNeedsUpdate == true || qloc == NULL) {
-            size_t targetId = tOrfDBr.sequenceReader->getId(res.dbKey);
-            char *header = tOrfDBr.sequenceReader->getData(targetId, thread_idx);
-
-            Orf::SequenceLocation tloc = Orf::parseOrfHeader(header);
-            res.dbKey   = (tloc.id != UINT_MAX) ? tloc.id : res.dbKey;
-            size_t from = (tloc.id != UINT_MAX) ? tloc.from : (tloc.strand == Orf::STRAND_MINUS) ? res.dbLen - 1 : 0;
-
-            int dbStartPos = isNucleotideSearch ? res.dbStartPos : res.dbStartPos * 3;
-            int dbEndPos   = isNucleotideSearch ? res.dbEndPos : res.dbEndPos * 3;
-            res.dbOrfStartPos = from;
-            res.dbOrfEndPos = tloc.to;
-            if (tloc.strand == Orf::STRAND_MINUS) {
-                res.dbStartPos = from - dbStartPos;
-                res.dbEndPos   = from - dbEndPos;
-                // account for last orf
-                //  GGCACC
-                //  GGCA
-                //     ^
-                //     last codon position
-                //  GGCACC
-                //    GGCA
-                //    ^
-                //     last codon position
-                if(isNucleotideSearch == false){
-                    res.dbEndPos = res.dbEndPos - 2;
-                }
-            } else {
-                res.dbStartPos = from + dbStartPos;
-                res.dbEndPos   = from + dbEndPos;
-                if(isNucleotideSearch == false){
-                    res.dbEndPos = res.dbEndPos + 2;
-                }
-            }
-        }
-        if (qloc != NULL) {
-            int qStartPos = isNucleotideSearch ? res.qStartPos : res.qStartPos * 3;
-            int qEndPos   = isNucleotideSearch ? res.qEndPos : res.qEndPos * 3;
-
-            size_t from = (qloc->id != UINT_MAX) ? qloc->from : (qloc->strand == Orf::STRAND_MINUS) ? 0 : res.qLen - 1;
-            res.queryOrfStartPos = from;
-            res.queryOrfEndPos =  qloc->to;
-
-            if (qloc->strand == Orf::STRAND_MINUS && qloc->id != UINT_MAX) {
-                res.qStartPos  = from - qStartPos;
-                res.qEndPos    = from - qEndPos;
-                if(isNucleotideSearch == false){
-                    res.qEndPos = res.qEndPos - 2;
-                }
-            } else {
-                res.qStartPos  = from + qStartPos;
-                res.qEndPos    = from + qEndPos;
-                if(isNucleotideSearch == false){
-                    res.qEndPos = res.qEndPos + 2;
-                }
-            }
-        }
+        updateHitOffset(results[i], qloc, tOrfLocations, targetNeedsUpdate, isNucleotideSearch, thread_idx);
+    }
+}
+
+void updateHitLength(Matcher::result_t &res, unsigned int qSourceLen, IndexReader* tSourceDbr) {
+    if (qSourceLen != UINT_MAX) {
+        res.qLen = qSourceLen;
+    }
+    if (tSourceDbr != NULL) {
+        size_t targetId = tSourceDbr->sequenceReader->getId(res.dbKey);
+        res.dbLen = tSourceDbr->sequenceReader->getSeqLen(targetId);
     }
 }
 
 void updateLengths(std::vector<Matcher::result_t> &results, unsigned int qSourceLen, IndexReader* tSourceDbr) {
     for (size_t i = 0; i < results.size(); ++i) {
-        Matcher::result_t &res = results[i];
-        if (qSourceLen != UINT_MAX) {
-            res.qLen = qSourceLen;
+        updateHitLength(results[i], qSourceLen, tSourceDbr);
+    }
+}
+
+// true if the hits of a result list are ordered by e-value and score, as the alignment writes them
+bool isSortedByEvalAndScore(char *data) {
+    const char *words[4];
+    double prevEval = 0.0;
+    int prevScore = 0;
+    bool first = true;
+    while (*data != '\0') {
+        if (Util::getWordsOfLine(data, words, 4) < 4) {
+            return false;
         }
-        if (tSourceDbr != NULL) {
-            size_t targetId = tSourceDbr->sequenceReader->getId(res.dbKey);
-            res.dbLen = tSourceDbr->sequenceReader->getSeqLen(targetId);
+        int score = Util::fast_atoi<int>(words[1]);
+        double eval = strtod(words[3], NULL);
+        if (first == false && (eval < prevEval || (eval == prevEval && score > prevScore))) {
+            return false;
         }
+        prevEval = eval;
+        prevScore = score;
+        first = false;
+        data = Util::skipLine(data);
     }
+    return true;
 }
 
+// Read position in one ORF result list during the streaming merge of the lists of a contig. The list is consumed
+// one group of hits with equal e-value and score at a time, since remapping target keys and lengths to the contigs
+// can only reorder hits within such a group. Only the current group is kept in memory.
+struct OrfHitCursor {
+    char *data;
+    Orf::SequenceLocation qloc;
+    bool hasQueryLocation;
+    bool targetNeedsUpdate;
+    std::vector<Matcher::result_t> group;
+    size_t pos;
+
+    OrfHitCursor() : data(NULL), qloc(0, 0, false, false, Orf::STRAND_PLUS), hasQueryLocation(false),
+                     targetNeedsUpdate(false), pos(0) {}
+
+    // remaps the next group of hits, false at the end of the list
+    bool nextGroup(const OrfLocationTable &tOrfLocations, bool isNucleotideSearch, unsigned int qSourceLen,
+                   IndexReader *tSourceDbr, int thread_idx) {
+        group.clear();
+        pos = 0;
+        int score = 0;
+        double eval = 0.0;
+        const char *words[4];
+        while (*data != '\0') {
+            Util::getWordsOfLine(data, words, 4);
+            if (group.empty()) {
+                score = Util::fast_atoi<int>(words[1]);
+                eval = strtod(words[3], NULL);
+            } else if (Util::fast_atoi<int>(words[1]) != score || strtod(words[3], NULL) != eval) {
+                break;
+            }
+            group.emplace_back(Matcher::parseAlignmentRecord(data, true));
+            Matcher::result_t &res = group.back();
+            updateHitOffset(res, hasQueryLocation ? &qloc : NULL, tOrfLocations, targetNeedsUpdate, isNucleotideSearch, thread_idx);
+            updateHitLength(res, qSourceLen, tSourceDbr);
+            data = Util::skipLine(data);
+        }
+        if (group.size() > 1) {
+            std::stable_sort(group.begin(), group.end(), Matcher::compareHits);
+        }
+        return group.empty() == false;
+    }
+
+    const Matcher::result_t &head() const {
+        return group[pos];
+    }
+};
+
+// priority_queue pops the largest element, so better hits and earlier ORFs have to compare greater
+// Ties go to the earlier ORF, the merge gives the order of a stable sort over all lists of the contig
+struct CompareCursorHead {
+    CompareCursorHead(const std::vector<OrfHitCursor> &cursors) : cursors(&cursors) {}
+    bool operator()(size_t first, size_t second) const {
+        const Matcher::result_t &firstHit = (*cursors)[first].head();
+        const Matcher::result_t &secondHit = (*cursors)[second].head();
+        if (Matcher::compareHits(secondHit, firstHit)) {
+            return true;
+        }
+        if (Matcher::compareHits(firstHit, secondHit)) {
+            return false;
+        }
+        return first > second;
+    }
+    const std::vector<OrfHitCursor> *cursors;
+};
+
 int offsetalignment(int argc, const char **argv, const Command &command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, 0, 0);
@@ -212,6 +304,15 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
         tOrfDbr = new IndexReader(par.db4.c_str(), par.threads, IndexReader::HEADERS, (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0);
     }
 
+    // ORF locations come from the binary location table if the ORF DB has one
+    OrfLocationTable qOrfLocations;
+    qOrfLocations.open(par.db2, qOrfDbr.sequenceReader);
+    OrfLocationTable *tOrfLocations = &qOrfLocations;
+    if (isSameOrfDB == false) {
+        tOrfLocations = new OrfLocationTable();
+        tOrfLocations->open(par.db4, tOrfDbr->sequenceReader);
+    }
+
     if (targetDbType == -1) {
         Debug(Debug::ERROR) << "Please recreate your database or add a .dbtype file to your sequence/profile database.\n";
         return EXIT_FAILURE;
@@ -289,8 +390,7 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
                     continue;
                 }
                 unsigned int queryKey = qOrfDbr.sequenceReader->getDbKey(queryId);
-                char *header = qOrfDbr.sequenceReader->getData(queryId, thread_idx);
-                Orf::SequenceLocation qloc = Orf::parseOrfHeader(header);
+                Orf::SequenceLocation qloc = qOrfLocations.getLocation(queryKey, thread_idx);
                 unsigned int id = (qloc.id != UINT_MAX) ? qloc.id : queryKey;
                 orfLookup[i] = id;
             }
@@ -344,6 +444,9 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
     }
     Debug::Progress progress(entryCount);
 
+    // getData of compressed DBs returns a per-thread buffer, so their lists cannot be read side by side
+    const bool streamMerge = par.mergeQuery == true && par.chainAlignment == false && alnDbr.isCompressed() == false;
+
 #pragma omp parallel num_threads(localThreads)
     {
         unsigned int thread_idx = 0;
@@ -360,6 +463,11 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
         results.reserve(300);
         tmp.reserve(300);
 
+        // merged lists are streamed through cursors, only one group of hits per ORF is parsed at a time
+        std::vector<OrfHitCursor> cursors;
+        size_t cursorCount = 0;
+        bool cursorsSorted = true;
+
         std::string newBacktrace;
         newBacktrace.reserve(300);
 
@@ -388,13 +496,23 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
                         continue;
                     }
                     char *data = alnDbr.getData(orfId, thread_idx);
-                    size_t queryId = qOrfDbr.sequenceReader->getId(orfKey);
-                    char *header = qOrfDbr.sequenceReader->getData(queryId, thread_idx);
-                    Orf::SequenceLocation qloc = Orf::parseOrfHeader(header);
+                    Orf::SequenceLocation qloc = qOrfLocations.getLocation(orfKey, thread_idx);
+                    if (streamMerge) {
+                        if (cursorCount == cursors.size()) {
+                            cursors.emplace_back();
+                        }
+                        OrfHitCursor &cursor = cursors[cursorCount++];
+                        cursor.data = data;
+                        cursor.qloc = qloc;
+                        cursor.hasQueryLocation = (qloc.id != UINT_MAX);
+                        cursor.targetNeedsUpdate = (isNuclNuclSearch || isTransNucTransNucSearch);
+                        cursorsSorted = cursorsSorted && isSortedByEvalAndScore(data);
+                        continue;
+                    }
                     if(qloc.id == UINT_MAX){
-                        updateOffset(data, results, NULL, *tOrfDbr, (isNuclNuclSearch||isTransNucTransNucSearch), isNuclNuclSearch, thread_idx);
+                        updateOffset(data, results, NULL, *tOrfLocations, (isNuclNuclSearch||isTransNucTransNucSearch), isNuclNuclSearch, thread_idx);
                     }else{
-                        updateOffset(data, results, &qloc, *tOrfDbr, (isNuclNuclSearch||isTransNucTransNucSearch), isNuclNuclSearch, thread_idx);
+                        updateOffset(data, results, &qloc, *tOrfLocations, (isNuclNuclSearch||isTransNucTransNucSearch), isNuclNuclSearch, thread_idx);
                     }
                     // do not merge entries
                     if(par.mergeQuery == false){
@@ -423,9 +541,64 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
                     qLen = qSourceDbr->sequenceReader->getSeqLen(queryId);
                 }
                 char *data = alnDbr.getData(i, thread_idx);
-                updateOffset(data, results, NULL, *tOrfDbr, true, isNuclNuclSearch, thread_idx);
+                if (streamMerge) {
+                    if (cursorCount == cursors.size()) {
+                        cursors.emplace_back();
+                    }
+                    OrfHitCursor &cursor = cursors[cursorCount++];
+                    cursor.data = data;
+                    cursor.hasQueryLocation = false;
+                    cursor.targetNeedsUpdate = true;
+                    cursorsSorted = isSortedByEvalAndScore(data);
+                } else {
+                    updateOffset(data, results, NULL, *tOrfLocations, true, isNuclNuclSearch, thread_idx);
+                }
             }
-            if(par.mergeQuery == true){
+            if (streamMerge && cursorsSorted) {
+                std::priority_queue<size_t, std::vector<size_t>, CompareCursorHead> heads((CompareCursorHead(cursors)));
+                for (size_t j = 0; j < cursorCount; ++j) {
+                    if (cursors[j].nextGroup(*tOrfLocations, isNuclNuclSearch, qLen, tSourceDbr, thread_idx)) {
+                        heads.push(j);
+                    }
+                }
+                resultWriter.writeStart(thread_idx);
+                while (heads.empty() == false) {
+                    size_t j = heads.top();
+                    heads.pop();
+                    OrfHitCursor &cursor = cursors[j];
+                    Matcher::result_t &res = cursor.group[cursor.pos];
+                    bool hasBacktrace = (res.backtrace.size() > 0);
+                    if (isTransNuclAln == true && isNuclNuclSearch == false && isTransNucTransNucSearch == true && hasBacktrace) {
+                        newBacktrace.reserve(res.backtrace.length() * 3);
+                        Matcher::result_t::protein2nucl(res.backtrace, newBacktrace);
+                        res.backtrace = newBacktrace;
+                        newBacktrace.clear();
+                    }
+                    size_t len = Matcher::resultToBuffer(buffer, res, hasBacktrace, false, true);
+                    ss.append(buffer, len);
+                    if (ss.size() > 1024 * 1024) {
+                        resultWriter.writeAdd(ss.c_str(), ss.length(), thread_idx);
+                        ss.clear();
+                    }
+                    cursor.pos++;
+                    if (cursor.pos < cursor.group.size()
+                        || cursor.nextGroup(*tOrfLocations, isNuclNuclSearch, qLen, tSourceDbr, thread_idx)) {
+                        heads.push(j);
+                    }
+                }
+                resultWriter.writeAdd(ss.c_str(), ss.length(), thread_idx);
+                resultWriter.writeEnd(queryKey, thread_idx);
+                ss.clear();
+                cursorCount = 0;
+            } else if(par.mergeQuery == true){
+                // a list that is not ordered by e-value cannot be streamed, all lists of the contig are sorted together
+                for (size_t j = 0; j < cursorCount; ++j) {
+                    OrfHitCursor &cursor = cursors[j];
+                    updateOffset(cursor.data, results, cursor.hasQueryLocation ? &cursor.qloc : NULL, *tOrfLocations,
+                                 cursor.targetNeedsUpdate, isNuclNuclSearch, thread_idx);
+                }
+                cursorCount = 0;
+                cursorsSorted = true;
                 updateLengths(results, qLen, tSourceDbr);
                 if(par.chainAlignment == false){
                     std::stable_sort(results.begin(), results.end(), Matcher::compareHits);
@@ -480,6 +653,7 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
     }
 
     if(isSameOrfDB == false){
+        delete tOrfLocations;
         delete tOrfDbr;
     }
     if(tSourceDbr != NULL){
@@ -21,6 +21,8 @@ int orftocontig(int argn, const char **argv, const Command& command) {
     // info will be obtained from orf headers:
     DBReader<unsigned int> orfHeadersReader(par.hdr2.c_str(), par.hdr2Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
     orfHeadersReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    OrfLocationTable orfLocations;
+    orfLocations.open(par.db2, &orfHeadersReader);
 
     // writing in alignment format:
     DBWriter alignmentFormatWriter(par.db3.c_str(), par.db3Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_ALIGNMENT_RES);
@@ -39,7 +41,7 @@ int orftocontig(int argn, const char **argv, const Command& command) {
         for (size_t id = 0; id < orfHeadersReader.getSize(); ++id) {
             progress.updateProgress();
             unsigned int orfKey = orfHeadersReader.getDbKey(id);
-            Matcher::result_t orfToContigResult = Orf::getFromDatabase(id, contigsReader, orfHeadersReader, thread_idx);
+            Matcher::result_t orfToContigResult = Orf::getFromDatabase(orfKey, contigsReader, orfLocations, thread_idx);
             size_t len = Matcher::resultToBuffer(orfToContigBuffer, orfToContigResult, true);
             alignmentFormatWriter.writeData(orfToContigBuffer, len, orfKey, thread_idx);
         }
@@ -47,6 +49,7 @@ int orftocontig(int argn, const char **argv, const Command& command) {
     
     // cleanup
     alignmentFormatWriter.close();
+    orfLocations.close();
     orfHeadersReader.close();
     contigsReader.close();
 
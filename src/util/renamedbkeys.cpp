@@ -8,18 +8,49 @@
 
 #include <climits>
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 static bool compareToFirst(const std::pair<unsigned int, unsigned int>& lhs, const std::pair<unsigned int, unsigned int>& rhs){
-    return (lhs.first <= rhs.first);
+    return lhs.first < rhs.first;
 }
 
-void copyEntry(unsigned int oldKey, unsigned int newKey, DBReader<unsigned int>& reader, DBWriter& writer, bool isCompressed, int subDbMode) {
-    const size_t id = reader.getId(oldKey);
-    if (id >= UINT_MAX) {
-        Debug(Debug::ERROR) << "Key " << oldKey << " not found in database\n";
-        EXIT(EXIT_FAILURE);
+static bool compareByFirst(const std::pair<size_t, size_t>& lhs, const std::pair<size_t, size_t>& rhs){
+    return lhs.first < rhs.first;
+}
+
+static bool compareNewMapping(const std::pair<size_t, unsigned int>& lhs, const std::pair<size_t, unsigned int>& rhs){
+    return lhs.first < rhs.first;
+}
+
+// resolves the old keys of the (by old key sorted) mapping with a single pass over the index
+// returns pairs of the local id in the reader and the new key
+static std::vector<std::pair<size_t, size_t>> resolveKeys(const std::vector<std::pair<size_t, size_t>>& mapping, DBReader<size_t>& reader) {
+    std::vector<std::pair<size_t, size_t>> resolved;
+    resolved.reserve(mapping.size());
+    size_t id = 0;
+    for (size_t i = 0; i < mapping.size(); ++i) {
+        const size_t oldKey = mapping[i].first;
+        while (id < reader.getSize() && reader.getDbKey(id) < oldKey) {
+            id++;
+        }
+        if (id >= reader.getSize() || reader.getDbKey(id) != oldKey) {
+            Debug(Debug::ERROR) << "Key " << oldKey << " not found in database\n";
+            EXIT(EXIT_FAILURE);
+        }
+        resolved.emplace_back(id, mapping[i].second);
     }
+    return resolved;
+}
+
+static bool compareByOffset(DBReader<size_t>& reader, const std::pair<size_t, size_t>& lhs, const std::pair<size_t, size_t>& rhs) {
+    return reader.getOffset(lhs.first) < reader.getOffset(rhs.first);
+}
+
+void copyEntry(size_t id, size_t newKey, DBReader<size_t>& reader, DBWriter& writer, bool isCompressed, int subDbMode, unsigned int thread_idx) {
     if (subDbMode == Parameters::SUBDB_MODE_SOFT) {
-        writer.writeIndexEntry(newKey, reader.getOffset(id), reader.getEntryLen(id), 0);
+        writer.writeIndexEntry(newKey, reader.getOffset(id), reader.getEntryLen(id), thread_idx);
     } else {
         char *data = reader.getDataUncompressed(id);
         size_t originalLength = reader.getEntryLen(id);
@@ -28,12 +59,41 @@ void copyEntry(unsigned int oldKey, unsigned int newKey, DBReader<unsigned int>&
         if (isCompressed) {
             // copy also the null byte since it contains the information if compressed or not
             entryLength = *(reinterpret_cast<unsigned int *>(data)) + sizeof(unsigned int) + 1;
-            writer.writeData(data, entryLength, newKey, 0, false, false);
+            writer.writeData(data, entryLength, newKey, thread_idx, false, false);
         } else {
-            writer.writeData(data, entryLength, newKey, 0, true, false);
+            writer.writeData(data, entryLength, newKey, thread_idx, true, false);
         }
         // do not write null byte since
-        writer.writeIndexEntry(newKey, writer.getStart(0), originalLength, 0);
+        writer.writeIndexEntry(newKey, writer.getStart(thread_idx), originalLength, thread_idx);
+    }
+}
+
+// soft mode only rewrites the index, it has to stay in one writer slot since the offsets point into the input data
+// otherwise entries are copied in the order of the input data, so that every thread reads one contiguous region
+static void copyEntries(std::vector<std::pair<size_t, size_t>>& entries, DBReader<size_t>& reader, DBWriter& writer, bool isCompressed, int subDbMode) {
+    if (subDbMode == Parameters::SUBDB_MODE_SOFT) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            copyEntry(entries[i].first, entries[i].second, reader, writer, isCompressed, subDbMode, 0);
+        }
+        return;
+    }
+
+    if (reader.isSortedByOffset() == false) {
+        SORT_PARALLEL(entries.begin(), entries.end(),
+                      [&reader](const std::pair<size_t, size_t>& lhs, const std::pair<size_t, size_t>& rhs) {
+                          return compareByOffset(reader, lhs, rhs);
+                      });
+    }
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+#pragma omp for schedule(static)
+        for (size_t i = 0; i < entries.size(); ++i) {
+            copyEntry(entries[i].first, entries[i].second, reader, writer, isCompressed, subDbMode, thread_idx);
+        }
     }
 }
 
@@ -42,29 +102,52 @@ int renamedbkeys(int argc, const char **argv, const Command &command) {
     par.parseParameters(argc, argv, command, true, 0, 0);
 
     FILE *orderFile = NULL;
-    if (FileUtil::fileExists(par.db1.c_str())) {
+    if (par.db1 == "stdin") {
+        orderFile = stdin;
+    } else if (FileUtil::fileExists(par.db1.c_str())) {
         orderFile = fopen(par.db1.c_str(), "r");
     } else {
         Debug(Debug::ERROR) << "File " << par.db1 << " does not exist.\n";
         EXIT(EXIT_FAILURE);
     }
 
+    // pairs of old and new key, sorted by the old key to merge-join them against the sorted index, lookup and mapping
+    // keys can be larger than 32 bits, e.g. to give the entries of a catalog globally unique keys
+    std::vector<std::pair<size_t, size_t>> keys;
+    char *line = NULL;
+    size_t len = 0;
+    const char *fields[2];
+    // getline malloc/reallocs automatically
+    while (getline(&line, &len, orderFile) != -1) {
+        const size_t columns = Util::getWordsOfLine(line, fields, 2);
+        if (columns < 2) {
+            Debug(Debug::WARNING) << "Not enough columns in mapping file\n";
+            continue;
+        }
+        keys.emplace_back(Util::fast_atoi<size_t>(fields[0]), Util::fast_atoi<size_t>(fields[1]));
+    }
+    free(line);
+    if (orderFile != stdin) {
+        fclose(orderFile);
+    }
+    SORT_PARALLEL(keys.begin(), keys.end(), compareByFirst);
+
     FILE* newLookupFile = NULL;
-    unsigned int mode = DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA;
+    unsigned int mode = DBReader<size_t>::USE_INDEX | DBReader<size_t>::USE_DATA;
     if (FileUtil::fileExists((par.db2 + ".lookup").c_str())) {
-        mode |= DBReader<unsigned int>::USE_LOOKUP;
+        mode |= DBReader<size_t>::USE_LOOKUP;
         newLookupFile = FileUtil::openAndDelete((par.db3 + ".lookup").c_str(), "w");
     }
-    DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str(), 1, mode);
-    reader.open(DBReader<unsigned int>::NOSORT);
+    DBReader<size_t> reader(par.db2.c_str(), par.db2Index.c_str(), par.threads, mode);
+    reader.open(DBReader<size_t>::NOSORT);
     const bool isCompressed = reader.isCompressed();
 
     FILE* newMappingFile = NULL;
     std::vector<std::pair<unsigned int, unsigned int>> mapping;
-    std::vector<std::pair<unsigned int, unsigned int>> newMapping;
+    std::vector<std::pair<size_t, unsigned int>> newMapping;
     if (FileUtil::fileExists((par.db2 + "_mapping").c_str())) {
         mapping.reserve(reader.getSize());
-        newMapping.reserve(reader.getSize());
+        newMapping.reserve(keys.size());
         bool isSorted = Util::readMapping(par.db2 + "_mapping", mapping);
         if (isSorted == false) {
             std::stable_sort(mapping.begin(), mapping.end(), compareToFirst);
@@ -73,73 +156,49 @@ int renamedbkeys(int argc, const char **argv, const Command &command) {
     }
 
     bool isHeaderCompressed = false;
-    DBReader<unsigned int>* headerReader = NULL;
+    DBReader<size_t>* headerReader = NULL;
     if (FileUtil::fileExists(par.hdr2dbtype.c_str())) {
-        headerReader = new DBReader<unsigned int>(par.hdr2.c_str(), par.hdr2Index.c_str(), 1, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
-        headerReader->open(DBReader<unsigned int>::NOSORT);
+        headerReader = new DBReader<size_t>(par.hdr2.c_str(), par.hdr2Index.c_str(), par.threads, DBReader<size_t>::USE_INDEX | DBReader<size_t>::USE_DATA);
+        headerReader->open(DBReader<size_t>::NOSORT);
         isHeaderCompressed = headerReader->isCompressed();
     }
 
-    DBWriter writer(par.db3.c_str(), par.db3Index.c_str(), 1, 0, Parameters::DBTYPE_OMIT_FILE);
+    // soft mode writes only index entries into the first slot
+    const unsigned int threads = (par.subDbMode == Parameters::SUBDB_MODE_SOFT) ? 1 : par.threads;
+    DBWriter writer(par.db3.c_str(), par.db3Index.c_str(), threads, 0, Parameters::DBTYPE_OMIT_FILE);
     writer.open();
-
-    DBWriter* headerWriter = NULL;
-    if (headerReader != NULL) {
-        headerWriter = new DBWriter(par.hdr3.c_str(), par.hdr3Index.c_str(), 1, 0, Parameters::DBTYPE_OMIT_FILE);
-        headerWriter->open();
-    }
-
-    DBReader<unsigned int>::LookupEntry* lookup = NULL;
-    std::vector<DBReader<unsigned int>::LookupEntry> newLookup;
-    if (newLookupFile != NULL) {
-        lookup = reader.getLookup();
-        newLookup.reserve(reader.getLookupSize());
+    std::vector<std::pair<size_t, size_t>> entries = resolveKeys(keys, reader);
+    copyEntries(entries, reader, writer, isCompressed, par.subDbMode);
+    // the slots of the threads are always merged into one data file
+    writer.close(true);
+    DBWriter::writeDbtypeFile(par.db3.c_str(), DBWriter::setLongKeys(reader.getDbtype(), writer.hasLongKeys()), isCompressed);
+    if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
+        DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::DATA);
     }
 
-    char *line = NULL;
-    size_t len = 0;
-    const char *fields[2];
-    // getline malloc/reallocs automatically
-    while (getline(&line, &len, orderFile) != -1) {
-        const size_t columns = Util::getWordsOfLine(line, fields, 2);
-        if (columns < 2) {
-            Debug(Debug::WARNING) << "Not enough columns in mapping file\n";
-            continue;
-        }
-        const unsigned int oldKey = Util::fast_atoi<unsigned int>(fields[0]);
-        const unsigned int newKey = Util::fast_atoi<unsigned int>(fields[1]);
-
-        copyEntry(oldKey, newKey, reader, writer, isCompressed, par.subDbMode);
-        if (lookup != NULL) {
-            unsigned int lookupId = reader.getLookupIdByKey(oldKey);
-            DBReader<unsigned int>::LookupEntry entry = lookup[lookupId];
-            entry.id = newKey;
-            newLookup.emplace_back(entry);
+    if (headerReader != NULL) {
+        DBWriter headerWriter(par.hdr3.c_str(), par.hdr3Index.c_str(), threads, 0, Parameters::DBTYPE_OMIT_FILE);
+        headerWriter.open();
+        std::vector<std::pair<size_t, size_t>> headerEntries = resolveKeys(keys, *headerReader);
+        copyEntries(headerEntries, *headerReader, headerWriter, isHeaderCompressed, par.subDbMode);
+        headerWriter.close(true);
+        DBWriter::writeDbtypeFile(par.hdr3.c_str(), DBWriter::setLongKeys(headerReader->getDbtype(), headerWriter.hasLongKeys()), isHeaderCompressed);
+        if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
+            DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::HEADER);
         }
+    }
 
-        if (mapping.size() > 0) {
-            std::pair<unsigned int, unsigned int> val;
-            val.first = oldKey;
-            std::vector<std::pair<unsigned int, unsigned int>>::iterator mappingIt;
-            mappingIt = std::upper_bound(mapping.begin(), mapping.end(), val, compareToFirst);
-            if (mappingIt != mapping.end() && mappingIt->first == val.first) {
-                val.first = newKey;
-                newMapping.emplace_back(val);
+    if (newMappingFile != NULL) {
+        size_t pos = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            while (pos < mapping.size() && mapping[pos].first < keys[i].first) {
+                pos++;
+            }
+            if (pos < mapping.size() && mapping[pos].first == keys[i].first) {
+                newMapping.emplace_back(keys[i].second, mapping[pos].second);
             }
         }
-
-        if (headerReader != NULL && headerWriter != NULL) {
-            copyEntry(oldKey, newKey, *headerReader, *headerWriter, isHeaderCompressed, par.subDbMode);
-        }
-    }
-    // merge any kind of sequence database
-    writer.close(headerWriter != NULL);
-    DBWriter::writeDbtypeFile(par.db3.c_str(), reader.getDbtype(), isCompressed);
-    if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
-        DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::DATA);
-    }
-    if (newMappingFile != NULL) {
-        SORT_PARALLEL(newMapping.begin(), newMapping.end(), compareToFirst);
+        SORT_PARALLEL(newMapping.begin(), newMapping.end(), compareNewMapping);
         std::string buffer;
         for (size_t i = 0; i < newMapping.size(); ++i) {
             buffer.append(SSTR(newMapping[i].first));
@@ -153,38 +212,54 @@ int renamedbkeys(int argc, const char **argv, const Command &command) {
     }
 
     if (newLookupFile != NULL) {
-        SORT_PARALLEL(newLookup.begin(), newLookup.end(), DBReader<unsigned int>::LookupEntry::compareById);
-        std::string lookupBuffer;
-        lookupBuffer.reserve(2048);
-        for (size_t i = 0; i < newLookup.size(); ++i) {
-            reader.lookupEntryToBuffer(lookupBuffer, newLookup[i]);
-            fwrite(lookupBuffer.c_str(), sizeof(char), lookupBuffer.size(), newLookupFile);
-            lookupBuffer.clear();
+        // the lookup is sorted by key, like the mapping it is merge-joined against the sorted keys
+        DBReader<size_t>::LookupEntry* lookup = reader.getLookup();
+        const size_t lookupSize = reader.getLookupSize();
+        std::vector<DBReader<size_t>::LookupEntry> newLookup;
+        newLookup.reserve(keys.size());
+        size_t pos = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            while (pos < lookupSize && lookup[pos].id < keys[i].first) {
+                pos++;
+            }
+            if (pos < lookupSize && lookup[pos].id == keys[i].first) {
+                newLookup.emplace_back(lookup[pos]);
+                newLookup.back().id = keys[i].second;
+            }
         }
-        fclose(newLookupFile);
-    }
+        SORT_PARALLEL(newLookup.begin(), newLookup.end(), DBReader<size_t>::LookupEntry::compareById);
 
-    if (headerWriter != NULL) {
-        headerWriter->close(true);
-        delete headerWriter;
-        DBWriter::writeDbtypeFile(par.hdr3.c_str(), headerReader->getDbtype(), isHeaderCompressed);
-        if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
-            DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::HEADER);
+        // every thread formats a contiguous block of the sorted entries, the blocks are written in order
+        std::vector<std::string> lookupBuffers(par.threads);
+#pragma omp parallel num_threads(par.threads)
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < newLookup.size(); ++i) {
+                reader.lookupEntryToBuffer(lookupBuffers[thread_idx], newLookup[i]);
+            }
         }
+        for (size_t i = 0; i < lookupBuffers.size(); ++i) {
+            fwrite(lookupBuffers[i].c_str(), sizeof(char), lookupBuffers[i].size(), newLookupFile);
+        }
+        fclose(newLookupFile);
     }
+
+    const DBFiles::Files ancillary = (DBFiles::Files) (DBFiles::SOURCE | DBFiles::TAX_MERGED | DBFiles::TAX_NAMES | DBFiles::TAX_NODES | DBFiles::TAX_BINARY | DBFiles::DICTIONARY | DBFiles::HEADER_DICTIONARY);
     if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
-        DBReader<unsigned int>::softlinkDb(par.db2, par.db3, (DBFiles::Files) (DBFiles::SOURCE | DBFiles::TAX_MERGED | DBFiles::TAX_NAMES | DBFiles::TAX_NODES | DBFiles::TAX_BINARY));
+        DBReader<unsigned int>::softlinkDb(par.db2, par.db3, ancillary);
     } else {
-        DBReader<unsigned int>::copyDb(par.db2, par.db3, (DBFiles::Files) (DBFiles::SOURCE | DBFiles::TAX_MERGED | DBFiles::TAX_NAMES | DBFiles::TAX_NODES | DBFiles::TAX_BINARY));
+        DBReader<unsigned int>::copyDb(par.db2, par.db3, ancillary);
     }
 
-    free(line);
     if (headerReader != NULL) {
         headerReader->close();
         delete headerReader;
     }
     reader.close();
-    fclose(orderFile);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,214 @@
+#include "Parameters.h"
+#include "FileUtil.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Util.h"
+#include "EntryDuplicates.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include <algorithm>
+#include <climits>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+struct MinHashSignature {
+    unsigned long long first;
+    unsigned long long second;
+    unsigned int key;
+    unsigned int id;
+
+    static bool compare(const MinHashSignature &a, const MinHashSignature &b) {
+        if (a.first != b.first) {
+            return a.first < b.first;
+        }
+        if (a.second != b.second) {
+            return a.second < b.second;
+        }
+        return a.key < b.key;
+    }
+};
+
+// two independent minima over the hashes of all k-mers of a sequence
+// sequences with a shared k-mer are likely to share the minimum and end up next to each other
+static std::vector<unsigned int> minHashOrder(DBReader<unsigned int> &reader, int kmerSize, unsigned int threads) {
+    const unsigned long long SEED_FIRST = 0x7f4a7c15ULL;
+    const unsigned long long SEED_SECOND = 0x2545f491ULL;
+    std::vector<MinHashSignature> signatures(reader.getSize());
+    Debug::Progress progress(reader.getSize());
+#pragma omp parallel num_threads(threads)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+#pragma omp for schedule(dynamic, 100)
+        for (size_t id = 0; id < reader.getSize(); ++id) {
+            progress.updateProgress();
+            const char *data = reader.getData(id, thread_idx);
+            const size_t length = reader.getSeqLen(id);
+            MinHashSignature &signature = signatures[id];
+            signature.key = reader.getDbKey(id);
+            signature.id = static_cast<unsigned int>(id);
+            if (length < static_cast<size_t>(kmerSize)) {
+                signature.first = XXH64(data, length, SEED_FIRST);
+                signature.second = XXH64(data, length, SEED_SECOND);
+                continue;
+            }
+            signature.first = ULLONG_MAX;
+            signature.second = ULLONG_MAX;
+            for (size_t pos = 0; pos + kmerSize <= length; ++pos) {
+                signature.first = std::min(signature.first, static_cast<unsigned long long>(XXH64(data + pos, kmerSize, SEED_FIRST)));
+                signature.second = std::min(signature.second, static_cast<unsigned long long>(XXH64(data + pos, kmerSize, SEED_SECOND)));
+            }
+        }
+    }
+    std::sort(signatures.begin(), signatures.end(), MinHashSignature::compare);
+
+    std::vector<unsigned int> order(signatures.size());
+    for (size_t i = 0; i < signatures.size(); ++i) {
+        order[i] = signatures[i].id;
+    }
+    return order;
+}
+
+// members of each cluster in the order of the cluster DB, entries that are not part of any cluster go last
+static std::vector<unsigned int> clusterOrder(DBReader<unsigned int> &reader, const std::string &clusterDb) {
+    DBReader<unsigned int> clusters(clusterDb.c_str(), (clusterDb + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    clusters.open(DBReader<unsigned int>::NOSORT);
+
+    std::vector<unsigned int> order;
+    order.reserve(reader.getSize());
+    std::vector<bool> placed(reader.getSize(), false);
+    size_t missing = 0;
+    char dbKey[255 + 1];
+    for (size_t i = 0; i < clusters.getSize(); ++i) {
+        char *data = clusters.getData(i, 0);
+        while (*data != '\0') {
+            Util::parseKey(data, dbKey);
+            data = Util::skipLine(data);
+            const unsigned int key = Util::fast_atoi<unsigned int>(dbKey);
+            const size_t id = reader.getId(key);
+            if (id == UINT_MAX) {
+                missing++;
+                continue;
+            }
+            if (placed[id] == false) {
+                placed[id] = true;
+                order.push_back(static_cast<unsigned int>(id));
+            }
+        }
+    }
+    clusters.close();
+    if (missing > 0) {
+        Debug(Debug::WARNING) << missing << " cluster members are not part of the sequence database\n";
+    }
+
+    for (size_t id = 0; id < reader.getSize(); ++id) {
+        if (placed[id] == false) {
+            order.push_back(static_cast<unsigned int>(id));
+        }
+    }
+    return order;
+}
+
+// copies the raw (possibly compressed) entries in the given order, the index stays sorted by key
+// entries of a deduplicated DB that share their data are written once and keep sharing it
+static void writeInOrder(DBReader<unsigned int> &reader, const std::vector<unsigned int> &order, const std::string &outDb, const std::string &outIndex) {
+    const bool isCompressed = reader.isCompressed();
+    const EntryDuplicates duplicates(reader, EntryDuplicates::isDeduplicated(reader.getDbtype()));
+    std::vector<size_t> writtenStart;
+    if (duplicates.getDuplicateCount() > 0) {
+        writtenStart.resize(reader.getSize(), SIZE_MAX);
+    }
+    DBWriter writer(outDb.c_str(), outIndex.c_str(), 1, 0, Parameters::DBTYPE_OMIT_FILE);
+    writer.open();
+    for (size_t i = 0; i < order.size(); ++i) {
+        const size_t id = order[i];
+        const unsigned int key = reader.getDbKey(id);
+        const size_t representative = duplicates.getRepresentative(id);
+        if (writtenStart.empty() == false && writtenStart[representative] != SIZE_MAX) {
+            writer.writeIndexEntry(key, writtenStart[representative], reader.getEntryLen(id), 0);
+            continue;
+        }
+        char *data = reader.getDataUncompressed(id);
+        const size_t originalLength = reader.getEntryLen(id);
+        size_t entryLength = std::max(originalLength, static_cast<size_t>(1)) - 1;
+        if (isCompressed) {
+            // copy also the null byte since it contains the information if compressed or not
+            entryLength = *(reinterpret_cast<unsigned int *>(data)) + sizeof(unsigned int) + 1;
+            writer.writeData(data, entryLength, key, 0, false, false);
+        } else {
+            writer.writeData(data, entryLength, key, 0, true, false);
+        }
+        writer.writeIndexEntry(key, writer.getStart(0), originalLength, 0);
+        if (writtenStart.empty() == false) {
+            writtenStart[representative] = writer.getStart(0);
+        }
+    }
+    writer.close(true, true);
+    DBWriter::writeDbtypeFile(outDb.c_str(), reader.getDbtype(), isCompressed);
+}
+
+int reorderdb(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.reorderMode = Parameters::REORDER_MODE_MINHASH;
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    reader.open(DBReader<unsigned int>::NOSORT);
+
+    std::vector<unsigned int> order;
+    if (par.reorderMode == Parameters::REORDER_MODE_MINHASH) {
+        if (Parameters::isEqualDbtype(reader.getDbtype(), Parameters::DBTYPE_HMM_PROFILE)) {
+            Debug(Debug::ERROR) << "--reorder-mode 1 does not support profile databases. Use --reorder-mode 2 instead.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        int kmerSize = par.kmerSize;
+        if (kmerSize == 0) {
+            kmerSize = Parameters::isEqualDbtype(reader.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES) ? 15 : 5;
+        }
+        Debug(Debug::INFO) << "Compute k-mer signatures with k = " << kmerSize << "\n";
+        order = minHashOrder(reader, kmerSize, par.threads);
+    } else if (par.reorderMode == Parameters::REORDER_MODE_CLUSTER) {
+        if (par.clusterDb.empty()) {
+            Debug(Debug::ERROR) << "--reorder-mode 2 needs a clustering result in --cluster-db.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        order = clusterOrder(reader, par.clusterDb);
+    } else {
+        order.resize(reader.getSize());
+        for (size_t id = 0; id < reader.getSize(); ++id) {
+            order[id] = static_cast<unsigned int>(id);
+        }
+    }
+
+    writeInOrder(reader, order, par.db2, par.db2Index);
+
+    // header entries are read in the same order as the sequences
+    if (FileUtil::fileExists(par.hdr1dbtype.c_str())) {
+        DBReader<unsigned int> headerReader(par.hdr1.c_str(), par.hdr1Index.c_str(), 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        headerReader.open(DBReader<unsigned int>::NOSORT);
+        std::vector<unsigned int> headerOrder;
+        headerOrder.reserve(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            const size_t headerId = headerReader.getId(reader.getDbKey(order[i]));
+            if (headerId != UINT_MAX) {
+                headerOrder.push_back(static_cast<unsigned int>(headerId));
+            }
+        }
+        writeInOrder(headerReader, headerOrder, par.hdr2, par.hdr2Index);
+        headerReader.close();
+    }
+
+    // compressed header entries are copied as they are, so they still need the dictionary they were compressed with
+    const DBFiles::Files writtenHeaderFiles = (DBFiles::Files) (DBFiles::HEADER | DBFiles::HEADER_INDEX | DBFiles::HEADER_DBTYPE | DBFiles::HEADER_FEDERATED);
+    DBReader<unsigned int>::softlinkDb(par.db1, par.db2, (DBFiles::Files) (DBFiles::SEQUENCE_ANCILLARY & ~writtenHeaderFiles));
+    reader.close();
+
+    return EXIT_SUCCESS;
+}
@@ -41,6 +41,10 @@ int splitsequence(int argc, const char **argv, const Command& command) {
 
     DBReader<unsigned int> headerReader(par.hdr1.c_str(), par.hdr1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
     headerReader.open(DBReader<unsigned int>::NOSORT);
+    OrfLocationTable orfLocations;
+    if (par.headerSplitMode == 0) {
+        orfLocations.open(par.db1, &headerReader);
+    }
 
     if (par.sequenceSplitMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT && par.compressed == true) {
         Debug(Debug::WARNING) << "Sequence split mode (--sequence-split-mode 0) and compressed (--compressed 1) can not be combined.\nTurn compressed to 0";
@@ -86,7 +90,7 @@ int splitsequence(int argc, const char **argv, const Command& command) {
             size_t from = 0;
             unsigned int dbKey = key;
             if (par.headerSplitMode == 0) {
-                loc = Orf::parseOrfHeader(header);
+                loc = orfLocations.getLocation(key, thread_idx);
                 if (loc.id != UINT_MAX) {
                     from = (loc.strand == Orf::STRAND_MINUS) ? loc.to : loc.from;
                     dbKey = loc.id;
@@ -126,6 +130,7 @@ int splitsequence(int argc, const char **argv, const Command& command) {
     }
     headerWriter.close(true);
     sequenceWriter.close(true);
+    orfLocations.close();
     headerReader.close();
     reader.close();
     if (par.sequenceSplitMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT) {
@@ -148,6 +153,7 @@ int splitsequence(int argc, const char **argv, const Command& command) {
         }
     }
     DBReader<unsigned int>::softlinkDb(par.db1, par.db2, DBFiles::SOURCE);
+    OrfLocationTable::writeTable(par.db2, par.threads);
 
     return EXIT_SUCCESS;
 }
@@ -4,6 +4,7 @@
 #include "DBReader.h"
 #include "DBWriter.h"
 #include "Matcher.h"
+#include "IntervalSet.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -50,25 +51,19 @@ int summarizeresult(int argc, const char **argv, const Command &command) {
 #endif
 
         char buffer[1024 + 32768*4];
-        std::vector<bool> covered(par.maxSeqLen + 1, false);
+        IntervalSet covered;
 
 #pragma omp for schedule(dynamic, 10)
         for (size_t i = dbFrom; i < dbFrom + dbSize; ++i) {
             progress.updateProgress();
             char *data = reader.getData(i, thread_idx);
 
-            bool readFirst = false;
+            covered.clear();
             writer.writeStart(thread_idx);
             while (*data != '\0') {
                 Matcher::result_t domain = Matcher::parseAlignmentRecord(data, true);
                 data = Util::skipLine(data);
 
-                if (readFirst == false) {
-                    covered.reserve(domain.qLen);
-                    std::fill_n(covered.begin(), domain.qLen, false);
-                    readFirst = true;
-                }
-
                 if (domain.qStartPos > static_cast<int>(domain.qLen) || domain.qEndPos > static_cast<int>(domain.qLen)) {
                     Debug(Debug::WARNING) << "Query alignment start or end is greater than query length! Skipping line.\n";
                     continue;
@@ -77,15 +72,12 @@ int summarizeresult(int argc, const char **argv, const Command &command) {
                     continue;
                 }
 
-                size_t counter = 0;
-                for (int j = std::min(domain.qStartPos, domain.qEndPos); j < std::max(domain.qStartPos, domain.qEndPos); ++j) {
-                    counter += covered[j] ? 1 : 0;
-                }
-                const float percentageOverlap = static_cast<float>(counter) / static_cast<float>(std::max(domain.qStartPos, domain.qEndPos) - std::min(domain.qStartPos, domain.qEndPos) + 1);
+                const unsigned int qStart = std::min(domain.qStartPos, domain.qEndPos);
+                const unsigned int qEnd = std::max(domain.qStartPos, domain.qEndPos);
+                const size_t counter = covered.coveredLength(qStart, qEnd);
+                const float percentageOverlap = static_cast<float>(counter) / static_cast<float>(qEnd - qStart + 1);
                 if (percentageOverlap <= par.overlap) {
-                    for (int j = std::min(domain.qStartPos, domain.qEndPos); j < std::max(domain.qStartPos, domain.qEndPos); ++j) {
-                        covered[j] = true;
-                    }
+                    covered.insert(qStart, qEnd);
                     size_t len = Matcher::resultToBuffer(buffer, domain, par.addBacktrace, false);
                     writer.writeAdd(buffer, len, thread_idx);
                 }
@@ -24,6 +24,10 @@ int translatenucs(int argc, const char **argv, const Command& command) {
         header = new DBReader<unsigned int>(par.hdr1.c_str(), par.hdr1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
         header->open(DBReader<unsigned int>::NOSORT);
     }
+    OrfLocationTable orfLocations;
+    if (addOrfStop == true) {
+        orfLocations.open(par.db1, header);
+    }
 
     size_t entries = reader.getSize();
     size_t localThreads = 1;
@@ -57,8 +61,7 @@ int translatenucs(int argc, const char **argv, const Command& command) {
             bool addStopAtStart = false;
             bool addStopAtEnd = false;
             if (addOrfStop == true) {
-                char* headData = header->getDataByDBKey(key, thread_idx);
-                Orf::SequenceLocation loc = Orf::parseOrfHeader(headData);
+                Orf::SequenceLocation loc = orfLocations.getLocation(key, thread_idx);
                 addStopAtStart=!(loc.hasIncompleteStart);
                 addStopAtEnd=!(loc.hasIncompleteEnd);
             }
@@ -107,6 +110,7 @@ int translatenucs(int argc, const char **argv, const Command& command) {
     DBReader<unsigned int>::softlinkDb(par.db1, par.db2, DBFiles::SEQUENCE_ANCILLARY);
 
     if (addOrfStop == true) {
+        orfLocations.close();
         header->close();
     }
     reader.close();
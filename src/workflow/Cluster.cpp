@@ -4,6 +4,7 @@
 #include "CommandCaller.h"
 #include "Debug.h"
 #include "FileUtil.h"
+#include "TmpSpace.h"
 
 #include "cascaded_clustering.sh.h"
 #include "nucleotide_clustering.sh.h"
@@ -197,6 +198,28 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         par.minDiagScoreThr = 0;
         par.diagonalScoring = 0;
         par.compBiasCorrection = 0;
+
+        // each cascade step writes a prefilter and an alignment result for at most all sequences,
+        // with --remove-tmp-files they are removed once the step that reads them has finished
+        const size_t sequenceDbSize = FileUtil::countLines(par.db1Index.c_str());
+        const size_t steps = static_cast<size_t>(std::max(par.clusterSteps, 1));
+        const size_t prefilterSize = TmpSpace::prefilterResultSize(sequenceDbSize, par.maxResListLen);
+        const size_t alignmentSize = TmpSpace::alignmentResultSize(sequenceDbSize, par.maxResListLen, false);
+        size_t predictedTmpSpace = 2 * prefilterSize + alignmentSize;
+        if (par.removeTmpFiles == false) {
+            predictedTmpSpace += (steps - 1) * (prefilterSize + alignmentSize);
+        }
+        // the clustering result has one line per sequence
+        const bool compressTmp = par.PARAM_COMPRESSED.wasSet == false
+                                 && TmpSpace::shouldCompress(tmpDir, predictedTmpSpace, par.db2, 12 * sequenceDbSize);
+        if (compressTmp) {
+            Debug(Debug::INFO) << "Intermediate results will be compressed\n";
+        }
+        // only the prefilter and alignment results of the steps are compressed, they never leave the tmp directory
+        const int outputCompressed = par.compressed;
+        const int tmpCompressed = compressTmp ? 1 : outputCompressed;
+
+        par.compressed = tmpCompressed;
         cmd.addVariable("PREFILTER0_PAR", par.createParameterString(par.prefilter).c_str());
         if (isUngappedMode) {
             par.rescoreMode = Parameters::RESCORE_MODE_ALIGNMENT;
@@ -205,6 +228,7 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         } else {
             cmd.addVariable("ALIGNMENT0_PAR", par.createParameterString(par.align).c_str());
         }
+        par.compressed = outputCompressed;
         cmd.addVariable("CLUSTER0_PAR", par.createParameterString(par.clust).c_str());
         par.diagonalScoring = 1;
         par.compBiasCorrection = 1;
@@ -213,6 +237,7 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         for (int step = 1; step < par.clusterSteps; step++) {
             par.sensitivity = 1.0 + sensStepSize * step;
 
+            par.compressed = tmpCompressed;
             cmd.addVariable(std::string("PREFILTER" + SSTR(step) + "_PAR").c_str(), par.createParameterString(par.prefilter).c_str());
             if (isUngappedMode) {
                 par.rescoreMode = Parameters::RESCORE_MODE_ALIGNMENT;
@@ -221,6 +246,7 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
             } else {
                 cmd.addVariable(std::string("ALIGNMENT" + SSTR(step) + "_PAR").c_str(), par.createParameterString(par.align).c_str());
             }
+            par.compressed = outputCompressed;
             cmd.addVariable(std::string("CLUSTER" + SSTR(step) + "_PAR").c_str(), par.createParameterString(par.clust).c_str());
         }
         cmd.addVariable("STEPS", SSTR(par.clusterSteps).c_str());
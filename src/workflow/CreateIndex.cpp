@@ -53,6 +53,14 @@ int createindex(Parameters &par, const Command &command, const std::string &inde
     if(flag.size() > 0){
         cmd.addVariable(flag.c_str(), "1");
     }
+    if (par.reorderMode != Parameters::REORDER_MODE_NONE) {
+        if (flag.size() > 0 || indexerModule != "indexdb") {
+            Debug(Debug::WARNING) << "--reorder-mode is only supported for amino acid and profile indices and will be ignored.\n";
+        } else {
+            cmd.addVariable("REORDER", "1");
+            cmd.addVariable("REORDER_PAR", par.createParameterString(par.reorderdb).c_str());
+        }
+    }
 
     std::string program(tmpDir + "/createindex.sh");
     FileUtil::writeFile(program, createindex_sh, createindex_sh_len);
@@ -93,7 +93,13 @@ int linclust(int argc, const char **argv, const Command& command) {
     cmd.addVariable("ALIGN_MODULE", isUngappedMode ? "rescorediagonal" : "align");
     // filter by diagonal in case of AA (do not filter for nucl, profiles, ...)
     cmd.addVariable("FILTER", Parameters::isEqualDbtype(dbType, Parameters::DBTYPE_AMINO_ACIDS) ? "1" : NULL);
+    // kmermatcher rescores its hits by Hamming distance (# 2.) while writing them, unless rescorediagonal
+    // needs options it does not support
+    if (par.wrappedScoring == false && par.sortResults == 0) {
+        par.rescoreDb = tmpDir + "/pref_rescore1";
+    }
     cmd.addVariable("KMERMATCHER_PAR", par.createParameterString(par.kmermatcher).c_str());
+    par.rescoreDb = "";
     cmd.addVariable("VERBOSITY", par.createParameterString(par.onlyverbosity).c_str());
     cmd.addVariable("VERBOSITYANDCOMPRESS", par.createParameterString(par.threadsandcompression).c_str());
 
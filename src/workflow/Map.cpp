@@ -53,9 +53,25 @@ int map(int argc, const char **argv, const Command &command) {
     CommandCaller cmd;
     cmd.addVariable("RUNNER", par.runner.c_str());
 
+    // the seed mapper is opt-in, it only handles pairs of the same sequence type
+    bool useSeedMapping = (par.mapMode == Parameters::MAP_MODE_SEED);
+    if (useSeedMapping) {
+        const int queryDbType = FileUtil::parseDbType(par.db1.c_str());
+        const int targetDbType = FileUtil::parseDbType(par.db2.c_str());
+        const bool sameType = Parameters::isEqualDbtype(queryDbType, targetDbType)
+                              && (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_AMINO_ACIDS)
+                                  || Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_NUCLEOTIDES));
+        if (sameType == false) {
+            Debug(Debug::WARNING) << "--map-mode 1 needs two amino acid or two nucleotide databases, using search instead\n";
+            useSeedMapping = false;
+        }
+    }
+    cmd.addVariable("SEED_MAPPING", useSeedMapping ? "TRUE" : NULL);
+    cmd.addVariable("KMERMAP_PAR", par.createParameterString(par.kmermap).c_str());
+
     par.mapworkflow.push_back(&(par.PARAM_ALIGNMENT_MODE));
     par.alignmentMode = 4;
-    cmd.addVariable("SEARCH_PAR", par.createParameterString(par.mapworkflow).c_str());
+    cmd.addVariable("SEARCH_PAR", par.createParameterString(par.removeParameter(par.mapworkflow, par.PARAM_MAP_MODE)).c_str());
 
     std::string program = tmpDir + "/map.sh";
     FileUtil::writeFile(program, map_sh, map_sh_len);
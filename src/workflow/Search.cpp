@@ -12,6 +12,7 @@
 #include "blastn.sh.h"
 #include "iterativepp.sh.h"
 #include "Parameters.h"
+#include "TmpSpace.h"
 
 #include <iomanip>
 #include <climits>
@@ -487,14 +488,41 @@ int search(int argc, const char **argv, const Command& command) {
                 prefilterWithoutS.push_back(par.prefilter[i]);
             }
         }
+
+        // each step writes a prefilter and an alignment result, the merge of the prefilter splits can double the former
+        // with --remove-tmp-files only the alignment results of earlier steps are still around
+        const size_t queryDbSize = FileUtil::countLines(par.db1Index.c_str());
+        const size_t steps = static_cast<size_t>(std::max(par.sensSteps, 1));
+        const size_t prefilterSize = TmpSpace::prefilterResultSize(queryDbSize, par.maxResListLen);
+        const size_t alignmentSize = TmpSpace::alignmentResultSize(queryDbSize, par.maxResListLen, par.addBacktrace);
+        size_t predictedTmpSpace = 2 * prefilterSize + (steps - 1) * alignmentSize;
+        if (par.removeTmpFiles == false) {
+            predictedTmpSpace += (steps - 1) * prefilterSize;
+        }
+        const bool compressTmp = par.PARAM_COMPRESSED.wasSet == false
+                                 && TmpSpace::shouldCompress(tmpDir, predictedTmpSpace, par.db3, alignmentSize);
+        if (compressTmp) {
+            Debug(Debug::INFO) << "Intermediate results will be compressed\n";
+        }
+
+        // prefilter results are always intermediates, alignment results only if there is more than one step
+        const int outputCompressed = par.compressed;
+        par.compressed = compressTmp ? 1 : outputCompressed;
         cmd.addVariable("PREFILTER_PAR", par.createParameterString(prefilterWithoutS).c_str());
+        cmd.addVariable("VERB_COMP_TMP_PAR", par.createParameterString(par.verbandcompression).c_str());
         if (isUngappedMode) {
             par.rescoreMode = Parameters::RESCORE_MODE_ALIGNMENT;
+            cmd.addVariable("ALIGNMENT_TMP_PAR", par.createParameterString(par.rescorediagonal).c_str());
+            par.compressed = outputCompressed;
             cmd.addVariable("ALIGNMENT_PAR", par.createParameterString(par.rescorediagonal).c_str());
             par.rescoreMode = originalRescoreMode;
         } else {
+            cmd.addVariable("ALIGNMENT_TMP_PAR", par.createParameterString(par.align).c_str());
+            par.compressed = outputCompressed;
             cmd.addVariable("ALIGNMENT_PAR", par.createParameterString(par.align).c_str());
         }
+        cmd.addVariable("TMP_COMPRESSED", (compressTmp && outputCompressed == 0) ? "TRUE" : NULL);
+        cmd.addVariable("THREADS_PAR", par.createParameterString(par.onlythreads).c_str());
         FileUtil::writeFile(tmpDir + "/blastp.sh", blastp_sh, blastp_sh_len);
         program = std::string(tmpDir + "/blastp.sh");
     }
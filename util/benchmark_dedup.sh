@@ -0,0 +1,76 @@
+#!/bin/sh -e
+# Compares createdb, search and cluster with and without --dedup on a FASTA file with identical sequences
+# Every n-th sequence of the input gets copies under new names, queries are taken from the same file
+# usage: benchmark_dedup.sh <mmseqs> <tmpDir> <fasta> [copy every n-th sequence] [copies] [query count]
+MMSEQS="$1"
+TMP="$2"
+FASTA="$3"
+EVERY="${4:-3}"
+COPIES="${5:-2}"
+QUERIES="${6:-1000}"
+
+if [ ! -x "$MMSEQS" ] || [ -z "$TMP" ] || [ ! -f "$FASTA" ]; then
+    echo "usage: $0 <mmseqs> <tmpDir> <fasta> [copy every n-th sequence] [copies] [query count]"
+    exit 1
+fi
+mkdir -p "$TMP"
+
+now() {
+    date +%s%N
+}
+
+seconds() {
+    awk -v s="$1" -v e="$2" 'BEGIN { printf "%.3f", (e - s) / 1000000000 }'
+}
+
+awk -v every="$EVERY" -v copies="$COPIES" '/^>/ { if (seq != "") { emit() } header = $0; seq = ""; n++; next }
+    { seq = seq $0 }
+    function emit() {
+        print header; print seq
+        if (n % every == 0) {
+            for (c = 0; c < copies; c++) {
+                printf(">copy%d_%d\n%s\n", c, n, seq)
+            }
+        }
+    }
+    END { if (seq != "") { emit() } }' "$FASTA" > "$TMP/input.fasta"
+awk -v queries="$QUERIES" '/^>/ { n++ } n <= queries' "$TMP/input.fasta" > "$TMP/query.fasta"
+
+# shuffling is disabled for both, so that both DBs have the same keys
+for MODE in 0 1; do
+    START=$(now)
+    "$MMSEQS" createdb "$TMP/input.fasta" "$TMP/target$MODE" --dedup "$MODE" --shuffle 0 -v 1
+    "$MMSEQS" createdb "$TMP/query.fasta" "$TMP/query$MODE" --dedup "$MODE" --shuffle 0 -v 1
+    END=$(now)
+    echo "createdb --dedup $MODE: $(seconds "$START" "$END")s, $(cat "$TMP/target$MODE" | wc -c) bytes"
+
+    rm -rf "$TMP/tmp"
+    START=$(now)
+    "$MMSEQS" search "$TMP/query$MODE" "$TMP/target$MODE" "$TMP/result$MODE" "$TMP/tmp" -v 1
+    END=$(now)
+    "$MMSEQS" convertalis "$TMP/query$MODE" "$TMP/target$MODE" "$TMP/result$MODE" "$TMP/result$MODE.m8" -v 1
+    sort "$TMP/result$MODE.m8" > "$TMP/result$MODE.sorted"
+    echo "search --dedup $MODE: $(seconds "$START" "$END")s, $(wc -l < "$TMP/result$MODE.sorted") hits"
+
+    rm -rf "$TMP/tmp"
+    START=$(now)
+    "$MMSEQS" cluster "$TMP/target$MODE" "$TMP/cluster$MODE" "$TMP/tmp" -v 1
+    END=$(now)
+    "$MMSEQS" createtsv "$TMP/target$MODE" "$TMP/target$MODE" "$TMP/cluster$MODE" "$TMP/cluster$MODE.tsv" -v 1
+    sort "$TMP/cluster$MODE.tsv" > "$TMP/cluster$MODE.sorted"
+    echo "cluster --dedup $MODE: $(seconds "$START" "$END")s, $(cut -f1 "$TMP/cluster$MODE.sorted" | sort -u | wc -l) clusters"
+done
+echo "search hits only found in one of the runs: $(comm -3 "$TMP/result0.sorted" "$TMP/result1.sorted" | wc -l)"
+echo "cluster members only found in one of the runs: $(comm -3 "$TMP/cluster0.sorted" "$TMP/cluster1.sorted" | wc -l)"
+
+rm -rf "$TMP/tmp"
+for MODE in 0 1; do
+    "$MMSEQS" rmdb "$TMP/target$MODE" -v 1
+    "$MMSEQS" rmdb "$TMP/target${MODE}_h" -v 1
+    "$MMSEQS" rmdb "$TMP/query$MODE" -v 1
+    "$MMSEQS" rmdb "$TMP/query${MODE}_h" -v 1
+    "$MMSEQS" rmdb "$TMP/result$MODE" -v 1
+    "$MMSEQS" rmdb "$TMP/cluster$MODE" -v 1
+    rm -f "$TMP/result$MODE.m8" "$TMP/result$MODE.sorted" "$TMP/cluster$MODE.tsv" "$TMP/cluster$MODE.sorted"
+done
+rm -f "$TMP/input.fasta" "$TMP/query.fasta"
@@ -0,0 +1,86 @@
+#!/bin/sh -e
+# Compares searching a federated DB against searching the concatenation of its members
+# The FASTA file is split into members that are combined once with concatdbs and once with federatedbs,
+# every member gets a precomputed index that only the federated search can use
+# usage: benchmark_federated.sh <mmseqs> <tmpDir> <fasta> [member count] [query count]
+MMSEQS="$1"
+TMP="$2"
+FASTA="$3"
+MEMBERS="${4:-4}"
+QUERIES="${5:-1000}"
+
+if [ ! -x "$MMSEQS" ] || [ -z "$TMP" ] || [ ! -f "$FASTA" ]; then
+    echo "usage: $0 <mmseqs> <tmpDir> <fasta> [member count] [query count]"
+    exit 1
+fi
+mkdir -p "$TMP"
+
+now() {
+    date +%s%N
+}
+
+seconds() {
+    awk -v s="$1" -v e="$2" 'BEGIN { printf "%.3f", (e - s) / 1000000000 }'
+}
+
+TOTAL=$(grep -c '^>' "$FASTA")
+awk -v total="$TOTAL" -v members="$MEMBERS" -v dir="$TMP" '/^>/ { n++ } { print > (dir "/member" int((n - 1) * members / total) ".fasta") }' "$FASTA"
+awk -v queries="$QUERIES" '/^>/ { n++ } n <= queries' "$FASTA" > "$TMP/query.fasta"
+"$MMSEQS" createdb "$TMP/query.fasta" "$TMP/query" -v 1
+
+START=$(now)
+MEMBER_DBS=""
+for i in $(seq 0 $((MEMBERS - 1))); do
+    "$MMSEQS" createdb "$TMP/member$i.fasta" "$TMP/member$i" -v 1
+    "$MMSEQS" createindex "$TMP/member$i" "$TMP/tmp" -v 1
+    MEMBER_DBS="$MEMBER_DBS $TMP/member$i"
+done
+END=$(now)
+echo "createdb and createindex of $MEMBERS members: $(seconds "$START" "$END")s"
+
+START=$(now)
+"$MMSEQS" cpdb "$TMP/member0" "$TMP/concat" -v 1
+"$MMSEQS" cpdb "$TMP/member0_h" "$TMP/concat_h" -v 1
+for i in $(seq 1 $((MEMBERS - 1))); do
+    "$MMSEQS" concatdbs "$TMP/concat" "$TMP/member$i" "$TMP/concat_next" --threads 1 -v 1
+    "$MMSEQS" concatdbs "$TMP/concat_h" "$TMP/member${i}_h" "$TMP/concat_next_h" --threads 1 -v 1
+    "$MMSEQS" mvdb "$TMP/concat_next" "$TMP/concat" -v 1
+    "$MMSEQS" mvdb "$TMP/concat_next_h" "$TMP/concat_h" -v 1
+done
+END=$(now)
+echo "concatdbs: $(seconds "$START" "$END")s, $(cat "$TMP"/concat | wc -c) bytes"
+
+START=$(now)
+# shellcheck disable=SC2086
+"$MMSEQS" federatedbs $MEMBER_DBS "$TMP/federated" -v 1
+END=$(now)
+echo "federatedbs: $(seconds "$START" "$END")s, $(cat "$TMP"/federated.federated | wc -c) bytes"
+
+for TARGET in concat federated; do
+    rm -rf "$TMP/tmp"
+    START=$(now)
+    "$MMSEQS" search "$TMP/query" "$TMP/$TARGET" "$TMP/result_$TARGET" "$TMP/tmp" -v 1
+    END=$(now)
+    "$MMSEQS" convertalis "$TMP/query" "$TMP/$TARGET" "$TMP/result_$TARGET" "$TMP/result_$TARGET.m8" -v 1
+    sort "$TMP/result_$TARGET.m8" > "$TMP/result_$TARGET.sorted"
+    echo "search against $TARGET: $(seconds "$START" "$END")s, $(wc -l < "$TMP/result_$TARGET.sorted") hits"
+done
+# target splits limit the hits per split, so the results can differ slightly for queries with many hits
+echo "hits only found in one of the searches: $(comm -3 "$TMP/result_concat.sorted" "$TMP/result_federated.sorted" | wc -l)"
+
+rm -rf "$TMP/tmp"
+"$MMSEQS" rmdb "$TMP/federated" -v 1
+"$MMSEQS" rmdb "$TMP/federated_h" -v 1
+"$MMSEQS" rmdb "$TMP/concat" -v 1
+"$MMSEQS" rmdb "$TMP/concat_h" -v 1
+"$MMSEQS" rmdb "$TMP/result_concat" -v 1
+"$MMSEQS" rmdb "$TMP/result_federated" -v 1
+"$MMSEQS" rmdb "$TMP/query" -v 1
+"$MMSEQS" rmdb "$TMP/query_h" -v 1
+for i in $(seq 0 $((MEMBERS - 1))); do
+    "$MMSEQS" rmdb "$TMP/member$i" -v 1
+    "$MMSEQS" rmdb "$TMP/member${i}_h" -v 1
+    "$MMSEQS" rmdb "$TMP/member$i.idx" -v 1
+    rm -f "$TMP/member$i.fasta"
+done
+rm -f "$TMP"/result_*.m8 "$TMP"/result_*.sorted "$TMP/query.fasta" "$TMP/concat_next.source"
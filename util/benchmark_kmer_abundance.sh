@@ -0,0 +1,96 @@
+#!/bin/sh -e
+# Compares prefilter throughput, index size and sensitivity for different --max-kmer-abundance values
+# on a synthetic DB of protein families that share repeated domains
+# usage: benchmark_kmer_abundance.sh <mmseqs> <tmpDir> [family count] [max k-mer abundance values...]
+MMSEQS="$1"
+TMP="$2"
+FAMILIES="${3:-2000}"
+
+if [ ! -x "$MMSEQS" ] || [ -z "$TMP" ]; then
+    echo "usage: $0 <mmseqs> <tmpDir> [family count] [max k-mer abundance values...]"
+    exit 1
+fi
+shift 2
+if [ "$#" -gt 0 ]; then
+    shift
+fi
+CAPS="${*:-0 1000 200 50}"
+mkdir -p "$TMP"
+
+now() {
+    date +%s%N
+}
+
+seconds() {
+    awk -v s="$1" -v e="$2" 'BEGIN { printf "%.3f", (e - s) / 1000000000 }'
+}
+
+# every family has 10 members mutated from a random seed at 20% of the positions
+# 5 domains of 40 residues are inserted into most members, so that their k-mers occur in thousands of sequences
+awk -v families="$FAMILIES" 'BEGIN {
+    srand(42);
+    aa = "ACDEFGHIKLMNPQRSTVWY";
+    for (d = 0; d < 5; d++) {
+        domain[d] = "";
+        for (i = 0; i < 40; i++) {
+            domain[d] = domain[d] substr(aa, int(rand() * 20) + 1, 1);
+        }
+    }
+    for (f = 0; f < families; f++) {
+        seed = "";
+        len = 150 + int(rand() * 250);
+        for (i = 0; i < len; i++) {
+            seed = seed substr(aa, int(rand() * 20) + 1, 1);
+        }
+        for (m = 0; m < 10; m++) {
+            seq = "";
+            for (i = 1; i <= len; i++) {
+                seq = seq ((rand() < 0.2) ? substr(aa, int(rand() * 20) + 1, 1) : substr(seed, i, 1));
+            }
+            if (rand() < 0.8) {
+                pos = int(rand() * len);
+                seq = substr(seq, 1, pos) domain[int(rand() * 5)] substr(seq, pos + 1);
+            }
+            printf(">fam%d_%d\n%s\n", f, m, seq);
+        }
+    }
+}' > "$TMP/synthetic.fasta"
+
+"$MMSEQS" createdb "$TMP/synthetic.fasta" "$TMP/target" -v 1
+# the first member of every family is the query
+awk '/^>/ { keep = ($0 ~ /_0$/) } keep' "$TMP/synthetic.fasta" > "$TMP/query.fasta"
+"$MMSEQS" createdb "$TMP/query.fasta" "$TMP/query" -v 1
+
+for CAP in $CAPS; do
+    rm -rf "$TMP/index"
+    mkdir -p "$TMP/index"
+    ln -sf "$TMP/target" "$TMP/index/target"
+    ln -sf "$TMP/target.index" "$TMP/index/target.index"
+    ln -sf "$TMP/target.dbtype" "$TMP/index/target.dbtype"
+    ln -sf "$TMP/target_h" "$TMP/index/target_h"
+    ln -sf "$TMP/target_h.index" "$TMP/index/target_h.index"
+    ln -sf "$TMP/target_h.dbtype" "$TMP/index/target_h.dbtype"
+    "$MMSEQS" createindex "$TMP/index/target" "$TMP/index/tmp" --max-kmer-abundance "$CAP" -v 1
+    INDEX_SIZE=$(cat "$TMP"/index/target.idx | wc -c)
+
+    # first run warms up the page cache
+    "$MMSEQS" prefilter "$TMP/query" "$TMP/index/target.idx" "$TMP/pref" -v 1
+    "$MMSEQS" rmdb "$TMP/pref" -v 1
+    START=$(now)
+    "$MMSEQS" prefilter "$TMP/query" "$TMP/index/target.idx" "$TMP/pref" -v 1
+    END=$(now)
+
+    # a hit is true if it belongs to the family of the query, other well scoring hits are caused by the shared domains
+    "$MMSEQS" createtsv "$TMP/query" "$TMP/index/target" "$TMP/pref" "$TMP/pref.tsv" -v 1
+    FOUND=$(awk -v n="$((FAMILIES * 10))" '{ split($1, q, "_"); split($2, t, "_"); if (q[1] == t[1]) { tp++ } else if ($3 > 100) { fp++ } } END { printf "%d of %d family members, %d domain hits", tp, n, fp }' "$TMP/pref.tsv")
+    echo "max-kmer-abundance $CAP: prefilter $(seconds "$START" "$END")s, index $INDEX_SIZE bytes, $FOUND"
+    "$MMSEQS" rmdb "$TMP/pref" -v 1
+    rm -f "$TMP/pref.tsv"
+done
+
+rm -rf "$TMP/index"
+"$MMSEQS" rmdb "$TMP/query" -v 1
+"$MMSEQS" rmdb "$TMP/query_h" -v 1
+"$MMSEQS" rmdb "$TMP/target" -v 1
+"$MMSEQS" rmdb "$TMP/target_h" -v 1
+rm -f "$TMP/synthetic.fasta" "$TMP/query.fasta"
@@ -0,0 +1,48 @@
+#!/bin/sh -e
+# Compares the alignment stage and the compressibility of a target DB before and after reorderdb
+# usage: benchmark_reorderdb.sh <mmseqs> <queryDB> <targetDB> <tmpDir> [reorderdb parameters]
+MMSEQS="$1"
+QUERY="$2"
+TARGET="$3"
+TMP="$4"
+shift 4
+
+if [ ! -x "$MMSEQS" ] || [ ! -f "$QUERY.dbtype" ] || [ ! -f "$TARGET.dbtype" ] || [ -z "$TMP" ]; then
+    echo "usage: $0 <mmseqs> <queryDB> <targetDB> <tmpDir> [reorderdb parameters]"
+    exit 1
+fi
+mkdir -p "$TMP"
+
+now() {
+    date +%s%N
+}
+
+seconds() {
+    awk -v s="$1" -v e="$2" 'BEGIN { printf "%.3f", (e - s) / 1000000000 }'
+}
+
+START=$(now)
+# shellcheck disable=SC2068
+"$MMSEQS" reorderdb "$TARGET" "$TMP/reordered" $@ -v 1
+END=$(now)
+echo "reorderdb: $(seconds "$START" "$END")s"
+
+# keys are stable, the same prefilter result works for both target DBs
+"$MMSEQS" prefilter "$QUERY" "$TARGET" "$TMP/pref" -v 1
+
+for DB in "$TARGET" "$TMP/reordered"; do
+    # first run warms up the page cache
+    "$MMSEQS" align "$QUERY" "$DB" "$TMP/pref" "$TMP/aln" -v 1
+    "$MMSEQS" rmdb "$TMP/aln" -v 1
+    START=$(now)
+    "$MMSEQS" align "$QUERY" "$DB" "$TMP/pref" "$TMP/aln" -v 1
+    END=$(now)
+    "$MMSEQS" rmdb "$TMP/aln" -v 1
+    SIZE=$(wc -c < "$DB")
+    GZIP_SIZE=$(gzip -c "$DB" | wc -c)
+    echo "$DB: align $(seconds "$START" "$END")s, data $SIZE bytes, gzip $GZIP_SIZE bytes ($(awk -v a="$SIZE" -v b="$GZIP_SIZE" 'BEGIN { printf "%.3f", a / b }')x)"
+done
+
+"$MMSEQS" rmdb "$TMP/pref" -v 1
+"$MMSEQS" rmdb "$TMP/reordered" -v 1
+"$MMSEQS" rmdb "$TMP/reordered_h" -v 1